@@ -0,0 +1,23 @@
+#version 450
+// Scanlines and an aperture grille, strength mixes them with the input
+layout(binding = 0) uniform sampler2D source;
+layout(push_constant) uniform PostProcess {
+    vec2 textureSize;
+    vec2 outputSize;
+    float strength;
+} pc;
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 texel = fragTexCoord * pc.textureSize;
+    // Rows stay sharp, the bilinear sampler blurs along them like a beam
+    vec4 color = texture(source, vec2(texel.x, floor(texel.y) + 0.5) /
+                                 pc.textureSize);
+    float scanline = mix(0.5, 1.0, sin(fract(texel.y) * 3.14159265));
+    vec3 mask = vec3(0.7);
+    mask[int(gl_FragCoord.x) % 3] = 1.0;
+    outColor = vec4(mix(color.rgb, color.rgb * scanline * mask, pc.strength),
+                    color.a);
+}
@@ -0,0 +1,18 @@
+#version 450
+// LCD ghosting, history is this pass's own output from the last frame and
+// strength how much of it is left
+layout(binding = 0) uniform sampler2D source;
+layout(binding = 1) uniform sampler2D history;
+layout(push_constant) uniform PostProcess {
+    vec2 textureSize;
+    vec2 outputSize;
+    float strength;
+} pc;
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = mix(texture(source, fragTexCoord),
+                   texture(history, fragTexCoord), pc.strength);
+}
@@ -0,0 +1,8 @@
+#version 450
+// One triangle covering the whole target, no vertex buffer needed
+layout(location = 0) out vec2 fragTexCoord;
+
+void main() {
+    fragTexCoord = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(fragTexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 450
+// Darkens the edges between Gameboy pixels, strength is how dark
+layout(binding = 0) uniform sampler2D source;
+layout(push_constant) uniform PostProcess {
+    vec2 textureSize;
+    vec2 outputSize;
+    float strength;
+} pc;
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 texel = fragTexCoord * pc.textureSize;
+    vec4 color = texture(source, (floor(texel) + 0.5) / pc.textureSize);
+    // Distance to the closest cell edge in output pixels, so the line is
+    // about one pixel wide at any scale
+    vec2 edge = min(fract(texel), 1.0 - fract(texel)) *
+                (pc.outputSize / pc.textureSize);
+    float line = 1.0 - smoothstep(0.0, 1.0, min(edge.x, edge.y));
+    outColor = vec4(color.rgb * (1.0 - pc.strength * line), color.a);
+}
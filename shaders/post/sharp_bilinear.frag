@@ -0,0 +1,22 @@
+#version 450
+// Integer scale sharp bilinear: nearest neighbour inside a texel, bilinear
+// only across the part of an output pixel the integer scale leaves over
+layout(binding = 0) uniform sampler2D source;
+layout(push_constant) uniform PostProcess {
+    vec2 textureSize;
+    vec2 outputSize;
+    float strength;
+} pc;
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 scale = max(floor(pc.outputSize / pc.textureSize), vec2(1.0));
+    vec2 texel = fragTexCoord * pc.textureSize;
+    vec2 region = 0.5 - 0.5 / scale;
+    vec2 center_distance = fract(texel) - 0.5;
+    vec2 blend = (center_distance -
+                  clamp(center_distance, -region, region)) * scale + 0.5;
+    outColor = texture(source, (floor(texel) + blend) / pc.textureSize);
+}
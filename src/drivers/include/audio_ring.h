@@ -0,0 +1,82 @@
+// Purpose: This header file contains the following
+//  * Single producer / single consumer lock free ring
+//  * Dynamic rate control for the audio output
+//
+// The emulator thread produces samples, the audio callback consumes them.
+// Neither side ever waits on the other or allocates, the callback can't be
+// allowed to block.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace binary {
+template <typename T, size_t k_Capacity>
+class SpscRing {
+  static_assert(std::has_single_bit(k_Capacity),
+                "the ring capacity has to be a power of two");
+  static_assert(std::is_trivially_copyable_v<T>);
+  static constexpr size_t k_Mask = k_Capacity - 1;
+
+ public:
+  // Producer side, copies as many of k_Count items as fit and returns how
+  // many that were
+  size_t Push(const T* data, const size_t k_Count) {
+    const size_t k_Head = head_.load(std::memory_order_relaxed);
+    const size_t k_Tail = tail_.load(std::memory_order_acquire);
+    const size_t k_Pushed = std::min(k_Count, k_Capacity - (k_Head - k_Tail));
+    const size_t k_Start = k_Head & k_Mask;
+    const size_t k_First = std::min(k_Pushed, k_Capacity - k_Start);
+    std::memcpy(&buffer_[k_Start], data, k_First * sizeof(T));
+    std::memcpy(&buffer_[0], data + k_First, (k_Pushed - k_First) * sizeof(T));
+    head_.store(k_Head + k_Pushed, std::memory_order_release);
+    return k_Pushed;
+  }
+
+  // Consumer side, same thing the other way around
+  size_t Pop(T* data, const size_t k_Count) {
+    const size_t k_Tail = tail_.load(std::memory_order_relaxed);
+    const size_t k_Head = head_.load(std::memory_order_acquire);
+    const size_t k_Popped = std::min(k_Count, k_Head - k_Tail);
+    const size_t k_Start = k_Tail & k_Mask;
+    const size_t k_First = std::min(k_Popped, k_Capacity - k_Start);
+    std::memcpy(data, &buffer_[k_Start], k_First * sizeof(T));
+    std::memcpy(data + k_First, &buffer_[0], (k_Popped - k_First) * sizeof(T));
+    tail_.store(k_Tail + k_Popped, std::memory_order_release);
+    return k_Popped;
+  }
+
+  // Either side, only a snapshot while the other one keeps going
+  size_t Size() const {
+    const size_t k_Tail = tail_.load(std::memory_order_acquire);
+    return head_.load(std::memory_order_acquire) - k_Tail;
+  }
+  static constexpr size_t Capacity() { return k_Capacity; }
+
+ private:
+  // Each index on its own cache line so the two threads don't fight over it
+  alignas(64) std::atomic<size_t> head_{};
+  alignas(64) std::atomic<size_t> tail_{};
+  alignas(64) std::array<T, k_Capacity> buffer_{};
+};
+
+// The emulator and the sound card run off different clocks, so the ring
+// slowly fills up or runs dry no matter how exact the emulation is. Instead
+// of dropping or repeating whole blocks, the producer resamples at a ratio
+// nudged towards keeping the ring half full, small enough that the pitch
+// change can't be heard.
+// Reference: H. K. Arntzen, Dynamic Rate Control for Retro Game Emulators
+constexpr double k_MaxRateDelta = 0.005;
+
+// Returns the ratio to multiply the output sample rate by, 1 + k_MaxRateDelta
+// on an empty ring down to 1 - k_MaxRateDelta on a full one
+constexpr double RateRatio(const size_t k_Filled, const size_t k_Capacity) {
+  const double k_Fill = std::min(
+      static_cast<double>(k_Filled) / static_cast<double>(k_Capacity), 1.0);
+  return 1.0 + (1.0 - 2.0 * k_Fill) * k_MaxRateDelta;
+}
+}  // namespace binary
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <SDL.h>
+#include "audio_ring.h"
+namespace binary {
+// Audio output through an SDL audio device, interleaved signed 16 bit stereo.
+// The emulator thread calls Push() and RateRatio(), everything else is for
+// the thread owning the device.
+class AudioSDL {
+ public:
+  static constexpr int k_DefaultSampleRate = 48'000;
+  static constexpr int k_Channels = 2;
+  // Sample frames SDL asks the callback for at a time
+  static constexpr uint16_t k_DeviceFrames = 512;
+  // Interleaved samples, 4096 frames is about 85 ms at 48 kHz. Rate control
+  // keeps it half full, which is the latency on top of the device's buffer.
+  static constexpr size_t k_RingSamples = 8192;
+
+  bool Open(const int k_SampleRate);
+  void Close();
+  // Queues up to k_Frames sample frames, returns how many fit
+  size_t Push(const int16_t* samples, const size_t k_Frames);
+  // What the producer should scale its sample rate by right now
+  double RateRatio() const;
+  inline int SampleRate() const { return sample_rate_; }
+  inline uint64_t Underruns() const {
+    return underruns_.load(std::memory_order_relaxed);
+  }
+  ~AudioSDL();
+
+ private:
+  // Runs on SDL's audio thread
+  static void Callback(void* user_data, Uint8* stream, int length);
+
+  SDL_AudioDeviceID device_{};
+  int sample_rate_{};
+  std::atomic<uint64_t> underruns_{};
+  SpscRing<int16_t, k_RingSamples> ring_{};
+};
+}  // namespace binary
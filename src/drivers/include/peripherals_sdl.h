@@ -5,6 +5,7 @@
 #include "imgui_internal.h"
 #include "../../main/include/gbengine.h"
 #include "../../types/include/enums.h"
+#include "audio_sdl.h"
 #include <SDL.h>
 #include <SDL_vulkan.h>
 #include <SDL_opengl.h>
@@ -27,9 +28,12 @@ class SDL {
   SDL_Surface* surface_{};
   SDL_Texture* texture_{};
   SDL_Renderer* renderer_{};
+  AudioSDL audio_;
   void LoadApplicationIcon();
   void Init(Application app);
   void PoolEvents(bool* running);
+  // Of the display the window is on, 0 when SDL can't tell
+  int RefreshRate();
   SDL(Application app);
   void InitTextureFromPath(const char* path_to_texture);
   void GetTextureDimensions(uint32_t* width,uint32_t* height);
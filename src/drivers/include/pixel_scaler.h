@@ -0,0 +1,59 @@
+// Purpose: This header file contains the following
+//  * Palette expansion and integer nearest neighbour upscaling on the CPU
+//
+// For the renderers without a GPU doing it for them. Indexed frames are
+// expanded and scaled in one pass: every source row is expanded and widened
+// straight into the first of its output rows, the other output rows are
+// copies of that one. AVX2 widens 8 pixels per step with a gather and one
+// permute per output vector, SSSE3 4 pixels with a byte shuffle, and plain
+// C++ does whatever is left at the end of a row.
+//
+// On x86-64 both SIMD kernels are always compiled, with target attributes
+// instead of -mavx2/-mssse3 for the whole build, and the fastest one the CPU
+// has is picked at runtime.
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || (defined(_M_X64) && !defined(_M_ARM64EC))
+#define BINARY_SCALER_X64
+#endif
+
+namespace binary {
+constexpr uint32_t k_MaxScale = 6;
+
+// RGBA colours in memory order, one uint32_t per entry so a pixel is a
+// single load and store
+typedef std::array<uint32_t, 256> PixelPalette;
+
+enum class ScalerKernel : uint8_t { k_Scalar, k_Ssse3, k_Avx2 };
+
+extern uint32_t PackColor(const std::array<uint8_t, 4>& color);
+extern bool ScalerKernelSupported(const ScalerKernel k_Kernel);
+// The fastest supported kernel, what ScaleIndexed() uses
+extern ScalerKernel BestScalerKernel();
+
+// Expands k_Width x k_Height palette indices to RGBA and scales them by
+// k_Scale, 1 to k_MaxScale, into output. k_Pitch is the bytes from one output
+// row to the next, at least k_Width * k_Scale * 4. Nothing past the scaled
+// width of a row is written.
+extern void ScaleIndexed(const uint8_t* indices, const uint32_t k_Width,
+                         const uint32_t k_Height, const PixelPalette& palette,
+                         const uint32_t k_Scale, uint8_t* output,
+                         const size_t k_Pitch);
+// ScaleIndexed() with a kernel of the caller's choosing, it has to be
+// supported by this CPU
+extern void ScaleIndexedWith(const ScalerKernel k_Kernel,
+                             const uint8_t* indices, const uint32_t k_Width,
+                             const uint32_t k_Height,
+                             const PixelPalette& palette,
+                             const uint32_t k_Scale, uint8_t* output,
+                             const size_t k_Pitch);
+// The same one pixel at a time, what the SIMD versions are tested against
+extern void ScaleIndexedScalar(const uint8_t* indices, const uint32_t k_Width,
+                               const uint32_t k_Height,
+                               const PixelPalette& palette,
+                               const uint32_t k_Scale, uint8_t* output,
+                               const size_t k_Pitch);
+}  // namespace binary
@@ -2,8 +2,36 @@
 #include "peripherals_sdl.h"
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
+#include <vector>
+#include "vk_mem_alloc.h"
 
 namespace binary {
+// Anything that streams data to the GPU every frame. Vulkan calls every
+// registered uploader while recording a frame's command buffer, ahead of the
+// render pass, so the copies are part of that frame's submission and fenced
+// by its in_flight_fence_.
+class VulkanUploader {
+ public:
+  virtual void RecordUploads(VkCommandBuffer command_buffer,
+                             uint32_t frame) = 0;
+  virtual ~VulkanUploader() = default;
+};
+
+// Runs the renderer's post-processing chain on an image the GUI shows
+// instead of on the renderer's own texture, see
+// renderer_vulkan_postprocess.cpp
+class VulkanPostProcessor {
+ public:
+  // The image the chain reads from the next frame on, in
+  // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL when it's sampled.
+  // VK_NULL_HANDLE before the view is destroyed.
+  virtual void SetPostProcessSource(VkImageView view, VkExtent2D extent) = 0;
+  // ImGui texture of the chain's output for the frame being recorded next,
+  // VK_NULL_HANDLE when there are no passes or no source
+  virtual VkDescriptorSet PostProcessOutput() = 0;
+  virtual ~VulkanPostProcessor() = default;
+};
+
 // Vulkan graphic device commuication struct
 typedef struct gbVulkanGraphicsHandler {
   VkPhysicalDevice* physical_device;
@@ -13,6 +41,15 @@ typedef struct gbVulkanGraphicsHandler {
   VkDescriptorPool* descriptor_pool;
   VkDescriptorPool* imgui_pool; 
   VkDescriptorSetLayout* descriptor_set_layout;
+  // Frame being recorded next and the fences guarding each frame in flight
+  uint32_t* current_frame;
+  std::vector<VkFence>* in_flight_fence;
+  std::vector<VulkanUploader*>* uploaders;
+  // Where buffers and images get their memory from, see Vulkan::CreateBuffer
+  VmaAllocator* vma_allocator;
+  VmaPool* staging_pool;
+  VkPipelineCache* pipeline_cache;
+  VulkanPostProcessor* post_processor;
 } gbVulkanGraphicsHandler;
 
 class Renderer {
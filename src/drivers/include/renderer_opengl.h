@@ -1,20 +1,45 @@
 #pragma once
 #include "../include/renderer.h"
 #include "imgui_impl_opengl3.h"
-#include <gl/GL.h>
+#include <SDL_opengl.h>
 namespace binary {
-class OpenGL : public Renderer{ 
+// Everything past OpenGL 1.1 that the renderer and OpenGLViewport call, loaded
+// through SDL once the context exists. buffer_storage is only loaded when the
+// context has ARB_buffer_storage (core in 4.4), nullptr otherwise.
+typedef struct gbOpenGLFunctions {
+  PFNGLGENBUFFERSPROC gen_buffers;
+  PFNGLDELETEBUFFERSPROC delete_buffers;
+  PFNGLBINDBUFFERPROC bind_buffer;
+  PFNGLBUFFERDATAPROC buffer_data;
+  PFNGLBUFFERSTORAGEPROC buffer_storage;
+  PFNGLMAPBUFFERRANGEPROC map_buffer_range;
+  PFNGLUNMAPBUFFERPROC unmap_buffer;
+  PFNGLFENCESYNCPROC fence_sync;
+  PFNGLCLIENTWAITSYNCPROC client_wait_sync;
+  PFNGLDELETESYNCPROC delete_sync;
+} gbOpenGLFunctions;
+
+class OpenGL : public Renderer {
  public:
-  OpenGL(SDL* sdl);
+  OpenGL(SDL* sdl, Application app);
+  // Headless, renders into a hidden app.width x app.height window of its own
+  // without ImGui. For tests and benchmarks on machines with a GL driver,
+  // llvmpipe works.
+  explicit OpenGL(Application app);
+  ~OpenGL();
   void DrawFrame();
+  const gbOpenGLFunctions* GetFunctions() const { return &functions_; }
 
  private:
-  void Init(SDL* sdl);
+  void Init(SDL_Window* window);
+  void LoadFunctions();
   void InitIMGUI();
+  bool headless_ = false;
   SDL_GLContext context_{};
-  int width_;
-  int height_;
-  SDL* sdl_;
-  SDL_Window* window_;
+  gbOpenGLFunctions functions_{};
+  int width_{};
+  int height_{};
+  SDL* sdl_{};
+  SDL_Window* window_{};
 };
 }
@@ -0,0 +1,18 @@
+#pragma once
+#include "../include/renderer.h"
+#include "imgui_impl_sdlrenderer2.h"
+namespace binary {
+// Draws through the SDL_Renderer SDL::Init() creates, which is a software
+// rasterizer when there's nothing better. The emulator's frames are expanded
+// and scaled on the CPU by SDLViewport, so presenting is a plain copy.
+class SDLRenderer : public Renderer {
+ public:
+  SDLRenderer(SDL* sdl);
+  ~SDLRenderer();
+  void DrawFrame();
+
+ private:
+  void InitIMGUI();
+  SDL* sdl_;
+};
+}
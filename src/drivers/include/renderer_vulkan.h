@@ -1,5 +1,6 @@
 // File: renderer_vulkan.h
 #pragma once
+#include <algorithm>
 #include <array>
 #include <string>
 #include <cstdint>
@@ -17,21 +18,13 @@
 #include "spdlog/spdlog.h"
 #include "peripherals_sdl.h"
 #include "renderer.h"
+#include "renderer_vulkan_upload.h"
 
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_vulkan.h"
 #include "imgui_internal.h"
 namespace binary {
-// If I don't make these function inline the command buffer stops
-// recording when returning for no reason.
-
-extern inline VkCommandBuffer BeginSingleTimeCommands(
-    VkCommandPool command_pool, VkDevice logical_device);
-extern inline void EndSingleTimeCommands(VkCommandBuffer command_buffer,
-                                         VkCommandPool command_pool,
-                                         VkDevice logical_device,
-                                         VkQueue queue);
 typedef struct UniformBufferObject {
   glm::mat4 model;
   glm::mat4 view;
@@ -91,12 +84,21 @@ typedef struct QueueFamilyIndices {
   }
 } QueueFamilyIndices;
 
-class Vulkan : public Renderer {
+class Vulkan : public Renderer, public VulkanPostProcessor {
  public:
   Vulkan(SDL* sdl, Application app);
+  // Headless, no window, surface or swapchain. Frames are rendered into
+  // app.width x app.height offscreen images and copied back to the host, so
+  // it runs on software rasterizers like lavapipe. No ImGui either.
+  explicit Vulkan(Application app);
   ~Vulkan();
   void DrawFrame();
+  // Headless only, waits for the last DrawFrame() and returns its RGBA8
+  // pixels, valid until the next DrawFrame()
+  const uint8_t* ReadBack();
   gbVulkanGraphicsHandler GetGraphicsHandler();
+  void SetPostProcessSource(VkImageView view, VkExtent2D extent) override;
+  VkDescriptorSet PostProcessOutput() override;
  private:
   const std::vector<const char*> validation_layers = {
       "VK_LAYER_KHRONOS_validation"};
@@ -137,11 +139,32 @@ class Vulkan : public Renderer {
     std::vector<VkSemaphore> render_finished_;
   } Semaphore;
 
+  // A post-processing pass renders into one of these, see
+  // renderer_vulkan_postprocess.cpp
+  typedef struct PostProcessTarget {
+    VkImage image_{};
+    VmaAllocation allocation_{};
+    VkImageView view_{};
+    VkFramebuffer frame_buffer_{};
+  } PostProcessTarget;
+
+  typedef struct PostProcessStage {
+    VkPipeline pipeline_{};
+    float strength_ = 0.0f;
+    // Reads its own output from the last frame
+    bool history_ = false;
+    // Per frame in flight, the target it reads, the one it writes and the
+    // set with its inputs
+    std::array<uint32_t, k_MaxFramesInFlight> input_{};
+    std::array<uint32_t, k_MaxFramesInFlight> target_{};
+    std::array<VkDescriptorSet, k_MaxFramesInFlight> descriptor_sets_{};
+  } PostProcessStage;
+
   typedef struct Buffer {
     VkBuffer vertex_;
     VkBuffer index_;
-    VkDeviceMemory vertex_memory_;
-    VkDeviceMemory index_memory_;
+    VmaAllocation vertex_allocation_;
+    VmaAllocation index_allocation_;
   } Buffer;
 
   // Command Buffers
@@ -150,7 +173,11 @@ class Vulkan : public Renderer {
 
   // Graphic Pipeline
   VkPipelineLayout pipeline_layout_;
+  // Kept on disk between runs, see SavePipelineCache()
+  static constexpr const char* k_PipelineCachePath =
+      "cache/vulkan_pipeline_cache.bin";
   VkPipelineCache pipeline_cache_;
+  bool pipeline_feedback_supported_ = false;
   VkPipeline graphics_pipeline_;
   VkRenderPass render_pass_;
   // Extensions and validation layers
@@ -179,20 +206,53 @@ class Vulkan : public Renderer {
   VkFence in_flight_fences_{};
 
   bool frame_buffer_resized_ = false;
+  // From binary_config.yaml, ChooseSwapPresentMode() falls back to FIFO
+  // when the surface doesn't support it
+  VkPresentModeKHR present_mode_ = VK_PRESENT_MODE_FIFO_KHR;
+
+  // Headless mode, swap_chain_.images_ are k_MaxFramesInFlight offscreen
+  // images instead, one readback slot each
+  bool headless_ = false;
+  std::vector<VmaAllocation> offscreen_allocations_;
+  VkBuffer readback_buffer_{};
+  VmaAllocation readback_allocation_{};
+  uint8_t* readback_mapped_{};
+  uint32_t last_frame_ = 0;
   Buffer buffer_{};
 
   // Descriptor Sets
   std::vector<VkDescriptorSet> descriptor_sets_;
 
+  // Recorded into every frame before the render pass
+  std::vector<VulkanUploader*> uploaders_;
+
+  // Post-processing chain from binary_config.yaml, run before the render
+  // pass on the image a VulkanViewport set with SetPostProcessSource(). The
+  // targets are allocated once per swapchain size and the descriptor sets
+  // with them, the sets are only written again when the source changes.
+  std::vector<PostProcessPass> post_process_passes_;
+  std::vector<PostProcessStage> post_process_stages_;
+  std::vector<PostProcessTarget> post_process_targets_;
+  VkRenderPass post_process_render_pass_{};
+  VkDescriptorSetLayout post_process_set_layout_{};
+  VkPipelineLayout post_process_pipeline_layout_{};
+  VkDescriptorPool post_process_descriptor_pool_{};
+  VkSampler post_process_sampler_{};
+  VkImageView post_process_source_{};
+  VkExtent2D post_process_source_extent_{};
+  // ImGui textures of the last target, made on first use since ImGui starts
+  // after the targets are created
+  std::array<VkDescriptorSet, k_MaxFramesInFlight> post_process_outputs_{};
+
   // Textures
   VkImage texture_image_{};
-  VkDeviceMemory texture_image_memory_{};
+  VmaAllocation texture_image_allocation_{};
   VkImageView texture_image_view_{};
   VkSampler texture_sampler_{};
 
   // Uniform Buffers
   std::vector<VkBuffer> uniform_buffer_;
-  std::vector<VkDeviceMemory> uniform_buffer_memory_;
+  std::vector<VmaAllocation> uniform_buffer_allocation_;
   std::vector<void*> uniform_buffer_mapped_;
 
   // Class pointers
@@ -209,12 +269,23 @@ class Vulkan : public Renderer {
   // Imgui stuff 
 	VkDescriptorPool imgui_pool_;
 
+  // Every buffer and image is suballocated from here. Staging buffers and
+  // the per frame uniform buffers get their own pools of host visible memory
+  // so they don't fragment the device local blocks.
+  VmaAllocator vma_allocator_{};
+  VmaPool staging_pool_{};
+  VmaPool uniform_pool_{};
+  bool memory_budget_supported_ = false;
+  // min(loader, VK_API_VERSION_1_3) after the instance is created, then
+  // lowered to the physical device's version once one is picked
+  uint32_t api_version_ = VK_API_VERSION_1_0;
+
   bool IsPhysicalDeviceSuitable(VkPhysicalDevice physical_device);
 
   void CreateImage(uint32_t width, uint32_t height, VkFormat format,
                    VkImageTiling tiling, VkImageUsageFlags usage,
                    VkMemoryPropertyFlags properties, VkImage& image,
-                   VkDeviceMemory& image_memory);
+                   VmaAllocation& image_allocation);
 
   void InitVulkanInstance(SDL_Window* window_, Application app);
   void SetupDebugMessenger();
@@ -222,6 +293,13 @@ class Vulkan : public Renderer {
   void PickPhysicalDevice();
   void CreateLogicalDevice();
   void CreateSwapChain(SDL_Window* window_);
+  void CreateOffscreenTarget();
+  void DestroyOffscreenTarget();
+  void CreateHeadlessTextureImage(UploadBatch& uploads);
+  void DrawOffscreenFrame();
+  void RecordReadBack(VkCommandBuffer command_buffer, uint32_t image_index);
+  // VK_KHR_swapchain unless headless
+  std::vector<const char*> RequiredDeviceExtensions();
   void CreateImageViews();
   void CreateGraphicsPipeline();
   void CreateRenderPass();
@@ -233,20 +311,44 @@ class Vulkan : public Renderer {
   void CleanUpSwapChain();
   void CreateDescriptorPool();
   void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
-  void CreateIndexBuffer();
-  void CreateVertexBuffer();
+  void CreateIndexBuffer(UploadBatch& uploads);
+  void CreateVertexBuffer(UploadBatch& uploads);
   void CreateDescriptorSetLayout();
   void CreateUniformBuffers();
   void CreatePipelineCache();
+  // Empty when there's no cache on disk or it's from another device/driver
+  std::vector<char> LoadPipelineCacheData(
+      const VkPhysicalDeviceProperties& properties);
+  void SavePipelineCache();
+  // vkCreateGraphicsPipelines() through pipeline_cache_, logs how long it
+  // took and whether the cache hit
+  VkResult CreateCachedGraphicsPipeline(
+      const char* name, VkGraphicsPipelineCreateInfo& pipeline_info,
+      VkPipeline* pipeline);
   void CreateDescriptorSets();
+  // Pipelines for the configured passes, unknown shaders are skipped
+  void CreatePostProcessPipelines();
+  void DestroyPostProcessPipelines();
+  // Targets and descriptor sets at swapchain size
+  void CreatePostProcessTargets();
+  void DestroyPostProcessTargets();
+  // Points the first pass at post_process_source_, the others at the
+  // targets they read
+  void WritePostProcessDescriptorSets();
+  void RecordPostProcess(VkCommandBuffer command_buffer);
   void CreateTextureImageView();
-  void CreateTextureImage(const char* image_path);
+  void CreateTextureImage(const char* image_path, UploadBatch& uploads);
   void CreateTextureSampler();
+  // pool overrides properties. A non null mapped gets the persistently
+  // mapped address of a host visible buffer.
   void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                     VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                    VkDeviceMemory& buffer_memory);
-  void CopyBuffer(VkBuffer source_buffer, VkBuffer destination_buffer,
-                  VkDeviceSize size);
+                    VmaAllocation& buffer_allocation,
+                    VmaPool pool = VK_NULL_HANDLE, void** mapped = nullptr);
+  void CreateAllocator();
+  VmaPool CreateHostVisiblePool(VkBufferUsageFlags usage,
+                                VkDeviceSize block_size);
+  void DestroyAllocator();
   uint32_t FindMemoryType(uint32_t type_filter,
                           VkMemoryPropertyFlags properties);
   uint64_t RateDeviceSuitability(VkPhysicalDevice physical_device);
@@ -263,11 +365,6 @@ class Vulkan : public Renderer {
   void DestroyDebugUtilsMessengerEXT(VkInstance instance_,
                                      VkDebugUtilsMessengerEXT debugMessenger,
                                      const VkAllocationCallbacks* pAllocator);
-  void TransitionImageLayout(VkImage image, VkFormat format,
-                             VkImageLayout old_layout,
-                             VkImageLayout new_layout);
-  void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
-                         uint32_t height);
   QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physical_device);
   bool CheckDeviceExtensionSupport(VkPhysicalDevice physical_device);
 
@@ -291,7 +388,8 @@ class Vulkan : public Renderer {
   void _FreeImage();
   void _DestoryImage();
   void CreateTextureDescriptorSet();
+  // Only records the upload, the texture is ready after uploads.Submit()
   void LoadImageFromArray(void* image_data, VkDeviceSize image_size, uint32_t w,
-                          uint32_t h);
+                          uint32_t h, UploadBatch& uploads);
 };
 }  // namespace binary
\ No newline at end of file
@@ -0,0 +1,56 @@
+// File: renderer_vulkan_upload.h
+#pragma once
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "vk_mem_alloc.h"
+namespace binary {
+// Block size of the renderer's staging pool. Anything bigger than a block
+// gets a dedicated allocation instead, it could never fit in the pool.
+inline constexpr VkDeviceSize k_StagingBlockSize = 16ull * 1024 * 1024;
+
+// Records every copy and layout transition of a group of uploads into one
+// command buffer, Submit() then costs a single submit and fence wait no
+// matter how many textures and buffers went in. Staging memory comes from
+// the staging pool and lives until Submit().
+//
+// Nothing recorded here is on the GPU before Submit() returns, so resources
+// can't be drawn with until then. Destroying an unsubmitted batch submits it.
+class UploadBatch {
+ public:
+  UploadBatch(VkDevice logical_device, VkCommandPool command_pool,
+              VkQueue queue, VmaAllocator vma_allocator,
+              VmaPool staging_pool);
+  ~UploadBatch();
+  UploadBatch(const UploadBatch&) = delete;
+  UploadBatch& operator=(const UploadBatch&) = delete;
+  // The moved from batch is left empty, destroying it submits nothing
+  UploadBatch(UploadBatch&& other) noexcept;
+
+  // Fills an RGBA8 image with pixels and leaves it in
+  // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. The old contents are discarded,
+  // the image may be a fresh one or one earlier frames sampled.
+  void UploadImage(VkImage image, uint32_t width, uint32_t height,
+                   const void* pixels, VkDeviceSize size);
+  // Same as UploadImage() with an all black image, nothing to stage
+  void ClearImage(VkImage image);
+  void UploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size);
+  void Submit();
+
+ private:
+  VkCommandBuffer Begin();
+  VkBuffer Stage(const void* data, VkDeviceSize size);
+  void Transition(VkImage image, VkImageLayout old_layout,
+                  VkImageLayout new_layout);
+
+  VkDevice logical_device_;
+  VkCommandPool command_pool_;
+  VkQueue queue_;
+  VmaAllocator vma_allocator_;
+  VmaPool staging_pool_;
+  VkCommandBuffer command_buffer_ = VK_NULL_HANDLE;
+  std::vector<std::pair<VkBuffer, VmaAllocation>> staging_buffers_;
+  // Uploads recorded since the last Submit(), for the log
+  uint32_t uploads_ = 0;
+};
+}  // namespace binary
@@ -1,17 +1,132 @@
 #include "../include/renderer_opengl.h"
-binary::OpenGL::OpenGL(SDL* sdl) { 
-  Init(sdl);
+namespace {
+// OpenGL 3.3 core, anything llvmpipe, a thin client's iGPU or Mesa's other
+// drivers offer. ARB_buffer_storage is optional on top of it.
+constexpr int k_GLMajorVersion = 3;
+constexpr int k_GLMinorVersion = 3;
+
+template <typename Function>
+Function LoadFunction(const char* name) {
+  Function function = reinterpret_cast<Function>(SDL_GL_GetProcAddress(name));
+  if (function == nullptr) {
+    spdlog::critical("Failed to load the OpenGL function {}", name);
+    throw std::runtime_error(std::string("failed to load the OpenGL function ")
+                             + name);
+  }
+  return function;
+}
+}  // namespace
+
+binary::OpenGL::OpenGL(SDL* sdl, Application app) {
+  sdl_ = sdl;
+  Init(sdl_->window_);
+  // There's no mailbox in OpenGL, without vsync the frame pacer keeps the
+  // frame rate down instead
+  if (SDL_GL_SetSwapInterval(app.present_mode == k_PresentFifo ? 1 : 0) != 0) {
+    spdlog::warn("Failed to set the swap interval: {}", SDL_GetError());
+  }
   InitIMGUI();
 }
+
+binary::OpenGL::OpenGL(Application app) {
+  headless_ = true;
+  if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
+    spdlog::critical("Failed to initialize SDL video: {}", SDL_GetError());
+    throw std::runtime_error(std::string("failed to initialize SDL video: ") +
+                             SDL_GetError());
+  }
+  window_ = SDL_CreateWindow(app.name.c_str(), SDL_WINDOWPOS_UNDEFINED,
+                             SDL_WINDOWPOS_UNDEFINED, app.width, app.height,
+                             SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (window_ == nullptr) {
+    spdlog::critical("Failed to create the OpenGL window: {}", SDL_GetError());
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    throw std::runtime_error(
+        std::string("failed to create the OpenGL window: ") + SDL_GetError());
+  }
+  try {
+    Init(window_);
+  } catch (const std::runtime_error&) {
+    SDL_DestroyWindow(window_);
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    throw;
+  }
+}
+
+binary::OpenGL::~OpenGL() {
+  if (!headless_) {
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
+    ImGui::DestroyContext();
+  }
+  SDL_GL_DeleteContext(context_);
+  if (headless_) {
+    SDL_DestroyWindow(window_);
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+  }
+}
+
 void binary::OpenGL::DrawFrame() {
+  // ImGui's platform windows leave their own context current
+  SDL_GL_MakeCurrent(window_, context_);
+  SDL_GL_GetDrawableSize(window_, &width_, &height_);
   glViewport(0, 0, width_, height_);
   glClearColor(0.2f, 0.2f, 0.2f, 0.f);
   glClear(GL_COLOR_BUFFER_BIT);
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  SDL_GL_SwapWindow(sdl_->window_); 
+  if (!headless_) {
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  }
+  SDL_GL_SwapWindow(window_);
+}
+
+void binary::OpenGL::Init(SDL_Window* window) {
+  window_ = window;
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, k_GLMajorVersion);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, k_GLMinorVersion);
+  context_ = SDL_GL_CreateContext(window_);
+  if (context_ == nullptr) {
+    spdlog::critical("Failed to create an OpenGL {}.{} context: {}",
+                     k_GLMajorVersion, k_GLMinorVersion, SDL_GetError());
+    throw std::runtime_error(
+        std::string("failed to create the OpenGL context: ") + SDL_GetError());
+  }
+  SDL_GL_MakeCurrent(window_, context_);
+  try {
+    LoadFunctions();
+  } catch (const std::runtime_error&) {
+    SDL_GL_DeleteContext(context_);
+    throw;
+  }
+  SDL_GL_GetDrawableSize(window_, &width_, &height_);
+  spdlog::info("OpenGL {} on {}",
+               reinterpret_cast<const char*>(glGetString(GL_VERSION)),
+               reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void binary::OpenGL::LoadFunctions() {
+  GLint major = 0;
+  GLint minor = 0;
+  functions_.gen_buffers = LoadFunction<PFNGLGENBUFFERSPROC>("glGenBuffers");
+  functions_.delete_buffers =
+      LoadFunction<PFNGLDELETEBUFFERSPROC>("glDeleteBuffers");
+  functions_.bind_buffer = LoadFunction<PFNGLBINDBUFFERPROC>("glBindBuffer");
+  functions_.buffer_data = LoadFunction<PFNGLBUFFERDATAPROC>("glBufferData");
+  functions_.map_buffer_range =
+      LoadFunction<PFNGLMAPBUFFERRANGEPROC>("glMapBufferRange");
+  functions_.unmap_buffer = LoadFunction<PFNGLUNMAPBUFFERPROC>("glUnmapBuffer");
+  functions_.fence_sync = LoadFunction<PFNGLFENCESYNCPROC>("glFenceSync");
+  functions_.client_wait_sync =
+      LoadFunction<PFNGLCLIENTWAITSYNCPROC>("glClientWaitSync");
+  functions_.delete_sync = LoadFunction<PFNGLDELETESYNCPROC>("glDeleteSync");
+  // GLX hands out a pointer for any name, only trust it with the extension
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if (major * 10 + minor >= 44 ||
+      SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+    functions_.buffer_storage =
+        LoadFunction<PFNGLBUFFERSTORAGEPROC>("glBufferStorage");
+  } else {
+    spdlog::warn("No ARB_buffer_storage, streaming textures map every frame");
+  }
 }
-void binary::OpenGL::Init(SDL* sdl) {
-  sdl_ = sdl;
-  context_ = SDL_GL_CreateContext(sdl_->window_);
-  SDL_GetWindowSize(sdl_->window_, &width_, &height_);
-}
\ No newline at end of file
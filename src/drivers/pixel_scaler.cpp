@@ -0,0 +1,244 @@
+#include "include/pixel_scaler.h"
+#include <cstring>
+#ifdef BINARY_SCALER_X64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic without flags, GCC and Clang need the function
+// marked with the instruction set it uses
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BINARY_SCALER_TARGET(isa)
+#else
+#define BINARY_SCALER_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace binary {
+namespace {
+typedef void (*ScaleRowFunction)(const uint8_t* indices,
+                                 const uint32_t k_Width,
+                                 const PixelPalette& palette,
+                                 const uint32_t k_Scale, uint8_t* output);
+
+// Writes every pixel from x on k_Scale times, the end of a row the SIMD
+// kernels leave over or the whole row without them
+void ScaleRowTail(const uint8_t* indices, uint32_t x, const uint32_t k_Width,
+                  const PixelPalette& palette, const uint32_t k_Scale,
+                  uint8_t* output) {
+  for (; x < k_Width; x++) {
+    for (uint32_t copy = 0; copy < k_Scale; copy++) {
+      std::memcpy(output + (x * k_Scale + copy) * 4, &palette[indices[x]], 4);
+    }
+  }
+}
+
+void ScaleRowScalar(const uint8_t* indices, const uint32_t k_Width,
+                    const PixelPalette& palette, const uint32_t k_Scale,
+                    uint8_t* output) {
+  ScaleRowTail(indices, 0, k_Width, palette, k_Scale, output);
+}
+
+#ifdef BINARY_SCALER_X64
+// Permutes for every scale, lane l of output vector j is source pixel
+// (j * 8 + l) / scale of the 8 gathered ones
+constexpr std::array<std::array<std::array<int32_t, 8>, k_MaxScale>,
+                     k_MaxScale + 1>
+    k_LaneSpread = [] {
+      std::array<std::array<std::array<int32_t, 8>, k_MaxScale>,
+                 k_MaxScale + 1>
+          table{};
+      for (uint32_t scale = 1; scale <= k_MaxScale; scale++) {
+        for (uint32_t vector = 0; vector < scale; vector++) {
+          for (uint32_t lane = 0; lane < 8; lane++) {
+            table[scale][vector][lane] = (vector * 8 + lane) / scale;
+          }
+        }
+      }
+      return table;
+    }();
+
+// The same for 4 pixels as byte shuffles, byte b of output vector j is byte
+// b % 4 of source pixel (j * 4 + b / 4) / scale
+constexpr std::array<std::array<std::array<uint8_t, 16>, k_MaxScale>,
+                     k_MaxScale + 1>
+    k_ByteSpread = [] {
+      std::array<std::array<std::array<uint8_t, 16>, k_MaxScale>,
+                 k_MaxScale + 1>
+          table{};
+      for (uint32_t scale = 1; scale <= k_MaxScale; scale++) {
+        for (uint32_t vector = 0; vector < scale; vector++) {
+          for (uint32_t byte = 0; byte < 16; byte++) {
+            table[scale][vector][byte] = static_cast<uint8_t>(
+                (vector * 4 + byte / 4) / scale * 4 + byte % 4);
+          }
+        }
+      }
+      return table;
+    }();
+
+BINARY_SCALER_TARGET("avx2")
+void ScaleRowAvx2(const uint8_t* indices, const uint32_t k_Width,
+                  const PixelPalette& palette, const uint32_t k_Scale,
+                  uint8_t* output) {
+  uint32_t x = 0;
+  __m256i spread[k_MaxScale];
+  for (uint32_t vector = 0; vector < k_Scale; vector++) {
+    spread[vector] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+        k_LaneSpread[k_Scale][vector].data()));
+  }
+  for (; x + 8 <= k_Width; x += 8) {
+    const __m256i k_Indices = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + x)));
+    const __m256i k_Colors = _mm256_i32gather_epi32(
+        reinterpret_cast<const int*>(palette.data()), k_Indices, 4);
+    for (uint32_t vector = 0; vector < k_Scale; vector++) {
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(output + (x * k_Scale + vector * 8) * 4),
+          _mm256_permutevar8x32_epi32(k_Colors, spread[vector]));
+    }
+  }
+  ScaleRowTail(indices, x, k_Width, palette, k_Scale, output);
+}
+
+BINARY_SCALER_TARGET("ssse3")
+void ScaleRowSsse3(const uint8_t* indices, const uint32_t k_Width,
+                   const PixelPalette& palette, const uint32_t k_Scale,
+                   uint8_t* output) {
+  uint32_t x = 0;
+  __m128i spread[k_MaxScale];
+  for (uint32_t vector = 0; vector < k_Scale; vector++) {
+    spread[vector] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+        k_ByteSpread[k_Scale][vector].data()));
+  }
+  for (; x + 4 <= k_Width; x += 4) {
+    // No gather before AVX2, 4 loads are still cheaper than the stores
+    const __m128i k_Colors = _mm_setr_epi32(
+        static_cast<int>(palette[indices[x]]),
+        static_cast<int>(palette[indices[x + 1]]),
+        static_cast<int>(palette[indices[x + 2]]),
+        static_cast<int>(palette[indices[x + 3]]));
+    for (uint32_t vector = 0; vector < k_Scale; vector++) {
+      _mm_storeu_si128(
+          reinterpret_cast<__m128i*>(output + (x * k_Scale + vector * 4) * 4),
+          _mm_shuffle_epi8(k_Colors, spread[vector]));
+    }
+  }
+  ScaleRowTail(indices, x, k_Width, palette, k_Scale, output);
+}
+
+bool CpuHasSsse3() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 9)) != 0;
+#else
+  return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+bool CpuHasAvx2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  // The OS has to save the YMM registers too, OSXSAVE and XCR0 bits 1-2
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+ScaleRowFunction RowFunction(const ScalerKernel k_Kernel) {
+  switch (k_Kernel) {
+#ifdef BINARY_SCALER_X64
+    case ScalerKernel::k_Avx2:
+      return ScaleRowAvx2;
+    case ScalerKernel::k_Ssse3:
+      return ScaleRowSsse3;
+#endif
+    default:
+      return ScaleRowScalar;
+  }
+}
+}  // namespace
+
+uint32_t PackColor(const std::array<uint8_t, 4>& color) {
+  uint32_t packed;
+  std::memcpy(&packed, color.data(), sizeof(packed));
+  return packed;
+}
+
+bool ScalerKernelSupported(const ScalerKernel k_Kernel) {
+  switch (k_Kernel) {
+#ifdef BINARY_SCALER_X64
+    case ScalerKernel::k_Avx2:
+      return CpuHasAvx2();
+    case ScalerKernel::k_Ssse3:
+      return CpuHasSsse3();
+#endif
+    case ScalerKernel::k_Scalar:
+      return true;
+    default:
+      return false;
+  }
+}
+
+ScalerKernel BestScalerKernel() {
+  static const ScalerKernel k_Best = [] {
+    for (const ScalerKernel k_Kernel :
+         {ScalerKernel::k_Avx2, ScalerKernel::k_Ssse3}) {
+      if (ScalerKernelSupported(k_Kernel)) {
+        return k_Kernel;
+      }
+    }
+    return ScalerKernel::k_Scalar;
+  }();
+  return k_Best;
+}
+
+void ScaleIndexed(const uint8_t* indices, const uint32_t k_Width,
+                  const uint32_t k_Height, const PixelPalette& palette,
+                  const uint32_t k_Scale, uint8_t* output,
+                  const size_t k_Pitch) {
+  ScaleIndexedWith(BestScalerKernel(), indices, k_Width, k_Height, palette,
+                   k_Scale, output, k_Pitch);
+}
+
+void ScaleIndexedWith(const ScalerKernel k_Kernel, const uint8_t* indices,
+                      const uint32_t k_Width, const uint32_t k_Height,
+                      const PixelPalette& palette, const uint32_t k_Scale,
+                      uint8_t* output, const size_t k_Pitch) {
+  const ScaleRowFunction k_ScaleRow = RowFunction(k_Kernel);
+  const size_t k_RowBytes = static_cast<size_t>(k_Width) * k_Scale * 4;
+  for (uint32_t y = 0; y < k_Height; y++) {
+    uint8_t* row = output + static_cast<size_t>(y) * k_Scale * k_Pitch;
+    k_ScaleRow(indices + static_cast<size_t>(y) * k_Width, k_Width, palette,
+               k_Scale, row);
+    for (uint32_t copy = 1; copy < k_Scale; copy++) {
+      std::memcpy(row + copy * k_Pitch, row, k_RowBytes);
+    }
+  }
+}
+
+void ScaleIndexedScalar(const uint8_t* indices, const uint32_t k_Width,
+                        const uint32_t k_Height, const PixelPalette& palette,
+                        const uint32_t k_Scale, uint8_t* output,
+                        const size_t k_Pitch) {
+  for (size_t y = 0; y < static_cast<size_t>(k_Height) * k_Scale; y++) {
+    for (size_t x = 0; x < static_cast<size_t>(k_Width) * k_Scale; x++) {
+      const uint8_t k_Index = indices[y / k_Scale * k_Width + x / k_Scale];
+      std::memcpy(output + y * k_Pitch + x * 4, &palette[k_Index], 4);
+    }
+  }
+}
+}  // namespace binary
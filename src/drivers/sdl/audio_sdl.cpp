@@ -0,0 +1,57 @@
+#include "../include/audio_sdl.h"
+#include "spdlog/spdlog.h"
+#include <cstring>
+
+bool binary::AudioSDL::Open(const int k_SampleRate) {
+  if (device_ != 0) {
+    spdlog::warn("Audio device was opened twice, closing the old one");
+    Close();
+  }
+  SDL_AudioSpec desired{};
+  desired.freq = k_SampleRate;
+  desired.format = AUDIO_S16SYS;
+  desired.channels = k_Channels;
+  desired.samples = k_DeviceFrames;
+  desired.callback = Callback;
+  desired.userdata = this;
+  // No allowed changes, SDL converts to whatever the device really wants so
+  // the callback can always copy samples straight out of the ring
+  SDL_AudioSpec obtained{};
+  device_ = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, 0);
+  if (device_ == 0) {
+    spdlog::error("Failed to open audio device {}", SDL_GetError());
+    return false;
+  }
+  sample_rate_ = k_SampleRate;
+  SDL_PauseAudioDevice(device_, 0);
+  return true;
+}
+
+void binary::AudioSDL::Close() {
+  if (device_ == 0) return;
+  SDL_CloseAudioDevice(device_);
+  device_ = 0;
+}
+
+size_t binary::AudioSDL::Push(const int16_t* samples, const size_t k_Frames) {
+  return ring_.Push(samples, k_Frames * k_Channels) / k_Channels;
+}
+
+double binary::AudioSDL::RateRatio() const {
+  return binary::RateRatio(ring_.Size(), k_RingSamples);
+}
+
+void binary::AudioSDL::Callback(void* user_data, Uint8* stream, int length) {
+  // No locks, no allocations and no logging in here, this is the audio thread
+  AudioSDL* audio = static_cast<AudioSDL*>(user_data);
+  int16_t* output = reinterpret_cast<int16_t*>(stream);
+  const size_t k_Samples = static_cast<size_t>(length) / sizeof(int16_t);
+  const size_t k_Popped = audio->ring_.Pop(output, k_Samples);
+  if (k_Popped < k_Samples) {
+    // Underrun, silence beats replaying stale samples
+    std::memset(output + k_Popped, 0, (k_Samples - k_Popped) * sizeof(int16_t));
+    audio->underruns_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+binary::AudioSDL::~AudioSDL() { Close(); }
@@ -20,6 +20,9 @@ void binary::SDL::Init(Application app) {
     case k_Vulkan:
       renderer = SDL_WINDOW_VULKAN;
       break;
+    case k_SDL:
+      renderer = static_cast<SDL_WindowFlags>(0);
+      break;
     default:
       renderer = SDL_WINDOW_HIDDEN; // place holder
 
@@ -32,6 +35,10 @@ void binary::SDL::Init(Application app) {
           "cannot display anything to the screen");
   }
   SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_AUDIO);
+  // No sound isn't a reason to not run at all
+  if (!audio_.Open(AudioSDL::k_DefaultSampleRate)) {
+    spdlog::warn("Running without audio");
+  }
   window_ = SDL_CreateWindow(app.name.c_str(), SDL_WINDOWPOS_CENTERED, 
                              SDL_WINDOWPOS_CENTERED, app.width, app.height,
                              SDL_WINDOW_SHOWN | 
@@ -41,8 +48,19 @@ void binary::SDL::Init(Application app) {
   int img_flags = IMG_INIT_PNG | IMG_INIT_JPG | IMG_INIT_TIF | IMG_INIT_WEBP;
   img_flags |= IMG_INIT_AVIF | IMG_INIT_JXL;
   IMG_Init(img_flags);
-  // Create SDL renderer
-  renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
+  // Create SDL renderer, SDL_Renderer only knows vsync or not
+  uint32_t vsync = 0;
+  if (app.renderer == k_SDL && app.present_mode == k_PresentFifo) {
+    vsync = SDL_RENDERER_PRESENTVSYNC;
+  }
+  renderer_ = SDL_CreateRenderer(window_, -1,
+                                 SDL_RENDERER_ACCELERATED | vsync);
+  if (renderer_ == nullptr && app.renderer == k_SDL) {
+    // SDLRenderer draws with it, so the software one has to do
+    spdlog::warn("No accelerated renderer, using software: {}",
+                 SDL_GetError());
+    renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_SOFTWARE | vsync);
+  }
   if (renderer_ == nullptr) {
     spdlog::critical("Failed to create renderer {}", SDL_GetError());
   } 
@@ -69,6 +87,15 @@ void binary::SDL::PoolEvents(bool* running) {
   }
 }
 
+int binary::SDL::RefreshRate() {
+  SDL_DisplayMode mode{};
+  const int k_Display = SDL_GetWindowDisplayIndex(window_);
+  if (k_Display < 0 || SDL_GetCurrentDisplayMode(k_Display, &mode) != 0) {
+    return 0;
+  }
+  return mode.refresh_rate;
+}
+
 binary::SDL::SDL(Application app) { 
   Init(app);
   LoadApplicationIcon();
@@ -170,6 +197,7 @@ binary::SDL::~SDL() {
   if (surface_ != nullptr) SDL_FreeSurface(surface_);
   if (window_ != nullptr) SDL_DestroyWindow(window_);
   NFD_Quit();
+  audio_.Close();
   SDL_Quit();
 }
 void binary::SDL::LoadApplicationIcon() { 
@@ -0,0 +1,22 @@
+#include "../include/renderer_sdl.h"
+binary::SDLRenderer::SDLRenderer(SDL* sdl) : sdl_(sdl) {
+  if (sdl_->renderer_ == nullptr) {
+    spdlog::critical("SDL has no renderer to draw with");
+    throw std::runtime_error("SDL has no renderer to draw with");
+  }
+  InitIMGUI();
+}
+
+binary::SDLRenderer::~SDLRenderer() {
+  ImGui_ImplSDLRenderer2_Shutdown();
+  ImGui_ImplSDL2_Shutdown();
+  ImGui::DestroyContext();
+}
+
+void binary::SDLRenderer::DrawFrame() {
+  SDL_SetRenderDrawColor(sdl_->renderer_, 51, 51, 51, 255);
+  SDL_RenderClear(sdl_->renderer_);
+  ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(),
+                                        sdl_->renderer_);
+  SDL_RenderPresent(sdl_->renderer_);
+}
@@ -3,7 +3,6 @@
 #pragma once
 #define _SILENCE_STDEXT_ARR_ITERS_DEPRECATION_WARNING
 #define _SILENCE_ALL_MS_EXT_DEPRECATION_WARNINGS
-#define VMA_VULKAN_VERSION 1002000
 #include "../../io/include/io.h"
 #include "../include/renderer_vulkan.h"
 #include "../include/peripherals_sdl.h"
@@ -11,17 +10,36 @@
 void binary::Vulkan::InitVulkan(SDL* sdl, Application app) {
   if (ValidationLayersEnabled) spdlog::set_level(spdlog::level::trace);
   spdlog::info("Initializing Vulkan Instance");
-  InitVulkanInstance(sdl->window_, app);
+  InitVulkanInstance(headless_ ? nullptr : sdl->window_, app);
   spdlog::info("Setting up Vulkan Debug Messenger");
   SetupDebugMessenger();
-  spdlog::info("Creating Vulkan surface");
-  CreateSurface(sdl->window_);
+  if (!headless_) {
+    spdlog::info("Creating Vulkan surface");
+    CreateSurface(sdl->window_);
+  }
   spdlog::info("Finding a suitable device that supports Vulkan");
   PickPhysicalDevice();
   spdlog::info("Initializing Vulkan Logical Device");
   CreateLogicalDevice();
+  spdlog::info("Creating the Vulkan memory allocator");
+  CreateAllocator();
   spdlog::info("Initializing Vulkan Presentation Layer");
-  CreateSwapChain(sdl->window_);
+  switch (app.present_mode) {
+    case k_PresentMailbox:
+      present_mode_ = VK_PRESENT_MODE_MAILBOX_KHR;
+      break;
+    case k_PresentImmediate:
+      present_mode_ = VK_PRESENT_MODE_IMMEDIATE_KHR;
+      break;
+    default:
+      present_mode_ = VK_PRESENT_MODE_FIFO_KHR;
+      break;
+  }
+  if (headless_) {
+    CreateOffscreenTarget();
+  } else {
+    CreateSwapChain(sdl->window_);
+  }
   CreateImageViews();
   spdlog::info("Creating Vulkan Render Pass");
   CreateRenderPass();
@@ -30,21 +48,33 @@ void binary::Vulkan::InitVulkan(SDL* sdl, Application app) {
   spdlog::info("Creating Vulkan Graphics Pipeline"); 
   CreatePipelineCache();
   CreateGraphicsPipeline();
+  post_process_passes_ = app.post_processing;
+  CreatePostProcessPipelines();
   spdlog::info("Creating Vulkan Command Pools ");
   CreateCommandPool();
   //CreateDepthResources();
   CreateFrameBuffer(); 
   spdlog::info("Fetching texture resources to Vulkan");
-  CreateTextureImage("resources/textures/main_menu.png");
+  // The texture, vertex and index uploads go to the GPU in one submit
+  UploadBatch uploads(logical_device_, command_pool_, graphics_queue_,
+                      vma_allocator_, staging_pool_);
+  if (headless_) {
+    CreateHeadlessTextureImage(uploads);
+  } else {
+    CreateTextureImage("resources/textures/main_menu.png", uploads);
+  }
   CreateTextureImageView();
   CreateTextureSampler();
-  CreateVertexBuffer(); 
-  CreateIndexBuffer();
+  CreateVertexBuffer(uploads);
+  CreateIndexBuffer(uploads);
+  uploads.Submit();
   CreateUniformBuffers();
   spdlog::info("Creating Vulkan Descriptor Pools ");
   CreateDescriptorPool();
   spdlog::info("Creating Vulkan Descriptor Sets ");
   CreateDescriptorSets();
+  spdlog::info("Creating the Vulkan post-processing targets");
+  CreatePostProcessTargets();
   spdlog::info("Creating Vulkan Command Buffers ");
   CreateCommandBuffer();
   spdlog::info("Syncing the Vulkan objects together");
@@ -52,6 +82,10 @@ void binary::Vulkan::InitVulkan(SDL* sdl, Application app) {
 }
 
 void binary::Vulkan::DrawFrame() {
+  if (headless_) {
+    DrawOffscreenFrame();
+    return;
+  }
   vkWaitForFences(logical_device_, 1, &in_flight_fence_[current_frame_],
                   VK_TRUE, UINT64_MAX);
   uint32_t image_index = 0;
@@ -135,6 +169,13 @@ binary::Vulkan::Vulkan(SDL* sdl, Application app) {
   InitIMGUI(sdl);
 }
 
+binary::Vulkan::Vulkan(Application app) {
+  sdl_ = nullptr;
+  headless_ = true;
+  swap_chain_.extent_ = {app.width, app.height};
+  InitVulkan(nullptr, app);
+}
+
 binary::gbVulkanGraphicsHandler 
 binary::Vulkan::GetGraphicsHandler() {
   gbVulkanGraphicsHandler graphics_handler{};
@@ -145,6 +186,13 @@ binary::Vulkan::GetGraphicsHandler() {
   graphics_handler.graphics_queue = &graphics_queue_;
   graphics_handler.physical_device = &physical_device_;
   graphics_handler.imgui_pool = &imgui_pool_;
+  graphics_handler.current_frame = &current_frame_;
+  graphics_handler.in_flight_fence = &in_flight_fence_;
+  graphics_handler.uploaders = &uploaders_;
+  graphics_handler.vma_allocator = &vma_allocator_;
+  graphics_handler.staging_pool = &staging_pool_;
+  graphics_handler.pipeline_cache = &pipeline_cache_;
+  graphics_handler.post_processor = this;
   return graphics_handler;
 }
 
@@ -155,15 +203,16 @@ binary::Vulkan::~Vulkan() {
   CleanUpSwapChain();
 
   // Destroy ImGui memory stuff
-  ImGui_ImplVulkan_Shutdown();
-  ImGui_ImplSDL2_Shutdown();
-  ImGui::DestroyContext();
-  vkDestroyDescriptorPool(logical_device_, imgui_pool_, allocator_); 
+  if (!headless_) {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
+    ImGui::DestroyContext();
+    vkDestroyDescriptorPool(logical_device_, imgui_pool_, allocator_);
+  }
 
   vkDestroySampler(logical_device_, texture_sampler_, allocator_);
   vkDestroyImageView(logical_device_, texture_image_view_, allocator_);
-  vkDestroyImage(logical_device_, texture_image_, allocator_);
-  vkFreeMemory(logical_device_, texture_image_memory_, allocator_);
+  vmaDestroyImage(vma_allocator_, texture_image_, texture_image_allocation_);
   
   vkDestroyDescriptorPool(logical_device_, descriptor_pool_, allocator_);
   descriptor_pool_ = VK_NULL_HANDLE;
@@ -172,10 +221,10 @@ binary::Vulkan::~Vulkan() {
   descriptor_set_layout_ = VK_NULL_HANDLE;
 
   for (size_t i = 0; i < k_MaxFramesInFlight; i++) { 
-    vkDestroyBuffer(logical_device_, uniform_buffer_[i], allocator_); 
+    vmaDestroyBuffer(vma_allocator_, uniform_buffer_[i],
+                     uniform_buffer_allocation_[i]);
     uniform_buffer_[i] = VK_NULL_HANDLE;
-    vkFreeMemory(logical_device_, uniform_buffer_memory_[i], allocator_);
-    uniform_buffer_memory_[i] = VK_NULL_HANDLE;
+    uniform_buffer_allocation_[i] = VK_NULL_HANDLE;
   }
 
   vkDestroyDescriptorSetLayout(logical_device_, descriptor_set_layout_,
@@ -197,30 +246,28 @@ binary::Vulkan::~Vulkan() {
   command_pool_ = VK_NULL_HANDLE;
   // Destroy vertex buffer
   if (buffer_.vertex_ != VK_NULL_HANDLE) {
-    vkDestroyBuffer(logical_device_, buffer_.vertex_, allocator_);
+    vmaDestroyBuffer(vma_allocator_, buffer_.vertex_,
+                     buffer_.vertex_allocation_);
     buffer_.vertex_ = VK_NULL_HANDLE;
-  }
-  if (buffer_.vertex_memory_ != VK_NULL_HANDLE) {
-    vkFreeMemory(logical_device_, buffer_.vertex_memory_, allocator_);
-    buffer_.vertex_memory_ = VK_NULL_HANDLE;
+    buffer_.vertex_allocation_ = VK_NULL_HANDLE;
   }
 
   // Destroy index buffer
   if (buffer_.index_ != VK_NULL_HANDLE) {
-    vkDestroyBuffer(logical_device_, buffer_.index_, allocator_);
+    vmaDestroyBuffer(vma_allocator_, buffer_.index_,
+                     buffer_.index_allocation_);
     buffer_.index_ = VK_NULL_HANDLE; 
-  }
-  if (buffer_.index_memory_ != VK_NULL_HANDLE) {
-    vkFreeMemory(logical_device_, buffer_.index_memory_, allocator_);
-    buffer_.index_memory_ = VK_NULL_HANDLE;
+    buffer_.index_allocation_ = VK_NULL_HANDLE;
   }
 
+  SavePipelineCache();
   vkDestroyPipelineCache(logical_device_, pipeline_cache_, allocator_);
   pipeline_cache_ = VK_NULL_HANDLE;
 
   vkDestroyPipeline(logical_device_, graphics_pipeline_, allocator_);
 
   graphics_pipeline_ = VK_NULL_HANDLE;
+  DestroyPostProcessPipelines();
 
   vkDestroyPipelineLayout(logical_device_, pipeline_layout_, allocator_);
   pipeline_layout_ = VK_NULL_HANDLE;
@@ -228,6 +275,9 @@ binary::Vulkan::~Vulkan() {
   vkDestroyRenderPass(logical_device_, render_pass_, allocator_);
   render_pass_ = VK_NULL_HANDLE;
 
+  // Everything allocated from it has to be gone by now
+  DestroyAllocator();
+
   vkDestroyDevice(logical_device_, allocator_);
   logical_device_ = VK_NULL_HANDLE;
 
@@ -0,0 +1,81 @@
+// File: renderer_vulkan_allocator.cpp
+// The one translation unit that compiles VulkanMemoryAllocator itself
+#define VMA_IMPLEMENTATION
+#define VMA_VULKAN_VERSION 1003000
+#include "../include/renderer_vulkan.h"
+
+namespace {
+// Staging buffers come and go with every texture upload, uniform buffers are
+// tiny. VMA's default 256 MiB blocks would be a waste of host visible memory
+// for either, k_StagingBlockSize is in renderer_vulkan_upload.h.
+constexpr VkDeviceSize k_UniformBlockSize = 1ull * 1024 * 1024;
+}  // namespace
+
+void binary::Vulkan::CreateAllocator() {
+  VmaAllocatorCreateInfo allocator_info{};
+  VkResult result;
+  // VMA only calls core entry points the instance and device both have
+  allocator_info.vulkanApiVersion = api_version_;
+  allocator_info.physicalDevice = physical_device_;
+  allocator_info.device = logical_device_;
+  allocator_info.instance = instance_;
+  allocator_info.pAllocationCallbacks = allocator_;
+  if (memory_budget_supported_) {
+    allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+  }
+  result = vmaCreateAllocator(&allocator_info, &vma_allocator_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create the memory allocator! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create the memory allocator! " +
+                             VkResultToString(result));
+  }
+  staging_pool_ = CreateHostVisiblePool(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                        k_StagingBlockSize);
+  uniform_pool_ = CreateHostVisiblePool(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                        k_UniformBlockSize);
+}
+
+VmaPool binary::Vulkan::CreateHostVisiblePool(VkBufferUsageFlags usage,
+                                              VkDeviceSize block_size) {
+  VkBufferCreateInfo buffer_info{};
+  VmaAllocationCreateInfo allocation_info{};
+  VmaPoolCreateInfo pool_info{};
+  VmaPool pool{};
+  uint32_t memory_type_index = 0;
+  VkResult result;
+  // A pool sticks to one memory type, ask VMA which one a buffer like the
+  // ones going in there would get
+  buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buffer_info.size = 1024;
+  buffer_info.usage = usage;
+  allocation_info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  result = vmaFindMemoryTypeIndexForBufferInfo(
+      vma_allocator_, &buffer_info, &allocation_info, &memory_type_index);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to find a host visible memory type! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to find a host visible memory type! " +
+                             VkResultToString(result));
+  }
+  pool_info.memoryTypeIndex = memory_type_index;
+  pool_info.blockSize = block_size;
+  result = vmaCreatePool(vma_allocator_, &pool_info, &pool);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create memory pool! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create memory pool! " +
+                             VkResultToString(result));
+  }
+  return pool;
+}
+
+void binary::Vulkan::DestroyAllocator() {
+  vmaDestroyPool(vma_allocator_, staging_pool_);
+  staging_pool_ = VK_NULL_HANDLE;
+  vmaDestroyPool(vma_allocator_, uniform_pool_);
+  uniform_pool_ = VK_NULL_HANDLE;
+  vmaDestroyAllocator(vma_allocator_);
+  vma_allocator_ = VK_NULL_HANDLE;
+}
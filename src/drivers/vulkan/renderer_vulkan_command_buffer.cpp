@@ -59,6 +59,13 @@ void binary::Vulkan::RecordCommandBuffer(VkCommandBuffer command_buffer,
                              VkResultToString(result));
   }
 
+  // Texture uploads have to happen outside of the render pass
+  for (VulkanUploader* uploader : uploaders_) {
+    uploader->RecordUploads(command_buffer, current_frame_);
+  }
+  // So do the post-processing passes, ImGui samples their output
+  RecordPostProcess(command_buffer);
+
   render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   render_pass_info.renderPass = render_pass_;
   render_pass_info.framebuffer = swap_chain_.frame_buffer_[image_index];
@@ -99,9 +106,14 @@ void binary::Vulkan::RecordCommandBuffer(VkCommandBuffer command_buffer,
   vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(indices_.size()), 1, 0,
                    0, 0);
   // Draw ImGui
-  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), command_buffer);
+  if (!headless_) {
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), command_buffer);
+  }
 
   vkCmdEndRenderPass(command_buffer);
+  if (headless_) {
+    RecordReadBack(command_buffer, image_index);
+  }
   result = vkEndCommandBuffer(command_buffer);
   if (result != VK_SUCCESS) {
     spdlog::critical("Failed to record Command Buffer! {}",
@@ -110,35 +122,3 @@ void binary::Vulkan::RecordCommandBuffer(VkCommandBuffer command_buffer,
                              VkResultToString(result));
   }
 }
-
-VkCommandBuffer binary::BeginSingleTimeCommands(VkCommandPool command_pool,
-                                                  VkDevice logical_device) {
-  VkCommandBufferAllocateInfo allocate_info{};
-  VkCommandBufferBeginInfo begin_info{};
-  VkCommandBuffer command_buffer;
-
-  allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocate_info.commandPool = command_pool;
-  allocate_info.commandBufferCount = 1;
-
-  vkAllocateCommandBuffers(logical_device, &allocate_info, &command_buffer);
-  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-  vkBeginCommandBuffer(command_buffer, &begin_info);
-  return command_buffer;
-}
-
-void binary::EndSingleTimeCommands(VkCommandBuffer command_buffer,
-                                  VkCommandPool command_pool,
-                                  VkDevice logical_device, VkQueue queue) {
-  VkSubmitInfo submit_info{};
-  vkEndCommandBuffer(command_buffer);
-  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit_info.commandBufferCount = 1;
-  submit_info.pCommandBuffers = &command_buffer;
-
-  vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE);
-  vkQueueWaitIdle(queue);
-  vkFreeCommandBuffers(logical_device, command_pool, 1, &command_buffer);
-}
\ No newline at end of file
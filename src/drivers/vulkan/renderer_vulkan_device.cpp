@@ -1,4 +1,5 @@
 #include "../include/renderer_vulkan.h"
+#include <cstring>
 
 // Vulkan Physical Device Functions
 bool binary::Vulkan::IsPhysicalDeviceSuitable(
@@ -8,9 +9,9 @@ bool binary::Vulkan::IsPhysicalDeviceSuitable(
   // application needs
   QueueFamilyIndices indices = FindQueueFamilies(phyiscal_device);
   bool extension_supported = CheckDeviceExtensionSupport(phyiscal_device);
-  bool swap_chain_adequate = false;
+  bool swap_chain_adequate = headless_;
   // Check if the physical device has the required extensions
-  if (extension_supported) {
+  if (extension_supported && !headless_) {
     // Check if the physical device can utilize swap chains
     SwapChainSupportDetails swap_chain_support =
         QuerySwapChainSupport(phyiscal_device);
@@ -71,8 +72,9 @@ bool binary::Vulkan::CheckDeviceExtensionSupport(
 
   // check if the physical has the required extensions needed for the
   // application to work
-  std::set<std::string> required_extensions(device_extensions.begin(),
-                                            device_extensions.end());
+  const std::vector<const char*> k_Required = RequiredDeviceExtensions();
+  std::set<std::string> required_extensions(k_Required.begin(),
+                                            k_Required.end());
   for (const auto& extension : available_extensions) {
     required_extensions.erase(extension.extensionName);
   }
@@ -124,6 +126,12 @@ void binary::Vulkan::PickPhysicalDevice() {
     spdlog::critical("Failed to find a suitable GPU!");
     throw std::runtime_error("");
   }
+
+  // Device level functionality is capped by both the instance and the
+  // device, anything that checks for core features goes by this version
+  VkPhysicalDeviceProperties properties{};
+  vkGetPhysicalDeviceProperties(physical_device_, &properties);
+  api_version_ = std::min(api_version_, properties.apiVersion);
 }
 
 void binary::Vulkan::CreateLogicalDevice() {
@@ -159,10 +167,27 @@ void binary::Vulkan::CreateLogicalDevice() {
       .pQueueCreateInfos = queue_create_info.data(),
       .pEnabledFeatures = &device_features};
 
-  // Add the extensions needed for the application for the logical device
+  // Add the extensions needed for the application for the logical device.
+  // VK_EXT_memory_budget is optional, with it VMA reports the driver's real
+  // budget instead of estimating it.
+  std::vector<const char*> enabled_extensions = RequiredDeviceExtensions();
+  uint32_t extension_count = 0;
+  vkEnumerateDeviceExtensionProperties(physical_device_, nullptr,
+                                       &extension_count, nullptr);
+  std::vector<VkExtensionProperties> available_extensions(extension_count);
+  vkEnumerateDeviceExtensionProperties(physical_device_, nullptr,
+                                       &extension_count,
+                                       available_extensions.data());
+  for (const auto& extension : available_extensions) {
+    if (strcmp(extension.extensionName,
+               VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+      enabled_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      memory_budget_supported_ = true;
+    }
+  }
   device_info.enabledExtensionCount =
-      static_cast<uint32_t>(device_extensions.size());
-  device_info.ppEnabledExtensionNames = device_extensions.data();
+      static_cast<uint32_t>(enabled_extensions.size());
+  device_info.ppEnabledExtensionNames = enabled_extensions.data();
 
   // Add debugging capabilities for the logical device if validation layers were
   // enabled
@@ -221,9 +246,12 @@ binary::QueueFamilyIndices binary::Vulkan::FindQueueFamilies(
     // Even if the queue family supports graphics, that doesn't mean it
     // supports presenting those graphics to the host machine. Check if
     // the queue family has present support
-    present_support = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(phyiscal_device, i, surface_,
-                                         &present_support);
+    // Headless there's no surface, the graphics queue is all it takes
+    present_support = headless_ && indices.graphics_family.has_value();
+    if (!headless_) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(phyiscal_device, i, surface_,
+                                           &present_support);
+    }
     if (present_support) {
       indices.present_family = i;
     }
@@ -0,0 +1,128 @@
+#include "../include/renderer_vulkan.h"
+
+// Vulkan Headless Rendering
+
+void binary::Vulkan::CreateOffscreenTarget() {
+  void* data;
+  const VkDeviceSize k_FrameSize =
+      static_cast<VkDeviceSize>(swap_chain_.extent_.width) *
+      swap_chain_.extent_.height * 4;
+  // One image per frame in flight like a swapchain would have, so a frame
+  // never renders into the image the previous one is still copying out of
+  swap_chain_.image_format_ = VK_FORMAT_R8G8B8A8_UNORM;
+  swap_chain_.images_.resize(k_MaxFramesInFlight);
+  offscreen_allocations_.resize(k_MaxFramesInFlight);
+  for (size_t i = 0; i < k_MaxFramesInFlight; i++) {
+    CreateImage(swap_chain_.extent_.width, swap_chain_.extent_.height,
+                swap_chain_.image_format_, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swap_chain_.images_[i],
+                offscreen_allocations_[i]);
+  }
+  CreateBuffer(k_FrameSize * k_MaxFramesInFlight,
+               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               readback_buffer_, readback_allocation_, VK_NULL_HANDLE, &data);
+  readback_mapped_ = static_cast<uint8_t*>(data);
+}
+
+void binary::Vulkan::DestroyOffscreenTarget() {
+  for (size_t i = 0; i < swap_chain_.images_.size(); i++) {
+    vmaDestroyImage(vma_allocator_, swap_chain_.images_[i],
+                    offscreen_allocations_[i]);
+  }
+  swap_chain_.images_.clear();
+  offscreen_allocations_.clear();
+  vmaDestroyBuffer(vma_allocator_, readback_buffer_, readback_allocation_);
+  readback_buffer_ = VK_NULL_HANDLE;
+  readback_mapped_ = nullptr;
+}
+
+void binary::Vulkan::CreateHeadlessTextureImage(UploadBatch& uploads) {
+  // Without SDL there's no PNG loading, a checkerboard of the same size
+  // costs the same to upload and sample
+  constexpr uint32_t k_Size = 256;
+  constexpr uint32_t k_Square = 16;
+  std::vector<uint8_t> pixels(k_Size * k_Size * 4);
+  for (uint32_t y = 0; y < k_Size; y++) {
+    for (uint32_t x = 0; x < k_Size; x++) {
+      const uint8_t k_Value = ((x / k_Square + y / k_Square) & 1) ? 0xFF : 0x00;
+      uint8_t* pixel = pixels.data() + (y * k_Size + x) * 4;
+      pixel[0] = k_Value;
+      pixel[1] = k_Value;
+      pixel[2] = k_Value;
+      pixel[3] = 0xFF;
+    }
+  }
+  LoadImageFromArray(pixels.data(), pixels.size(), k_Size, k_Size, uploads);
+}
+
+void binary::Vulkan::RecordReadBack(VkCommandBuffer command_buffer,
+                                    uint32_t image_index) {
+  VkBufferImageCopy region{};
+  VkMemoryBarrier barrier{};
+  // The render pass already left the image in TRANSFER_SRC_OPTIMAL, its
+  // subpass dependency to VK_SUBPASS_EXTERNAL orders this copy after the
+  // attachment writes
+  region.bufferOffset = static_cast<VkDeviceSize>(image_index) *
+                        swap_chain_.extent_.width * swap_chain_.extent_.height *
+                        4;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {swap_chain_.extent_.width, swap_chain_.extent_.height,
+                        1};
+  vkCmdCopyImageToBuffer(command_buffer, swap_chain_.images_[image_index],
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         readback_buffer_, 1, &region);
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+                       0, nullptr);
+}
+
+void binary::Vulkan::DrawOffscreenFrame() {
+  VkSubmitInfo submit_info{};
+  VkResult result;
+  vkWaitForFences(logical_device_, 1, &in_flight_fence_[current_frame_],
+                  VK_TRUE, UINT64_MAX);
+  // The offscreen image of a frame is the one with its index, nothing to
+  // acquire and nothing to wait on before drawing
+  RecordCommandBuffer(command_buffers_[current_frame_], current_frame_);
+  vkResetFences(logical_device_, 1, &in_flight_fence_[current_frame_]);
+
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &command_buffers_[current_frame_];
+  result = vkQueueSubmit(graphics_queue_, 1, &submit_info,
+                         in_flight_fence_[current_frame_]);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to submit draw command buffer! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to submit draw command buffer!" +
+                             VkResultToString(result));
+  }
+  last_frame_ = current_frame_;
+  current_frame_ = (current_frame_ + 1) % k_MaxFramesInFlight;
+}
+
+const uint8_t* binary::Vulkan::ReadBack() {
+  if (!headless_) {
+    return nullptr;
+  }
+  vkWaitForFences(logical_device_, 1, &in_flight_fence_[last_frame_], VK_TRUE,
+                  UINT64_MAX);
+  return readback_mapped_ + static_cast<size_t>(last_frame_) *
+                                swap_chain_.extent_.width *
+                                swap_chain_.extent_.height * 4;
+}
+
+std::vector<const char*> binary::Vulkan::RequiredDeviceExtensions() {
+  if (headless_) {
+    return {};
+  }
+  return device_extensions;
+}
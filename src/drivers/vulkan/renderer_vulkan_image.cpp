@@ -26,13 +26,14 @@ VkImageView binary::Vulkan::CreateImageView(VkImage image, VkFormat format,
   return image_view;
 }
 
-void binary::Vulkan::CreateTextureImage(const char* image_path) {
+void binary::Vulkan::CreateTextureImage(const char* image_path,
+                                        UploadBatch& uploads) {
   VkDeviceSize image_size;
   sdl_->InitSurfaceFromPath(image_path, File::PNG); 
   image_size = sdl_->surface_->format->BytesPerPixel * sdl_->surface_->w *
                sdl_->surface_->h;
   LoadImageFromArray(sdl_->surface_->pixels, image_size, sdl_->surface_->w,
-                     sdl_->surface_->h);
+                     sdl_->surface_->h, uploads);
 }
 
 void binary::Vulkan::CreateTextureSampler() {
@@ -71,11 +72,10 @@ void binary::Vulkan::CreateImage(uint32_t width, uint32_t height,
                                    VkImageUsageFlags usage,
                                    VkMemoryPropertyFlags properties,
                                    VkImage& image,
-                                   VkDeviceMemory& image_memory) {
+                                   VmaAllocation& image_allocation) {
   VkResult result;
   VkImageCreateInfo image_info{};
-  VkMemoryRequirements memory_requirements;
-  VkMemoryAllocateInfo allocate_info{};
+  VmaAllocationCreateInfo allocation_info{};
 
   image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   image_info.imageType = VK_IMAGE_TYPE_2D;
@@ -92,95 +92,15 @@ void binary::Vulkan::CreateImage(uint32_t width, uint32_t height,
   image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
   image_info.flags = 0;
 
-  result = vkCreateImage(logical_device_, &image_info, allocator_, &image);
+  allocation_info.requiredFlags = properties;
+  result = vmaCreateImage(vma_allocator_, &image_info, &allocation_info,
+                          &image, &image_allocation, nullptr);
 
   if (result != VK_SUCCESS) {
     spdlog::critical("Failed to create image! {}", VkResultToString(result));
     throw std::runtime_error("Failed to create image! " +
                              VkResultToString(result));
   }
-
-  vkGetImageMemoryRequirements(logical_device_, image, &memory_requirements);
-
-  allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocate_info.allocationSize = memory_requirements.size;
-  allocate_info.memoryTypeIndex =
-      FindMemoryType(memory_requirements.memoryTypeBits, properties);
-
-  result = vkAllocateMemory(logical_device_, &allocate_info, allocator_,
-                            &image_memory);
-  if (result != VK_SUCCESS) {
-    spdlog::critical("Failed to allocate image memory! {}",
-                     VkResultToString(result));
-    throw std::runtime_error("Failed to allocate image memory! " +
-                             VkResultToString(result));
-  }
-  vkBindImageMemory(logical_device_, image, image_memory, 0);
-}
-
-void binary::Vulkan::CopyBufferToImage(VkBuffer buffer, VkImage image,
-                                         uint32_t width, uint32_t height) {
-  VkCommandBuffer command_buffer =
-      BeginSingleTimeCommands(command_pool_, logical_device_);
-  VkBufferImageCopy region{};
-  region.bufferOffset = 0;
-  region.bufferRowLength = 0;
-  region.bufferImageHeight = 0;
-  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount = 1;
-  region.imageOffset = {0, 0, 0};
-  region.imageExtent = {width, height, 1};
-  vkCmdCopyBufferToImage(command_buffer, buffer, image,
-                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-  EndSingleTimeCommands(command_buffer, command_pool_, logical_device_,
-                        graphics_queue_);
-}
-
-void binary::Vulkan::TransitionImageLayout(VkImage image, VkFormat format,
-                                             VkImageLayout old_layout,
-                                             VkImageLayout new_layout) {
-  VkImageMemoryBarrier barrier{};
-  VkPipelineStageFlags source_stage;
-  VkPipelineStageFlags destination_stage;
-  VkCommandBuffer command_buffer =
-      BeginSingleTimeCommands(command_pool_, logical_device_);
-
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.oldLayout = old_layout;
-  barrier.newLayout = new_layout;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = image;
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
-
-  if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED &&
-      new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-    source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-  } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-             new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  } else {
-    spdlog::warn("Unsupported Layout translation!");
-    throw std::invalid_argument("Unsupported Layout translation!");
-  }
-  vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0,
-                       nullptr, 0, nullptr, 1, &barrier);
-  EndSingleTimeCommands(command_buffer, command_pool_, logical_device_,
-                        graphics_queue_);
 }
 
 uint32_t binary::Vulkan::FindMemoryType(uint32_t type_filter,
@@ -233,7 +153,10 @@ VkFormat binary::Vulkan::FindSupportedFormat(
 
 
 void binary::Vulkan::LoadImageFromPath(const char* image_path) {
-  CreateTextureImage(image_path);
+  UploadBatch uploads(logical_device_, command_pool_, graphics_queue_,
+                      vma_allocator_, staging_pool_);
+  CreateTextureImage(image_path, uploads);
+  uploads.Submit();
   CreateTextureImageView();
   CreateTextureSampler();
   CreateTextureDescriptorSet();
@@ -246,51 +169,21 @@ void binary::Vulkan::_FreeImage() {
 void binary::Vulkan::_DestoryImage() {
   vkDestroySampler(logical_device_, texture_sampler_, allocator_);
   vkDestroyImageView(logical_device_, texture_image_view_, allocator_);
-  vkDestroyImage(logical_device_, texture_image_, allocator_);
-  vkFreeMemory(logical_device_, texture_image_memory_, allocator_);
+  vmaDestroyImage(vma_allocator_, texture_image_, texture_image_allocation_);
 }
 
 void binary::Vulkan::CreateTextureDescriptorSet() { 
 
 }
 
-void binary::Vulkan::LoadImageFromArray(
-    void* image_data, VkDeviceSize image_size, uint32_t w,
-                          uint32_t h) { 
-  void* data; 
-  VkDeviceMemory staging_buffer_memory;
-  VkBuffer staging_buffer; 
-  CreateBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-               staging_buffer, staging_buffer_memory); 
-
-  // Data is a pointer to VRAM in your graphics card, and if you
-  // don't have a graphics card then it's DDRAM.
-  //
-  // This whole setup is allocating space in whatever memory channel you're
-  // using and putting the image there
-  vkMapMemory(logical_device_, staging_buffer_memory, 0, image_size, 0, &data);
-
-  // We got the pointer to the memory free for us to use, lets put the surface
-  // pixels where the data address is pointing at
-  memcpy(data, image_data, static_cast<size_t>(image_size)); 
-  vkUnmapMemory(logical_device_, staging_buffer_memory);
-
+void binary::Vulkan::LoadImageFromArray(void* image_data,
+                                        VkDeviceSize image_size, uint32_t w,
+                                        uint32_t h, UploadBatch& uploads) {
   CreateImage(w, h, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_,
-              texture_image_memory_);
-
-  TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM,
-                        VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  CopyBufferToImage(staging_buffer, texture_image_, w, h);
-
-  TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  vkDestroyBuffer(logical_device_, staging_buffer, allocator_);
-  vkFreeMemory(logical_device_, staging_buffer_memory, allocator_);
-}
\ No newline at end of file
+              texture_image_allocation_);
+  // The pixels are copied to staging memory right away, image_data can go
+  // before the batch is submitted
+  uploads.UploadImage(texture_image_, w, h, image_data, image_size);
+}
@@ -22,6 +22,18 @@ void binary::Vulkan::InitVulkanInstance(SDL_Window* window_,
     spdlog::critical("Validation layers requested, but not available!");
   }
 
+  // A 1.0 loader rejects any apiVersion above 1.0 and doesn't export
+  // vkEnumerateInstanceVersion, newer loaders report what they support. Ask
+  // for 1.3 but never more than the loader has.
+  uint32_t loader_version = VK_API_VERSION_1_0;
+  auto enumerate_instance_version =
+      reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+          vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+  if (enumerate_instance_version != nullptr) {
+    enumerate_instance_version(&loader_version);
+  }
+  api_version_ = std::min(VK_API_VERSION_1_3, loader_version);
+
   // Init the application infomation to Vulkan
   app_info = {
       .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -29,7 +41,7 @@ void binary::Vulkan::InitVulkanInstance(SDL_Window* window_,
       .applicationVersion = VK_MAKE_API_VERSION(1, 0, 0, 0),
       .pEngineName = app.name.c_str(),
       .engineVersion = VK_MAKE_API_VERSION(1, 0, 0, 0),
-      .apiVersion = VK_API_VERSION_1_3,
+      .apiVersion = api_version_,
   };
   // required_extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
   instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -64,11 +76,10 @@ void binary::Vulkan::InitVulkanInstance(SDL_Window* window_,
   // Create the Vulkan instance with all the infomation given above
   result = vkCreateInstance(&instance_info, allocator_, &instance_);
   if (result != VK_SUCCESS) {
-    spdlog::critical("Failed to create Vulkan instance ", 
+    spdlog::critical("Failed to create Vulkan instance {}",
       VkResultToString(result));
-    std::runtime_error("Failed to create Vulkan instance " +
+    throw std::runtime_error("Failed to create Vulkan instance " +
       VkResultToString(result));
-    return;
   }
 
   // Collect the infomation from the Vulkan instance, and print the extensions
@@ -93,6 +104,14 @@ std::vector<const char*> binary::Vulkan::GetExtensions(SDL_Window* window_) {
   // based on the number it gives, then push the extension names inside of
   // vector
   uint32_t sdl_extension_count = 0;
+  if (headless_) {
+    // Nothing to present to, no surface extensions
+    std::vector<const char*> extensions;
+    if (ValidationLayersEnabled) {
+      extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+    return extensions;
+  }
   if (!SDL_Vulkan_GetInstanceExtensions(window_, &sdl_extension_count,
                                         nullptr)) {
     spdlog::critical(
@@ -1,4 +1,16 @@
 #include "../include/renderer_vulkan.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 std::vector<char> binary::ReadFile(const std::string& filename) {
@@ -164,9 +176,8 @@ void binary::Vulkan::CreateGraphicsPipeline() {
   pipeline_info.subpass = 0;
   pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-  result =
-      vkCreateGraphicsPipelines(logical_device_, pipeline_cache_, 1,
-                                &pipeline_info, nullptr, &graphics_pipeline_);
+  result = CreateCachedGraphicsPipeline("main", pipeline_info,
+                                        &graphics_pipeline_);
   if (result != VK_SUCCESS) {
     spdlog::critical("Failed to create graphics pipeline {}",
                      VkResultToString(result));
@@ -178,13 +189,192 @@ void binary::Vulkan::CreateGraphicsPipeline() {
 
 void binary::Vulkan::CreatePipelineCache() {
   VkPipelineCacheCreateInfo pipeline_cache_info{};
+  VkPhysicalDeviceProperties properties{};
   VkResult result;
+  vkGetPhysicalDeviceProperties(physical_device_, &properties);
+  // Creation feedback is core in 1.3, it tells us whether the cache hit
+  pipeline_feedback_supported_ = api_version_ >= VK_API_VERSION_1_3;
+
+  // Whatever the last run compiled, the driver skips compiling it again
+  std::vector<char> cache_data = LoadPipelineCacheData(properties);
   pipeline_cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-  pipeline_cache_info.initialDataSize = 0;
-  pipeline_cache_info.pInitialData = nullptr;
+  pipeline_cache_info.initialDataSize = cache_data.size();
+  pipeline_cache_info.pInitialData =
+      cache_data.empty() ? nullptr : cache_data.data();
   result = vkCreatePipelineCache(logical_device_, &pipeline_cache_info,
                                  allocator_, &pipeline_cache_);
+  if (result != VK_SUCCESS && !cache_data.empty()) {
+    spdlog::warn("Pipeline cache data was rejected, starting empty {}",
+                 VkResultToString(result));
+    pipeline_cache_info.initialDataSize = 0;
+    pipeline_cache_info.pInitialData = nullptr;
+    result = vkCreatePipelineCache(logical_device_, &pipeline_cache_info,
+                                   allocator_, &pipeline_cache_);
+  }
   if (result != VK_SUCCESS) {
     spdlog::critical("IMGUI REALLY NEEDS THIS {}", VkResultToString(result));
   }
-}
\ No newline at end of file
+}
+
+std::vector<char> binary::Vulkan::LoadPipelineCacheData(
+    const VkPhysicalDeviceProperties& properties) {
+  VkPipelineCacheHeaderVersionOne header{};
+  std::ifstream file(k_PipelineCachePath, std::ios::ate | std::ios::binary);
+  if (!file.is_open()) {
+    spdlog::info("No pipeline cache at {}, pipelines compile from scratch",
+                 k_PipelineCachePath);
+    return {};
+  }
+  std::vector<char> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(data.data(), data.size());
+  if (!file || data.size() < sizeof(header)) {
+    spdlog::warn("Pipeline cache {} is truncated, ignoring it",
+                 k_PipelineCachePath);
+    return {};
+  }
+  // Drivers are supposed to reject caches from another device themselves,
+  // not all of them do it gracefully
+  memcpy(&header, data.data(), sizeof(header));
+  if (header.headerSize < sizeof(header) ||
+      header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+      header.vendorID != properties.vendorID ||
+      header.deviceID != properties.deviceID ||
+      memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+             VK_UUID_SIZE) != 0) {
+    spdlog::info("Pipeline cache {} is from another device or driver, "
+                 "ignoring it", k_PipelineCachePath);
+    return {};
+  }
+  spdlog::info("Loaded {} bytes of pipeline cache from {}", data.size(),
+               k_PipelineCachePath);
+  return data;
+}
+
+namespace {
+// Writes and flushes the file to disk before returning. Without the flush a
+// rename can reach the disk before the data does, and a power loss leaves an
+// empty or truncated file under the final name.
+bool WriteFileDurably(const std::filesystem::path& path,
+                      const std::vector<char>& data) {
+#ifdef _WIN32
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  DWORD written = 0;
+  bool ok = WriteFile(file, data.data(), static_cast<DWORD>(data.size()),
+                      &written, nullptr) &&
+            written == data.size() && FlushFileBuffers(file);
+  CloseHandle(file);
+  return ok;
+#else
+  int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (file < 0) {
+    return false;
+  }
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t written = write(file, data.data() + offset, data.size() - offset);
+    if (written < 0) {
+      close(file);
+      return false;
+    }
+    offset += static_cast<size_t>(written);
+  }
+  bool ok = fsync(file) == 0;
+  return close(file) == 0 && ok;
+#endif
+}
+
+// The rename itself lives in the directory, POSIX needs that flushed too
+void FlushDirectory(const std::filesystem::path& directory) {
+#ifndef _WIN32
+  int handle = open(directory.c_str(), O_RDONLY);
+  if (handle >= 0) {
+    fsync(handle);
+    close(handle);
+  }
+#else
+  (void)directory;
+#endif
+}
+}  // namespace
+
+void binary::Vulkan::SavePipelineCache() {
+  size_t size = 0;
+  VkResult result;
+  if (pipeline_cache_ == VK_NULL_HANDLE) {
+    return;
+  }
+  result = vkGetPipelineCacheData(logical_device_, pipeline_cache_, &size,
+                                  nullptr);
+  std::vector<char> data(size);
+  if (result == VK_SUCCESS) {
+    result = vkGetPipelineCacheData(logical_device_, pipeline_cache_, &size,
+                                    data.data());
+  }
+  if (result != VK_SUCCESS) {
+    spdlog::error("Failed to read back the pipeline cache {}",
+                  VkResultToString(result));
+    return;
+  }
+  // Written next to the real file, flushed, then renamed over it. A crash or
+  // power loss at any point leaves the old cache (or none) instead of a
+  // corrupt one
+  const std::filesystem::path k_Path(k_PipelineCachePath);
+  const std::filesystem::path k_Temporary =
+      std::filesystem::path(k_PipelineCachePath).concat(".tmp");
+  std::error_code error;
+  std::filesystem::create_directories(k_Path.parent_path(), error);
+  data.resize(size);
+  if (!WriteFileDurably(k_Temporary, data)) {
+    spdlog::error("Failed to write pipeline cache to {}",
+                  k_Temporary.string());
+    return;
+  }
+  std::filesystem::rename(k_Temporary, k_Path, error);
+  if (error) {
+    spdlog::error("Failed to replace pipeline cache {}: {}",
+                  k_PipelineCachePath, error.message());
+    return;
+  }
+  FlushDirectory(k_Path.parent_path());
+  spdlog::info("Saved {} bytes of pipeline cache to {}", size,
+               k_PipelineCachePath);
+}
+
+VkResult binary::Vulkan::CreateCachedGraphicsPipeline(
+    const char* name, VkGraphicsPipelineCreateInfo& pipeline_info,
+    VkPipeline* pipeline) {
+  VkPipelineCreationFeedback feedback{};
+  VkPipelineCreationFeedbackCreateInfo feedback_info{};
+  const void* next = pipeline_info.pNext;
+  if (pipeline_feedback_supported_) {
+    feedback_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+    feedback_info.pNext = next;
+    feedback_info.pPipelineCreationFeedback = &feedback;
+    pipeline_info.pNext = &feedback_info;
+  }
+  const auto k_Start = std::chrono::steady_clock::now();
+  VkResult result = vkCreateGraphicsPipelines(
+      logical_device_, pipeline_cache_, 1, &pipeline_info, allocator_,
+      pipeline);
+  const std::chrono::duration<double, std::milli> k_Elapsed =
+      std::chrono::steady_clock::now() - k_Start;
+  pipeline_info.pNext = next;
+
+  const char* cache_hit = "unknown";
+  if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) {
+    cache_hit =
+        (feedback.flags &
+         VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+            ? "hit"
+            : "miss";
+  }
+  spdlog::info("Created {} pipeline in {:.2f} ms, pipeline cache {}", name,
+               k_Elapsed.count(), cache_hit);
+  return result;
+}
@@ -0,0 +1,518 @@
+#include "../include/renderer_vulkan.h"
+#include <algorithm>
+
+// Vulkan Post-Processing
+//
+// A chain of full screen passes from binary_config.yaml. Each one is its own
+// small render pass drawing one triangle into a swapchain sized RGBA8
+// target, recorded before the main render pass. The first pass reads the
+// image a VulkanViewport set with SetPostProcessSource(), the emulator's
+// frame after palette.comp expanded it, and ImGui draws the last target in
+// its place. Passes without history ping-pong between two shared targets, a
+// pass with history owns one target per frame in flight and reads the other
+// one, its output from the frame before.
+
+namespace binary {
+namespace {
+// The shaders in shaders/post a pass can name
+typedef struct PostProcessEffect {
+  const char* name;
+  bool history;
+  float strength;
+} PostProcessEffect;
+
+constexpr std::array<PostProcessEffect, 4> k_PostProcessEffects = {{
+    {"sharp_bilinear", false, 1.0f},
+    {"lcd_grid", false, 0.25f},
+    {"frame_blend", true, 0.5f},
+    {"crt", false, 0.5f}}};
+
+// Matches the push_constant block of the shaders
+typedef struct PostProcessConstants {
+  glm::vec2 texture_size;
+  glm::vec2 output_size;
+  float strength;
+} PostProcessConstants;
+
+constexpr VkFormat k_PostProcessFormat = VK_FORMAT_R8G8B8A8_UNORM;
+constexpr uint32_t k_PingPongTargets = 2;
+// What the first pass reads, the source image rather than a target
+constexpr uint32_t k_SourceInput = UINT32_MAX;
+}  // namespace
+}  // namespace binary
+
+void binary::Vulkan::CreatePostProcessPipelines() {
+  VkAttachmentDescription color_attachment{};
+  VkAttachmentReference color_attachment_reference{};
+  VkSubpassDescription subpass{};
+  std::array<VkSubpassDependency, 2> dependencies{};
+  VkRenderPassCreateInfo render_pass_info{};
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  VkPushConstantRange push_constant_range{};
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  VkSamplerCreateInfo sampler_info{};
+  VkPipelineShaderStageCreateInfo shader_stages[2] = {};
+  std::vector<VkDynamicState> dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT,
+                                                VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamic_state{};
+  VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+  VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+  VkPipelineViewportStateCreateInfo viewport_state{};
+  VkPipelineRasterizationStateCreateInfo rasterizer{};
+  VkPipelineMultisampleStateCreateInfo multisampling{};
+  VkPipelineColorBlendAttachmentState color_blend_attachment{};
+  VkPipelineColorBlendStateCreateInfo color_blending{};
+  VkGraphicsPipelineCreateInfo pipeline_info{};
+  VkResult result;
+  if (post_process_passes_.empty()) {
+    return;
+  }
+
+  // Every pass writes its whole target, nothing to load
+  color_attachment.format = k_PostProcessFormat;
+  color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  color_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  color_attachment_reference.attachment = 0;
+  color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &color_attachment_reference;
+
+  // The frame before may still be sampling or writing the target
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  // The next pass or the main render pass samples it
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  render_pass_info.attachmentCount = 1;
+  render_pass_info.pAttachments = &color_attachment;
+  render_pass_info.subpassCount = 1;
+  render_pass_info.pSubpasses = &subpass;
+  render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  render_pass_info.pDependencies = dependencies.data();
+  result = vkCreateRenderPass(logical_device_, &render_pass_info, allocator_,
+                              &post_process_render_pass_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create post-processing Render Pass!: {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create post-processing Render Pass!:" +
+                             VkResultToString(result));
+  }
+
+  // Binding 0 is the input, binding 1 the pass's output from the last frame
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  }
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+  layout_info.pBindings = bindings.data();
+  result = vkCreateDescriptorSetLayout(logical_device_, &layout_info,
+                                       allocator_, &post_process_set_layout_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create post-processing descriptor set "
+                     "layout! {}", VkResultToString(result));
+    throw std::runtime_error(
+        "failed to create post-processing descriptor set layout!" +
+        VkResultToString(result));
+  }
+
+  push_constant_range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  push_constant_range.offset = 0;
+  push_constant_range.size = sizeof(PostProcessConstants);
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &post_process_set_layout_;
+  pipeline_layout_info.pushConstantRangeCount = 1;
+  pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+  result = vkCreatePipelineLayout(logical_device_, &pipeline_layout_info,
+                                  allocator_, &post_process_pipeline_layout_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create post-processing pipeline layout! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create post-processing pipeline "
+                             "layout! " + VkResultToString(result));
+  }
+
+  // Bilinear, the shaders snap to texel centres themselves where they want
+  // sharp pixels
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_LINEAR;
+  sampler_info.minFilter = VK_FILTER_LINEAR;
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.maxAnisotropy = 1.0f;
+  sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  result = vkCreateSampler(logical_device_, &sampler_info, allocator_,
+                           &post_process_sampler_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create post-processing sampler! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("failed to create post-processing sampler!");
+  }
+
+  // Everything but the fragment shader is the same for every pass. No
+  // vertex input, the vertex shader makes the triangle from gl_VertexIndex.
+  shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+  shader_stages[0].module =
+      CreateShaderModule(ReadFile("shaders/post/fullscreen.spv"));
+  shader_stages[0].pName = "main";
+  shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  shader_stages[1].pName = "main";
+
+  vertex_input_info.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  input_assembly.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  input_assembly.primitiveRestartEnable = VK_FALSE;
+  dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamic_state.dynamicStateCount =
+      static_cast<uint32_t>(dynamic_states.size());
+  dynamic_state.pDynamicStates = dynamic_states.data();
+  viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewport_state.viewportCount = 1;
+  viewport_state.scissorCount = 1;
+  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth = 1.0f;
+  rasterizer.cullMode = VK_CULL_MODE_NONE;
+  rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+  multisampling.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  color_blend_attachment.colorWriteMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  color_blend_attachment.blendEnable = VK_FALSE;
+  color_blending.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  color_blending.attachmentCount = 1;
+  color_blending.pAttachments = &color_blend_attachment;
+
+  pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipeline_info.stageCount = 2;
+  pipeline_info.pStages = shader_stages;
+  pipeline_info.pVertexInputState = &vertex_input_info;
+  pipeline_info.pInputAssemblyState = &input_assembly;
+  pipeline_info.pViewportState = &viewport_state;
+  pipeline_info.pRasterizationState = &rasterizer;
+  pipeline_info.pMultisampleState = &multisampling;
+  pipeline_info.pColorBlendState = &color_blending;
+  pipeline_info.pDynamicState = &dynamic_state;
+  pipeline_info.layout = post_process_pipeline_layout_;
+  pipeline_info.renderPass = post_process_render_pass_;
+  pipeline_info.subpass = 0;
+
+  for (const PostProcessPass& pass : post_process_passes_) {
+    const auto k_Effect = std::find_if(
+        k_PostProcessEffects.begin(), k_PostProcessEffects.end(),
+        [&pass](const PostProcessEffect& effect) {
+          return pass.shader == effect.name;
+        });
+    if (k_Effect == k_PostProcessEffects.end()) {
+      spdlog::error("Unknown post-processing shader {}, skipping it",
+                    pass.shader);
+      continue;
+    }
+    PostProcessStage stage{};
+    stage.history_ = k_Effect->history;
+    stage.strength_ =
+        std::clamp(pass.strength.value_or(k_Effect->strength), 0.0f, 1.0f);
+    shader_stages[1].module = CreateShaderModule(
+        ReadFile("shaders/post/" + pass.shader + ".spv"));
+    result = CreateCachedGraphicsPipeline(k_Effect->name, pipeline_info,
+                                          &stage.pipeline_);
+    vkDestroyShaderModule(logical_device_, shader_stages[1].module,
+                          allocator_);
+    if (result != VK_SUCCESS) {
+      spdlog::critical("Failed to create {} pipeline {}", k_Effect->name,
+                       VkResultToString(result));
+      throw std::runtime_error("");
+    }
+    post_process_stages_.push_back(stage);
+  }
+  vkDestroyShaderModule(logical_device_, shader_stages[0].module, allocator_);
+}
+
+void binary::Vulkan::DestroyPostProcessPipelines() {
+  for (PostProcessStage& stage : post_process_stages_) {
+    vkDestroyPipeline(logical_device_, stage.pipeline_, allocator_);
+  }
+  post_process_stages_.clear();
+  vkDestroySampler(logical_device_, post_process_sampler_, allocator_);
+  post_process_sampler_ = VK_NULL_HANDLE;
+  vkDestroyPipelineLayout(logical_device_, post_process_pipeline_layout_,
+                          allocator_);
+  post_process_pipeline_layout_ = VK_NULL_HANDLE;
+  vkDestroyDescriptorSetLayout(logical_device_, post_process_set_layout_,
+                               allocator_);
+  post_process_set_layout_ = VK_NULL_HANDLE;
+  vkDestroyRenderPass(logical_device_, post_process_render_pass_, allocator_);
+  post_process_render_pass_ = VK_NULL_HANDLE;
+}
+
+void binary::Vulkan::CreatePostProcessTargets() {
+  uint32_t target_count = k_PingPongTargets;
+  VkDescriptorPoolSize pool_size{};
+  VkDescriptorPoolCreateInfo pool_info{};
+  std::vector<VkDescriptorSetLayout> layouts(k_MaxFramesInFlight,
+                                             post_process_set_layout_);
+  VkDescriptorSetAllocateInfo allocate_info{};
+  std::array<uint32_t, k_MaxFramesInFlight> inputs{};
+  uint32_t history_target = k_PingPongTargets;
+  VkResult result;
+  if (post_process_stages_.empty()) {
+    return;
+  }
+  for (const PostProcessStage& stage : post_process_stages_) {
+    if (stage.history_) {
+      target_count += k_MaxFramesInFlight;
+    }
+  }
+
+  // Cleared so the history read on the first frame is black instead of
+  // undefined, and every target starts out in SHADER_READ_ONLY_OPTIMAL
+  UploadBatch uploads(logical_device_, command_pool_, graphics_queue_,
+                      vma_allocator_, staging_pool_);
+  post_process_targets_.resize(target_count);
+  for (PostProcessTarget& target : post_process_targets_) {
+    VkFramebufferCreateInfo frame_buffer_info{};
+    CreateImage(swap_chain_.extent_.width, swap_chain_.extent_.height,
+                k_PostProcessFormat, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_SAMPLED_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target.image_,
+                target.allocation_);
+    uploads.ClearImage(target.image_);
+    target.view_ = CreateImageView(target.image_, k_PostProcessFormat,
+                                   VK_IMAGE_ASPECT_COLOR_BIT);
+    frame_buffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    frame_buffer_info.renderPass = post_process_render_pass_;
+    frame_buffer_info.attachmentCount = 1;
+    frame_buffer_info.pAttachments = &target.view_;
+    frame_buffer_info.width = swap_chain_.extent_.width;
+    frame_buffer_info.height = swap_chain_.extent_.height;
+    frame_buffer_info.layers = 1;
+    result = vkCreateFramebuffer(logical_device_, &frame_buffer_info,
+                                 allocator_, &target.frame_buffer_);
+    if (result != VK_SUCCESS) {
+      spdlog::critical("Failed to create post-processing Frame Buffer!: {}",
+                       VkResultToString(result));
+      throw std::runtime_error("");
+    }
+  }
+  uploads.Submit();
+
+  // One set per pass and frame in flight, they only change with the targets
+  // and the source
+  pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  pool_size.descriptorCount = static_cast<uint32_t>(
+      post_process_stages_.size() * k_MaxFramesInFlight * 2);
+  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  pool_info.poolSizeCount = 1;
+  pool_info.pPoolSizes = &pool_size;
+  pool_info.maxSets = static_cast<uint32_t>(post_process_stages_.size() *
+                                            k_MaxFramesInFlight);
+  result = vkCreateDescriptorPool(logical_device_, &pool_info, allocator_,
+                                  &post_process_descriptor_pool_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create post-processing Descriptor Pool! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create post-processing Descriptor "
+                             "Pool!: " + VkResultToString(result));
+  }
+  allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocate_info.descriptorPool = post_process_descriptor_pool_;
+  allocate_info.descriptorSetCount = static_cast<uint32_t>(k_MaxFramesInFlight);
+  allocate_info.pSetLayouts = layouts.data();
+
+  // Which target every pass reads and writes
+  inputs.fill(k_SourceInput);
+  for (PostProcessStage& stage : post_process_stages_) {
+    result = vkAllocateDescriptorSets(logical_device_, &allocate_info,
+                                      stage.descriptor_sets_.data());
+    if (result != VK_SUCCESS) {
+      spdlog::critical("Failed to create post-processing descriptor set!: {}",
+                       VkResultToString(result));
+      throw std::runtime_error("Failed to create post-processing descriptor "
+                               "set! " + VkResultToString(result));
+    }
+    for (uint32_t frame = 0; frame < k_MaxFramesInFlight; frame++) {
+      stage.input_[frame] = inputs[frame];
+      if (stage.history_) {
+        stage.target_[frame] = history_target + frame;
+      } else {
+        stage.target_[frame] = inputs[frame] == 0 ? 1 : 0;
+      }
+      inputs[frame] = stage.target_[frame];
+    }
+    if (stage.history_) {
+      history_target += k_MaxFramesInFlight;
+    }
+  }
+  WritePostProcessDescriptorSets();
+}
+
+void binary::Vulkan::WritePostProcessDescriptorSets() {
+  // A set can't point at nothing, they're written once there's a source and
+  // the chain isn't recorded before that
+  if (post_process_source_ == VK_NULL_HANDLE ||
+      post_process_descriptor_pool_ == VK_NULL_HANDLE) {
+    return;
+  }
+  const auto k_InputView = [this](uint32_t input) {
+    return input == k_SourceInput ? post_process_source_
+                                  : post_process_targets_[input].view_;
+  };
+  for (PostProcessStage& stage : post_process_stages_) {
+    for (uint32_t frame = 0; frame < k_MaxFramesInFlight; frame++) {
+      std::array<VkDescriptorImageInfo, 2> image_infos{};
+      std::array<VkWriteDescriptorSet, 2> descriptor_writes{};
+      image_infos[0].imageView = k_InputView(stage.input_[frame]);
+      image_infos[1].imageView = image_infos[0].imageView;
+      if (stage.history_) {
+        // The other frame's target, what this pass wrote the frame before
+        image_infos[1].imageView =
+            post_process_targets_[stage.target_[(frame + 1) %
+                                                k_MaxFramesInFlight]]
+                .view_;
+      }
+      for (uint32_t i = 0; i < descriptor_writes.size(); i++) {
+        image_infos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_infos[i].sampler = post_process_sampler_;
+        descriptor_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[i].dstSet = stage.descriptor_sets_[frame];
+        descriptor_writes[i].dstBinding = i;
+        descriptor_writes[i].descriptorType =
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptor_writes[i].descriptorCount = 1;
+        descriptor_writes[i].pImageInfo = &image_infos[i];
+      }
+      vkUpdateDescriptorSets(logical_device_,
+                             static_cast<uint32_t>(descriptor_writes.size()),
+                             descriptor_writes.data(), 0, nullptr);
+    }
+  }
+}
+
+void binary::Vulkan::DestroyPostProcessTargets() {
+  for (VkDescriptorSet& output : post_process_outputs_) {
+    if (output != VK_NULL_HANDLE) {
+      ImGui_ImplVulkan_RemoveTexture(output);
+      output = VK_NULL_HANDLE;
+    }
+  }
+  // Frees the descriptor sets with it
+  vkDestroyDescriptorPool(logical_device_, post_process_descriptor_pool_,
+                          allocator_);
+  post_process_descriptor_pool_ = VK_NULL_HANDLE;
+  for (PostProcessTarget& target : post_process_targets_) {
+    vkDestroyFramebuffer(logical_device_, target.frame_buffer_, allocator_);
+    vkDestroyImageView(logical_device_, target.view_, allocator_);
+    vmaDestroyImage(vma_allocator_, target.image_, target.allocation_);
+  }
+  post_process_targets_.clear();
+}
+
+void binary::Vulkan::SetPostProcessSource(VkImageView view,
+                                          VkExtent2D extent) {
+  if (view == post_process_source_) {
+    post_process_source_extent_ = extent;
+    return;
+  }
+  // The frames in flight may still be reading the old source through the
+  // sets, they can't be written before those are done
+  if (!in_flight_fence_.empty()) {
+    vkWaitForFences(logical_device_,
+                    static_cast<uint32_t>(in_flight_fence_.size()),
+                    in_flight_fence_.data(), VK_TRUE, UINT64_MAX);
+  }
+  post_process_source_ = view;
+  post_process_source_extent_ = extent;
+  WritePostProcessDescriptorSets();
+}
+
+VkDescriptorSet binary::Vulkan::PostProcessOutput() {
+  if (headless_ || post_process_stages_.empty() ||
+      post_process_targets_.empty() ||
+      post_process_source_ == VK_NULL_HANDLE) {
+    return VK_NULL_HANDLE;
+  }
+  VkDescriptorSet& output = post_process_outputs_[current_frame_];
+  if (output == VK_NULL_HANDLE) {
+    const PostProcessStage& k_Last = post_process_stages_.back();
+    output = ImGui_ImplVulkan_AddTexture(
+        post_process_sampler_,
+        post_process_targets_[k_Last.target_[current_frame_]].view_,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
+  return output;
+}
+
+void binary::Vulkan::RecordPostProcess(VkCommandBuffer command_buffer) {
+  VkRenderPassBeginInfo render_pass_info{};
+  VkViewport viewport{};
+  VkRect2D scissor{};
+  PostProcessConstants constants{};
+  if (post_process_source_ == VK_NULL_HANDLE) {
+    return;
+  }
+  constants.texture_size = glm::vec2(post_process_source_extent_.width,
+                                     post_process_source_extent_.height);
+  constants.output_size =
+      glm::vec2(swap_chain_.extent_.width, swap_chain_.extent_.height);
+  viewport.width = static_cast<float>(swap_chain_.extent_.width);
+  viewport.height = static_cast<float>(swap_chain_.extent_.height);
+  viewport.maxDepth = 1.0f;
+  scissor.extent = swap_chain_.extent_;
+  render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  render_pass_info.renderPass = post_process_render_pass_;
+  render_pass_info.renderArea.extent = swap_chain_.extent_;
+
+  for (const PostProcessStage& stage : post_process_stages_) {
+    render_pass_info.framebuffer =
+        post_process_targets_[stage.target_[current_frame_]].frame_buffer_;
+    constants.strength = stage.strength_;
+    vkCmdBeginRenderPass(command_buffer, &render_pass_info,
+                         VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      stage.pipeline_);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            post_process_pipeline_layout_, 0, 1,
+                            &stage.descriptor_sets_[current_frame_], 0,
+                            nullptr);
+    vkCmdPushConstants(command_buffer, post_process_pipeline_layout_,
+                       VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants),
+                       &constants);
+    vkCmdDraw(command_buffer, 3, 1, 0, 0);
+    vkCmdEndRenderPass(command_buffer);
+  }
+}
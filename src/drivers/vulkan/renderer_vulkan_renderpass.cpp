@@ -7,7 +7,7 @@ void binary::Vulkan::CreateRenderPass() {
   VkAttachmentReference color_attachment_reference{};
   VkSubpassDescription subpass{};
   VkRenderPassCreateInfo render_pass_info{};
-  VkSubpassDependency dependency{};
+  std::array<VkSubpassDependency, 2> dependencies{};
   VkAttachmentDescription attachments{};
   color_attachment.format = swap_chain_.image_format_;
   color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -16,7 +16,10 @@ void binary::Vulkan::CreateRenderPass() {
   color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // Headless frames get copied to the readback buffer instead of presented
+  color_attachment.finalLayout = headless_
+                                     ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                     : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   color_attachment_reference.attachment = 0;
   color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -25,12 +28,21 @@ void binary::Vulkan::CreateRenderPass() {
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &color_attachment_reference;
 
-  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.dstSubpass = 0;
-  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.srcAccessMask = 0;
-  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+  // RecordReadBack() copies the image right after the render pass, the copy
+  // has to wait for the attachment writes and the final layout transition
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
   attachments = color_attachment;
   render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -38,8 +50,9 @@ void binary::Vulkan::CreateRenderPass() {
   render_pass_info.pAttachments = &attachments;
   render_pass_info.subpassCount = 1;
   render_pass_info.pSubpasses = &subpass;
-  render_pass_info.dependencyCount = 1;
-  render_pass_info.pDependencies = &dependency;
+  // Presenting waits on the render finished semaphore instead
+  render_pass_info.dependencyCount = headless_ ? 2 : 1;
+  render_pass_info.pDependencies = dependencies.data();
 
   VkResult result = vkCreateRenderPass(logical_device_, &render_pass_info,
                                        allocator_, &render_pass_);
@@ -9,6 +9,10 @@ void binary::Vulkan::CleanUpSwapChain() {
     vkDestroyImageView(logical_device_, swap_chain_.image_views_[i],
                        allocator_);
   }
+  DestroyPostProcessTargets();
+  if (headless_) {
+    DestroyOffscreenTarget();
+  }
   vkDestroySwapchainKHR(logical_device_, swap_chain_.KHR_, allocator_);
 }
 
@@ -27,6 +31,7 @@ void binary::Vulkan::RecreateSwapChain(SDL_Window* window_,
   CreateSwapChain(window_);
   CreateImageViews();
   CreateFrameBuffer();
+  CreatePostProcessTargets();
 }
 
 void binary::Vulkan::CreateSwapChain(SDL_Window* window_) {
@@ -45,6 +50,10 @@ void binary::Vulkan::CreateSwapChain(SDL_Window* window_) {
                                             indices.present_family.value()};
 
   image_count = swap_chain_support.capabilities.minImageCount;
+  // Mailbox wants one image on screen, one waiting and one to draw into
+  if (present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
+    image_count++;
+  }
   if (swap_chain_support.capabilities.maxImageCount > 0 &&
       image_count > swap_chain_support.capabilities.maxImageCount) {
     image_count = swap_chain_support.capabilities.maxImageCount;
@@ -52,7 +61,7 @@ void binary::Vulkan::CreateSwapChain(SDL_Window* window_) {
 
   swap_chain_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
   swap_chain_info.surface = surface_;
-  swap_chain_info.minImageCount = swap_chain_support.capabilities.minImageCount;
+  swap_chain_info.minImageCount = image_count;
   swap_chain_info.imageFormat = surface_format.format;
   swap_chain_info.imageColorSpace = surface_format.colorSpace;
   swap_chain_info.imageExtent = extent;
@@ -72,7 +81,7 @@ void binary::Vulkan::CreateSwapChain(SDL_Window* window_) {
   swap_chain_info.preTransform =
       swap_chain_support.capabilities.currentTransform;
   swap_chain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-  swap_chain_info.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+  swap_chain_info.presentMode = present_mode;
   swap_chain_info.clipped = VK_TRUE;
   // swap_chain_info.oldSwapchain   = VK_NULL_HANDLE;
 
@@ -110,10 +119,13 @@ VkPresentModeKHR binary::Vulkan::ChooseSwapPresentMode(
     const std::vector<VkPresentModeKHR>& available_present_modes) {
   for (const VkPresentModeKHR& available_present_mode :
        available_present_modes) {
-    if (available_present_mode == VK_PRESENT_MODE_FIFO_KHR) {
+    if (available_present_mode == present_mode_) {
       return available_present_mode;
     }
   }
+  // FIFO is the one every surface has to support
+  spdlog::warn("{} isn't supported by the surface, using FIFO",
+               string_VkPresentModeKHR(present_mode_));
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -3,17 +3,15 @@
 void binary::Vulkan::CreateUniformBuffers() {
   VkDeviceSize buffer_size = sizeof(UniformBufferObject);
   uniform_buffer_.resize(k_MaxFramesInFlight);
-  uniform_buffer_memory_.resize(k_MaxFramesInFlight);
+  uniform_buffer_allocation_.resize(k_MaxFramesInFlight);
   uniform_buffer_mapped_.resize(k_MaxFramesInFlight);
   for (size_t i = 0; i < k_MaxFramesInFlight; i++) {
-
+    // Written every frame, so they stay mapped for the renderer's lifetime
     CreateBuffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 uniform_buffer_[i], uniform_buffer_memory_[i]);
-
-    vkMapMemory(logical_device_, uniform_buffer_memory_[i], 0, buffer_size, 0,
-                &uniform_buffer_mapped_[i]);
+                 uniform_buffer_[i], uniform_buffer_allocation_[i],
+                 uniform_pool_, &uniform_buffer_mapped_[i]);
   }
 }
 
@@ -0,0 +1,220 @@
+#include <cstring>
+#include <utility>
+#include "../include/renderer_vulkan.h"
+
+binary::UploadBatch::UploadBatch(VkDevice logical_device,
+                                 VkCommandPool command_pool, VkQueue queue,
+                                 VmaAllocator vma_allocator,
+                                 VmaPool staging_pool)
+    : logical_device_(logical_device),
+      command_pool_(command_pool),
+      queue_(queue),
+      vma_allocator_(vma_allocator),
+      staging_pool_(staging_pool) {}
+
+binary::UploadBatch::UploadBatch(UploadBatch&& other) noexcept
+    : logical_device_(other.logical_device_),
+      command_pool_(other.command_pool_),
+      queue_(other.queue_),
+      vma_allocator_(other.vma_allocator_),
+      staging_pool_(other.staging_pool_),
+      command_buffer_(std::exchange(other.command_buffer_, VK_NULL_HANDLE)),
+      staging_buffers_(std::move(other.staging_buffers_)),
+      uploads_(std::exchange(other.uploads_, 0)) {
+  other.staging_buffers_.clear();
+}
+
+binary::UploadBatch::~UploadBatch() {
+  try {
+    Submit();
+  } catch (const std::runtime_error& error) {
+    spdlog::critical("Dropped unsubmitted uploads! {}", error.what());
+  }
+}
+
+VkCommandBuffer binary::UploadBatch::Begin() {
+  VkCommandBufferAllocateInfo allocate_info{};
+  VkCommandBufferBeginInfo begin_info{};
+  VkResult result;
+  if (command_buffer_ != VK_NULL_HANDLE) {
+    return command_buffer_;
+  }
+  allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocate_info.commandPool = command_pool_;
+  allocate_info.commandBufferCount = 1;
+  result = vkAllocateCommandBuffers(logical_device_, &allocate_info,
+                                    &command_buffer_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to allocate upload command buffer! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to allocate upload command buffer! " +
+                             VkResultToString(result));
+  }
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(command_buffer_, &begin_info);
+  return command_buffer_;
+}
+
+VkBuffer binary::UploadBatch::Stage(const void* data, VkDeviceSize size) {
+  VkBufferCreateInfo buffer_info{};
+  VmaAllocationCreateInfo allocation_info{};
+  VmaAllocationInfo allocated{};
+  VkBuffer buffer;
+  VmaAllocation allocation;
+  VkResult result;
+  buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buffer_info.size = size;
+  buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  allocation_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  if (size <= k_StagingBlockSize) {
+    allocation_info.pool = staging_pool_;
+  } else {
+    // Too big for any block of the pool, it gets its own memory which goes
+    // away again after Submit()
+    allocation_info.usage = VMA_MEMORY_USAGE_AUTO;
+    allocation_info.flags |=
+        VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT |
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+  }
+  result = vmaCreateBuffer(vma_allocator_, &buffer_info, &allocation_info,
+                           &buffer, &allocation, &allocated);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create staging buffer! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create staging buffer! " +
+                             VkResultToString(result));
+  }
+  memcpy(allocated.pMappedData, data, static_cast<size_t>(size));
+  // The staging pool is host coherent, this only does something for a
+  // dedicated allocation that landed in non coherent memory
+  vmaFlushAllocation(vma_allocator_, allocation, 0, VK_WHOLE_SIZE);
+  staging_buffers_.emplace_back(buffer, allocation);
+  return buffer;
+}
+
+void binary::UploadBatch::Transition(VkImage image, VkImageLayout old_layout,
+                                     VkImageLayout new_layout) {
+  VkImageMemoryBarrier barrier{};
+  VkPipelineStageFlags source_stage;
+  VkPipelineStageFlags destination_stage;
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+  if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+    // The image may be one earlier frames or an earlier upload in this
+    // batch used, wait for their reads and writes before overwriting it
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT |
+                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  } else {
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  }
+  vkCmdPipelineBarrier(Begin(), source_stage, destination_stage, 0, 0,
+                       nullptr, 0, nullptr, 1, &barrier);
+}
+
+void binary::UploadBatch::UploadImage(VkImage image, uint32_t width,
+                                      uint32_t height, const void* pixels,
+                                      VkDeviceSize size) {
+  VkBufferImageCopy region{};
+  const VkBuffer k_Staging = Stage(pixels, size);
+  Transition(image, VK_IMAGE_LAYOUT_UNDEFINED,
+             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyBufferToImage(Begin(), k_Staging, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+  Transition(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  uploads_++;
+}
+
+void binary::UploadBatch::ClearImage(VkImage image) {
+  VkClearColorValue black = {{0.0f, 0.0f, 0.0f, 1.0f}};
+  VkImageSubresourceRange range{};
+  range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  range.levelCount = 1;
+  range.layerCount = 1;
+  Transition(image, VK_IMAGE_LAYOUT_UNDEFINED,
+             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  vkCmdClearColorImage(Begin(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       &black, 1, &range);
+  Transition(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  uploads_++;
+}
+
+void binary::UploadBatch::UploadBuffer(VkBuffer buffer, const void* data,
+                                       VkDeviceSize size) {
+  VkBufferCopy region{};
+  const VkBuffer k_Staging = Stage(data, size);
+  region.size = size;
+  vkCmdCopyBuffer(Begin(), k_Staging, buffer, 1, &region);
+  uploads_++;
+}
+
+void binary::UploadBatch::Submit() {
+  VkMemoryBarrier barrier{};
+  VkSubmitInfo submit_info{};
+  VkFenceCreateInfo fence_info{};
+  VkFence fence;
+  VkResult result;
+  if (command_buffer_ == VK_NULL_HANDLE) {
+    return;
+  }
+  // Whatever reads the buffers later (vertex input, index fetch ...) sees
+  // the copies, the fence wait alone doesn't order GPU work
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+  vkCmdPipelineBarrier(command_buffer_, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+  vkEndCommandBuffer(command_buffer_);
+
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  result = vkCreateFence(logical_device_, &fence_info, nullptr, &fence);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create upload fence! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create upload fence! " +
+                             VkResultToString(result));
+  }
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &command_buffer_;
+  result = vkQueueSubmit(queue_, 1, &submit_info, fence);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to submit uploads! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to submit uploads! " +
+                             VkResultToString(result));
+  }
+  // Only waits for this batch, not for everything else on the queue like
+  // vkQueueWaitIdle() would
+  vkWaitForFences(logical_device_, 1, &fence, VK_TRUE, UINT64_MAX);
+  vkDestroyFence(logical_device_, fence, nullptr);
+  vkFreeCommandBuffers(logical_device_, command_pool_, 1, &command_buffer_);
+  command_buffer_ = VK_NULL_HANDLE;
+  for (const auto& [buffer, allocation] : staging_buffers_) {
+    vmaDestroyBuffer(vma_allocator_, buffer, allocation);
+  }
+  staging_buffers_.clear();
+  spdlog::debug("Submitted {} uploads in one batch", uploads_);
+  uploads_ = 0;
+}
@@ -0,0 +1,691 @@
+#include "include/gb_apu.h"
+#include "include/gb_instruction.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace binary::gb {
+namespace {
+// One more phase than there are, the last one is the first shifted by a
+// sample so every phase has a next one to interpolate towards
+typedef std::array<std::array<float, BlipBuffer::k_Taps>,
+                   BlipBuffer::k_Phases + 1>
+    StepKernel;
+
+constexpr uint32_t k_FractionBits = 32;
+constexpr uint32_t k_PhaseBits = 5;
+static_assert((1 << k_PhaseBits) == BlipBuffer::k_Phases);
+constexpr uint32_t k_InterpolationBits = 16;
+// Where the sinc's main lobe ends, as a fraction of the sample rate. A bit
+// under Nyquist so the window's transition band doesn't fold back.
+constexpr double k_Cutoff = 0.45;
+// Per T-cycle, reference: https://gbdev.io/pandocs/Audio_details.html
+constexpr double k_ChargeFactor = 0.999958;
+
+// Blackman windowed sinc impulses, one per phase between two samples.
+// Integrating one gives a band limited step. Steps between two phases
+// interpolate, rounding the time to a phase would add jitter noise of its
+// own.
+const StepKernel& Kernel() {
+  static const StepKernel k_Kernel = [] {
+    StepKernel kernel{};
+    constexpr double k_Half = BlipBuffer::k_Taps / 2.0;
+    for (size_t phase = 0; phase <= BlipBuffer::k_Phases; phase++) {
+      std::array<double, BlipBuffer::k_Taps> taps{};
+      double sum = 0;
+      for (size_t tap = 0; tap < taps.size(); tap++) {
+        const double k_X = static_cast<double>(tap) - (k_Half - 1) -
+                           static_cast<double>(phase) / BlipBuffer::k_Phases;
+        const double k_Sinc =
+            (k_X == 0) ? 2 * k_Cutoff
+                       : std::sin(2 * std::numbers::pi * k_Cutoff * k_X) /
+                             (std::numbers::pi * k_X);
+        const double k_Window =
+            0.42 + 0.5 * std::cos(std::numbers::pi * k_X / k_Half) +
+            0.08 * std::cos(2 * std::numbers::pi * k_X / k_Half);
+        taps[tap] = k_Sinc * k_Window;
+        sum += taps[tap];
+      }
+      // Every phase has to add up to exactly the step it represents
+      for (size_t tap = 0; tap < taps.size(); tap++) {
+        kernel[phase][tap] = static_cast<float>(taps[tap] / sum);
+      }
+    }
+    return kernel;
+  }();
+  return k_Kernel;
+}
+
+// Sound registers 0xFF10-0xFF23 are 5 per channel, NR20 and NR40 don't exist
+constexpr uint16_t k_ChannelRegisters = 5;
+constexpr uint8_t k_SoundStart = 0x10;
+constexpr size_t k_Square1 = 0;
+constexpr size_t k_Square2 = 1;
+constexpr size_t k_Wave = 2;
+constexpr size_t k_Noise = 3;
+// Bits set when reading back, write only bits read as 1
+constexpr std::array<uint8_t, 0x17> k_ReadMasks = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF,  // NR10-NR14
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,  // NR20-NR24
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,  // NR30-NR34
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,  // NR40-NR44
+    0x00, 0x00, 0x70};             // NR50-NR52
+constexpr std::array<uint8_t, 4> k_DutyPatterns = {0x01, 0x81, 0x87, 0x7E};
+// NR32 output level as a right shift of the 4 bit sample
+constexpr std::array<uint8_t, 4> k_WaveShifts = {4, 0, 1, 2};
+constexpr std::array<uint8_t, 8> k_NoiseDivisors = {8,  16, 32, 48,
+                                                    64, 80, 96, 112};
+constexpr uint8_t k_Trigger = 0x80;
+constexpr uint8_t k_LengthEnable = 0x40;
+constexpr uint8_t k_Power = 0x80;
+// 480 is the loudest a side gets, 4 channels at 15 times a gain of 8
+constexpr float k_VolumeScale = 64.0f;
+// A BlipBuffer frame longer than this gets split, one frame sequencer step
+constexpr uint64_t k_MaxFrameTime = k_FrameSequencerCycles * 4;
+
+inline uint8_t& Nr(GameBoy* gb, const size_t k_Channel,
+                   const size_t k_Register) {
+  return gb->bus_.io_registers_[k_SoundStart +
+                                k_Channel * k_ChannelRegisters + k_Register];
+}
+
+inline uint8_t& Io(GameBoy* gb, const HardwareRegistersName k_Register) {
+  return gb->bus_.io_registers_[static_cast<uint16_t>(k_Register) -
+                                static_cast<uint16_t>(
+                                    MemoryMap::k_IoRegistersStart)];
+}
+
+inline uint16_t Frequency(GameBoy* gb, const size_t k_Channel) {
+  return Nr(gb, k_Channel, 3) | ((Nr(gb, k_Channel, 4) & 0x07) << 8);
+}
+
+// Channels 1, 2 and 4 have their DAC on as long as NRx2 isn't 0 or 8
+inline bool DacEnabled(GameBoy* gb, const size_t k_Channel) {
+  if (k_Channel == k_Wave) {
+    return (Nr(gb, k_Wave, 0) & 0x80) != 0;
+  }
+  return (Nr(gb, k_Channel, 2) & 0xF8) != 0;
+}
+
+inline uint64_t SquarePeriod(GameBoy* gb, const size_t k_Channel) {
+  return (2048 - Frequency(gb, k_Channel)) * 4;
+}
+
+inline uint64_t WavePeriod(GameBoy* gb) {
+  return (2048 - Frequency(gb, k_Wave)) * 2;
+}
+
+inline uint64_t NoisePeriod(GameBoy* gb) {
+  const uint8_t k_Nr43 = Nr(gb, k_Noise, 3);
+  return static_cast<uint64_t>(k_NoiseDivisors[k_Nr43 & 0x07])
+         << (k_Nr43 >> 4);
+}
+
+// Channel 1's frequency after the next sweep step, over 2047 turns it off
+inline uint16_t SweepTarget(GameBoy* gb, const SquareChannel& k_Channel) {
+  const uint8_t k_Nr10 = Nr(gb, k_Square1, 0);
+  const uint16_t k_Delta = k_Channel.shadow_frequency_ >> (k_Nr10 & 0x07);
+  if (k_Nr10 & 0x08) {
+    return k_Channel.shadow_frequency_ - k_Delta;
+  }
+  return k_Channel.shadow_frequency_ + k_Delta;
+}
+
+void ClockEnvelope(GameBoy* gb, const size_t k_Channel, Envelope& envelope) {
+  const uint8_t k_Nrx2 = Nr(gb, k_Channel, 2);
+  const uint8_t k_Pace = k_Nrx2 & 0x07;
+  if (k_Pace == 0 || --envelope.timer_ != 0) {
+    return;
+  }
+  envelope.timer_ = k_Pace;
+  if ((k_Nrx2 & 0x08) && envelope.volume_ < 15) {
+    envelope.volume_++;
+  } else if (!(k_Nrx2 & 0x08) && envelope.volume_ > 0) {
+    envelope.volume_--;
+  }
+}
+}  // namespace
+
+BlipBuffer::BlipBuffer() { SetRates(k_ClockRate, k_DefaultSampleRate); }
+
+void BlipBuffer::SetRates(const uint32_t k_InputRate,
+                          const uint32_t k_SampleRate) {
+  input_rate_ = k_InputRate;
+  SetSampleRate(k_SampleRate);
+  Clear();
+}
+
+void BlipBuffer::SetSampleRate(const double k_SampleRate) {
+  factor_ = static_cast<uint64_t>(
+      k_SampleRate * static_cast<double>(uint64_t{1} << k_FractionBits) /
+      input_rate_);
+  charge_factor_ = static_cast<float>(
+      std::pow(k_ChargeFactor, input_rate_ / k_SampleRate));
+}
+
+void BlipBuffer::AddDelta(const uint64_t k_Time, const float k_Delta) {
+  const uint64_t k_Position = offset_ + k_Time * factor_;
+  const size_t k_Sample = k_Position >> k_FractionBits;
+  if (k_Sample >= k_Capacity) [[unlikely]] {
+    return;
+  }
+  const size_t k_Phase =
+      (k_Position >> (k_FractionBits - k_PhaseBits)) & (k_Phases - 1);
+  const float k_Weight =
+      static_cast<float>((k_Position >> (k_FractionBits - k_PhaseBits -
+                                         k_InterpolationBits)) &
+                         ((1 << k_InterpolationBits) - 1)) /
+      (1 << k_InterpolationBits);
+  const std::array<float, k_Taps>& k_Impulse = Kernel()[k_Phase];
+  const std::array<float, k_Taps>& k_Next = Kernel()[k_Phase + 1];
+  const float k_NextDelta = k_Delta * k_Weight;
+  const float k_ThisDelta = k_Delta - k_NextDelta;
+  used_ = std::max(used_, k_Sample + k_Taps);
+  float* deltas = &deltas_[k_Sample];
+  for (size_t tap = 0; tap < k_Taps; tap++) {
+    deltas[tap] += k_Impulse[tap] * k_ThisDelta + k_Next[tap] * k_NextDelta;
+  }
+}
+
+void BlipBuffer::EndFrame(const uint64_t k_Time) {
+  offset_ += k_Time * factor_;
+  available_ = offset_ >> k_FractionBits;
+  // Nobody is reading, drop the oldest samples so the next frames still fit
+  if (available_ > k_Capacity / 2) {
+    ReadSamples(nullptr, available_ - k_Capacity / 4, 1);
+  }
+}
+
+size_t BlipBuffer::ReadSamples(int16_t* output, const size_t k_Count,
+                               const size_t k_Stride) {
+  const size_t k_Read = std::min(k_Count, available_);
+  for (size_t index = 0; index < k_Read; index++) {
+    integrator_ += deltas_[index];
+    const float k_Sample = integrator_ - capacitor_;
+    capacitor_ = integrator_ - k_Sample * charge_factor_;
+    if (output != nullptr) {
+      output[index * k_Stride] = static_cast<int16_t>(
+          std::clamp(std::lround(k_Sample), -32768L, 32767L));
+    }
+  }
+  // The deltas of the unfinished frame and the kernel tails move along
+  const size_t k_Used = std::max(used_, k_Read);
+  std::copy(deltas_.begin() + k_Read, deltas_.begin() + k_Used,
+            deltas_.begin());
+  std::fill(deltas_.begin() + (k_Used - k_Read), deltas_.begin() + k_Used,
+            0.0f);
+  used_ = k_Used - k_Read;
+  available_ -= k_Read;
+  offset_ -= static_cast<uint64_t>(k_Read) << k_FractionBits;
+  return k_Read;
+}
+
+void BlipBuffer::Clear() {
+  std::fill(deltas_.begin(), deltas_.end(), 0.0f);
+  offset_ = 0;
+  available_ = 0;
+  used_ = 0;
+  integrator_ = 0;
+  capacitor_ = 0;
+}
+
+void Apu::Connect(GameBoy* gb) {
+  gb->bus_.MapIo(IORanges::k_AudioStart, IORanges::k_AudioEnd,
+                 ReadAudioRegister, WriteAudioRegister);
+  gb->bus_.MapIo(IORanges::k_WavePatternStart, IORanges::k_WavePatternEnd,
+                 nullptr, WriteWaveRam);
+  gb->scheduler_.SetHandler(EventType::k_ApuFrameSequencer,
+                            ApuFrameSequencerEvent);
+}
+
+void Apu::SetSampleRate(const uint32_t k_SampleRate) {
+  sample_rate_ = k_SampleRate;
+  left_.SetRates(k_ClockRate, k_SampleRate);
+  right_.SetRates(k_ClockRate, k_SampleRate);
+}
+
+void Apu::SetRateRatio(const double k_Ratio) {
+  left_.SetSampleRate(sample_rate_ * k_Ratio);
+  right_.SetSampleRate(sample_rate_ * k_Ratio);
+}
+
+void Apu::RunUntil(GameBoy* gb, const uint64_t k_Time) {
+  if (!powered_) {
+    return;
+  }
+  while (time_ < k_Time) {
+    // Stretches without a frame sequencer event (the event loop isn't
+    // running, or is run by hand) get split so a frame always fits
+    const uint64_t k_End = std::min(k_Time, frame_start_ + k_MaxFrameTime);
+    RunSquare(gb, square1_, k_Square1, k_End);
+    RunSquare(gb, square2_, k_Square2, k_End);
+    RunWave(gb, k_End);
+    RunNoise(gb, k_End);
+    time_ = k_End;
+    if (k_End == frame_start_ + k_MaxFrameTime) {
+      EndBlipFrame(k_End);
+    }
+  }
+}
+
+void Apu::EndFrame(GameBoy* gb) {
+  RunUntil(gb, gb->cycles_ * 4);
+  if (powered_) {
+    EndBlipFrame(time_);
+  }
+}
+
+void Apu::EndBlipFrame(const uint64_t k_Time) {
+  left_.EndFrame(k_Time - frame_start_);
+  right_.EndFrame(k_Time - frame_start_);
+  frame_start_ = k_Time;
+}
+
+size_t Apu::ReadSamples(int16_t* output, const size_t k_Frames) {
+  const size_t k_Read = left_.ReadSamples(output, k_Frames, 2);
+  right_.ReadSamples((output != nullptr) ? output + 1 : nullptr, k_Read, 2);
+  return k_Read;
+}
+
+void Apu::SetPower(GameBoy* gb, const bool k_On) {
+  const uint64_t k_Time = gb->cycles_ * 4;
+  if (k_On && !powered_) {
+    powered_ = true;
+    time_ = k_Time;
+    frame_start_ = k_Time;
+    sequencer_step_ = 0;
+    gb->scheduler_.Schedule(EventType::k_ApuFrameSequencer,
+                            gb->cycles_ + k_FrameSequencerCycles);
+  } else if (!k_On && powered_) {
+    for (size_t channel = 0; channel < k_Channels; channel++) {
+      Disable(channel, k_Time);
+    }
+    UpdatePanning(k_Time, 0, 0);
+    EndBlipFrame(k_Time);
+    powered_ = false;
+    gb->scheduler_.Cancel(EventType::k_ApuFrameSequencer);
+    // Powering off clears every register, wave RAM is left alone
+    std::fill(&Nr(gb, k_Square1, 0),
+              &Io(gb, HardwareRegistersName::k_Nr52), 0);
+    square1_ = {};
+    square2_ = {};
+    wave_ = {};
+    noise_ = {};
+  }
+  Io(gb, HardwareRegistersName::k_Nr52) = k_On ? k_Power : 0;
+}
+
+bool Apu::Enabled(const size_t k_Channel) const {
+  switch (k_Channel) {
+    case k_Square1:
+      return square1_.enabled_;
+    case k_Square2:
+      return square2_.enabled_;
+    case k_Wave:
+      return wave_.enabled_;
+    default:
+      return noise_.enabled_;
+  }
+}
+
+uint8_t Apu::Level(GameBoy* gb, const size_t k_Channel) const {
+  switch (k_Channel) {
+    case k_Square1:
+    case k_Square2: {
+      const SquareChannel& k_Square =
+          (k_Channel == k_Square1) ? square1_ : square2_;
+      const uint8_t k_Pattern = k_DutyPatterns[Nr(gb, k_Channel, 1) >> 6];
+      const bool k_High = (k_Pattern >> (7 - k_Square.duty_step_)) & 1;
+      return (k_Square.enabled_ && k_High) ? k_Square.envelope_.volume_ : 0;
+    }
+    case k_Wave: {
+      if (!wave_.enabled_) {
+        return 0;
+      }
+      // Two samples per byte, high nibble first
+      const uint8_t k_Samples =
+          (&Io(gb, HardwareRegistersName::k_WaveRam))[wave_.position_ / 2];
+      const uint8_t k_Sample =
+          (wave_.position_ & 1) ? (k_Samples & 0x0F) : (k_Samples >> 4);
+      return k_Sample >> k_WaveShifts[(Nr(gb, k_Wave, 2) >> 5) & 0x03];
+    }
+    default:
+      return (noise_.enabled_ && !(noise_.lfsr_ & 1))
+                 ? noise_.envelope_.volume_
+                 : 0;
+  }
+}
+
+void Apu::Output(const size_t k_Channel, const uint64_t k_Time,
+                 const uint8_t k_Level) {
+  const int k_Delta = static_cast<int>(k_Level) - levels_[k_Channel];
+  if (k_Delta == 0) {
+    return;
+  }
+  levels_[k_Channel] = k_Level;
+  const uint64_t k_Offset = k_Time - frame_start_;
+  if (left_gain_[k_Channel] != 0) {
+    left_.AddDelta(k_Offset, k_Delta * left_gain_[k_Channel] * k_VolumeScale);
+  }
+  if (right_gain_[k_Channel] != 0) {
+    right_.AddDelta(k_Offset,
+                    k_Delta * right_gain_[k_Channel] * k_VolumeScale);
+  }
+}
+
+void Apu::Refresh(GameBoy* gb, const size_t k_Channel, const uint64_t k_Time) {
+  Output(k_Channel, k_Time, Level(gb, k_Channel));
+}
+
+void Apu::UpdatePanning(const uint64_t k_Time, const uint8_t k_Nr50,
+                        const uint8_t k_Nr51) {
+  const uint64_t k_Offset = k_Time - frame_start_;
+  for (size_t channel = 0; channel < k_Channels; channel++) {
+    const uint8_t k_Left =
+        ((k_Nr51 >> (channel + 4)) & 1) ? ((k_Nr50 >> 4) & 0x07) + 1 : 0;
+    const uint8_t k_Right = ((k_Nr51 >> channel) & 1) ? (k_Nr50 & 0x07) + 1 : 0;
+    if (levels_[channel] != 0 && k_Left != left_gain_[channel]) {
+      left_.AddDelta(k_Offset, levels_[channel] *
+                                   (k_Left - left_gain_[channel]) *
+                                   k_VolumeScale);
+    }
+    if (levels_[channel] != 0 && k_Right != right_gain_[channel]) {
+      right_.AddDelta(k_Offset, levels_[channel] *
+                                    (k_Right - right_gain_[channel]) *
+                                    k_VolumeScale);
+    }
+    left_gain_[channel] = k_Left;
+    right_gain_[channel] = k_Right;
+  }
+}
+
+void Apu::Trigger(GameBoy* gb, const size_t k_Channel, const uint64_t k_Time) {
+  const bool k_Dac = DacEnabled(gb, k_Channel);
+  switch (k_Channel) {
+    case k_Square1:
+    case k_Square2: {
+      SquareChannel& square = (k_Channel == k_Square1) ? square1_ : square2_;
+      square.enabled_ = k_Dac;
+      square.length_ = (square.length_ == 0) ? 64 : square.length_;
+      square.envelope_.volume_ = Nr(gb, k_Channel, 2) >> 4;
+      square.envelope_.timer_ = Nr(gb, k_Channel, 2) & 0x07;
+      square.next_step_ = k_Time + SquarePeriod(gb, k_Channel);
+      if (k_Channel == k_Square1) {
+        const uint8_t k_Nr10 = Nr(gb, k_Square1, 0);
+        const uint8_t k_Pace = (k_Nr10 >> 4) & 0x07;
+        square.shadow_frequency_ = Frequency(gb, k_Square1);
+        square.sweep_timer_ = (k_Pace == 0) ? 8 : k_Pace;
+        square.sweep_enabled_ = k_Pace != 0 || (k_Nr10 & 0x07) != 0;
+        if ((k_Nr10 & 0x07) != 0 && SweepTarget(gb, square) > 2047) {
+          square.enabled_ = false;
+        }
+      }
+      break;
+    }
+    case k_Wave:
+      wave_.enabled_ = k_Dac;
+      wave_.length_ = (wave_.length_ == 0) ? 256 : wave_.length_;
+      wave_.position_ = 0;
+      wave_.next_step_ = k_Time + WavePeriod(gb);
+      break;
+    default:
+      noise_.enabled_ = k_Dac;
+      noise_.length_ = (noise_.length_ == 0) ? 64 : noise_.length_;
+      noise_.envelope_.volume_ = Nr(gb, k_Noise, 2) >> 4;
+      noise_.envelope_.timer_ = Nr(gb, k_Noise, 2) & 0x07;
+      noise_.lfsr_ = 0x7FFF;
+      noise_.next_step_ = k_Time + NoisePeriod(gb);
+      break;
+  }
+  Refresh(gb, k_Channel, k_Time);
+}
+
+void Apu::Disable(const size_t k_Channel, const uint64_t k_Time) {
+  switch (k_Channel) {
+    case k_Square1:
+      square1_.enabled_ = false;
+      break;
+    case k_Square2:
+      square2_.enabled_ = false;
+      break;
+    case k_Wave:
+      wave_.enabled_ = false;
+      break;
+    default:
+      noise_.enabled_ = false;
+      break;
+  }
+  Output(k_Channel, k_Time, 0);
+}
+
+void Apu::LoadLength(const size_t k_Channel, const uint8_t k_Value) {
+  switch (k_Channel) {
+    case k_Square1:
+      square1_.length_ = 64 - (k_Value & 0x3F);
+      break;
+    case k_Square2:
+      square2_.length_ = 64 - (k_Value & 0x3F);
+      break;
+    case k_Wave:
+      wave_.length_ = 256 - k_Value;
+      break;
+    default:
+      noise_.length_ = 64 - (k_Value & 0x3F);
+      break;
+  }
+}
+
+void Apu::RunSquare(GameBoy* gb, SquareChannel& channel,
+                    const size_t k_Channel, const uint64_t k_Time) {
+  if (!channel.enabled_ || channel.next_step_ > k_Time) {
+    return;
+  }
+  const uint64_t k_Period = SquarePeriod(gb, k_Channel);
+  if (channel.envelope_.volume_ == 0) {
+    // Silent, only the position in the duty cycle has to move on
+    const uint64_t k_Steps = (k_Time - channel.next_step_) / k_Period + 1;
+    channel.duty_step_ = (channel.duty_step_ + k_Steps) & 0x07;
+    channel.next_step_ += k_Steps * k_Period;
+    return;
+  }
+  while (channel.next_step_ <= k_Time) {
+    channel.duty_step_ = (channel.duty_step_ + 1) & 0x07;
+    Refresh(gb, k_Channel, channel.next_step_);
+    channel.next_step_ += k_Period;
+  }
+}
+
+void Apu::RunWave(GameBoy* gb, const uint64_t k_Time) {
+  if (!wave_.enabled_ || wave_.next_step_ > k_Time) {
+    return;
+  }
+  const uint64_t k_Period = WavePeriod(gb);
+  if ((Nr(gb, k_Wave, 2) & 0x60) == 0) {
+    const uint64_t k_Steps = (k_Time - wave_.next_step_) / k_Period + 1;
+    wave_.position_ = (wave_.position_ + k_Steps) & 0x1F;
+    wave_.next_step_ += k_Steps * k_Period;
+    return;
+  }
+  while (wave_.next_step_ <= k_Time) {
+    wave_.position_ = (wave_.position_ + 1) & 0x1F;
+    Refresh(gb, k_Wave, wave_.next_step_);
+    wave_.next_step_ += k_Period;
+  }
+}
+
+void Apu::RunNoise(GameBoy* gb, const uint64_t k_Time) {
+  if (!noise_.enabled_ || noise_.next_step_ > k_Time) {
+    return;
+  }
+  const uint8_t k_Nr43 = Nr(gb, k_Noise, 3);
+  // Clock shifts 14 and 15 stop the LFSR
+  if ((k_Nr43 >> 4) >= 14) {
+    noise_.next_step_ = k_Time + 1;
+    return;
+  }
+  const uint64_t k_Period = NoisePeriod(gb);
+  const bool k_Short = (k_Nr43 & 0x08) != 0;
+  const bool k_Audible = noise_.envelope_.volume_ != 0;
+  while (noise_.next_step_ <= k_Time) {
+    const uint16_t k_Bit = (noise_.lfsr_ ^ (noise_.lfsr_ >> 1)) & 1;
+    noise_.lfsr_ = (noise_.lfsr_ >> 1) | (k_Bit << 14);
+    if (k_Short) {
+      noise_.lfsr_ = (noise_.lfsr_ & ~0x40) | (k_Bit << 6);
+    }
+    if (k_Audible) {
+      Refresh(gb, k_Noise, noise_.next_step_);
+    }
+    noise_.next_step_ += k_Period;
+  }
+}
+
+// Reference: https://gbdev.io/pandocs/Audio_details.html#div-apu
+void Apu::ClockFrameSequencer(GameBoy* gb, const uint64_t k_Time) {
+  if ((sequencer_step_ & 1) == 0) {
+    ClockLength(gb, k_Time);
+  }
+  if (sequencer_step_ == 2 || sequencer_step_ == 6) {
+    ClockSweep(gb, k_Time);
+  }
+  if (sequencer_step_ == 7) {
+    ClockEnvelopes(gb, k_Time);
+  }
+  sequencer_step_ = (sequencer_step_ + 1) & 0x07;
+}
+
+void Apu::ClockLength(GameBoy* gb, const uint64_t k_Time) {
+  const std::array<uint16_t*, k_Channels> k_Lengths = {
+      &square1_.length_, &square2_.length_, &wave_.length_, &noise_.length_};
+  for (size_t channel = 0; channel < k_Channels; channel++) {
+    if (!(Nr(gb, channel, 4) & k_LengthEnable) || *k_Lengths[channel] == 0) {
+      continue;
+    }
+    if (--*k_Lengths[channel] == 0) {
+      Disable(channel, k_Time);
+    }
+  }
+}
+
+void Apu::ClockSweep(GameBoy* gb, const uint64_t k_Time) {
+  SquareChannel& square = square1_;
+  if (--square.sweep_timer_ != 0) {
+    return;
+  }
+  const uint8_t k_Nr10 = Nr(gb, k_Square1, 0);
+  const uint8_t k_Pace = (k_Nr10 >> 4) & 0x07;
+  square.sweep_timer_ = (k_Pace == 0) ? 8 : k_Pace;
+  if (!square.enabled_ || !square.sweep_enabled_ || k_Pace == 0) {
+    return;
+  }
+  const uint16_t k_Target = SweepTarget(gb, square);
+  if (k_Target > 2047) {
+    Disable(k_Square1, k_Time);
+    return;
+  }
+  if ((k_Nr10 & 0x07) == 0) {
+    return;
+  }
+  square.shadow_frequency_ = k_Target;
+  Nr(gb, k_Square1, 3) = k_Target & 0xFF;
+  Nr(gb, k_Square1, 4) = (Nr(gb, k_Square1, 4) & ~0x07) | (k_Target >> 8);
+  // The new frequency is checked straight away as well
+  if (SweepTarget(gb, square) > 2047) {
+    Disable(k_Square1, k_Time);
+  }
+}
+
+void Apu::ClockEnvelopes(GameBoy* gb, const uint64_t k_Time) {
+  ClockEnvelope(gb, k_Square1, square1_.envelope_);
+  ClockEnvelope(gb, k_Square2, square2_.envelope_);
+  ClockEnvelope(gb, k_Noise, noise_.envelope_);
+  Refresh(gb, k_Square1, k_Time);
+  Refresh(gb, k_Square2, k_Time);
+  Refresh(gb, k_Noise, k_Time);
+}
+
+void ApuFrameSequencerEvent(GameBoy* gb, const uint64_t k_Late) {
+  const uint64_t k_Now = gb->cycles_ - k_Late;
+  Apu& apu = gb->apu_;
+  apu.RunUntil(gb, k_Now * 4);
+  // A register write in the instruction that ran past the event already
+  // rendered a little further
+  const uint64_t k_Time = std::max(apu.time_, k_Now * 4);
+  apu.ClockFrameSequencer(gb, k_Time);
+  apu.EndBlipFrame(k_Time);
+  gb->scheduler_.Schedule(EventType::k_ApuFrameSequencer,
+                          k_Now + k_FrameSequencerCycles);
+}
+
+uint8_t ReadAudioRegister(GameBoy* gb, const uint16_t k_Address) {
+  const uint8_t k_Index = (k_Address & 0x7F) - k_SoundStart;
+  if (static_cast<HardwareRegistersName>(k_Address) ==
+      HardwareRegistersName::k_Nr52) {
+    uint8_t status = k_ReadMasks[k_Index];
+    status |= gb->apu_.powered_ ? k_Power : 0;
+    for (size_t channel = 0; channel < Apu::k_Channels; channel++) {
+      status |= gb->apu_.Enabled(channel) ? (1 << channel) : 0;
+    }
+    return status;
+  }
+  return gb->bus_.io_registers_[k_Address & 0x7F] | k_ReadMasks[k_Index];
+}
+
+void WriteAudioRegister(GameBoy* gb, const uint16_t k_Address,
+                        const uint8_t k_Value) {
+  Apu& apu = gb->apu_;
+  const uint64_t k_Time = gb->cycles_ * 4;
+  apu.RunUntil(gb, k_Time);
+  const auto k_Register = static_cast<HardwareRegistersName>(k_Address);
+  if (k_Register == HardwareRegistersName::k_Nr52) {
+    apu.SetPower(gb, (k_Value & k_Power) != 0);
+    return;
+  }
+  // Everything but NR52 is read only while the APU is off
+  if (!apu.powered_) {
+    return;
+  }
+  gb->bus_.io_registers_[k_Address & 0x7F] = k_Value;
+  if (k_Register == HardwareRegistersName::k_Nr50 ||
+      k_Register == HardwareRegistersName::k_Nr51) {
+    apu.UpdatePanning(k_Time, Io(gb, HardwareRegistersName::k_Nr50),
+                      Io(gb, HardwareRegistersName::k_Nr51));
+    return;
+  }
+  const size_t k_Channel =
+      ((k_Address & 0x7F) - k_SoundStart) / k_ChannelRegisters;
+  switch (((k_Address & 0x7F) - k_SoundStart) % k_ChannelRegisters) {
+    case 0:
+      if (k_Channel == k_Wave && !DacEnabled(gb, k_Wave)) {
+        apu.Disable(k_Wave, k_Time);
+      }
+      break;
+    case 1:
+      apu.LoadLength(k_Channel, k_Value);
+      break;
+    case 2:
+      if (k_Channel != k_Wave && !DacEnabled(gb, k_Channel)) {
+        apu.Disable(k_Channel, k_Time);
+      } else if (k_Channel == k_Wave) {
+        apu.Refresh(gb, k_Wave, k_Time);
+      }
+      break;
+    case 4:
+      if (k_Value & k_Trigger) {
+        apu.Trigger(gb, k_Channel, k_Time);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void WriteWaveRam(GameBoy* gb, const uint16_t k_Address,
+                  const uint8_t k_Value) {
+  Apu& apu = gb->apu_;
+  apu.RunUntil(gb, gb->cycles_ * 4);
+  gb->bus_.io_registers_[k_Address & 0x7F] = k_Value;
+  if (apu.powered_) {
+    apu.Refresh(gb, k_Wave, gb->cycles_ * 4);
+  }
+}
+}  // namespace binary::gb
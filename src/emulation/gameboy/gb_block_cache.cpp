@@ -0,0 +1,356 @@
+#include "include/gb_block_cache.h"
+#include "include/gb_dispatch.h"
+#include <utility>
+
+namespace binary::gb {
+namespace {
+enum class CodeRegion { k_None, k_RomBank00, k_RomBankNn, k_WorkRam, k_HighRam };
+
+constexpr CodeRegion RegionOf(const uint32_t k_Address) {
+  if (k_Address <= static_cast<uint16_t>(MemoryMap::k_RomBank00End)) {
+    return CodeRegion::k_RomBank00;
+  }
+  if (k_Address <= static_cast<uint16_t>(MemoryMap::k_RomBank01NnEnd)) {
+    return CodeRegion::k_RomBankNn;
+  }
+  if (k_Address >= static_cast<uint16_t>(MemoryMap::k_WorkRamStart) &&
+      k_Address <= static_cast<uint16_t>(MemoryMap::k_EchoRamEnd)) {
+    return CodeRegion::k_WorkRam;
+  }
+  if (k_Address >= static_cast<uint16_t>(MemoryMap::k_HighRamStart) &&
+      k_Address <= static_cast<uint16_t>(MemoryMap::k_HighRamEnd)) {
+    return CodeRegion::k_HighRam;
+  }
+  return CodeRegion::k_None;
+}
+
+// Echo RAM mirrors WRAM, so a write to either one has to find the same blocks
+constexpr uint16_t PhysicalAddress(const uint16_t k_Address) {
+  constexpr uint16_t k_EchoOffset =
+      static_cast<uint16_t>(MemoryMap::k_EchoRamStart) -
+      static_cast<uint16_t>(MemoryMap::k_WorkRamStart);
+  if (k_Address >= static_cast<uint16_t>(MemoryMap::k_EchoRamStart) &&
+      k_Address <= static_cast<uint16_t>(MemoryMap::k_EchoRamEnd)) {
+    return k_Address - k_EchoOffset;
+  }
+  return k_Address;
+}
+
+constexpr uint32_t BlockKey(const uint16_t k_Bank, const bool k_Prefixed,
+                            const uint16_t k_Address) {
+  return (static_cast<uint32_t>(k_Bank) << 17) |
+         (static_cast<uint32_t>(k_Prefixed) << 16) | k_Address;
+}
+
+// Anything that can move the program counter somewhere else ends a block,
+// NullOpcode() also skips a byte
+constexpr bool EndsBlock(const uint16_t k_Instruction) {
+  switch (k_Instruction) {
+    case JR_R8: case JR_NZ_R8: case JR_Z_R8: case JR_NC_R8: case JR_C_R8:
+    case JP_A16: case JP_NZ_A16: case JP_Z_A16: case JP_NC_A16:
+    case JP_C_A16: case JP__HL:
+    case CALL_A16: case CALL_NZ_A16: case CALL_Z_A16: case CALL_NC_A16:
+    case CALL_C_A16:
+    case RET: case RET_NZ: case RET_Z: case RET_NC: case RET_C: case RETI:
+    case RST_00H: case RST_08H: case RST_10H: case RST_18H:
+    case RST_20H: case RST_28H: case RST_30H: case RST_38H:
+    case HALT: case STOP:
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
+BasicBlock* BlockCache::Lookup(GameBoy* gb) {
+  // A new cartridge replaces every ROM block
+  if (cartridge_generation_ != gb->bus_.cartridge_generation_) {
+    Clear(gb);
+    cartridge_generation_ = gb->bus_.cartridge_generation_;
+    idle_stats_ = {};
+  }
+  const uint16_t k_Address = gb->reg_.program_counter_;
+  const CodeRegion k_Region = RegionOf(k_Address);
+  if (k_Region == CodeRegion::k_None) {
+    return nullptr;
+  }
+  const uint16_t k_Bank =
+      (k_Region == CodeRegion::k_RomBankNn) ? gb->bus_.rom_bank_ : 0;
+  const uint32_t k_Key = BlockKey(k_Bank, gb->cb_prefixed, k_Address);
+  const uint16_t k_Slot = k_Address % k_RecentBlockCount;
+  if (recent_blocks_[k_Slot] != nullptr && recent_keys_[k_Slot] == k_Key) {
+    hits_++;
+    return recent_blocks_[k_Slot];
+  }
+  const auto k_Found = blocks_.find(k_Key);
+  if (k_Found != blocks_.end()) {
+    hits_++;
+    recent_keys_[k_Slot] = k_Key;
+    recent_blocks_[k_Slot] = &k_Found->second;
+    return &k_Found->second;
+  }
+
+  misses_++;
+  BasicBlock block = Decode(gb, k_Address, gb->cb_prefixed, k_Bank);
+  if (block.ops_.empty()) {
+    return nullptr;
+  }
+  if (k_Region == CodeRegion::k_WorkRam || k_Region == CodeRegion::k_HighRam) {
+    const uint16_t k_FirstPage = PhysicalAddress(block.start_) >> 8;
+    const uint16_t k_LastPage = PhysicalAddress(block.end_) >> 8;
+    for (uint16_t page = k_FirstPage; page <= k_LastPage; page++) {
+      page_blocks_[page].push_back(k_Key);
+      TrapPage(gb, page);
+    }
+  }
+  BasicBlock* cached = &blocks_.emplace(k_Key, std::move(block)).first->second;
+  recent_keys_[k_Slot] = k_Key;
+  recent_blocks_[k_Slot] = cached;
+  return cached;
+}
+
+void BlockCache::Erase(const uint32_t k_Key) {
+  const uint16_t k_Slot = (k_Key & 0xFFFF) % k_RecentBlockCount;
+  if (recent_keys_[k_Slot] == k_Key) {
+    recent_blocks_[k_Slot] = nullptr;
+  }
+  blocks_.erase(k_Key);
+}
+
+BasicBlock BlockCache::Decode(GameBoy* gb, const uint16_t k_Start,
+                              const bool k_Prefixed, const uint16_t k_Bank) {
+  BasicBlock block{};
+  block.start_ = k_Start;
+  block.end_ = k_Start;
+  block.bank_ = k_Bank;
+  block.prefixed_ = k_Prefixed;
+
+  const CodeRegion k_Region = RegionOf(k_Start);
+  uint32_t address = k_Start;
+  bool prefixed = k_Prefixed;
+  while (block.ops_.size() < k_MaxBlockLength) {
+    // The immediates have to come from the same region as the opcode,
+    // otherwise a bank switch could change them behind our back
+    if (RegionOf(address) != k_Region || RegionOf(address + 2) != k_Region) {
+      break;
+    }
+    const uint16_t k_Instruction =
+        gb->Read(address) + (prefixed ? k_PrefixOffset : 0);
+    MicroOp op{};
+    op.execute_ = k_DispatchTable[k_Instruction];
+    op.opcode_ = k_Instruction;
+    op.address_ = address;
+    op.immediate_ = gb->Read(address + 1) | (gb->Read(address + 2) << 8);
+    op.fallthrough_ = (k_Instruction == PREFIX_CB) ? address + 1 : address;
+    op.fetched_ = gb->Read(op.fallthrough_);
+    op.cycles_ = k_MachineCycleTable[k_Instruction].cycles_;
+    op.prefixed_ = prefixed;
+    block.ops_.push_back(op);
+    block.end_ = address + 2;
+    block.cycles_ += op.cycles_;
+
+    if (EndsBlock(k_Instruction) || op.execute_ == NullOpcode) {
+      break;
+    }
+    prefixed = (k_Instruction == PREFIX_CB);
+    address = op.fallthrough_ + 1;
+  }
+  return block;
+}
+
+void BlockCache::InvalidateWrite(GameBoy* gb, const uint16_t k_Address) {
+  const uint16_t k_Physical = PhysicalAddress(k_Address);
+  const uint16_t k_Page = k_Physical >> 8;
+  std::vector<uint32_t>& keys = page_blocks_[k_Page];
+  for (size_t index = 0; index < keys.size();) {
+    const auto k_Found = blocks_.find(keys[index]);
+    if (k_Found == blocks_.end()) {
+      keys[index] = keys.back();
+      keys.pop_back();
+      continue;
+    }
+    const BasicBlock& k_Block = k_Found->second;
+    if (k_Physical < PhysicalAddress(k_Block.start_) ||
+        k_Physical > PhysicalAddress(k_Block.end_)) {
+      index++;
+      continue;
+    }
+    // Blocks crossing a page boundary leave a stale key on the other page,
+    // it's removed the next time that page is written to
+    Erase(keys[index]);
+    keys[index] = keys.back();
+    keys.pop_back();
+    invalidations_++;
+    generation_++;
+  }
+  if (keys.empty()) {
+    UntrapPage(gb, k_Page);
+  }
+}
+
+void BlockCache::Clear(GameBoy* gb) {
+  blocks_.clear();
+  recent_blocks_.fill(nullptr);
+  idle_block_ = nullptr;
+  for (uint16_t page = 0; page < k_PageCount; page++) {
+    page_blocks_[page].clear();
+    UntrapPage(gb, page);
+  }
+  generation_++;
+}
+
+void BlockCache::CheckIdleLoop(GameBoy* gb) {
+  gb->MaterializeFlags();
+  IdleState state{};
+  state.cycles_ = gb->cycles_;
+  state.memory_writes_ = gb->memory_writes_;
+  state.af_ = gb->reg_.af_;
+  state.bc_ = gb->reg_.bc_;
+  state.de_ = gb->reg_.de_;
+  state.hl_ = gb->reg_.hl_;
+  state.stack_pointer_ = gb->reg_.stack_pointer_;
+  state.program_counter_ = gb->reg_.program_counter_;
+  state.interrupt_ = gb->interrupt_;
+  state.cb_prefixed_ = gb->cb_prefixed;
+  const IdleState k_Last = idle_state_;
+  const IdleState& k_State = state;
+  const bool k_Same =
+      idle_state_valid_ && k_State.memory_writes_ == k_Last.memory_writes_ &&
+      k_State.af_ == k_Last.af_ && k_State.bc_ == k_Last.bc_ &&
+      k_State.de_ == k_Last.de_ && k_State.hl_ == k_Last.hl_ &&
+      k_State.stack_pointer_ == k_Last.stack_pointer_ &&
+      k_State.program_counter_ == k_Last.program_counter_ &&
+      k_State.interrupt_ == k_Last.interrupt_ &&
+      k_State.cb_prefixed_ == k_Last.cb_prefixed_;
+  idle_state_ = k_State;
+  idle_state_valid_ = true;
+  if (!k_Same || gb->cycles_ >= gb->cycle_deadline_) {
+    return;
+  }
+  // Whole iterations only, the state at the end is the one a real run would
+  // have at that cycle
+  const uint64_t k_Period = k_State.cycles_ - k_Last.cycles_;
+  const uint64_t k_Skipped =
+      (gb->cycle_deadline_ - gb->cycles_) / k_Period * k_Period;
+  if (k_Skipped == 0) {
+    return;
+  }
+  gb->cycles_ += k_Skipped;
+  idle_state_.cycles_ = gb->cycles_;
+  idle_stats_.skips_++;
+  idle_stats_.skipped_cycles_ += k_Skipped;
+}
+
+void BlockCache::TrapPage(GameBoy* gb, const uint16_t k_Page) {
+  // HRAM shares its page with the I/O registers, WriteHighPage() checks it
+  // instead
+  if (RegionOf(k_Page << 8) != CodeRegion::k_WorkRam) {
+    return;
+  }
+  constexpr uint16_t k_EchoPageOffset =
+      (static_cast<uint16_t>(MemoryMap::k_EchoRamStart) -
+       static_cast<uint16_t>(MemoryMap::k_WorkRamStart)) >> 8;
+  constexpr uint16_t k_LastEchoPage =
+      static_cast<uint16_t>(MemoryMap::k_EchoRamEnd) >> 8;
+  for (const uint16_t k_Alias : {k_Page, uint16_t(k_Page + k_EchoPageOffset)}) {
+    if (k_Alias > k_LastEchoPage || saved_write_[k_Alias] != nullptr) {
+      continue;
+    }
+    MemoryPage& page = gb->bus_.page_table_[k_Alias];
+    saved_write_[k_Alias] = page.write_;
+    page.write_ = nullptr;
+    page.write_handler_ = WriteCodePage;
+  }
+}
+
+void BlockCache::UntrapPage(GameBoy* gb, const uint16_t k_Page) {
+  constexpr uint16_t k_EchoPageOffset =
+      (static_cast<uint16_t>(MemoryMap::k_EchoRamStart) -
+       static_cast<uint16_t>(MemoryMap::k_WorkRamStart)) >> 8;
+  for (const uint16_t k_Alias : {k_Page, uint16_t(k_Page + k_EchoPageOffset)}) {
+    if (k_Alias >= k_PageCount || saved_write_[k_Alias] == nullptr) {
+      continue;
+    }
+    MemoryPage& page = gb->bus_.page_table_[k_Alias];
+    page.write_ = saved_write_[k_Alias];
+    page.write_handler_ = nullptr;
+    saved_write_[k_Alias] = nullptr;
+  }
+}
+
+void WriteCodePage(GameBoy* gb, const uint16_t k_Address,
+                   const uint8_t k_Value) {
+  BlockCache& cache = gb->block_cache_;
+  uint8_t* memory = cache.saved_write_[k_Address >> 8];
+  cache.InvalidateWrite(gb, k_Address);
+  memory[k_Address & 0xFF] = k_Value;
+}
+
+void ExecuteBlock(GameBoy* gb, const BasicBlock& block) {
+  const uint32_t k_Generation = gb->block_cache_.generation_;
+  const MicroOp* op = block.ops_.data();
+  const MicroOp* const k_Last = op + block.ops_.size() - 1;
+  gb->immediate_latched_ = true;
+  // When the whole block fits in what's left of the slice nothing but the
+  // last instruction can stop it, the ones before it only have to look out
+  // for their own writes dropping the block
+  if ((gb->cycles_ + block.cycles_) <= gb->cycle_deadline_) {
+    while (op != k_Last) {
+      // The block can be dropped by its own handler, don't touch it
+      // afterwards
+      const uint8_t k_Cycles = op->cycles_;
+      const bool k_Prefixed = op->prefixed_;
+      gb->reg_.program_counter_ = op->address_;
+      gb->immediate_ = op->immediate_;
+      op->execute_(gb);
+      if (k_Prefixed) {
+        gb->cb_prefixed = false;
+      }
+      if (gb->block_cache_.generation_ != k_Generation) [[unlikely]] {
+        gb->immediate_latched_ = false;
+        instructionset::Fetch(gb);
+        gb->cycles_ += k_Cycles - 1;
+        return;
+      }
+      gb->cycles_ += k_Cycles;
+      op++;
+    }
+  }
+  // Straddles the deadline, check it after every instruction
+  while (true) {
+    const MicroOp k_Op = *op++;
+    gb->reg_.program_counter_ = k_Op.address_;
+    gb->immediate_ = k_Op.immediate_;
+    k_Op.execute_(gb);
+    if (k_Op.prefixed_) {
+      gb->cb_prefixed = false;
+    }
+    // Only the last instruction can branch, the bus bookkeeping Fetch() does
+    // is skipped until the block stops
+    const bool k_Stop = (op > k_Last) ||
+                        (gb->block_cache_.generation_ != k_Generation) ||
+                        ((gb->cycles_ + k_Op.cycles_) >= gb->cycle_deadline_);
+    if (!k_Stop) {
+      gb->cycles_ += k_Op.cycles_;
+      continue;
+    }
+    gb->immediate_latched_ = false;
+    if (gb->reg_.program_counter_ != k_Op.fallthrough_ ||
+        gb->block_cache_.generation_ != k_Generation) {
+      // Branched or overwritten, Fetch() reads whatever is in memory now
+      instructionset::Fetch(gb);
+      gb->cycles_ += InstructionCycles(gb, k_Op.opcode_) - 1;
+      return;
+    }
+    // Same as Fetch() but the byte was read when the block was decoded
+    gb->address_bus_ = k_Op.fallthrough_;
+    gb->idu_ = k_Op.fallthrough_ + 1;
+    gb->reg_.program_counter_ = gb->idu_;
+    gb->read_signal_ = true;
+    gb->instruction_ = k_Op.fetched_;
+    // A conditional branch can be taken and still land on fallthrough_
+    gb->cycles_ += InstructionCycles(gb, k_Op.opcode_);
+    return;
+  }
+}
+}  // namespace binary::gb
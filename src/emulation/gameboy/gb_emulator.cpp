@@ -1,5 +1,6 @@
 #include "include/gb_emulator.h"
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <fstream>
 void binary::gb::test() {
   binary::gb::GameBoy gb;
@@ -33,32 +34,139 @@ void binary::gb::LoadRom(std::string file_path, void* data) {
 }
 
 void binary::gb::Emulate(GameBoy* gameboy, bool running) {
-  using namespace binary::gb::instructionset;
-  constexpr uint16_t k_PrefixOffset = 256;
-  std::array<Opcode, 512> opcode_table;
-  InitOpcodeTable(opcode_table);
+  // Run in slices so the interpreter can return to us every so often
+  constexpr uint64_t k_CyclesPerSlice = 70224;
   while (running) {
-    const uint16_t k_Instruction = 
-        gameboy->memory_[gameboy->reg_.program_counter_]; 
+    EmulateFor(gameboy, k_CyclesPerSlice);
+  }
+}
 
-    if (gameboy->cb_prefixed == false) {
-      opcode_table.at(k_Instruction).execute_(gameboy);
+namespace {
+// The interpreter picked at build time
+inline void RunCpu(binary::gb::GameBoy* gameboy, const uint64_t k_Cycles) {
+  using namespace binary::gb;
+#if defined(BINARY_GB_JIT) && defined(BINARY_GB_JIT_X64)
+  EmulateJit(gameboy, k_Cycles);
+#elif defined(BINARY_GB_CACHED_INTERPRETER) || defined(BINARY_GB_JIT)
+  EmulateCached(gameboy, k_Cycles);
+#elif defined(BINARY_GB_THREADED_INTERPRETER) && defined(BINARY_GB_MUSTTAIL)
+  EmulateThreaded(gameboy, k_Cycles);
+#else
+#if defined(BINARY_GB_THREADED_INTERPRETER)
+#pragma message("BINARY_GB_THREADED_INTERPRETER needs [[clang::musttail]], " \
+                "falling back to the table interpreter")
+#endif
+  EmulateLoop(gameboy, k_Cycles);
+#endif
+}
+}  // namespace
+
+void binary::gb::EmulateFor(GameBoy* gameboy, const uint64_t k_Cycles) {
+  const uint64_t k_End = gameboy->cycles_ + k_Cycles;
+  Scheduler& scheduler = gameboy->scheduler_;
+  scheduler.Dispatch(gameboy);
+  while (gameboy->cycles_ < k_End) {
+    // Nothing else can change before the next event, the CPU gets the whole
+    // stretch up to it in one go
+    const uint64_t k_Until = std::min(k_End, scheduler.NextEvent());
+    if (gameboy->mode_ == CpuMode::k_Running) {
+      RunCpu(gameboy, k_Until - gameboy->cycles_);
     } else {
-      opcode_table.at(k_Instruction + k_PrefixOffset).execute_(gameboy);
-      gameboy->cb_prefixed = false;
+      // HALT/STOP, only an event can request the interrupt that wakes the
+      // CPU up so there's nothing to run until then
+      gameboy->cycles_ = k_Until;
     }
-    Fetch(gameboy); 
+    scheduler.Dispatch(gameboy);
   }
 }
 
-void binary::gb::instructionset::Fetch(GameBoy* gb) {
-  
-  gb->idu_                  = gb->reg_.program_counter_;
-  gb->address_bus_          = gb->idu_;
-  gb->idu_++;                 
-  gb->reg_.program_counter_ = gb->idu_;
-  gb->read_signal_          = true;
-  gb->reg_.instruction_     = gb->memory_[gb->address_bus_];
-  gb->cycles_++;
-  return;
+namespace {
+// One instruction through k_DispatchTable
+inline void Step(binary::gb::GameBoy* gameboy) {
+  using namespace binary::gb;
+  using namespace binary::gb::instructionset;
+  const uint16_t k_Instruction = 
+      gameboy->Read(gameboy->reg_.program_counter_); 
+
+  const bool k_Prefixed = gameboy->cb_prefixed;
+  const uint16_t k_Opcode = k_Instruction + (k_Prefixed ? k_PrefixOffset : 0);
+  k_DispatchTable[k_Opcode](gameboy);
+  if (k_Prefixed) {
+    gameboy->cb_prefixed = false;
+  }
+  Fetch(gameboy);
+  // Fetch() counted the first machine cycle
+  gameboy->cycles_ += InstructionCycles(gameboy, k_Opcode) - 1;
+}
+}  // namespace
+
+void binary::gb::EmulateLoop(GameBoy* gameboy, const uint64_t k_Cycles) {
+  gameboy->cycle_deadline_ = gameboy->cycles_ + k_Cycles;
+  while (gameboy->cycles_ < gameboy->cycle_deadline_) {
+    Step(gameboy);
+  }
+}
+
+void binary::gb::EmulateCached(GameBoy* gameboy, const uint64_t k_Cycles) {
+  gameboy->cycle_deadline_ = gameboy->cycles_ + k_Cycles;
+  gameboy->block_cache_.ForgetIdleLoop();
+  while (gameboy->cycles_ < gameboy->cycle_deadline_) {
+    const BasicBlock* block = gameboy->block_cache_.Lookup(gameboy);
+    if (block == nullptr) {
+      // Code outside ROM/WRAM/HRAM isn't cached
+      Step(gameboy);
+      continue;
+    }
+    gameboy->block_cache_.SkipIdleLoop(gameboy, block);
+    if (gameboy->cycles_ >= gameboy->cycle_deadline_) {
+      break;
+    }
+    ExecuteBlock(gameboy, *block);
+  }
+}
+
+void binary::gb::EmulateJit(GameBoy* gameboy, const uint64_t k_Cycles) {
+  gameboy->cycle_deadline_ = gameboy->cycles_ + k_Cycles;
+  gameboy->block_cache_.ForgetIdleLoop();
+  while (gameboy->cycles_ < gameboy->cycle_deadline_) {
+    BasicBlock* block = gameboy->block_cache_.Lookup(gameboy);
+    if (block == nullptr) {
+      Step(gameboy);
+      continue;
+    }
+    gameboy->block_cache_.SkipIdleLoop(gameboy, block);
+    if (gameboy->cycles_ >= gameboy->cycle_deadline_) {
+      break;
+    }
+    // Compiled code assumes lazy flags, see gb_jit.h
+    const bool k_Native = gameboy->jit_.enabled_ && gameboy->lazy_flags_;
+    if (k_Native && block->native_ == nullptr &&
+        ++block->executions_ == k_HotBlockThreshold &&
+        !gameboy->jit_.Compile(gameboy, *block)) {
+      // Out of code space, start over with an empty cache
+      gameboy->block_cache_.Clear(gameboy);
+      gameboy->jit_.Reset();
+      continue;
+    }
+    if (k_Native && block->native_ != nullptr &&
+        gameboy->cycles_ + block->cycles_ <= gameboy->cycle_deadline_) {
+      block->native_(gameboy);
+    } else {
+      ExecuteBlock(gameboy, *block);
+    }
+  }
+}
+
+#ifdef BINARY_GB_MUSTTAIL
+void binary::gb::EmulateThreaded(GameBoy* gameboy, const uint64_t k_Cycles) {
+  gameboy->cycle_deadline_ = gameboy->cycles_ + k_Cycles;
+  if (gameboy->cycles_ >= gameboy->cycle_deadline_) {
+    return;
+  }
+  // The handlers keep jumping to each other until the deadline is reached
+  const uint16_t k_Instruction =
+      gameboy->Read(gameboy->reg_.program_counter_) |
+      (static_cast<uint16_t>(gameboy->cb_prefixed) << 8);
+  k_ThreadedTable[k_Instruction](gameboy);
 }
+#endif
@@ -1,4 +1,6 @@
 #include "include/gb_instruction.h"
+#include "include/gb_dispatch.h"
+#include <algorithm>
 #include <memory>
 namespace binary::gb::instructionset {
 
@@ -8,36 +10,35 @@ namespace binary::gb::instructionset {
 // four clock cycles, and if the machine requires more cycles, it's always
 // a product of 4 
 // 
-// If an opcode is only one machine cycle it means function implementation
-// doesn't increment the gb->cycle variable since the fetch function would
-// do that anyways
-//
-// The only functions that increments gb->cycles are opcodes which have
-// more than 1 machine cycle
+// Fetch() counts the first machine cycle of every instruction, the
+// interpreters add the rest from k_MachineCycleTable after the handler ran.
+// Handlers don't touch gb->cycles_ themselves, conditional jumps, calls and
+// returns set gb->branched when they're taken so machine_cycles_branch_ is
+// charged instead.
 
 void NoOperation(GameBoy* gb) { return; }
 
 void binary::gb::instructionset::ReturnFromInterruptHandler(GameBoy* gb) {
   gb->reg_.program_counter_ = gb->ReturnAddress();
-  gb->reg_.interrupt_ = 1;
+  gb->interrupt_ = 1;
 }
 
 void JumpIndirect(GameBoy* gb) {
-  const uint16_t k_JumpAddress = gb->memory_[gb->reg_.hl_];
+  const uint16_t k_JumpAddress = gb->Read(gb->reg_.hl_);
   gb->reg_.stack_pointer_ = gb->reg_.program_counter_;
   gb->reg_.program_counter_ = k_JumpAddress;
 }
 
 void LoadHighAddressIntoRegA(GameBoy* gb) {
-  const uint8_t k_HighAddress = gb->memory_[gb->reg_.program_counter_ + 2];
+  const uint8_t k_HighAddress = gb->Read(gb->reg_.program_counter_ + 2);
   gb->reg_.a_ = k_HighAddress;
 }
 void LoadRegAIntoHighAddress(GameBoy* gb) {
-  gb->memory_[gb->reg_.program_counter_] = gb->reg_.a_;
+  gb->Write(gb->reg_.program_counter_, gb->reg_.a_);
 }
 
 void SubImmediate8Function(GameBoy* gb) {
-  const uint16_t k_Operand = gb->memory_[gb->reg_.program_counter_ + 1];
+  const uint16_t k_Operand = gb->Read(gb->reg_.program_counter_ + 1);
   const uint16_t k_Result = gb->reg_.a_ - k_Operand;
   SetFlagZ1HC(gb, k_Result, gb->reg_.a_, k_Operand);
   gb->reg_.a_ = k_Result;
@@ -45,23 +46,11 @@ void SubImmediate8Function(GameBoy* gb) {
 
 void SetFlagZ1HC(GameBoy* gb, const uint16_t k_Result, const uint8_t k_Reg,
                  const uint8_t k_Operand) {
-  const bool k_IsZero   = (static_cast<uint8_t>(k_Result) == 0);
-  const bool k_IsHCarry = ((k_Reg & 0x0f) + (k_Operand & 0x0f) > 0x0f);
-  const bool k_IsCarry  = ((k_Result & 0x100) != 0);
-
-  gb->reg_.f_[k_BitIndexZ] = k_IsZero;
-  gb->reg_.f_[k_BitIndexN] = true;
-  gb->reg_.f_[k_BitIndexH] = k_IsHCarry;
-  gb->reg_.f_[k_BitIndexC] = k_IsCarry;
+  gb->DeferFlags(FlagOperation::k_Z1HC, k_Result, k_Reg, k_Operand);
 }
 
 void SetFlagZ00C(GameBoy* gb, const uint16_t k_Result) {
-  const bool k_IsZero = (static_cast<uint8_t>(k_Result) == 0);
-  const bool k_IsCarry = ((k_Result & 0x100) != 0);
-  gb->reg_.f_[k_BitIndexZ] = k_IsZero;
-  gb->reg_.f_[k_BitIndexN] = false;
-  gb->reg_.f_[k_BitIndexH] = false;
-  gb->reg_.f_[k_BitIndexC] = k_IsCarry;
+  gb->DeferFlags(FlagOperation::k_Z00C, k_Result, 0, 0);
 }
 
 void PrefixCB(GameBoy* gb) {
@@ -70,40 +59,57 @@ void PrefixCB(GameBoy* gb) {
   return;
 }
 
-void EnableInterrput(GameBoy* gb) { gb->reg_.interrupt_ = true; }
+void EnableInterrput(GameBoy* gb) { gb->interrupt_ = true; }
+
+void DisableInterrput(GameBoy* gb) { gb->interrupt_ = false; }
+
+// Turns A back into BCD after an ADD/ADC or SUB/SBC of two BCD values, N
+// tells which one it was so the pending flags have to be resolved first
+void DecimalAdjust(GameBoy* gb) {
+  const bool k_IsSubtraction = gb->Flag(k_BitIndexN);
+  const bool k_IsHCarry = gb->Flag(k_BitIndexH);
+  bool is_carry = gb->Flag(k_BitIndexC);
+  uint8_t correction = 0;
 
-void DisableInterrput(GameBoy* gb) { gb->reg_.interrupt_ = false; }
+  if (k_IsHCarry || (!k_IsSubtraction && (gb->reg_.a_ & 0x0f) > 0x09)) {
+    correction |= 0x06;
+  }
+  if (is_carry || (!k_IsSubtraction && gb->reg_.a_ > 0x99)) {
+    correction |= 0x60;
+    is_carry = true;
+  }
+  gb->reg_.a_ = k_IsSubtraction ? gb->reg_.a_ - correction
+                                : gb->reg_.a_ + correction;
+  gb->SetFlags(((gb->reg_.a_ == 0) ? k_FlagZ : 0) |
+               (k_IsSubtraction ? k_FlagN : 0) | (is_carry ? k_FlagC : 0));
+}
 
 void SetCarryFlag(GameBoy* gb) { 
-  gb->reg_.f_[k_BitIndexN] = false;
-  gb->reg_.f_[k_BitIndexH] = false;
-  gb->reg_.f_[k_BitIndexC] = true; 
-  gb->UpdateRegisters<&Register::a_>();
+  gb->SetFlag(k_BitIndexN, false);
+  gb->SetFlag(k_BitIndexH, false);
+  gb->SetFlag(k_BitIndexC, true); 
 }
 
 void ComplementCarryFlag(GameBoy* gb) {
-  gb->reg_.f_[k_BitIndexN] = false;
-  gb->reg_.f_[k_BitIndexH] = false;
-  gb->reg_.f_[k_BitIndexC] = ~gb->reg_.f_[k_BitIndexC];
-  gb->UpdateRegisters<&Register::a_>();
+  gb->SetFlag(k_BitIndexN, false);
+  gb->SetFlag(k_BitIndexH, false);
+  gb->SetFlag(k_BitIndexC, !gb->Flag(k_BitIndexC));
 }
 
 void ComplementAccumulator(GameBoy* gb) {
-  gb->reg_.f_[k_BitIndexN] = true;
-  gb->reg_.f_[k_BitIndexH] = true;
+  gb->SetFlag(k_BitIndexN, true);
+  gb->SetFlag(k_BitIndexH, true);
   gb->reg_.a_ = ~gb->reg_.a_;
-  gb->UpdateRegisters<&Register::a_>();
 }
 
 void RotateLeftAccumulatorCarry(GameBoy* gb) {
   const uint8_t k_MostSignificantBit = ((gb->reg_.a_ & 0b01111111) != 0);
-  const bool k_IsCarryFlagSet = gb->reg_.f_[k_BitIndexC];
-  const uint8_t k_Result = (gb->reg_.a_ << 1) | gb->reg_.f_[k_BitIndexC];
+  const bool k_IsCarryFlagSet = gb->Flag(k_BitIndexC);
+  const uint8_t k_Result = (gb->reg_.a_ << 1) | gb->Flag(k_BitIndexC);
 
   SetFlagZ00C(gb, k_Result);
-  gb->reg_.f_[k_BitIndexC] = k_MostSignificantBit;
+  gb->SetFlag(k_BitIndexC, k_MostSignificantBit);
   gb->reg_.a_ = k_Result;
-  gb->UpdateRegisters<&Register::a_>();
 }
 
 void RotateLeftAccumulator(GameBoy* gb) {
@@ -112,44 +118,47 @@ void RotateLeftAccumulator(GameBoy* gb) {
 
   SetFlagZ00C(gb, k_Result); 
   gb->reg_.a_ = k_Result; 
-  gb->UpdateRegisters<&Register::a_>();
 }
 
 void RotateRightAccumulatorCarry(GameBoy* gb) {
   bool k_FirstBit = ((gb->reg_.a_ & 1) > 0);
   gb->reg_.a_ >>= 1;
   gb->reg_.a_ |= (k_FirstBit == true) ? 0x80 : 0;
-  gb->reg_.f_[k_BitIndexC] = k_FirstBit;
-  gb->reg_.f_[k_BitIndexH] = false;
-  gb->UpdateRegisters<&Register::a_>();
+  gb->SetFlag(k_BitIndexC, k_FirstBit);
+  gb->SetFlag(k_BitIndexH, false);
 }
 
 void RotateRightAccumulator(GameBoy* gb) {
   bool k_FirstBit = ((gb->reg_.a_ & 1) > 0);
   gb->reg_.a_ >>= 1; 
   gb->reg_.a_ |= (k_FirstBit == true) ? 0x80 : 0;
-  gb->UpdateRegisters<&Register::a_>();
 }
 
 
 
 void SetFlagZ0HC(GameBoy* gb, const uint16_t k_Result, uint8_t reg,
                  const uint8_t k_Operand) {
-  const bool k_IsZero = (static_cast<uint8_t>(k_Result) == 0);
-  const bool k_IsHCarry = ((reg & 0x0f) + (k_Operand & 0x0f) > 0x0f);
-  const bool k_IsCarry  = ((k_Result & 0x100) != 0);
+  gb->DeferFlags(FlagOperation::k_Z0HC, k_Result, reg, k_Operand);
+}
 
-  gb->reg_.f_[k_BitIndexZ] = k_IsZero;
-  gb->reg_.f_[k_BitIndexN] = false;
-  gb->reg_.f_[k_BitIndexH] = k_IsHCarry;
-  gb->reg_.f_[k_BitIndexC] = k_IsCarry;
+// HALT and STOP end the interpreter's run by pulling the deadline in, the
+// instruction still finishes with its Fetch()
+void Halt(GameBoy* gb) {
+  // With an interrupt already pending the CPU doesn't go to sleep at all
+  if (gb->PendingInterrupts() != 0) {
+    return;
+  }
+  gb->mode_ = CpuMode::k_Halted;
+  gb->cycle_deadline_ = gb->cycles_;
 }
 
   // Stop instruction
 void Stop(GameBoy* gb) {
   // There's no reason to call a helper function for this, since there's only
   // one opcode like this
-  gb->reg_.interrupt_ = false;
+  gb->interrupt_ = false;
+  gb->mode_ = CpuMode::k_Stopped;
+  gb->cycle_deadline_ = gb->cycles_;
 }
 
 }  // namespace binary::gb::instructionset
@@ -165,54 +174,80 @@ void binary::gb::Opcode::SetMachineCycles(uint8_t machine_cycles) {
   machine_cycles_branch_ = machine_cycles;
 }
 
-void binary::gb::GameBoy::ClearRegisters() { 
-  reg_.a_  = 0;
-  reg_.b_  = 0;
-  reg_.c_  = 0;
-  reg_.d_  = 0;
-  reg_.e_  = 0;
-  reg_.f_  = 0;
-  reg_.h_  = 0;
-  reg_.l_  = 0;
-  UpdateAll16BitReg();
-}
-
-void binary::gb::GameBoy::UpdateRegHL() {
-  Update16BitRegister(reg_.hl_, reg_.h_, reg_.l_);
-}
-
-void binary::gb::GameBoy::UpdateRegBC() {
-  Update16BitRegister(reg_.bc_, reg_.b_, reg_.c_);
+void binary::gb::GameBoy::ResolveFlags() {
+  const bool k_IsZero = (static_cast<uint8_t>(lazy_.result_) == 0);
+  const bool k_IsCarry = ((lazy_.result_ & 0x100) != 0);
+  const bool k_IsHCarry =
+      ((lazy_.reg_ & 0x0f) + (lazy_.operand_ & 0x0f) > 0x0f);
+
+  switch (lazy_.operation_) {
+    case FlagOperation::k_Z0HC:
+      reg_.SetFlag(k_BitIndexZ, k_IsZero);
+      reg_.SetFlag(k_BitIndexN, false);
+      reg_.SetFlag(k_BitIndexH, k_IsHCarry);
+      reg_.SetFlag(k_BitIndexC, k_IsCarry);
+      break;
+    case FlagOperation::k_Z1HC:
+      reg_.SetFlag(k_BitIndexZ, k_IsZero);
+      reg_.SetFlag(k_BitIndexN, true);
+      reg_.SetFlag(k_BitIndexH, k_IsHCarry);
+      reg_.SetFlag(k_BitIndexC, k_IsCarry);
+      break;
+    case FlagOperation::k_Z00C:
+      reg_.SetFlag(k_BitIndexZ, k_IsZero);
+      reg_.SetFlag(k_BitIndexN, false);
+      reg_.SetFlag(k_BitIndexH, false);
+      reg_.SetFlag(k_BitIndexC, k_IsCarry);
+      break;
+    case FlagOperation::k_None:
+      break;
+  }
+  lazy_.operation_ = FlagOperation::k_None;
 }
 
-void binary::gb::GameBoy::UpdateRegDE() {
-  Update16BitRegister(reg_.de_, reg_.d_, reg_.e_);
+void binary::gb::GameBoy::SetLazyFlags(const bool k_Enable) {
+  MaterializeFlags();
+  lazy_flags_ = k_Enable;
 }
 
-void binary::gb::GameBoy::UpdateRegAF() {
-  const uint8_t k_RegisterFValue = static_cast<uint8_t>(reg_.f_.to_ulong());
-  Update16BitRegister(reg_.af_, reg_.a_, k_RegisterFValue);
+void binary::gb::GameBoy::ClearRegisters() { 
+  lazy_.operation_ = FlagOperation::k_None;
+  reg_.af_ = 0;
+  reg_.bc_ = 0;
+  reg_.de_ = 0;
+  reg_.hl_ = 0;
+}
+
+namespace {
+// IF lives in io_registers_, IE has its own member in the bus
+constexpr uint16_t k_InterruptFlagIndex =
+    static_cast<uint16_t>(binary::gb::HardwareRegistersName::k_If) -
+    static_cast<uint16_t>(binary::gb::MemoryMap::k_IoRegistersStart);
+}  // namespace
+
+binary::gb::GameBoy::GameBoy() {
+  ppu_.Connect(this);
+  apu_.Connect(this);
+}
+
+void binary::gb::GameBoy::RequestInterrupt(const uint8_t k_Interrupts) {
+  bus_.io_registers_[k_InterruptFlagIndex] |= (k_Interrupts & k_InterruptMask);
+  if (mode_ == CpuMode::k_Halted && PendingInterrupts() != 0) {
+    mode_ = CpuMode::k_Running;
+  } else if (mode_ == CpuMode::k_Stopped &&
+             (k_Interrupts & k_InterruptJoypad) != 0) {
+    mode_ = CpuMode::k_Running;
+  }
 }
 
-void binary::gb::GameBoy::UpdateAll16BitReg() { 
-  UpdateRegHL();
-  UpdateRegBC();
-  UpdateRegDE();
-  UpdateRegAF();
+uint8_t binary::gb::GameBoy::PendingInterrupts() {
+  return bus_.interrupt_enable_ & bus_.io_registers_[k_InterruptFlagIndex] &
+         k_InterruptMask;
 }
 
-uint8_t binary::gb::GameBoy::Operand8Bit() {
-  return memory_[reg_.program_counter_ + 1];
-}
-uint16_t binary::gb::GameBoy::Operand16Bit() { 
-  const uint16_t k_LowByte = memory_[reg_.program_counter_ + 1];
-  const uint16_t k_HighByte = memory_[reg_.program_counter_ + 2];
-  const uint16_t k_Operand16bit = (k_HighByte << 8) | k_LowByte;
-  return k_Operand16bit;
-}
 uint16_t binary::gb::GameBoy::ReturnAddress() { 
-  const uint16_t k_LowByte = memory_[reg_.stack_pointer_ + 1];
-  const uint16_t k_HighByte = memory_[reg_.stack_pointer_ + 2];
+  const uint16_t k_LowByte = Read(reg_.stack_pointer_ + 1);
+  const uint16_t k_HighByte = Read(reg_.stack_pointer_ + 2);
   const uint16_t k_ReturnAddress = (k_HighByte << 8) | k_LowByte;
   reg_.stack_pointer_ += 2;
   return k_ReturnAddress;
@@ -224,11 +259,6 @@ void binary::gb::GameBoy::GetProgramCounterBytes(uint8_t& high_byte,
    low_byte =  (reg_.program_counter_ << 8);
    return;
 }
-void binary::gb::GameBoy::Update16BitRegister(uint16_t& _16bit_reg,
-                                             const uint8_t& k_HighReg,
-                                             const uint8_t& k_LowReg) {
-  _16bit_reg = static_cast<uint16_t>((k_HighReg << 8) | k_LowReg);
-}
 
 namespace binary::gb {
 
@@ -244,6 +274,31 @@ void InitOpcodeTable(std::array<Opcode, 512>& opcode_table) {
   InitMiscellaneous(opcode_table);
 }
 
+namespace {
+std::array<MachineCycles, 512> MakeMachineCycleTable() {
+  auto opcode_table = std::make_unique<std::array<Opcode, 512>>();
+  InitOpcodeTable(*opcode_table);
+  std::array<MachineCycles, 512> table{};
+  for (size_t opcode = 0; opcode < table.size(); opcode++) {
+    const Opcode& k_Opcode = opcode_table->at(opcode);
+    // Opcodes without timings yet cost the single cycle Fetch() counts
+    uint8_t cycles = std::max<uint8_t>(k_Opcode.machine_cycles_, 1);
+    uint8_t branch = std::max(k_Opcode.machine_cycles_branch_, cycles);
+    // CB prefixed timings include the prefix byte, PREFIX_CB was already
+    // charged for it
+    if (opcode >= k_PrefixOffset && cycles > 1) {
+      cycles--;
+      branch--;
+    }
+    table[opcode] = {cycles, branch};
+  }
+  return table;
+}
+}  // namespace
+
+const std::array<MachineCycles, 512> k_MachineCycleTable =
+    MakeMachineCycleTable();
+
 void InitPrefixTable(std::array<Opcode, 512>& opcode_table) {
   using namespace binary::gb::instructionset;
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -349,7 +404,7 @@ uint8_t register_index = 0;
     const uint8_t k_DecrementOpcode = opcode + 2; 
   
     // Indirect instruction on opcode 0x34 and 0x35 takes 3 machine instructions
-    const uint8_t cycles = (opcode == 0x34 || opcode == 0x35) ? 1 : 3;
+    const uint8_t cycles = (k_IncrementOpcode == 0x34) ? 3 : 1;
     if ((opcode & 0x03) == 0x03) { 
       opcode_table[k_16BitOpcode].opcode_ = PrintOpcode<>;
       opcode_table[k_16BitOpcode].SetMachineCycles(2); 
@@ -453,7 +508,7 @@ void InitRestart(std::array<Opcode, 512>& opcode_table) {
   InitGenericOpcode<1>(opcode_table[RST_20H], "RST 20H", 4);
   opcode_table[RST_20H].execute_ = Restart<0x20>;
   InitGenericOpcode<1>(opcode_table[RST_30H], "RST 30H", 4);
-  opcode_table[RST_20H].execute_ = Restart<0x30>;
+  opcode_table[RST_30H].execute_ = Restart<0x30>;
   InitGenericOpcode<1>(opcode_table[RST_08H], "RST 08H", 4);
   opcode_table[RST_08H].execute_ = Restart<0x08>;
   InitGenericOpcode<1>(opcode_table[RST_18H], "RST 18H", 4);
@@ -473,11 +528,14 @@ void InitMiscellaneous(std::array<Opcode, 512>& opcode_table) {
   opcode_table[DI].execute_ = DisableInterrput;
   // Find documentation that goes over how these opecode operate in this system
   InitGenericOpcode<1>(opcode_table[HALT], "HALT", 1);
+  opcode_table[HALT].execute_ = Halt;
   InitGenericOpcode<2>(opcode_table[STOP], "STOP", 1);
+  opcode_table[STOP].execute_ = Stop;
   InitGenericOpcode<1>(opcode_table[NOP], "NOP", 1);
   opcode_table[NOP].execute_ = NoOperation;
 
   InitGenericOpcode<1>(opcode_table[DAA], "DAA", 1);
+  opcode_table[DAA].execute_ = DecimalAdjust;
   InitGenericOpcode<1>(opcode_table[SCF], "SCF", 1);
   opcode_table[SCF].execute_ = SetCarryFlag; 
   InitGenericOpcode<1>(opcode_table[CPL], "CPL", 1);
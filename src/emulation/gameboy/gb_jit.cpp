@@ -0,0 +1,718 @@
+#include "include/gb_jit.h"
+#include "include/gb_dispatch.h"
+#include <cstring>
+#include <utility>
+#include <vector>
+#ifdef BINARY_GB_JIT_X64
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace binary::gb {
+#ifdef BINARY_GB_JIT_X64
+namespace {
+enum HostRegister : uint8_t {
+  k_Rax = 0, k_Rcx = 1, k_Rdx = 2, k_Rbx = 3,
+  k_Rsp = 4, k_Rbp = 5, k_Rsi = 6, k_Rdi = 7,
+  k_R8  = 8, k_R12 = 12, k_R13 = 13, k_R14 = 14, k_R15 = 15
+};
+#ifdef _WIN32
+constexpr HostRegister k_ArgumentRegister = k_Rcx;
+#else
+constexpr HostRegister k_ArgumentRegister = k_Rdi;
+#endif
+
+// Guest registers in the order the host registers are assigned to them. Every
+// host register here is callee saved on Windows, the prologue saves them all.
+constexpr size_t k_GuestRegisterCount = 7;
+constexpr std::array<uint8_t Register::*, k_GuestRegisterCount>
+    k_GuestRegisters = {&Register::a_, &Register::b_, &Register::c_,
+                        &Register::d_, &Register::e_, &Register::h_,
+                        &Register::l_};
+constexpr std::array<HostRegister, k_GuestRegisterCount> k_HostRegisters = {
+    k_R12, k_R13, k_R14, k_R15, k_Rbp, k_Rsi, k_Rdi};
+constexpr size_t k_GuestA = 0;
+constexpr std::array<uint16_t Register::*, 4> k_GuestPairs = {
+    &Register::bc_, &Register::de_, &Register::hl_, &Register::stack_pointer_};
+// Halves of each pair in k_GuestRegisters, SP doesn't have any
+constexpr std::array<std::pair<int, int>, 4> k_GuestPairHalves = {
+    {{1, 2}, {3, 4}, {5, 6}, {-1, -1}}};
+
+// Pushed registers plus this keeps the stack 16 byte aligned for calls, the
+// Windows shadow space sits at [rsp] and our spill slot right after it
+constexpr uint8_t k_FrameSize = 40;
+constexpr uint8_t k_GenerationSlot = 32;
+constexpr std::array<HostRegister, 8> k_SavedRegisters = {
+    k_Rbx, k_Rbp, k_Rsi, k_Rdi, k_R12, k_R13, k_R14, k_R15};
+
+enum class NativeKind : uint8_t {
+  k_Call, k_Nop, k_Load8, k_Increment8, k_Decrement8, k_Increment16,
+  k_Decrement16, k_Add8, k_Sub8, k_And8, k_Or8, k_Xor8
+};
+
+typedef struct NativeOp {
+  NativeKind kind_ = NativeKind::k_Call;
+  uint8_t x_{};
+  uint8_t y_{};
+} NativeOp;
+
+// Only opcodes whose k_DispatchTable entry is exactly the handler we
+// translate become native, anything mapped differently stays a call
+void Match(std::array<NativeOp, 256>& table, const Execute k_Handler,
+           const NativeOp k_Op) {
+  for (size_t opcode = 0; opcode < table.size(); opcode++) {
+    if (k_DispatchTable[opcode] == k_Handler) {
+      table[opcode] = k_Op;
+    }
+  }
+}
+
+template <size_t k_X, size_t k_Y>
+void MatchLoad(std::array<NativeOp, 256>& table) {
+  using namespace instructionset;
+  Match(table,
+        Load<uint8_t, k_GuestRegisters[k_X], k_GuestRegisters[k_Y]>,
+        {NativeKind::k_Load8, k_X, k_Y});
+}
+
+template <size_t k_X>
+void MatchRegister(std::array<NativeOp, 256>& table) {
+  using namespace instructionset;
+  constexpr uint8_t Register::*k_Register = k_GuestRegisters[k_X];
+  Match(table, Increment<uint8_t, k_Register>, {NativeKind::k_Increment8, k_X});
+  Match(table, Decrement<uint8_t, k_Register>, {NativeKind::k_Decrement8, k_X});
+  Match(table, Add<k_Register>, {NativeKind::k_Add8, k_X});
+  Match(table, Sub<k_Register>, {NativeKind::k_Sub8, k_X});
+  Match(table, And<k_Register>, {NativeKind::k_And8, k_X});
+  Match(table, Or<k_Register>, {NativeKind::k_Or8, k_X});
+  Match(table, Xor<k_Register>, {NativeKind::k_Xor8, k_X});
+}
+
+template <size_t k_X>
+void MatchPair(std::array<NativeOp, 256>& table) {
+  using namespace instructionset;
+  constexpr uint16_t Register::*k_Pair = k_GuestPairs[k_X];
+  Match(table, Increment<uint16_t, k_Pair>, {NativeKind::k_Increment16, k_X});
+  Match(table, Decrement<uint16_t, k_Pair>, {NativeKind::k_Decrement16, k_X});
+}
+
+template <size_t... k_Index>
+std::array<NativeOp, 256> MakeNativeTable(std::index_sequence<k_Index...>) {
+  std::array<NativeOp, 256> table{};
+  table[NOP] = {NativeKind::k_Nop};
+  (MatchLoad<k_Index / k_GuestRegisterCount, k_Index % k_GuestRegisterCount>(
+       table), ...);
+  MatchRegister<0>(table); MatchRegister<1>(table); MatchRegister<2>(table);
+  MatchRegister<3>(table); MatchRegister<4>(table); MatchRegister<5>(table);
+  MatchRegister<6>(table);
+  MatchPair<0>(table); MatchPair<1>(table); MatchPair<2>(table);
+  MatchPair<3>(table);
+  return table;
+}
+
+const std::array<NativeOp, 256>& NativeTable() {
+  static const std::array<NativeOp, 256> k_Table = MakeNativeTable(
+      std::make_index_sequence<k_GuestRegisterCount * k_GuestRegisterCount>{});
+  return k_Table;
+}
+
+void FetchThunk(GameBoy* gb) { instructionset::Fetch(gb); }
+
+// Where every field the compiled code touches lives relative to the GameBoy
+typedef struct Offsets {
+  std::array<int32_t, k_GuestRegisterCount> registers_{};
+  std::array<int32_t, 4> pairs_{};
+  int32_t f_{};
+  int32_t program_counter_{};
+  int32_t immediate_{};
+  int32_t immediate_latched_{};
+  int32_t cb_prefixed_{};
+  int32_t cycles_{};
+  int32_t branched_{};
+  int32_t generation_{};
+  int32_t lazy_operation_{};
+  int32_t lazy_reg_{};
+  int32_t lazy_operand_{};
+  int32_t lazy_result_{};
+  int32_t address_bus_{};
+  int32_t idu_{};
+  int32_t read_signal_{};
+  int32_t instruction_{};
+} Offsets;
+
+Offsets MakeOffsets(GameBoy* gb) {
+  const auto k_Offset = [gb](const void* field) {
+    return static_cast<int32_t>(static_cast<const uint8_t*>(field) -
+                                reinterpret_cast<const uint8_t*>(gb));
+  };
+  Offsets offsets{};
+  for (size_t index = 0; index < k_GuestRegisterCount; index++) {
+    offsets.registers_[index] = k_Offset(&(gb->reg_.*k_GuestRegisters[index]));
+  }
+  for (size_t index = 0; index < k_GuestPairs.size(); index++) {
+    offsets.pairs_[index] = k_Offset(&(gb->reg_.*k_GuestPairs[index]));
+  }
+  offsets.f_ = k_Offset(&gb->reg_.f_);
+  offsets.program_counter_ = k_Offset(&gb->reg_.program_counter_);
+  offsets.immediate_ = k_Offset(&gb->immediate_);
+  offsets.immediate_latched_ = k_Offset(&gb->immediate_latched_);
+  offsets.cb_prefixed_ = k_Offset(&gb->cb_prefixed);
+  offsets.cycles_ = k_Offset(&gb->cycles_);
+  offsets.branched_ = k_Offset(&gb->branched);
+  offsets.generation_ = k_Offset(&gb->block_cache_.generation_);
+  offsets.lazy_operation_ = k_Offset(&gb->lazy_.operation_);
+  offsets.lazy_reg_ = k_Offset(&gb->lazy_.reg_);
+  offsets.lazy_operand_ = k_Offset(&gb->lazy_.operand_);
+  offsets.lazy_result_ = k_Offset(&gb->lazy_.result_);
+  offsets.address_bus_ = k_Offset(&gb->address_bus_);
+  offsets.idu_ = k_Offset(&gb->idu_);
+  offsets.read_signal_ = k_Offset(&gb->read_signal_);
+  offsets.instruction_ = k_Offset(&gb->instruction_);
+  return offsets;
+}
+
+// Just enough of x86-64 for the compiled blocks. Memory operands are always
+// [rbx + disp32] since rbx holds the GameBoy pointer.
+class Assembler {
+ public:
+  std::vector<uint8_t> code_;
+
+  void Emit(const uint8_t k_Byte) { code_.push_back(k_Byte); }
+  void Emit16(const uint16_t k_Value) {
+    Emit(k_Value & 0xFF);
+    Emit(k_Value >> 8);
+  }
+  void Emit32(const uint32_t k_Value) {
+    Emit16(k_Value & 0xFFFF);
+    Emit16(k_Value >> 16);
+  }
+  void Emit64(const uint64_t k_Value) {
+    Emit32(k_Value & 0xFFFFFFFF);
+    Emit32(k_Value >> 32);
+  }
+
+  // k_Byte forces a REX prefix so spl/bpl/sil/dil are used instead of ah..bh
+  void Rex(const bool k_Wide, const uint8_t k_Reg, const uint8_t k_Rm,
+           const bool k_Byte = false) {
+    const uint8_t k_Rex = 0x40 | (k_Wide << 3) | (((k_Reg >> 3) & 1) << 2) |
+                          ((k_Rm >> 3) & 1);
+    if (k_Rex != 0x40 || k_Byte) {
+      Emit(k_Rex);
+    }
+  }
+  void Memory(const uint8_t k_Reg, const int32_t k_Displacement) {
+    Emit(0x80 | ((k_Reg & 7) << 3) | k_Rbx);
+    Emit32(static_cast<uint32_t>(k_Displacement));
+  }
+  void Direct(const uint8_t k_Reg, const uint8_t k_Rm) {
+    Emit(0xC0 | ((k_Reg & 7) << 3) | (k_Rm & 7));
+  }
+  static bool IsByteRex(const uint8_t k_Reg) { return k_Reg >= 4 && k_Reg < 8; }
+
+  void Push(const uint8_t k_Reg) {
+    Rex(false, 0, k_Reg);
+    Emit(0x50 + (k_Reg & 7));
+  }
+  void Pop(const uint8_t k_Reg) {
+    Rex(false, 0, k_Reg);
+    Emit(0x58 + (k_Reg & 7));
+  }
+  void MovRegReg64(const uint8_t k_Dst, const uint8_t k_Src) {
+    Rex(true, k_Src, k_Dst);
+    Emit(0x89);
+    Direct(k_Src, k_Dst);
+  }
+  void MovRegReg32(const uint8_t k_Dst, const uint8_t k_Src) {
+    Rex(false, k_Src, k_Dst);
+    Emit(0x89);
+    Direct(k_Src, k_Dst);
+  }
+  void MovRegImm32(const uint8_t k_Reg, const uint32_t k_Value) {
+    Rex(false, 0, k_Reg);
+    Emit(0xB8 + (k_Reg & 7));
+    Emit32(k_Value);
+  }
+  void MovRegImm64(const uint8_t k_Reg, const uint64_t k_Value) {
+    Rex(true, 0, k_Reg);
+    Emit(0xB8 + (k_Reg & 7));
+    Emit64(k_Value);
+  }
+  void Load8(const uint8_t k_Dst, const int32_t k_Displacement) {
+    Rex(false, k_Dst, k_Rbx);
+    Emit(0x0F);
+    Emit(0xB6);
+    Memory(k_Dst, k_Displacement);
+  }
+  void Load32(const uint8_t k_Dst, const int32_t k_Displacement) {
+    Rex(false, k_Dst, k_Rbx);
+    Emit(0x8B);
+    Memory(k_Dst, k_Displacement);
+  }
+  void Store8(const int32_t k_Displacement, const uint8_t k_Src) {
+    Rex(false, k_Src, k_Rbx, IsByteRex(k_Src));
+    Emit(0x88);
+    Memory(k_Src, k_Displacement);
+  }
+  void Store16(const int32_t k_Displacement, const uint8_t k_Src) {
+    Emit(0x66);
+    Rex(false, k_Src, k_Rbx);
+    Emit(0x89);
+    Memory(k_Src, k_Displacement);
+  }
+  void Store8Imm(const int32_t k_Displacement, const uint8_t k_Value) {
+    Emit(0xC6);
+    Memory(0, k_Displacement);
+    Emit(k_Value);
+  }
+  void Store16Imm(const int32_t k_Displacement, const uint16_t k_Value) {
+    Emit(0x66);
+    Emit(0xC7);
+    Memory(0, k_Displacement);
+    Emit16(k_Value);
+  }
+  void Add64Imm8(const int32_t k_Displacement, const int8_t k_Value) {
+    Rex(true, 0, k_Rbx);
+    Emit(0x83);
+    Memory(0, k_Displacement);
+    Emit(static_cast<uint8_t>(k_Value));
+  }
+  void Add64Imm32(const int32_t k_Displacement, const int32_t k_Value) {
+    Rex(true, 0, k_Rbx);
+    Emit(0x81);
+    Memory(0, k_Displacement);
+    Emit32(static_cast<uint32_t>(k_Value));
+  }
+  void Add16Imm8(const int32_t k_Displacement, const int8_t k_Value) {
+    Emit(0x66);
+    Emit(0x83);
+    Memory(0, k_Displacement);
+    Emit(static_cast<uint8_t>(k_Value));
+  }
+  void Cmp8Imm(const int32_t k_Displacement, const uint8_t k_Value) {
+    Emit(0x80);
+    Memory(7, k_Displacement);
+    Emit(k_Value);
+  }
+  void Cmp16Imm(const int32_t k_Displacement, const uint16_t k_Value) {
+    Emit(0x66);
+    Emit(0x81);
+    Memory(7, k_Displacement);
+    Emit16(k_Value);
+  }
+  // /0 add, /5 sub on the low byte of k_Reg
+  void Alu8Imm(const uint8_t k_Extension, const uint8_t k_Reg,
+               const uint8_t k_Value) {
+    Rex(false, 0, k_Reg, IsByteRex(k_Reg));
+    Emit(0x80);
+    Direct(k_Extension, k_Reg);
+    Emit(k_Value);
+  }
+  // /4 and on all of k_Reg
+  void Alu32Imm(const uint8_t k_Extension, const uint8_t k_Reg,
+                const uint32_t k_Value) {
+    Rex(false, 0, k_Reg);
+    Emit(0x81);
+    Direct(k_Extension, k_Reg);
+    Emit32(k_Value);
+  }
+  // 0x01 add, 0x29 sub, 0x21 and, 0x09 or, 0x31 xor, 0x85 test
+  void Alu32(const uint8_t k_Opcode, const uint8_t k_Dst, const uint8_t k_Src) {
+    Rex(false, k_Src, k_Dst);
+    Emit(k_Opcode);
+    Direct(k_Src, k_Dst);
+  }
+  void CmoveZero(const uint8_t k_Dst, const uint8_t k_Src) {
+    Rex(false, k_Dst, k_Src);
+    Emit(0x0F);
+    Emit(0x44);
+    Direct(k_Dst, k_Src);
+  }
+  // [rsp + disp8], only used for the spill slot
+  void StoreStack32(const uint8_t k_Displacement, const uint8_t k_Src) {
+    Rex(false, k_Src, k_Rsp);
+    Emit(0x89);
+    Emit(0x44 | ((k_Src & 7) << 3));
+    Emit(0x24);
+    Emit(k_Displacement);
+  }
+  void CmpStack32(const uint8_t k_Reg, const uint8_t k_Displacement) {
+    Rex(false, k_Reg, k_Rsp);
+    Emit(0x3B);
+    Emit(0x44 | ((k_Reg & 7) << 3));
+    Emit(0x24);
+    Emit(k_Displacement);
+  }
+  void AdjustStack(const bool k_Grow, const uint8_t k_Bytes) {
+    Emit(0x48);
+    Emit(0x83);
+    Emit(k_Grow ? 0xEC : 0xC4);
+    Emit(k_Bytes);
+  }
+  void Call(const void* k_Function) {
+    MovRegImm64(k_Rax, reinterpret_cast<uint64_t>(k_Function));
+    Emit(0xFF);
+    Emit(0xD0);
+  }
+  // Returns where the rel32 goes, Bind() fills it in
+  size_t Jump(const uint8_t k_Condition) {
+    Emit(0x0F);
+    Emit(0x80 | k_Condition);
+    Emit32(0);
+    return code_.size() - 4;
+  }
+  void Bind(const size_t k_Patch) {
+    const int32_t k_Relative = static_cast<int32_t>(code_.size() - (k_Patch + 4));
+    std::memcpy(code_.data() + k_Patch, &k_Relative, sizeof(k_Relative));
+  }
+};
+constexpr uint8_t k_JumpEqual = 0x4;
+constexpr uint8_t k_JumpNotEqual = 0x5;
+
+class BlockCompiler {
+ public:
+  BlockCompiler(GameBoy* gb) : offsets_(MakeOffsets(gb)) {}
+
+  std::vector<uint8_t> Compile(const BasicBlock& block) {
+    const std::array<NativeOp, 256>& k_Native = NativeTable();
+    Prologue();
+    as_.Store8Imm(offsets_.immediate_latched_, 1);
+    as_.Load32(k_Rax, offsets_.generation_);
+    as_.StoreStack32(k_GenerationSlot, k_Rax);
+
+    for (size_t index = 0; index < block.ops_.size(); index++) {
+      const MicroOp& k_Op = block.ops_[index];
+      const bool k_Last = (index + 1 == block.ops_.size());
+      const NativeOp k_NativeOp =
+          k_Op.prefixed_ ? NativeOp{} : k_Native[k_Op.opcode_];
+      if (k_NativeOp.kind_ != NativeKind::k_Call) {
+        EmitNative(k_NativeOp);
+        if (k_Last) {
+          SpillAll();
+          ExitFallthrough(k_Op);
+        } else {
+          pending_cycles_ += k_Op.cycles_;
+        }
+        continue;
+      }
+
+      // Handlers read and write the guest registers in memory
+      SpillAll();
+      Forget();
+      FlushCycles();
+      as_.Store16Imm(offsets_.immediate_, k_Op.immediate_);
+      as_.Store16Imm(offsets_.program_counter_, k_Op.address_);
+      as_.MovRegReg64(k_ArgumentRegister, k_Rbx);
+      as_.Call(reinterpret_cast<const void*>(k_Op.execute_));
+      if (k_Op.prefixed_) {
+        as_.Store8Imm(offsets_.cb_prefixed_, 0);
+      }
+      if (k_Last) {
+        ExitChecked(k_Op);
+        continue;
+      }
+      // A handler that overwrote cached code ends the block
+      as_.Load32(k_Rax, offsets_.generation_);
+      as_.CmpStack32(k_Rax, k_GenerationSlot);
+      const size_t k_Continue = as_.Jump(k_JumpEqual);
+      ExitFetch(k_Op);
+      as_.Bind(k_Continue);
+      pending_cycles_ += k_Op.cycles_;
+    }
+    return std::move(as_.code_);
+  }
+
+ private:
+  void Prologue() {
+    for (const HostRegister k_Reg : k_SavedRegisters) {
+      as_.Push(k_Reg);
+    }
+    as_.AdjustStack(true, k_FrameSize);
+    as_.MovRegReg64(k_Rbx, k_ArgumentRegister);
+  }
+  void Epilogue() {
+    as_.AdjustStack(false, k_FrameSize);
+    for (size_t index = k_SavedRegisters.size(); index > 0; index--) {
+      as_.Pop(k_SavedRegisters[index - 1]);
+    }
+    as_.Emit(0xC3);
+  }
+
+  // Guest register -> host register, loaded on first use
+  uint8_t Use(const size_t k_Guest) {
+    if (!loaded_[k_Guest]) {
+      as_.Load8(k_HostRegisters[k_Guest], offsets_.registers_[k_Guest]);
+      loaded_[k_Guest] = true;
+    }
+    return k_HostRegisters[k_Guest];
+  }
+  uint8_t Define(const size_t k_Guest) {
+    loaded_[k_Guest] = true;
+    dirty_[k_Guest] = true;
+    return k_HostRegisters[k_Guest];
+  }
+  void Spill(const size_t k_Guest) {
+    if (dirty_[k_Guest]) {
+      as_.Store8(offsets_.registers_[k_Guest], k_HostRegisters[k_Guest]);
+      dirty_[k_Guest] = false;
+    }
+  }
+  void SpillAll() {
+    for (size_t guest = 0; guest < k_GuestRegisterCount; guest++) {
+      Spill(guest);
+    }
+  }
+  void Forget() { loaded_.fill(false); }
+  void AddCycles(const uint32_t k_Cycles) {
+    if (k_Cycles <= 127) {
+      as_.Add64Imm8(offsets_.cycles_, static_cast<int8_t>(k_Cycles));
+    } else {
+      as_.Add64Imm32(offsets_.cycles_, static_cast<int32_t>(k_Cycles));
+    }
+  }
+  void FlushCycles() {
+    if (pending_cycles_ != 0) {
+      AddCycles(pending_cycles_);
+      pending_cycles_ = 0;
+    }
+  }
+  // Same as InstructionCycles(): a taken conditional branch set
+  // gb->branched and costs machine_cycles_branch_ instead
+  void ChargeBranch(const MicroOp& k_Op) {
+    const MachineCycles& k_Cycles = k_MachineCycleTable[k_Op.opcode_];
+    if (k_Cycles.branch_ == k_Cycles.cycles_) {
+      return;
+    }
+    as_.Cmp8Imm(offsets_.branched_, 0);
+    const size_t k_NotTaken = as_.Jump(k_JumpEqual);
+    AddCycles(k_Cycles.branch_ - k_Cycles.cycles_);
+    as_.Store8Imm(offsets_.branched_, 0);
+    as_.Bind(k_NotTaken);
+  }
+
+  void EmitNative(const NativeOp& k_Op) {
+    switch (k_Op.kind_) {
+      case NativeKind::k_Nop:
+      case NativeKind::k_Call:
+        break;
+      case NativeKind::k_Load8: {
+        const uint8_t k_Src = Use(k_Op.y_);
+        as_.MovRegReg32(Define(k_Op.x_), k_Src);
+        break;
+      }
+      case NativeKind::k_Increment8:
+        Use(k_Op.x_);
+        as_.Alu8Imm(0, Define(k_Op.x_), 1);
+        break;
+      case NativeKind::k_Decrement8:
+        Use(k_Op.x_);
+        as_.Alu8Imm(5, Define(k_Op.x_), 1);
+        break;
+      case NativeKind::k_Increment16:
+      case NativeKind::k_Decrement16: {
+        // Updated in memory, so the halves can't stay pinned
+        const auto [k_High, k_Low] = k_GuestPairHalves[k_Op.x_];
+        for (const int k_Half : {k_High, k_Low}) {
+          if (k_Half >= 0) {
+            Spill(k_Half);
+            loaded_[k_Half] = false;
+          }
+        }
+        as_.Add16Imm8(offsets_.pairs_[k_Op.x_],
+                      (k_Op.kind_ == NativeKind::k_Increment16) ? 1 : -1);
+        break;
+      }
+      case NativeKind::k_Add8:
+      case NativeKind::k_Sub8: {
+        // Same record SetFlagZ0HC/SetFlagZ1HC defer: the old A, the operand
+        // and the 16 bit result
+        const uint8_t k_A = Use(k_GuestA);
+        const uint8_t k_Operand = Use(k_Op.x_);
+        as_.MovRegReg32(k_Rax, k_A);
+        as_.Alu32((k_Op.kind_ == NativeKind::k_Add8) ? 0x01 : 0x29, k_Rax,
+                  k_Operand);
+        as_.Store8(offsets_.lazy_reg_, k_A);
+        as_.Store8(offsets_.lazy_operand_, k_Operand);
+        as_.Store16(offsets_.lazy_result_, k_Rax);
+        as_.Store8Imm(offsets_.lazy_operation_,
+                      static_cast<uint8_t>((k_Op.kind_ == NativeKind::k_Add8)
+                                               ? FlagOperation::k_Z0HC
+                                               : FlagOperation::k_Z1HC));
+        // Host registers always hold the zero extended guest value
+        as_.Alu32Imm(4, k_Rax, 0xFF);
+        as_.MovRegReg32(Define(k_GuestA), k_Rax);
+        break;
+      }
+      case NativeKind::k_And8:
+      case NativeKind::k_Or8:
+      case NativeKind::k_Xor8: {
+        // F only depends on the result being zero, take it from the host ZF
+        uint8_t alu = 0x21;
+        uint8_t not_zero = k_FlagH;
+        uint8_t zero = k_FlagZ | k_FlagH;
+        if (k_Op.kind_ == NativeKind::k_Or8) {
+          alu = 0x09;
+          not_zero = 0;
+          zero = k_FlagZ;
+        } else if (k_Op.kind_ == NativeKind::k_Xor8) {
+          alu = 0x31;
+          not_zero = 0;
+          zero = k_FlagZ;
+        }
+        const uint8_t k_A = Use(k_GuestA);
+        const uint8_t k_Operand = Use(k_Op.x_);
+        as_.MovRegReg32(k_Rax, k_A);
+        as_.Alu32(alu, k_Rax, k_Operand);
+        as_.MovRegImm32(k_Rcx, not_zero);
+        as_.MovRegImm32(k_Rdx, zero);
+        as_.Alu32(0x85, k_Rax, k_Rax);
+        as_.CmoveZero(k_Rcx, k_Rdx);
+        as_.Store8(offsets_.f_, k_Rcx);
+        as_.Store8Imm(offsets_.lazy_operation_,
+                      static_cast<uint8_t>(FlagOperation::k_None));
+        as_.MovRegReg32(Define(k_GuestA), k_Rax);
+        break;
+      }
+    }
+  }
+
+  // Same as ExecuteBlock() when the block stops
+  void ExitFallthrough(const MicroOp& k_Op) {
+    FlushCycles();
+    as_.Store8Imm(offsets_.immediate_latched_, 0);
+    as_.Store16Imm(offsets_.address_bus_, k_Op.fallthrough_);
+    as_.Store16Imm(offsets_.idu_, k_Op.fallthrough_ + 1);
+    as_.Store16Imm(offsets_.program_counter_, k_Op.fallthrough_ + 1);
+    as_.Store8Imm(offsets_.read_signal_, 1);
+    as_.Store8Imm(offsets_.instruction_, k_Op.fetched_);
+    AddCycles(k_Op.cycles_);
+    ChargeBranch(k_Op);
+    Epilogue();
+  }
+  void ExitFetch(const MicroOp& k_Op) {
+    FlushCycles();
+    as_.Store8Imm(offsets_.immediate_latched_, 0);
+    as_.MovRegReg64(k_ArgumentRegister, k_Rbx);
+    as_.Call(reinterpret_cast<const void*>(FetchThunk));
+    // Fetch() counted the first machine cycle
+    if (k_Op.cycles_ > 1) {
+      AddCycles(k_Op.cycles_ - 1);
+    }
+    ChargeBranch(k_Op);
+    Epilogue();
+  }
+  // Branched or overwritten blocks let Fetch() read memory
+  void ExitChecked(const MicroOp& k_Op) {
+    as_.Cmp16Imm(offsets_.program_counter_, k_Op.fallthrough_);
+    const size_t k_Branched = as_.Jump(k_JumpNotEqual);
+    as_.Load32(k_Rax, offsets_.generation_);
+    as_.CmpStack32(k_Rax, k_GenerationSlot);
+    const size_t k_Overwritten = as_.Jump(k_JumpNotEqual);
+    const uint32_t k_Pending = pending_cycles_;
+    ExitFallthrough(k_Op);
+    pending_cycles_ = k_Pending;
+    as_.Bind(k_Branched);
+    as_.Bind(k_Overwritten);
+    ExitFetch(k_Op);
+  }
+
+  Assembler as_;
+  const Offsets offsets_;
+  std::array<bool, k_GuestRegisterCount> loaded_{};
+  std::array<bool, k_GuestRegisterCount> dirty_{};
+  uint32_t pending_cycles_{};
+};
+}  // namespace
+
+Jit::~Jit() {
+  if (code_ == nullptr) {
+    return;
+  }
+#ifdef _WIN32
+  VirtualFree(code_, 0, MEM_RELEASE);
+#else
+  munmap(code_, k_JitCodeSize);
+#endif
+}
+
+bool Jit::Compile(GameBoy* gb, BasicBlock& block) {
+  if (code_ == nullptr) {
+#ifdef _WIN32
+    code_ = static_cast<uint8_t*>(VirtualAlloc(nullptr, k_JitCodeSize,
+                                               MEM_COMMIT | MEM_RESERVE,
+                                               PAGE_READWRITE));
+#else
+    void* memory = mmap(nullptr, k_JitCodeSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    code_ = (memory == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(memory);
+#endif
+    if (code_ == nullptr) {
+      // No executable memory, stay on the interpreter
+      enabled_ = false;
+      return true;
+    }
+    writable_ = true;
+  }
+  BlockCompiler compiler(gb);
+  const std::vector<uint8_t> k_Code = compiler.Compile(block);
+  if (used_ + k_Code.size() > k_JitCodeSize) {
+    return false;
+  }
+  // The buffer is never writable and executable at the same time
+  if (!Protect(true)) {
+    enabled_ = false;
+    return true;
+  }
+  uint8_t* const k_Entry = code_ + used_;
+  std::memcpy(k_Entry, k_Code.data(), k_Code.size());
+  if (!Protect(false)) {
+    // The blocks compiled so far can't run either, EmulateJit() checks
+    // enabled_ before calling them
+    enabled_ = false;
+    return true;
+  }
+#ifdef _WIN32
+  FlushInstructionCache(GetCurrentProcess(), k_Entry, k_Code.size());
+#else
+  __builtin___clear_cache(reinterpret_cast<char*>(k_Entry),
+                          reinterpret_cast<char*>(k_Entry + k_Code.size()));
+#endif
+  block.native_ = reinterpret_cast<void (*)(GameBoy*)>(k_Entry);
+  used_ += k_Code.size();
+  compiled_blocks_++;
+  return true;
+}
+
+bool Jit::Protect(const bool k_Writable) {
+  if (writable_ == k_Writable) {
+    return true;
+  }
+#ifdef _WIN32
+  DWORD old_protection = 0;
+  const bool k_Changed =
+      VirtualProtect(code_, k_JitCodeSize,
+                     k_Writable ? PAGE_READWRITE : PAGE_EXECUTE_READ,
+                     &old_protection) != 0;
+#else
+  const bool k_Changed =
+      mprotect(code_, k_JitCodeSize,
+               k_Writable ? (PROT_READ | PROT_WRITE)
+                          : (PROT_READ | PROT_EXEC)) == 0;
+#endif
+  if (k_Changed) {
+    writable_ = k_Writable;
+  }
+  return k_Changed;
+}
+
+void Jit::Reset() { used_ = 0; }
+#else
+Jit::~Jit() {}
+bool Jit::Compile(GameBoy* gb, BasicBlock& block) { return true; }
+void Jit::Reset() {}
+#endif
+}  // namespace binary::gb
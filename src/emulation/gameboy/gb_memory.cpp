@@ -0,0 +1,161 @@
+#include "include/gb_memory.h"
+#include "include/gb_instruction.h"
+#include <algorithm>
+
+namespace binary::gb {
+namespace {
+constexpr uint8_t PageIndex(const uint16_t k_Address) {
+  return static_cast<uint8_t>(k_Address >> 8);
+}
+constexpr uint8_t PageIndex(const MemoryMap k_Address) {
+  return PageIndex(static_cast<uint16_t>(k_Address));
+}
+constexpr uint8_t k_OpenBus = 0xFF;
+}  // namespace
+
+MemoryBus::MemoryBus() {
+  // Writing to ROM doesn't change it, the MBC watches those writes instead
+  MapRomBank(rom_bank_);
+  MapHandlers(MemoryMap::k_RomBank00Start, MemoryMap::k_RomBank01NnEnd,
+              nullptr, WriteMemoryBankController);
+  MapMemory(MemoryMap::k_VideoRamStart, MemoryMap::k_VideoRamEnd,
+            video_ram_.data());
+  EnableExternalRam(false);
+  MapMemory(MemoryMap::k_WorkRamStart, MemoryMap::k_WorkRamBank01End,
+            work_ram_.data());
+  MapMemory(MemoryMap::k_EchoRamStart, MemoryMap::k_EchoRamEnd,
+            work_ram_.data());
+  MapMemory(MemoryMap::k_OamStart, MemoryMap::k_NotUsableEnd, oam_.data());
+  // I/O registers, HRAM and IE share the last page
+  MapHandlers(MemoryMap::k_IoRegistersStart, MemoryMap::k_InterruptEnable,
+              ReadHighPage, WriteHighPage);
+}
+
+void MemoryBus::LoadCartridge(const uint8_t* data, const size_t k_Size) {
+  // Pad the ROM to full banks so a bank pointer never runs off the end
+  const size_t k_Banks =
+      std::max<size_t>(2, (k_Size + k_RomBankSize - 1) / k_RomBankSize);
+  rom_.assign(k_Banks * k_RomBankSize, 0);
+  std::copy(data, data + k_Size, rom_.begin());
+  MapRomBank(1);
+  cartridge_generation_++;
+}
+
+void MemoryBus::MapRomBank(uint16_t bank) {
+  const size_t k_Banks = rom_.size() / k_RomBankSize;
+  bank %= k_Banks;
+  rom_bank_ = bank;
+  for (uint16_t page = 0; page < k_RomBankSize / k_PageSize; page++) {
+    page_table_[PageIndex(MemoryMap::k_RomBank00Start) + page].read_ =
+        rom_.data() + (page * k_PageSize);
+    page_table_[PageIndex(MemoryMap::k_RomBank01NnStart) + page].read_ =
+        rom_.data() + (bank * k_RomBankSize) + (page * k_PageSize);
+  }
+}
+
+void MemoryBus::EnableExternalRam(const bool k_Enable) {
+  external_ram_enabled_ = k_Enable;
+  if (k_Enable) {
+    MapMemory(MemoryMap::k_ExternalRamStart, MemoryMap::k_ExternalRamEnd,
+              external_ram_.data());
+  } else {
+    MapHandlers(MemoryMap::k_ExternalRamStart, MemoryMap::k_ExternalRamEnd,
+                ReadExternalRamDisabled, WriteExternalRamDisabled);
+  }
+}
+
+void MemoryBus::MapMemory(const MemoryMap k_Start, const MemoryMap k_End,
+                          uint8_t* memory) {
+  for (uint16_t page = PageIndex(k_Start); page <= PageIndex(k_End); page++) {
+    const size_t k_Offset = (page - PageIndex(k_Start)) * k_PageSize;
+    page_table_[page].read_ = memory + k_Offset;
+    page_table_[page].read_handler_ = nullptr;
+    page_table_[page].write_ = memory + k_Offset;
+    page_table_[page].write_handler_ = nullptr;
+  }
+}
+
+void MemoryBus::MapHandlers(const MemoryMap k_Start, const MemoryMap k_End,
+                            ReadHandler read_handler,
+                            WriteHandler write_handler) {
+  for (uint16_t page = PageIndex(k_Start); page <= PageIndex(k_End); page++) {
+    if (read_handler != nullptr) {
+      page_table_[page].read_ = nullptr;
+      page_table_[page].read_handler_ = read_handler;
+    }
+    if (write_handler != nullptr) {
+      page_table_[page].write_ = nullptr;
+      page_table_[page].write_handler_ = write_handler;
+    }
+  }
+}
+
+void MemoryBus::MapIo(const IORanges k_Start, const IORanges k_End,
+                      ReadHandler read_handler, WriteHandler write_handler) {
+  const uint16_t k_First = static_cast<uint16_t>(k_Start) & 0x7F;
+  const uint16_t k_Last = static_cast<uint16_t>(k_End) & 0x7F;
+  for (uint16_t index = k_First; index <= k_Last; index++) {
+    io_read_[index] = read_handler;
+    io_write_[index] = write_handler;
+  }
+}
+
+// Reference: https://gbdev.io/pandocs/MBC1.html
+// Only ROM banking and the RAM enable are wired up for now, the RAM bank and
+// banking mode registers are ignored.
+void WriteMemoryBankController(GameBoy* gb, const uint16_t k_Address,
+                               const uint8_t k_Value) {
+  if (k_Address < 0x2000) {
+    gb->bus_.EnableExternalRam((k_Value & 0x0F) == 0x0A);
+  } else if (k_Address < 0x4000) {
+    const uint8_t k_Bank = k_Value & 0x1F;
+    gb->bus_.MapRomBank((k_Bank == 0) ? 1 : k_Bank);
+    gb->block_cache_.Remapped();
+  }
+}
+
+uint8_t ReadExternalRamDisabled(GameBoy*, const uint16_t) {
+  return k_OpenBus;
+}
+
+void WriteExternalRamDisabled(GameBoy*, const uint16_t, const uint8_t) {
+  return;
+}
+
+uint8_t ReadHighPage(GameBoy* gb, const uint16_t k_Address) {
+  MemoryBus& bus = gb->bus_;
+  if (k_Address == static_cast<uint16_t>(MemoryMap::k_InterruptEnable)) {
+    return bus.interrupt_enable_;
+  }
+  if (k_Address >= static_cast<uint16_t>(MemoryMap::k_HighRamStart)) {
+    return bus.high_ram_[k_Address & 0x7F];
+  }
+  const uint8_t k_Index = k_Address & 0x7F;
+  if (bus.io_read_[k_Index] != nullptr) {
+    return bus.io_read_[k_Index](gb, k_Address);
+  }
+  return bus.io_registers_[k_Index];
+}
+
+void WriteHighPage(GameBoy* gb, const uint16_t k_Address,
+                   const uint8_t k_Value) {
+  MemoryBus& bus = gb->bus_;
+  if (k_Address == static_cast<uint16_t>(MemoryMap::k_InterruptEnable)) {
+    bus.interrupt_enable_ = k_Value;
+    return;
+  }
+  if (k_Address >= static_cast<uint16_t>(MemoryMap::k_HighRamStart)) {
+    if (gb->block_cache_.HasCode(k_Address)) {
+      gb->block_cache_.InvalidateWrite(gb, k_Address);
+    }
+    bus.high_ram_[k_Address & 0x7F] = k_Value;
+    return;
+  }
+  const uint8_t k_Index = k_Address & 0x7F;
+  if (bus.io_write_[k_Index] != nullptr) {
+    bus.io_write_[k_Index](gb, k_Address, k_Value);
+    return;
+  }
+  bus.io_registers_[k_Index] = k_Value;
+}
+}  // namespace binary::gb
@@ -0,0 +1,528 @@
+#include "include/gb_ppu.h"
+#include "include/gb_instruction.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#ifdef BINARY_GB_PPU_X64
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic without flags, GCC and Clang need the function
+// marked with the instruction set it uses
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BINARY_GB_PPU_TARGET(isa)
+#else
+#define BINARY_GB_PPU_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace binary::gb {
+namespace {
+// Offsets into video_ram_
+constexpr uint16_t k_TileMap0 = 0x1800;
+constexpr uint16_t k_TileMap1 = 0x1C00;
+// 0x8800 addressing numbers tiles from 0x9000 with a signed byte
+constexpr uint16_t k_SignedTileBase = 256;
+// Only the tile data pages go through WriteTileData(), the maps don't need to
+constexpr MemoryMap k_TileDataEnd = static_cast<MemoryMap>(
+    static_cast<uint16_t>(MemoryMap::k_VideoRamStart) + k_TileDataSize - 1);
+constexpr uint8_t k_TilesPerLine = k_ScreenWidth / 8 + 1;
+constexpr uint8_t k_SpriteCount = 40;
+// OAM attribute bits, reference: https://gbdev.io/pandocs/OAM.html
+constexpr uint8_t k_SpritePalette = 0x10;
+constexpr uint8_t k_SpriteFlipX = 0x20;
+constexpr uint8_t k_SpriteFlipY = 0x40;
+constexpr uint8_t k_SpriteBehindBackground = 0x80;
+// STAT bits, reference: https://gbdev.io/pandocs/STAT.html
+constexpr uint8_t k_StatMode = 0x03;
+constexpr uint8_t k_StatCoincidence = 0x04;
+constexpr uint8_t k_StatHBlankSource = 0x08;
+constexpr uint8_t k_StatVBlankSource = 0x10;
+constexpr uint8_t k_StatOamSource = 0x20;
+constexpr uint8_t k_StatCoincidenceSource = 0x40;
+constexpr uint8_t k_StatWritable = 0x78;
+
+inline uint8_t& Io(GameBoy* gb, const HardwareRegistersName k_Register) {
+  return gb->bus_.io_registers_[static_cast<uint16_t>(k_Register) -
+                                static_cast<uint16_t>(
+                                    MemoryMap::k_IoRegistersStart)];
+}
+
+// Entry b has bit 7 - i of b in byte i, so the leftmost pixel comes first
+constexpr std::array<std::array<uint8_t, 8>, 256> k_BitSpread = [] {
+  std::array<std::array<uint8_t, 8>, 256> table{};
+  for (size_t value = 0; value < table.size(); value++) {
+    for (size_t pixel = 0; pixel < 8; pixel++) {
+      table[value][pixel] = (value >> (7 - pixel)) & 1;
+    }
+  }
+  return table;
+}();
+
+// Colour indices of one tile row, both planes at once as 8 bytes
+inline void SpreadRow(const uint8_t k_Low, const uint8_t k_High,
+                      uint8_t* output) {
+  uint64_t low = 0;
+  uint64_t high = 0;
+  std::memcpy(&low, k_BitSpread[k_Low].data(), sizeof(low));
+  std::memcpy(&high, k_BitSpread[k_High].data(), sizeof(high));
+  const uint64_t k_Indices = low | (high << 1);
+  std::memcpy(output, &k_Indices, sizeof(k_Indices));
+}
+
+// Index into Ppu::tiles_ of a tile map entry
+inline uint16_t TileNumber(const uint8_t k_Lcdc, const uint8_t k_Tile) {
+  if (k_Lcdc & k_LcdcTileData) {
+    return k_Tile;
+  }
+  return k_SignedTileBase + static_cast<int8_t>(k_Tile);
+}
+
+// Palette registers hold a 2 bit shade for each of the 4 colour indices
+void ApplyPaletteScalar(const uint8_t* indices, const uint8_t k_Palette,
+                        uint8_t* shades) {
+  for (size_t x = 0; x < k_ScreenWidth; x++) {
+    shades[x] = (k_Palette >> (indices[x] * 2)) & 3;
+  }
+}
+
+void WriteColorsScalar(const uint8_t* shades, uint8_t* output) {
+  for (size_t x = 0; x < k_ScreenWidth; x++) {
+    std::memcpy(output + x * 4, k_ShadeColors[shades[x]].data(), 4);
+  }
+}
+
+void DecodeTileRowsScalar(const uint8_t* low, const uint8_t* high,
+                          const size_t k_Tiles, uint8_t* output) {
+  for (size_t tile = 0; tile < k_Tiles; tile += 2) {
+    SpreadRow(low[tile], high[tile], output + tile * 8);
+    SpreadRow(low[tile + 1], high[tile + 1], output + tile * 8 + 8);
+  }
+}
+
+#ifdef BINARY_GB_PPU_X64
+BINARY_GB_PPU_TARGET("ssse3")
+void ApplyPaletteSsse3(const uint8_t* indices, const uint8_t k_Palette,
+                       uint8_t* shades) {
+  const __m128i k_Lookup =
+      _mm_setr_epi8(k_Palette & 3, (k_Palette >> 2) & 3, (k_Palette >> 4) & 3,
+                    k_Palette >> 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  for (size_t x = 0; x < k_ScreenWidth; x += 16) {
+    const __m128i k_Indices =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + x));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(shades + x),
+                     _mm_shuffle_epi8(k_Lookup, k_Indices));
+  }
+}
+
+BINARY_GB_PPU_TARGET("ssse3")
+void WriteColorsSsse3(const uint8_t* shades, uint8_t* output) {
+  // All 4 colours fit in one register, shade * 4 + byte picks a byte of one
+  const __m128i k_Colors = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(k_ShadeColors.data()));
+  const __m128i k_ByteOffsets =
+      _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+  const __m128i k_Broadcast[4] = {
+      _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3),
+      _mm_setr_epi8(4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7),
+      _mm_setr_epi8(8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11),
+      _mm_setr_epi8(12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15,
+                    15, 15)};
+  for (size_t x = 0; x < k_ScreenWidth; x += 16) {
+    // Shades are at most 3, shifting 16 bit lanes can't spill between bytes
+    const __m128i k_Offsets = _mm_slli_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(shades + x)), 2);
+    for (size_t part = 0; part < 4; part++) {
+      const __m128i k_Select = _mm_add_epi8(
+          _mm_shuffle_epi8(k_Offsets, k_Broadcast[part]), k_ByteOffsets);
+      _mm_storeu_si128(
+          reinterpret_cast<__m128i*>(output + (x + part * 4) * 4),
+          _mm_shuffle_epi8(k_Colors, k_Select));
+    }
+  }
+}
+
+BINARY_GB_PPU_TARGET("ssse3")
+void DecodeTileRowsSsse3(const uint8_t* low, const uint8_t* high,
+                         const size_t k_Tiles, uint8_t* output) {
+  // Two tiles per register: broadcast each plane byte over its 8 pixels, then
+  // test every pixel's own bit
+  const __m128i k_PixelBits = _mm_setr_epi8(
+      static_cast<char>(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+      static_cast<char>(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+  const __m128i k_LowPlane =
+      _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+  const __m128i k_HighPlane =
+      _mm_setr_epi8(2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+  const __m128i k_One = _mm_set1_epi8(1);
+  const __m128i k_Two = _mm_set1_epi8(2);
+  for (size_t tile = 0; tile < k_Tiles; tile += 2) {
+    const int k_Planes = low[tile] | (low[tile + 1] << 8) |
+                         (high[tile] << 16) | (high[tile + 1] << 24);
+    const __m128i k_Bytes = _mm_cvtsi32_si128(k_Planes);
+    const __m128i k_Low = _mm_cmpeq_epi8(
+        _mm_and_si128(_mm_shuffle_epi8(k_Bytes, k_LowPlane), k_PixelBits),
+        k_PixelBits);
+    const __m128i k_High = _mm_cmpeq_epi8(
+        _mm_and_si128(_mm_shuffle_epi8(k_Bytes, k_HighPlane), k_PixelBits),
+        k_PixelBits);
+    const __m128i k_Indices = _mm_or_si128(_mm_and_si128(k_Low, k_One),
+                                           _mm_and_si128(k_High, k_Two));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + tile * 8),
+                     k_Indices);
+  }
+}
+
+bool CpuHasSsse3() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 9)) != 0;
+#else
+  return __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+// The kernels every line goes through, picked once for the CPU
+typedef struct PpuKernels {
+  void (*apply_palette)(const uint8_t*, const uint8_t, uint8_t*);
+  void (*write_colors)(const uint8_t*, uint8_t*);
+  void (*decode_tile_rows)(const uint8_t*, const uint8_t*, const size_t,
+                           uint8_t*);
+} PpuKernels;
+
+const PpuKernels& Kernels() {
+  static const PpuKernels k_Kernels = [] {
+#ifdef BINARY_GB_PPU_X64
+    if (CpuHasSsse3()) {
+      return PpuKernels{ApplyPaletteSsse3, WriteColorsSsse3,
+                        DecodeTileRowsSsse3};
+    }
+#endif
+    return PpuKernels{ApplyPaletteScalar, WriteColorsScalar,
+                      DecodeTileRowsScalar};
+  }();
+  return k_Kernels;
+}
+
+void ApplyPalette(const uint8_t* indices, const uint8_t k_Palette,
+                  uint8_t* shades) {
+  Kernels().apply_palette(indices, k_Palette, shades);
+}
+
+void WriteColors(const uint8_t* shades, uint8_t* output) {
+  Kernels().write_colors(shades, output);
+}
+
+// STAT interrupts are requested when the OR of every enabled source goes
+// from low to high
+void UpdateStatLine(GameBoy* gb) {
+  const uint8_t k_Stat = Io(gb, HardwareRegistersName::k_Stat);
+  const PpuMode k_Mode = gb->ppu_.mode_;
+  const bool k_Line =
+      ((k_Stat & k_StatCoincidenceSource) && (k_Stat & k_StatCoincidence)) ||
+      ((k_Stat & k_StatHBlankSource) && k_Mode == PpuMode::k_HBlank) ||
+      ((k_Stat & k_StatVBlankSource) && k_Mode == PpuMode::k_VBlank) ||
+      ((k_Stat & k_StatOamSource) && k_Mode == PpuMode::k_OamScan);
+  if (k_Line && !gb->ppu_.stat_line_) {
+    gb->RequestInterrupt(k_InterruptStat);
+  }
+  gb->ppu_.stat_line_ = k_Line;
+}
+
+// Updates the mode and LY=LYC bits in STAT
+void EnterMode(GameBoy* gb, const PpuMode k_Mode) {
+  gb->ppu_.mode_ = k_Mode;
+  uint8_t& stat = Io(gb, HardwareRegistersName::k_Stat);
+  stat = (stat & ~(k_StatMode | k_StatCoincidence)) |
+         static_cast<uint8_t>(k_Mode);
+  if (Io(gb, HardwareRegistersName::k_Ly) ==
+      Io(gb, HardwareRegistersName::k_Lyc)) {
+    stat |= k_StatCoincidence;
+  }
+  UpdateStatLine(gb);
+}
+
+void Schedule(GameBoy* gb, const uint64_t k_Timestamp) {
+  gb->scheduler_.Schedule(EventType::k_PpuMode, k_Timestamp);
+}
+}  // namespace
+
+void DecodeTileRows(const uint8_t* low, const uint8_t* high,
+                    const size_t k_Tiles, uint8_t* output) {
+  Kernels().decode_tile_rows(low, high, k_Tiles, output);
+}
+
+void Ppu::Connect(GameBoy* gb) {
+  gb->bus_.MapHandlers(MemoryMap::k_VideoRamStart, k_TileDataEnd, nullptr,
+                       WriteTileData);
+  gb->bus_.MapIo(IORanges::k_LcdStart, IORanges::k_LcdEnd, nullptr,
+                 WriteLcdRegister);
+  gb->scheduler_.SetHandler(EventType::k_PpuMode, PpuModeEvent);
+}
+
+void Ppu::RefreshTiles(GameBoy* gb) {
+  for (size_t word = 0; word < dirty_tiles_.size(); word++) {
+    uint64_t dirty = dirty_tiles_[word];
+    dirty_tiles_[word] = 0;
+    while (dirty != 0) {
+      const uint16_t k_Tile = word * 64 + std::countr_zero(dirty);
+      dirty &= dirty - 1;
+      // The planes are interleaved per row, split them so the 8 rows decode
+      // like 8 tiles of one line
+      const uint8_t* k_Data = &gb->bus_.video_ram_[k_Tile * 16];
+      std::array<uint8_t, 8> low;
+      std::array<uint8_t, 8> high;
+      for (size_t row = 0; row < 8; row++) {
+        low[row] = k_Data[row * 2];
+        high[row] = k_Data[row * 2 + 1];
+      }
+      DecodeTileRows(low.data(), high.data(), 8,
+                     &tiles_[k_Tile * k_TilePixels]);
+    }
+  }
+}
+
+void Ppu::RenderScanline(GameBoy* gb) {
+  const uint8_t k_Line = Io(gb, HardwareRegistersName::k_Ly);
+  if (k_Line >= k_ScreenHeight) {
+    return;
+  }
+  RefreshTiles(gb);
+  const uint8_t k_Lcdc = Io(gb, HardwareRegistersName::k_Lcdc);
+  if (k_Lcdc & k_LcdcBackgroundEnable) {
+    RenderBackground(gb, k_Line);
+    if (k_Lcdc & k_LcdcWindowEnable) {
+      RenderWindow(gb, k_Line);
+    }
+    ApplyPalette(background_.data(), Io(gb, HardwareRegistersName::k_Bgp),
+                 shades_.data());
+  } else {
+    // On the DMG this blanks the background and the window to white
+    background_.fill(0);
+    shades_.fill(0);
+  }
+  if (k_Lcdc & k_LcdcObjectEnable) {
+    RenderSprites(gb, k_Line);
+  }
+  std::memcpy(indexed_framebuffer_.data() + k_Line * k_ScreenWidth,
+              shades_.data(), k_ScreenWidth);
+}
+
+void Ppu::ExpandFramebuffer(
+    std::array<uint8_t, k_FramebufferSize>& output) const {
+  for (size_t line = 0; line < k_ScreenHeight; line++) {
+    WriteColors(indexed_framebuffer_.data() + line * k_ScreenWidth,
+                output.data() + line * k_ScreenWidth * 4);
+  }
+}
+
+void Ppu::RenderBackground(GameBoy* gb, const uint8_t k_Line) {
+  const std::array<uint8_t, k_RamBankSize>& k_Vram = gb->bus_.video_ram_;
+  const uint8_t k_Lcdc = Io(gb, HardwareRegistersName::k_Lcdc);
+  const uint8_t k_Scx = Io(gb, HardwareRegistersName::k_Scx);
+  const uint8_t k_Y = k_Line + Io(gb, HardwareRegistersName::k_Scy);
+  const uint16_t k_Map =
+      ((k_Lcdc & k_LcdcBackgroundMap) ? k_TileMap1 : k_TileMap0) +
+      (k_Y / 8) * 32;
+
+  // One more tile than fits on screen when SCX isn't a multiple of 8
+  std::array<uint8_t, k_LineBufferSize> line;
+  for (uint8_t tile = 0; tile < k_TilesPerLine; tile++) {
+    const uint8_t k_Column = ((k_Scx / 8) + tile) & 31;
+    std::memcpy(&line[tile * 8],
+                &tiles_[TileNumber(k_Lcdc, k_Vram[k_Map + k_Column]) *
+                            k_TilePixels +
+                        (k_Y % 8) * 8],
+                8);
+  }
+  std::memcpy(background_.data(), line.data() + (k_Scx % 8), k_ScreenWidth);
+}
+
+void Ppu::RenderWindow(GameBoy* gb, const uint8_t k_Line) {
+  const uint8_t k_Wx = Io(gb, HardwareRegistersName::k_Wx);
+  if (k_Line < Io(gb, HardwareRegistersName::k_Wy) || k_Wx > 166) {
+    return;
+  }
+  const std::array<uint8_t, k_RamBankSize>& k_Vram = gb->bus_.video_ram_;
+  const uint8_t k_Lcdc = Io(gb, HardwareRegistersName::k_Lcdc);
+  // WX is the screen position plus 7, the window can start up to 7 pixels
+  // off screen
+  const int k_Start = k_Wx - 7;
+  const uint8_t k_Tiles = (k_ScreenWidth - k_Start + 7) / 8;
+  const uint16_t k_Map =
+      ((k_Lcdc & k_LcdcWindowMap) ? k_TileMap1 : k_TileMap0) +
+      (window_line_ / 8) * 32;
+
+  std::array<uint8_t, k_LineBufferSize> line;
+  for (uint8_t tile = 0; tile < k_Tiles; tile++) {
+    std::memcpy(&line[tile * 8],
+                &tiles_[TileNumber(k_Lcdc, k_Vram[k_Map + tile]) *
+                            k_TilePixels +
+                        (window_line_ % 8) * 8],
+                8);
+  }
+  const int k_First = std::max(k_Start, 0);
+  std::memcpy(background_.data() + k_First, line.data() + (k_First - k_Start),
+              k_ScreenWidth - k_First);
+  window_line_++;
+}
+
+void Ppu::RenderSprites(GameBoy* gb, const uint8_t k_Line) {
+  const std::array<uint8_t, k_PageSize>& k_Oam = gb->bus_.oam_;
+  const uint8_t k_Lcdc = Io(gb, HardwareRegistersName::k_Lcdc);
+  const uint8_t k_Height = (k_Lcdc & k_LcdcObjectSize) ? 16 : 8;
+
+  // OAM scan, the first 10 sprites on the line are the only ones drawn
+  std::array<uint8_t, k_MaxSpritesPerLine> sprites{};
+  uint8_t count = 0;
+  for (uint8_t sprite = 0;
+       sprite < k_SpriteCount && count < k_MaxSpritesPerLine; sprite++) {
+    const int k_Top = k_Oam[sprite * 4] - 16;
+    if (k_Line >= k_Top && k_Line < k_Top + k_Height) {
+      sprites[count++] = sprite;
+    }
+  }
+  // Lower X wins, OAM order breaks ties
+  std::stable_sort(sprites.begin(), sprites.begin() + count,
+                   [&k_Oam](const uint8_t k_A, const uint8_t k_B) {
+                     return k_Oam[k_A * 4 + 1] < k_Oam[k_B * 4 + 1];
+                   });
+
+  // A pixel belongs to the first sprite that has a colour there, even when
+  // that sprite is hidden behind the background
+  std::array<bool, k_ScreenWidth> taken{};
+  for (uint8_t index = 0; index < count; index++) {
+    const uint8_t* k_Sprite = &k_Oam[sprites[index] * 4];
+    const uint8_t k_Attributes = k_Sprite[3];
+    uint8_t row = k_Line - (k_Sprite[0] - 16);
+    if (k_Attributes & k_SpriteFlipY) {
+      row = k_Height - 1 - row;
+    }
+    const uint8_t k_Tile = (k_Height == 16) ? (k_Sprite[2] & 0xFE) : k_Sprite[2];
+    const uint8_t* k_Pixels = &tiles_[k_Tile * k_TilePixels + row * 8];
+    const uint8_t k_Palette = Io(gb, (k_Attributes & k_SpritePalette)
+                                         ? HardwareRegistersName::k_Obp1
+                                         : HardwareRegistersName::k_Obp0);
+    for (int pixel = 0; pixel < 8; pixel++) {
+      const int k_X = k_Sprite[1] - 8 + pixel;
+      if (k_X < 0 || k_X >= k_ScreenWidth || taken[k_X]) {
+        continue;
+      }
+      const uint8_t k_Index =
+          k_Pixels[(k_Attributes & k_SpriteFlipX) ? 7 - pixel : pixel];
+      if (k_Index == 0) {
+        continue;
+      }
+      taken[k_X] = true;
+      if ((k_Attributes & k_SpriteBehindBackground) && background_[k_X] != 0) {
+        continue;
+      }
+      shades_[k_X] = (k_Palette >> (k_Index * 2)) & 3;
+    }
+  }
+}
+
+// Reference: https://gbdev.io/pandocs/Rendering.html
+void PpuModeEvent(GameBoy* gb, const uint64_t k_Late) {
+  const uint64_t k_Now = gb->cycles_ - k_Late;
+  uint8_t& ly = Io(gb, HardwareRegistersName::k_Ly);
+  switch (gb->ppu_.mode_) {
+    case PpuMode::k_OamScan:
+      EnterMode(gb, PpuMode::k_Drawing);
+      gb->ppu_.RenderScanline(gb);
+      Schedule(gb, k_Now + k_DrawingCycles);
+      break;
+    case PpuMode::k_Drawing:
+      EnterMode(gb, PpuMode::k_HBlank);
+      Schedule(gb, k_Now + k_HBlankCycles);
+      break;
+    case PpuMode::k_HBlank:
+      ly++;
+      if (ly == k_VBlankLine) {
+        EnterMode(gb, PpuMode::k_VBlank);
+        gb->ppu_.frames_++;
+        gb->RequestInterrupt(k_InterruptVBlank);
+        Schedule(gb, k_Now + k_ScanlineCycles);
+      } else {
+        EnterMode(gb, PpuMode::k_OamScan);
+        Schedule(gb, k_Now + k_OamScanCycles);
+      }
+      break;
+    case PpuMode::k_VBlank:
+      ly++;
+      if (ly == k_LinesPerFrame) {
+        ly = 0;
+        gb->ppu_.window_line_ = 0;
+        EnterMode(gb, PpuMode::k_OamScan);
+        Schedule(gb, k_Now + k_OamScanCycles);
+      } else {
+        EnterMode(gb, PpuMode::k_VBlank);
+        Schedule(gb, k_Now + k_ScanlineCycles);
+      }
+      break;
+  }
+}
+
+void WriteTileData(GameBoy* gb, const uint16_t k_Address,
+                   const uint8_t k_Value) {
+  const uint16_t k_Offset =
+      k_Address - static_cast<uint16_t>(MemoryMap::k_VideoRamStart);
+  const uint16_t k_Tile = k_Offset / 16;
+  gb->bus_.video_ram_[k_Offset] = k_Value;
+  gb->ppu_.dirty_tiles_[k_Tile / 64] |= uint64_t{1} << (k_Tile % 64);
+}
+
+void WriteLcdRegister(GameBoy* gb, const uint16_t k_Address,
+                      const uint8_t k_Value) {
+  uint8_t& reg = gb->bus_.io_registers_[k_Address & 0x7F];
+  const bool k_Enabled =
+      (Io(gb, HardwareRegistersName::k_Lcdc) & k_LcdcEnable) != 0;
+  switch (static_cast<HardwareRegistersName>(k_Address)) {
+    case HardwareRegistersName::k_Lcdc:
+      reg = k_Value;
+      if (!k_Enabled && (k_Value & k_LcdcEnable)) {
+        // Turning the LCD on starts a new frame at line 0
+        Io(gb, HardwareRegistersName::k_Ly) = 0;
+        gb->ppu_.window_line_ = 0;
+        EnterMode(gb, PpuMode::k_OamScan);
+        Schedule(gb, gb->cycles_ + k_OamScanCycles);
+      } else if (k_Enabled && !(k_Value & k_LcdcEnable)) {
+        gb->scheduler_.Cancel(EventType::k_PpuMode);
+        Io(gb, HardwareRegistersName::k_Ly) = 0;
+        gb->ppu_.mode_ = PpuMode::k_HBlank;
+        gb->ppu_.stat_line_ = false;
+        Io(gb, HardwareRegistersName::k_Stat) &= ~k_StatMode;
+      }
+      break;
+    case HardwareRegistersName::k_Stat:
+      reg = (k_Value & k_StatWritable) | (reg & ~k_StatWritable);
+      if (k_Enabled) {
+        UpdateStatLine(gb);
+      }
+      break;
+    case HardwareRegistersName::k_Ly:
+      // Read only
+      break;
+    case HardwareRegistersName::k_Lyc:
+      reg = k_Value;
+      if (k_Enabled) {
+        EnterMode(gb, gb->ppu_.mode_);
+      }
+      break;
+    case HardwareRegistersName::k_Dma:
+      // The 160 byte copy is done straight away instead of over 160 cycles
+      reg = k_Value;
+      for (uint16_t index = 0; index < 0xA0; index++) {
+        gb->bus_.oam_[index] = gb->Read((k_Value << 8) | index);
+      }
+      break;
+    default:
+      reg = k_Value;
+      break;
+  }
+}
+}  // namespace binary::gb
@@ -0,0 +1,50 @@
+#include "include/gb_scheduler.h"
+#include "include/gb_instruction.h"
+
+namespace binary::gb {
+void Scheduler::Schedule(const EventType k_Type, const uint64_t k_Timestamp) {
+  timestamps_[static_cast<size_t>(k_Type)] = k_Timestamp;
+  if (k_Timestamp < next_timestamp_ ||
+      (k_Timestamp == next_timestamp_ && k_Type < next_type_)) {
+    next_timestamp_ = k_Timestamp;
+    next_type_ = k_Type;
+  } else if (k_Type == next_type_) {
+    // The earliest event moved back, something else may be first now
+    UpdateNext();
+  }
+}
+
+void Scheduler::Cancel(const EventType k_Type) {
+  timestamps_[static_cast<size_t>(k_Type)] = k_NoEvent;
+  if (k_Type == next_type_) {
+    UpdateNext();
+  }
+}
+
+void Scheduler::Dispatch(GameBoy* gb) {
+  while (next_timestamp_ <= gb->cycles_) {
+    const EventType k_Type = next_type_;
+    const uint64_t k_Timestamp = next_timestamp_;
+    // Cleared before the handler runs so it can schedule itself again
+    Cancel(k_Type);
+    dispatched_++;
+    const EventHandler k_Handler = handlers_[static_cast<size_t>(k_Type)];
+    if (k_Handler != nullptr) {
+      k_Handler(gb, gb->cycles_ - k_Timestamp);
+    }
+  }
+}
+
+void Scheduler::UpdateNext() {
+  // Ties go to the lower event type so the order never depends on the order
+  // things were scheduled in
+  next_timestamp_ = k_NoEvent;
+  next_type_ = EventType::k_Count;
+  for (size_t index = 0; index < k_EventCount; index++) {
+    if (timestamps_[index] < next_timestamp_) {
+      next_timestamp_ = timestamps_[index];
+      next_type_ = static_cast<EventType>(index);
+    }
+  }
+}
+}  // namespace binary::gb
@@ -0,0 +1,181 @@
+// Purpose: This header file contains the following
+//  * Band limited step buffer
+//  * APU for the Gameboy (DMG), 2 square, 1 wave and 1 noise channel
+//
+// The APU isn't clocked with the CPU. A channel's output only ever changes in
+// steps (a duty cycle edge, the next wave sample, an LFSR shift ...), so each
+// channel knows the cycle its next step happens at and RunUntil() walks
+// through all of them in one go when something needs the APU to be up to
+// date: a register write, a frame sequencer event or the end of a frame. Every
+// step is added to a BlipBuffer as a band limited step, which is where the
+// actual samples come from. Nothing is done per CPU cycle and nothing aliases,
+// even a square wave at 131 kHz comes out as silence instead of noise.
+//
+// Timestamps are in T-cycles (4 per GameBoy::cycles_), the square and wave
+// channels step on T-cycle boundaries.
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binary::gb {
+class GameBoy;
+
+constexpr uint32_t k_ClockRate = 4'194'304;
+constexpr uint32_t k_DefaultSampleRate = 48'000;
+// 512 Hz, in machine cycles like the scheduler
+constexpr uint64_t k_FrameSequencerCycles = 2048;
+
+// Adds band limited steps at exact clock times and integrates them into
+// samples. Reference: http://www.slack.net/~ant/bl-synth/
+class BlipBuffer {
+ public:
+  // Phases of the step kernel between two samples and its width in samples
+  static constexpr size_t k_Phases = 32;
+  static constexpr size_t k_Taps = 16;
+  // Samples kept around when nobody reads them, about a third of a second
+  static constexpr size_t k_Capacity = 1 << 14;
+
+  BlipBuffer();
+  void SetRates(const uint32_t k_InputRate, const uint32_t k_SampleRate);
+  // Changes the output rate and keeps everything buffered. Only call it
+  // right after EndFrame(), deltas already in the frame were placed at the
+  // old rate.
+  void SetSampleRate(const double k_SampleRate);
+  // k_Time is in clocks since the last EndFrame()
+  void AddDelta(const uint64_t k_Time, const float k_Delta);
+  // Makes every sample before k_Time readable, times are then relative to it
+  void EndFrame(const uint64_t k_Time);
+  inline size_t Available() const { return available_; }
+  // Writes up to k_Count samples k_Stride apart, returns how many. A nullptr
+  // output throws them away.
+  size_t ReadSamples(int16_t* output, const size_t k_Count,
+                     const size_t k_Stride);
+  void Clear();
+
+ private:
+  // Deltas of everything not read yet, the kernel tail runs past available_
+  std::vector<float> deltas_ = std::vector<float>(k_Capacity + k_Taps);
+  // 32.32 fixed point samples per clock and the position of the frame start
+  uint64_t factor_{};
+  uint64_t offset_{};
+  uint32_t input_rate_{};
+  size_t available_{};
+  // Everything from here on is still 0
+  size_t used_{};
+  float integrator_{};
+  // DC blocking like the capacitor on the hardware's output
+  float capacitor_{};
+  float charge_factor_{};
+};
+
+// Reference: https://gbdev.io/pandocs/Audio_details.html
+typedef struct Envelope {
+  uint8_t volume_{};
+  uint8_t timer_{};
+} Envelope;
+
+typedef struct SquareChannel {
+  bool enabled_{};
+  uint8_t duty_step_{};
+  uint16_t length_{};
+  Envelope envelope_{};
+  // T-cycle of the next duty step
+  uint64_t next_step_{};
+  // Channel 1 only
+  uint16_t shadow_frequency_{};
+  uint8_t sweep_timer_{};
+  bool sweep_enabled_{};
+} SquareChannel;
+
+typedef struct WaveChannel {
+  bool enabled_{};
+  uint8_t position_{};
+  uint16_t length_{};
+  uint64_t next_step_{};
+} WaveChannel;
+
+typedef struct NoiseChannel {
+  bool enabled_{};
+  uint16_t lfsr_{};
+  uint16_t length_{};
+  Envelope envelope_{};
+  uint64_t next_step_{};
+} NoiseChannel;
+
+class Apu {
+ public:
+  static constexpr size_t k_Channels = 4;
+
+  // Maps the sound registers on gb's bus and the frame sequencer event. The
+  // APU starts powered off, writing bit 7 of NR52 turns it on.
+  void Connect(GameBoy* gb);
+  void SetSampleRate(const uint32_t k_SampleRate);
+  // Resamples at k_Ratio times the sample rate without dropping anything
+  // buffered, for dynamic rate control of the audio output. Only call it
+  // right after EndFrame().
+  void SetRateRatio(const double k_Ratio);
+  // Renders every channel up to k_Time in T-cycles
+  void RunUntil(GameBoy* gb, const uint64_t k_Time);
+  // Renders up to gb->cycles_ and makes the samples readable
+  void EndFrame(GameBoy* gb);
+  inline size_t AvailableSamples() const { return left_.Available(); }
+  // Interleaved stereo, returns the number of sample frames written. A
+  // nullptr output drops them.
+  size_t ReadSamples(int16_t* output, const size_t k_Frames);
+
+  // Used by the register handlers and the frame sequencer, the APU has to be
+  // rendered up to k_Time before any of these
+  void SetPower(GameBoy* gb, const bool k_On);
+  void Trigger(GameBoy* gb, const size_t k_Channel, const uint64_t k_Time);
+  void Disable(const size_t k_Channel, const uint64_t k_Time);
+  void LoadLength(const size_t k_Channel, const uint8_t k_Value);
+  // Outputs the channel's current level, after anything changed it
+  void Refresh(GameBoy* gb, const size_t k_Channel, const uint64_t k_Time);
+  // NR50/NR51 changed, every channel's contribution moves
+  void UpdatePanning(const uint64_t k_Time, const uint8_t k_Nr50,
+                     const uint8_t k_Nr51);
+  void ClockFrameSequencer(GameBoy* gb, const uint64_t k_Time);
+  void EndBlipFrame(const uint64_t k_Time);
+  bool Enabled(const size_t k_Channel) const;
+
+  bool powered_{};
+  SquareChannel square1_{};
+  SquareChannel square2_{};
+  WaveChannel wave_{};
+  NoiseChannel noise_{};
+  uint8_t sequencer_step_{};
+  // Every channel's last output level 0-15 and its gain on each side
+  std::array<uint8_t, k_Channels> levels_{};
+  std::array<uint8_t, k_Channels> left_gain_{};
+  std::array<uint8_t, k_Channels> right_gain_{};
+  // The T-cycle everything is rendered up to and the one the BlipBuffer
+  // frame started at
+  uint64_t time_{};
+  uint64_t frame_start_{};
+
+ private:
+  uint8_t Level(GameBoy* gb, const size_t k_Channel) const;
+  void Output(const size_t k_Channel, const uint64_t k_Time,
+              const uint8_t k_Level);
+  void RunSquare(GameBoy* gb, SquareChannel& channel, const size_t k_Channel,
+                 const uint64_t k_Time);
+  void RunWave(GameBoy* gb, const uint64_t k_Time);
+  void RunNoise(GameBoy* gb, const uint64_t k_Time);
+  void ClockLength(GameBoy* gb, const uint64_t k_Time);
+  void ClockSweep(GameBoy* gb, const uint64_t k_Time);
+  void ClockEnvelopes(GameBoy* gb, const uint64_t k_Time);
+
+  uint32_t sample_rate_ = k_DefaultSampleRate;
+  BlipBuffer left_{};
+  BlipBuffer right_{};
+};
+
+extern void ApuFrameSequencerEvent(GameBoy* gb, const uint64_t k_Late);
+extern uint8_t ReadAudioRegister(GameBoy* gb, const uint16_t k_Address);
+extern void WriteAudioRegister(GameBoy* gb, const uint16_t k_Address,
+                               const uint8_t k_Value);
+extern void WriteWaveRam(GameBoy* gb, const uint16_t k_Address,
+                         const uint8_t k_Value);
+}  // namespace binary::gb
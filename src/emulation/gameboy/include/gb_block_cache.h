@@ -0,0 +1,163 @@
+// Purpose: This header file contains the following
+//  * Predecoded basic block cache for the Gameboy CPU (LR35902)
+//
+// The table interpreter reads every opcode through the page table, then the
+// handler reads its immediates through Operand8Bit()/Operand16Bit() again.
+// The cached interpreter decodes a run of instructions up to the next branch
+// once, storing the handler, the immediates and the cycle cost of each one.
+// Afterwards the block is executed straight out of the cache.
+//
+// Blocks are keyed by ROM bank, program counter and the CB prefix state.
+// ROM can't be written so ROM blocks stay valid until a new cartridge is
+// loaded. Blocks in WRAM/HRAM are invalidated when a write lands in their
+// range: the WRAM pages holding code get a write handler that drops the
+// blocks, and WriteHighPage() does the same for HRAM. Code running from
+// anywhere else (VRAM, external RAM, OAM) isn't cached and runs through the
+// table interpreter.
+//
+// Short blocks that keep branching back to themselves are checked for busy
+// waiting (polling LY, a HRAM flag ...). If the CPU enters the block again in
+// exactly the same state and nothing was written in between, every further
+// iteration does the same thing until a scheduler event changes memory, so
+// those iterations are skipped. The result is identical to running them.
+//
+// Every instruction still goes through an indirect call to its handler, so
+// straight line code runs about as fast as EmulateLoop (the benchmark in
+// test_gb_benchmark.cpp). The gains come from the idle loop skipping and from
+// the JIT compiling the decoded blocks.
+#pragma once
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "gb_memory.h"
+
+namespace binary::gb {
+// Longest run of instructions that gets decoded into a single block
+constexpr uint16_t k_MaxBlockLength = 64;
+// Direct mapped lookup in front of the hash map, indexed by the low bits of
+// the program counter
+constexpr uint16_t k_RecentBlockCount = 1024;
+// Longest block that's checked for busy waiting
+constexpr uint16_t k_MaxIdleLoopLength = 8;
+
+typedef struct MicroOp {
+  void (*execute_)(GameBoy*) = nullptr;
+  // Index into k_DispatchTable, CB prefixed opcodes included
+  uint16_t opcode_{};
+  uint16_t address_{};
+  // The two bytes after the opcode, Operand8Bit() returns the low byte
+  uint16_t immediate_{};
+  // Program counter after execute_ when it doesn't branch, PREFIX_CB moves
+  // it forward by one
+  uint16_t fallthrough_{};
+  // Byte Fetch() reads at fallthrough_
+  uint8_t fetched_{};
+  // From k_MachineCycleTable, a taken branch costs its branch_ instead
+  uint8_t cycles_{};
+  bool prefixed_{};
+} MicroOp;
+
+typedef struct BasicBlock {
+  uint16_t start_{};
+  // Last byte the block read, immediates included
+  uint16_t end_{};
+  uint16_t bank_{};
+  bool prefixed_{};
+  uint32_t cycles_{};
+  std::vector<MicroOp> ops_;
+  // Filled in by the JIT once the block is hot
+  uint32_t executions_{};
+  void (*native_)(GameBoy*) = nullptr;
+} BasicBlock;
+
+typedef struct IdleLoopStats {
+  uint64_t skips_{};
+  uint64_t skipped_cycles_{};
+} IdleLoopStats;
+
+class BlockCache {
+ public:
+  // Returns the block starting at the program counter, decoding it on a
+  // miss. Returns nullptr when the code can't be cached.
+  BasicBlock* Lookup(GameBoy* gb);
+  // Drops every block containing k_Address
+  void InvalidateWrite(GameBoy* gb, const uint16_t k_Address);
+  void Clear(GameBoy* gb);
+  // ROM bank switches change the code under a running block
+  inline void Remapped() { generation_++; }
+  inline bool HasCode(const uint16_t k_Address) const {
+    return !page_blocks_[k_Address >> 8].empty();
+  }
+  // Called before running a block, moves cycles_ forward when the CPU is
+  // busy waiting in it. Only blocks entered twice in a row get checked.
+  inline void SkipIdleLoop(GameBoy* gb, const BasicBlock* block) {
+    if (!skip_idle_loops_ || block->ops_.size() > k_MaxIdleLoopLength) {
+      return;
+    }
+    if (block != idle_block_) {
+      idle_block_ = block;
+      idle_state_valid_ = false;
+      return;
+    }
+    CheckIdleLoop(gb);
+  }
+  // Events change memory without going through GameBoy::Write(), so a loop
+  // seen before them proves nothing afterwards
+  inline void ForgetIdleLoop() { idle_block_ = nullptr; }
+
+  // Changes every time a block is dropped or the ROM bank is switched, a
+  // running block stops when this doesn't match anymore
+  uint32_t generation_{};
+  uint64_t hits_{};
+  uint64_t misses_{};
+  uint64_t invalidations_{};
+  // Turned off to compare against a run without any skipping
+  bool skip_idle_loops_ = true;
+  // Reset when a new cartridge is loaded
+  IdleLoopStats idle_stats_{};
+
+  // Host pointers of the WRAM pages that were given a write handler
+  std::array<uint8_t*, k_PageCount> saved_write_{};
+
+ private:
+  // Everything a read only loop could depend on besides memory
+  typedef struct IdleState {
+    uint64_t cycles_{};
+    uint64_t memory_writes_{};
+    uint16_t af_{};
+    uint16_t bc_{};
+    uint16_t de_{};
+    uint16_t hl_{};
+    uint16_t stack_pointer_{};
+    uint16_t program_counter_{};
+    uint8_t interrupt_{};
+    bool cb_prefixed_{};
+  } IdleState;
+
+  void CheckIdleLoop(GameBoy* gb);
+  void Erase(const uint32_t k_Key);
+  BasicBlock Decode(GameBoy* gb, const uint16_t k_Start, const bool k_Prefixed,
+                    const uint16_t k_Bank);
+  void TrapPage(GameBoy* gb, const uint16_t k_Page);
+  void UntrapPage(GameBoy* gb, const uint16_t k_Page);
+
+  std::unordered_map<uint32_t, BasicBlock> blocks_;
+  // Pointers into blocks_ are stable until the block is erased
+  std::array<uint32_t, k_RecentBlockCount> recent_keys_{};
+  std::array<BasicBlock*, k_RecentBlockCount> recent_blocks_{};
+  // Keys of the WRAM/HRAM blocks touching each page, echo RAM is folded into
+  // the WRAM pages it mirrors
+  std::array<std::vector<uint32_t>, k_PageCount> page_blocks_;
+  uint32_t cartridge_generation_{};
+  const BasicBlock* idle_block_ = nullptr;
+  IdleState idle_state_{};
+  bool idle_state_valid_{};
+};
+
+// Runs the block until it ends, branches, gets overwritten or the cycle
+// deadline is reached
+extern void ExecuteBlock(GameBoy* gb, const BasicBlock& block);
+extern void WriteCodePage(GameBoy* gb, const uint16_t k_Address,
+                          const uint8_t k_Value);
+}  // namespace binary::gb
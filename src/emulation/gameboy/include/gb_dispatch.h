@@ -0,0 +1,214 @@
+// Purpose: This header file contains the following
+//  * Compile time dispatch table for the Gameboy CPU (LR35902)
+//  * Threaded interpreter table (BINARY_GB_THREADED_INTERPRETER)
+//
+// The Opcode table from InitOpcodeTable() stores every handler inside a
+// std::function next to its mnemonic, which is great for the debugger but
+// slow for Emulate(). Each instruction paid for a bounds check plus a type
+// erased call. k_DispatchTable holds plain function pointers to the exact same
+// template instances and is built by the compiler, so the hot loop is a single
+// indexed load and an indirect call.
+#pragma once
+#include <array>
+#include <utility>
+#include "gb_instruction.h"
+
+// Guaranteed tail calls are needed for the threaded interpreter, otherwise
+// every instruction would push a stack frame. MSVC doesn't have them, so on
+// that compiler the threaded interpreter falls back to the table loop.
+#ifndef BINARY_GB_MUSTTAIL
+#if defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::musttail)
+#define BINARY_GB_MUSTTAIL [[clang::musttail]]
+#endif
+#endif
+#endif
+
+namespace binary::gb {
+typedef void (*Execute)(GameBoy*);
+
+// CB prefixed opcodes live in the upper half of the table
+constexpr uint16_t k_PrefixOffset = 256;
+
+// The BINARY_GB_EXECUTE macros write to opcode_table[opcode].execute_, so
+// this struct mirrors that member and lets us reuse the same macros inside a
+// consteval function. The entries written out by hand below are copies of
+// the Init* assignments though, DispatchTableMatchesOpcodeTable in
+// test_gb_cpu.cpp compares every opcode of the two tables to catch a drift.
+typedef struct DispatchEntry {
+  Execute execute_ = nullptr;
+} DispatchEntry;
+
+consteval std::array<Execute, 512> MakeDispatchTable() {
+  using namespace binary::gb::instructionset;
+  constexpr bool k_Branch = true;
+  std::array<DispatchEntry, 512> opcode_table{};
+  std::array<Execute, 512> dispatch_table{};
+
+  // InitLoadInstructionsTable
+  opcode_table[LD_BC_D16].execute_ =
+      Load<uint16_t, &Register::bc_, &Register::bc_, k_Immediate16>;
+  opcode_table[LD_DE_D16].execute_ =
+      Load<uint16_t, &Register::de_, &Register::de_, k_Immediate16>;
+  opcode_table[LD_HL_D16].execute_ =
+      Load<uint16_t, &Register::hl_, &Register::hl_, k_Immediate16>;
+  opcode_table[LD_SP_D16].execute_ =
+      Load<uint16_t, &Register::bc_, &Register::bc_, k_StackPointer>;
+  opcode_table[LD__A16_SP].execute_ =
+      Load<uint16_t, &Register::bc_, &Register::bc_, k_Address16>;
+  BINARY_GB_ALL_REG(BINARY_GB_EXECUTE_EQUALS_LOAD_REGX_FROM_REG);
+  BINARY_GB_EXECUTE_EQUALS_LOAD_REGX_FROM_INDIRECT_REG
+
+  // Init8BitArithmeticLogicRegisterDirectTable
+  opcode_table[ADD_SP_R8].execute_ = Add<&Register::a_, k_StackPointer>;
+  BINARY_GB_ALL_REG(BINARY_GB_EXECUTE_EQUALS_OPERATION_REG);
+  BINARY_GB_EXECUTE_EQUALS_OPERATION_REG_INDIRECT;
+
+  // InitIncrementAndDecrement
+  opcode_table[DEC__HL].execute_ = Decrement<uint16_t, &Register::hl_,
+                                             k_RegisterIndirect>;
+  opcode_table[INC__HL].execute_ = Increment<uint16_t, &Register::hl_,
+                                             k_RegisterIndirect>;
+  BINARY_GB_ALL_REG(BINARY_GB_EXECUTE_DEC_AND_INC);
+  BINARY_GB_EXECUTE_16BIT_DEC_AND_INC_ALL_REG(BINARY_GB_EXECUTE_16BIT_DEC_AND_INC)
+
+  // InitConditional
+  opcode_table[RET_NZ].execute_ = Return<k_Branch, k_BitIndexZ, false>;
+  opcode_table[RET_NC].execute_ = Return<k_Branch, k_BitIndexC, false>;
+  opcode_table[RET_Z].execute_ = Return<k_Branch, k_BitIndexZ, true>;
+  opcode_table[RET_C].execute_ = Return<k_Branch, k_BitIndexC, true>;
+  opcode_table[RET].execute_ = Return<!k_Branch>;
+  opcode_table[RETI].execute_ = ReturnFromInterruptHandler;
+  opcode_table[JR_NZ_R8].execute_ = JumpRelative<k_Branch, k_BitIndexZ, false>;
+  opcode_table[JR_NC_R8].execute_ = JumpRelative<k_Branch, k_BitIndexC, false>;
+  opcode_table[JR_Z_R8].execute_ = JumpRelative<k_Branch, k_BitIndexZ, true>;
+  opcode_table[JR_C_R8].execute_ = JumpRelative<k_Branch, k_BitIndexC, true>;
+  opcode_table[JR_R8].execute_ = JumpRelative<!k_Branch>;
+  opcode_table[JP_NZ_A16].execute_ = Jump<k_Branch, k_BitIndexZ, false>;
+  opcode_table[JP_NC_A16].execute_ = Jump<k_Branch, k_BitIndexC, false>;
+  opcode_table[JP_Z_A16].execute_ = Jump<k_Branch, k_BitIndexZ, true>;
+  opcode_table[JP_C_A16].execute_ = Jump<k_Branch, k_BitIndexC, true>;
+  opcode_table[JP_A16].execute_ = Jump<!k_Branch>;
+  opcode_table[JP__HL].execute_ = JumpIndirect;
+  opcode_table[CALL_NZ_A16].execute_ = Call<k_Branch, k_BitIndexZ, false>;
+  opcode_table[CALL_NC_A16].execute_ = Call<k_Branch, k_BitIndexC, false>;
+  opcode_table[CALL_Z_A16].execute_ = Call<k_Branch, k_BitIndexZ, true>;
+  opcode_table[CALL_C_A16].execute_ = Call<k_Branch, k_BitIndexC, true>;
+  opcode_table[CALL_A16].execute_ = Call<!k_Branch>;
+
+  // InitPushAndPop
+  BINARY_GB_REPEAT_FOR_ALL_16BIT_REG(BINARY_GB_EXECUTE_POP_AND_PUSH);
+
+  // InitRestart
+  opcode_table[RST_00H].execute_ = Restart<0x00>;
+  opcode_table[RST_08H].execute_ = Restart<0x08>;
+  opcode_table[RST_10H].execute_ = Restart<0x10>;
+  opcode_table[RST_18H].execute_ = Restart<0x18>;
+  opcode_table[RST_20H].execute_ = Restart<0x20>;
+  opcode_table[RST_28H].execute_ = Restart<0x28>;
+  opcode_table[RST_30H].execute_ = Restart<0x30>;
+  opcode_table[RST_38H].execute_ = Restart<0x38>;
+
+  // InitPrefixTable
+  BINARY_GB_ALL_REG(BINARY_GB_EXECUTE_BYTE_PREFIX);
+  BINARY_GB_REPEAT_FOR_ALL_BIT_PREFIX(BINARY_GB_EXECUTE_BIT_PREFIX);
+  BINARY_GB_EXECUTE_REGISTER_INDIRECT_BYTE_PREFIX;
+  BINARY_GB_REPEAT_FOR_ALL_REGISTER_INDIRECT_BIT_PREFIX(
+      BINARY_GB_EXECUTE_REGISTER_INDIRECT_BIT_PREFIX);
+
+  // InitNullOpcodes
+  opcode_table[NUL_D3].execute_ = NullOpcode;
+  opcode_table[NUL_E3].execute_ = NullOpcode;
+  opcode_table[NUL_E4].execute_ = NullOpcode;
+  opcode_table[NUL_F4].execute_ = NullOpcode;
+  opcode_table[NUL_DB].execute_ = NullOpcode;
+  opcode_table[NUL_EB].execute_ = NullOpcode;
+  opcode_table[NUL_EC].execute_ = NullOpcode;
+  opcode_table[NUL_FC].execute_ = NullOpcode;
+  opcode_table[NUL_DD].execute_ = NullOpcode;
+  opcode_table[NUL_ED].execute_ = NullOpcode;
+  opcode_table[NUL_FD].execute_ = NullOpcode;
+
+  // InitMiscellaneous
+  opcode_table[PREFIX_CB].execute_ = PrefixCB;
+  opcode_table[EI].execute_ = EnableInterrput;
+  opcode_table[DI].execute_ = DisableInterrput;
+  opcode_table[NOP].execute_ = NoOperation;
+  opcode_table[HALT].execute_ = Halt;
+  opcode_table[STOP].execute_ = Stop;
+  opcode_table[DAA].execute_ = DecimalAdjust;
+  opcode_table[SCF].execute_ = SetCarryFlag;
+  opcode_table[CPL].execute_ = ComplementAccumulator;
+  opcode_table[CCF].execute_ = ComplementCarryFlag;
+
+  // Opcodes that don't have an implementation yet behave like a NOP instead
+  // of throwing std::bad_function_call
+  for (size_t opcode = 0; opcode < opcode_table.size(); opcode++) {
+    dispatch_table[opcode] = (opcode_table[opcode].execute_ != nullptr)
+                                 ? opcode_table[opcode].execute_
+                                 : NoOperation;
+  }
+  return dispatch_table;
+}
+
+inline constexpr std::array<Execute, 512> k_DispatchTable = MakeDispatchTable();
+
+// machine_cycles_/machine_cycles_branch_ of every opcode, taken from
+// InitOpcodeTable() once at startup. Every interpreter and the JIT charge
+// instructions from here so they all stay cycle identical.
+typedef struct MachineCycles {
+  uint8_t cycles_{};
+  // Charged instead of cycles_ when a conditional jump, call or return is
+  // taken
+  uint8_t branch_{};
+} MachineCycles;
+extern const std::array<MachineCycles, 512> k_MachineCycleTable;
+
+// Cost of the instruction that just ran, clears gb->branched for the next one
+inline uint8_t InstructionCycles(GameBoy* gb, const uint16_t k_Opcode) {
+  const MachineCycles& k_Cycles = k_MachineCycleTable[k_Opcode];
+  if (gb->branched) [[unlikely]] {
+    gb->branched = false;
+    return k_Cycles.branch_;
+  }
+  return k_Cycles.cycles_;
+}
+
+#ifdef BINARY_GB_MUSTTAIL
+// Threaded code: instead of returning to a central while loop, every handler
+// executes its opcode, fetches, then jumps straight to the next handler. Each
+// opcode gets its own indirect branch, which branch predictors handle a lot
+// better than the single shared one in the table loop.
+template <uint16_t k_Opcode>
+void Threaded(GameBoy* gb);
+
+template <size_t... k_Opcodes>
+consteval std::array<Execute, 512> MakeThreadedTable(
+    std::index_sequence<k_Opcodes...>) {
+  return {Threaded<k_Opcodes>...};
+}
+
+inline constexpr std::array<Execute, 512> k_ThreadedTable =
+    MakeThreadedTable(std::make_index_sequence<512>{});
+
+template <uint16_t k_Opcode>
+void Threaded(GameBoy* gb) {
+  // k_Opcode is known at compile time, so this is a direct call the compiler
+  // can inline
+  constexpr Execute k_Execute = k_DispatchTable[k_Opcode];
+  k_Execute(gb);
+  if constexpr (k_Opcode >= k_PrefixOffset) {
+    gb->cb_prefixed = false;
+  }
+  instructionset::Fetch(gb);
+  // Fetch() counted the first machine cycle
+  gb->cycles_ += InstructionCycles(gb, k_Opcode) - 1;
+  if (gb->cycles_ >= gb->cycle_deadline_) {
+    return;
+  }
+  const uint16_t k_Next = gb->Read(gb->reg_.program_counter_) |
+                          (static_cast<uint16_t>(gb->cb_prefixed) << 8);
+  BINARY_GB_MUSTTAIL return k_ThreadedTable[k_Next](gb);
+}
+#endif
+}  // namespace binary::gb
@@ -1,8 +1,30 @@
+#pragma once
 #include <string>
 #include "gb_instruction.h" 
+#include "gb_dispatch.h"
+#include "gb_block_cache.h"
+#include "gb_jit.h"
+#include "gb_scheduler.h"
+#include "gb_ppu.h"
+#include "gb_apu.h"
 namespace binary::gb {
 extern void test();
 extern void Emulate(GameBoy* gameboy, bool running);
+// Runs for k_Cycles using the interpreter picked at build time, the CPU is
+// only stopped to dispatch gb->scheduler_ events. Time spent in HALT/STOP is
+// skipped instead of emulated.
+extern void EmulateFor(GameBoy* gameboy, const uint64_t k_Cycles);
+// The interpreters below return early when the CPU halts
+// Table interpreter, one central loop around k_DispatchTable
+extern void EmulateLoop(GameBoy* gameboy, const uint64_t k_Cycles);
+// Cached interpreter, runs predecoded basic blocks from gb->block_cache_
+extern void EmulateCached(GameBoy* gameboy, const uint64_t k_Cycles);
+// Cached interpreter that compiles hot blocks to x86-64 through gb->jit_
+extern void EmulateJit(GameBoy* gameboy, const uint64_t k_Cycles);
+#ifdef BINARY_GB_MUSTTAIL
+// Threaded interpreter, the handlers tail call each other
+extern void EmulateThreaded(GameBoy* gameboy, const uint64_t k_Cycles);
+#endif
 void LoadRom(std::string file_path, void* data);
 }
 
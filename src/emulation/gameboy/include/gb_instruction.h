@@ -1,7 +1,5 @@
 // Purpose: This header file contains the following 
 //  * Instruction Set Opcodes Enums
-//  * Memory Map
-//  * IO Ranges
 //  * VRAM memory map
 //  * Hardware Registers
 //  * CPU Flag Mask
@@ -9,13 +7,19 @@
 //  * New/Old licensee code
 //  * Cartridge Type Flags
 //  * ROM size Flags
-
+#pragma once
 #include <format>
 #include <array>
 #include <string>
 #include <functional>
-#include <bitset>
+#include <bit>
 #include <type_traits>
+#include "gb_memory.h"
+#include "gb_block_cache.h"
+#include "gb_jit.h"
+#include "gb_scheduler.h"
+#include "gb_ppu.h"
+#include "gb_apu.h"
 
 namespace binary::gb {
 enum CpuFlags {
@@ -160,7 +164,7 @@ MACRO(HL, hl) MACRO(BC, bc)  MACRO(DE, de) MACRO(AF, af)
   opcode_table[DEC_##upper].execute_ = Decrement<uint16_t, &Register::lower##_>; 
 
 #define BINARY_GB_EXECUTE_16BIT_DEC_AND_INC_ALL_REG(MACRO) \
-MACRO(BC, bc) MACRO(DE, de) MACRO(AF, af) MACRO(SP, stack_pointer)
+MACRO(BC, bc) MACRO(DE, de) MACRO(HL, hl) MACRO(SP, stack_pointer)
 constexpr uint8_t k_FlagZ = 0x80;
 constexpr uint8_t k_FlagN = 0x40;
 constexpr uint8_t k_FlagH = 0x20;
@@ -171,56 +175,188 @@ constexpr uint8_t k_BitIndexN  = 6;
 constexpr uint8_t k_BitIndexH  = 5;
 constexpr uint8_t k_BitIndexC  = 4;
 
+// Interrupt sources, the same bits in IF (0xFF0F) and IE (0xFFFF)
+constexpr uint8_t k_InterruptVBlank = 0x01;
+constexpr uint8_t k_InterruptStat   = 0x02;
+constexpr uint8_t k_InterruptTimer  = 0x04;
+constexpr uint8_t k_InterruptSerial = 0x08;
+constexpr uint8_t k_InterruptJoypad = 0x10;
+constexpr uint8_t k_InterruptMask   = 0x1F;
+
+// HALT sleeps until any enabled interrupt is requested, STOP only wakes up
+// for the joypad
+enum class CpuMode : uint8_t { k_Running, k_Halted, k_Stopped };
+
+// Every 16 bit pair aliases its two 8 bit halves, so writing to b_ is also a
+// write to bc_ and nothing has to be kept in sync. The high register is the
+// upper byte of the pair, which puts it second in memory on little endian
+// hosts.
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define BINARY_GB_REGISTER_PAIR(high, low) \
+  union {                                  \
+    uint16_t high##low##_{};               \
+    struct {                               \
+      uint8_t high##_;                     \
+      uint8_t low##_;                      \
+    };                                     \
+  };
+#else
+#define BINARY_GB_REGISTER_PAIR(high, low) \
+  union {                                  \
+    uint16_t high##low##_{};               \
+    struct {                               \
+      uint8_t low##_;                      \
+      uint8_t high##_;                     \
+    };                                     \
+  };
+#endif
+
 typedef struct Register {
-  // 8 Bit general purpose Registers
-  uint8_t a_{};
-  uint8_t b_{};
-  uint8_t c_{};
-  uint8_t d_{};
-  uint8_t e_{};
-  uint8_t h_{};
-  uint8_t l_{};
-  std::bitset<8> f_{};
-
-  uint16_t hl_{};
-  uint16_t bc_{};
-  uint16_t de_{};
-  uint16_t af_{};  // Only for Pushing and Popping
+  BINARY_GB_REGISTER_PAIR(a, f)
+  BINARY_GB_REGISTER_PAIR(b, c)
+  BINARY_GB_REGISTER_PAIR(d, e)
+  BINARY_GB_REGISTER_PAIR(h, l)
   uint16_t program_counter_{};
   uint16_t stack_pointer_{};
-  uint16_t IDU_{};
-  uint8_t instruction_{};
-  uint8_t interrupt_{};
+
+  inline bool Flag(const uint8_t k_BitIndex) const {
+    return ((f_ >> k_BitIndex) & 1) != 0;
+  }
+  inline void SetFlag(const uint8_t k_BitIndex, const bool k_Value) {
+    f_ = static_cast<uint8_t>((f_ & ~(1 << k_BitIndex)) |
+                              (static_cast<uint8_t>(k_Value) << k_BitIndex));
+  }
 } Register;
+static_assert(sizeof(Register) == 12, "Register should be packed");
+static_assert(std::endian::native == std::endian::little ||
+                  std::endian::native == std::endian::big,
+              "Mixed endian hosts aren't supported");
+
+// Lazy flags: SetFlagZ0HC, SetFlagZ1HC and SetFlagZ00C only record the last
+// flag setting operation, Z/N/H/C are worked out once something reads F
+// (conditional jumps, PUSH AF, DAA, the debugger). k_None means F is up to
+// date.
+enum class FlagOperation : uint8_t { k_None, k_Z0HC, k_Z1HC, k_Z00C };
+
+typedef struct LazyFlags {
+  FlagOperation operation_ = FlagOperation::k_None;
+  uint8_t reg_{};
+  uint8_t operand_{};
+  uint16_t result_{};
+} LazyFlags;
 
 class GameBoy {
 public:
+  // Connects the peripherals to bus_ and scheduler_
+  GameBoy();
+
   uint64_t cycles_{};
-  uint8_t idu_{};
+  // The interpreter stops once cycles_ reaches this value
+  uint64_t cycle_deadline_{};
+  // Counts every Write(), the block cache uses it to tell that a loop only
+  // reads memory
+  uint64_t memory_writes_{};
+  uint16_t idu_{};
   uint8_t read_signal_{};
-  uint8_t address_bus_{};
+  uint16_t address_bus_{};
   uint8_t data_bus_{};
   bool branched{};
   bool cb_prefixed{}; 
   Register reg_{};
-  std::array<uint8_t, 8000> memory_ = {}; 
+  LazyFlags lazy_{};
+  // When false the flags are resolved straight away like on the hardware,
+  // used to check that both modes give the same results
+  bool lazy_flags_ = true;
+  uint8_t instruction_{};
+  uint8_t interrupt_{};
+  // While the CPU sleeps EmulateFor() moves cycles_ straight to the next
+  // scheduled event instead of running the interpreter
+  CpuMode mode_ = CpuMode::k_Running;
+  // Set by the cached interpreter, the immediates were already read when the
+  // block was decoded
+  uint16_t immediate_{};
+  bool immediate_latched_{};
+  MemoryBus bus_{};
+  BlockCache block_cache_{};
+  Jit jit_{};
+  Scheduler scheduler_{};
+  Ppu ppu_{};
+  Apu apu_{};
+  // Plain memory is read and written straight through the page table, only
+  // pages without a host pointer call their handler
+  inline uint8_t Read(const uint16_t k_Address) {
+    const MemoryPage& k_Page = bus_.page_table_[k_Address >> 8];
+    if (k_Page.read_ != nullptr) [[likely]] {
+      return k_Page.read_[k_Address & 0xFF];
+    }
+    return k_Page.read_handler_(this, k_Address);
+  }
+  inline void Write(const uint16_t k_Address, const uint8_t k_Value) {
+    memory_writes_++;
+    const MemoryPage& k_Page = bus_.page_table_[k_Address >> 8];
+    if (k_Page.write_ != nullptr) [[likely]] {
+      k_Page.write_[k_Address & 0xFF] = k_Value;
+      return;
+    }
+    k_Page.write_handler_(this, k_Address, k_Value);
+  }
+  // Handlers must go through these instead of reg_.f_ so pending flags are
+  // resolved first
+  inline void MaterializeFlags() {
+    if (lazy_.operation_ != FlagOperation::k_None) {
+      ResolveFlags();
+    }
+  }
+  inline bool Flag(const uint8_t k_BitIndex) {
+    MaterializeFlags();
+    return reg_.Flag(k_BitIndex);
+  }
+  inline void SetFlag(const uint8_t k_BitIndex, const bool k_Value) {
+    MaterializeFlags();
+    reg_.SetFlag(k_BitIndex, k_Value);
+  }
+  inline uint8_t Flags() {
+    MaterializeFlags();
+    return reg_.f_;
+  }
+  inline void SetFlags(const uint8_t k_Value) {
+    lazy_.operation_ = FlagOperation::k_None;
+    reg_.f_ = k_Value;
+  }
+  inline void DeferFlags(const FlagOperation k_Operation,
+                         const uint16_t k_Result, const uint8_t k_Reg,
+                         const uint8_t k_Operand) {
+    lazy_.operation_ = k_Operation;
+    lazy_.reg_ = k_Reg;
+    lazy_.operand_ = k_Operand;
+    lazy_.result_ = k_Result;
+    if (!lazy_flags_) {
+      ResolveFlags();
+    }
+  }
+  void ResolveFlags();
+  void SetLazyFlags(const bool k_Enable);
   void ClearRegisters();
-  void UpdateRegHL();
-  void UpdateRegBC();
-  void UpdateRegDE();
-  void UpdateRegAF();
-  void UpdateAll16BitReg();
-  uint8_t Operand8Bit();
-  uint16_t Operand16Bit();
+  // Sets the bits in IF, wakes the CPU up when one of them is enabled
+  void RequestInterrupt(const uint8_t k_Interrupts);
+  // Interrupts that are both requested and enabled
+  uint8_t PendingInterrupts();
+  inline uint8_t Operand8Bit() {
+    if (immediate_latched_) {
+      return static_cast<uint8_t>(immediate_);
+    }
+    return Read(reg_.program_counter_ + 1);
+  }
+  inline uint16_t Operand16Bit() {
+    if (immediate_latched_) {
+      return immediate_;
+    }
+    const uint16_t k_LowByte = Read(reg_.program_counter_ + 1);
+    const uint16_t k_HighByte = Read(reg_.program_counter_ + 2);
+    return (k_HighByte << 8) | k_LowByte;
+  }
   uint16_t ReturnAddress();
   void GetProgramCounterBytes(uint8_t& high_byte, uint8_t& low_byte);
-  template <uint8_t Register::*x_>
-  void UpdateRegisters();
-  template <uint16_t Register::*x_>
-  void UpdateRegisters(); 
- private:
-  inline void Update16BitRegister(uint16_t& _16bit_reg, const uint8_t& high_reg,
-                                  const uint8_t& low_reg);
 };
 // TDLR: I broke the style guide here
 // The Google Style Guide states all new enums should be prefix with k, however
@@ -244,7 +380,7 @@ enum Instruction : uint16_t {
 //Nibble 0            Nibble 1          Nibble 2          Nibble 3
   NOP         = 0x00, LD_BC_D16 = 0x01, LD__BC_A  = 0x02, INC_BC    = 0x03,
   STOP        = 0x10, LD_DE_D16 = 0x11, LD__DE_A  = 0x12, INC_DE    = 0x13,
-  JR_NZ_R8    = 0x20, LD_HL_D16 = 0x21, LD__HLp_A = 0x22, INC_AF    = 0x23,
+  JR_NZ_R8    = 0x20, LD_HL_D16 = 0x21, LD__HLp_A = 0x22, INC_HL    = 0x23,
   JR_NC_R8    = 0x30, LD_SP_D16 = 0x31, LD__HLm_A = 0x32, INC_SP    = 0x33,
   LD_B_B      = 0x40, LD_B_C    = 0x41, LD_B_D    = 0x42, LD_B_E    = 0x43,
   LD_D_B      = 0x50, LD_D_C    = 0x51, LD_D_D    = 0x52, LD_D_E    = 0x53,
@@ -278,7 +414,7 @@ enum Instruction : uint16_t {
 //Nibble 8            Nibble 9          Nibble A          Nibble B
   LD__A16_SP  = 0x08, ADD_HL_BC = 0x09, LD__A_BC  = 0x0A, DEC_BC    = 0x0B,
   JR_R8       = 0x18, ADD_HL_DE = 0x19, LD__A_DE  = 0x1A, DEC_DE    = 0x1B,
-  JR_Z_R8     = 0x28, ADD_HL_HL = 0x29, LD__A_HLp = 0x2A, DEC_AF    = 0x2B,
+  JR_Z_R8     = 0x28, ADD_HL_HL = 0x29, LD__A_HLp = 0x2A, DEC_HL    = 0x2B,
   JR_C_R8     = 0x38, ADD_HL_SP = 0x39, LD__A_HLm = 0x3A, DEC_SP    = 0x3B,
   LD_C_B      = 0x48, LD_C_C    = 0x49, LD_C_D    = 0x4A, LD_C_E    = 0x4B,
   LD_E_B      = 0x58, LD_E_C    = 0x59, LD_E_D    = 0x5A, LD_E_E    = 0x5B,
@@ -381,34 +517,6 @@ enum Instruction : uint16_t {
   SET_5_H = 0x1EC, SET_5_L = 0x1ED, SET_5__HL = 0x1EE, SET_5_A = 0x1EF,
   SET_7_H = 0x1FC, SET_7_L = 0x1FD, SET_7__HL = 0x1FE, SET_7_A = 0x1FF
 };
-// Reference: https://gbdev.io/pandocs/Memory_Map.html
-enum class MemoryMap : uint16_t {
-  k_RomBank00Start   = 0x0000, k_RomBank00End   = 0x3FFF,
-  k_RomBank01NnStart = 0x4000, k_RomBank01NnEnd = 0x7FFF,
-  k_VideoRamStart    = 0x8000, k_VideoRamEnd    = 0x9FFF,
-  k_ExternalRamStart = 0xA000, k_ExternalRamEnd = 0xBFFF,
-  k_WorkRamStart     = 0xC000, k_WorkRamEnd     = 0xCFFF,
-  k_EchoRamStart     = 0xE000, k_EchoRamEnd     = 0xFDFF,
-  k_OamStart         = 0xFE00, k_OamEnd         = 0xFE9F,
-  k_NotUsableStart   = 0xFEA0, k_NotUsableEnd   = 0xFEFF,
-  k_IoRegistersStart = 0xFF00, k_IoRegistersEnd = 0xFF7F,
-  k_HighRamStart     = 0xFF80, k_HighRamEnd     = 0xFFFE,
-  k_InterruptEnable  = 0xFFFF
-};
-
-// Reference: https://gbdev.io/pandocs/Memory_Map.html
-enum class IORanges : uint16_t {
-  k_JoypadInput          = 0xFF00,
-  k_SerialTransferStart  = 0xFF01, k_SerialTransferEnd  = 0xFF02,
-  k_TimerDividerStart    = 0xFF04, k_TimerDividerEnd    = 0xFF07,
-  k_AudioStart           = 0xFF10, k_AudioEnd           = 0xFF26,
-  k_WavePatternStart     = 0xFF30, k_WavePatternEnd     = 0xFF3F,
-  k_VramBankSelect       = 0xFF4F,
-  k_DisableBootRom       = 0xFF50, 
-  k_VramDmaStart         = 0xFF51, k_VramDmaEnd         = 0xFF55,
-  k_BgObjPalettesStart   = 0xFF68, k_BgObjPalettesEnd   = 0xFF6B,
-  k_WramBankSelect       = 0xFF70
-};
 // Reference: https://gbdev.io/pandocs/Hardware_Reg_List.html
 enum class HardwareRegistersName : uint16_t {
   k_P1Joyp   = 0xFF00, // JoyPad
@@ -588,37 +696,6 @@ extern void InitConditional(std::array<Opcode, 512>& opcode_table);
 extern void InitRestart(std::array<Opcode, 512>& opcode_table);
 extern void InitMiscellaneous(std::array<Opcode, 512> &opcode_table);
 extern void InitBitwise(std::array<Opcode, 512>& opcode_table);
-template <uint8_t Register::*x_>
-inline void GameBoy::UpdateRegisters() {
-  if constexpr (x_ == &Register::b_ || x_ == &Register::c_) {
-    UpdateRegBC();
-  } else if constexpr (x_ == &Register::d_ || x_ == &Register::e_) {
-    UpdateRegDE();
-  } else if constexpr (x_ == &Register::a_) {
-    UpdateRegAF();
-  } else {
-    UpdateRegHL();
-  }
-}
-
-template <uint16_t Register::*x_> 
-inline void GameBoy::UpdateRegisters() { 
-  if constexpr (x_ == &Register::bc_) { 
-    reg_.b_ = (reg_.bc_ >> 8);
-    reg_.c_ = (reg_.bc_ & 0x0F); 
-  } else if constexpr (x_ == &Register::de_) {
-    reg_.d_ = (reg_.de_ >> 8);
-    reg_.e_ = (reg_.de_ & 0x0F);
-  } else if constexpr (x_ == &Register::af_) {
-    reg_.a_ = (reg_.de_ >> 8);
-    reg_.f_.set(reg_.de_ & 0x0F);
-  } else if constexpr (x_ == &Register::hl_) {
-    reg_.h_ = (reg_.de_ >> 8);
-    reg_.l_ = (reg_.de_ & 0x0F);
-  }
-  // any other 16 bit register arn't tied to a 8 bit register so we don't update
-  // anything
-}
 
 }  // namespace binary::gb
 
@@ -652,6 +729,8 @@ extern void PrefixCB(GameBoy* gb);
 extern void EnableInterrput(GameBoy* gb);
 extern void DisableInterrput(GameBoy* gb);
 extern void NoOperation(GameBoy* gb);
+extern void Halt(GameBoy* gb);
+extern void Stop(GameBoy* gb);
 template <typename T = uint8_t, T Register::*x_>
 void Swap(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
@@ -659,19 +738,17 @@ void Swap(GameBoy* gb) {
     const uint8_t k_LowNibble = gb->reg_.*x_ << 4;
     const uint16_t k_Result = k_HighNibble | k_LowNibble;
 
-    gb->reg_.f_ = (k_Result != 0) ? 0 : k_FlagZ;
+    gb->SetFlags((k_Result != 0) ? 0 : k_FlagZ);
     gb->reg_.*x_ = k_Result;
-    gb->UpdateRegisters<x_>(); 
   } else if constexpr (std::is_same_v<T, uint16_t>) {
-    const uint8_t k_HighNibble = gb->memory_[gb->reg_.*x_] >> 4;
-    const uint8_t k_LowNibble = gb->memory_[gb->reg_.*x_] << 4;
+    const uint8_t k_HighNibble = gb->Read(gb->reg_.*x_) >> 4;
+    const uint8_t k_LowNibble = gb->Read(gb->reg_.*x_) << 4;
     const uint16_t k_Result = k_HighNibble | k_LowNibble;
 
-    gb->reg_.f_ = (k_Result != 0) ? 0 : k_FlagZ;
-    gb->memory_[gb->reg_.*x_] = k_Result;
+    gb->SetFlags((k_Result != 0) ? 0 : k_FlagZ);
+    gb->Write(gb->reg_.*x_, k_Result);
   }
 
-  gb->UpdateRegAF();
 }
 
 
@@ -679,24 +756,22 @@ template <typename T = uint8_t, T Register::*x_>
 void RotateLeft(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
     const bool k_7thBit = ((gb->reg_.*x_ & 0x80) > 0);
-    const bool k_IsCarryFlagSet = gb->reg_.f_[k_BitIndexC]; 
-    const uint8_t k_Result = (gb->reg_.*x_ << 1) | gb->reg_.f_[k_BitIndexC]; 
+    const bool k_IsCarryFlagSet = gb->Flag(k_BitIndexC); 
+    const uint8_t k_Result = (gb->reg_.*x_ << 1) | gb->Flag(k_BitIndexC); 
 
     SetFlagZ00C(gb, k_Result); 
-    gb->reg_.f_[k_BitIndexC] = k_7thBit; 
+    gb->SetFlag(k_BitIndexC, k_7thBit); 
     gb->reg_.*x_ = k_Result; 
-    gb->UpdateRegisters<x_>();
   } else if constexpr (std::is_same_v<T, uint16_t>) {
-    const bool k_7thBit = ((gb->memory_[gb->reg_.*x_] & 0x80) > 0);
-    const bool k_IsCarryFlagSet = gb->reg_.f_[k_BitIndexC]; 
-    const uint8_t k_Result = (gb->memory_[gb->reg_.*x_]<< 1) 
-                             | gb->reg_.f_[k_BitIndexC];
+    const bool k_7thBit = ((gb->Read(gb->reg_.*x_) & 0x80) > 0);
+    const bool k_IsCarryFlagSet = gb->Flag(k_BitIndexC); 
+    const uint8_t k_Result = (gb->Read(gb->reg_.*x_)<< 1) 
+                             | gb->Flag(k_BitIndexC);
 
     SetFlagZ00C(gb, k_Result);
-    gb->reg_.f_[k_BitIndexC] = k_7thBit; 
-    gb->memory_[gb->reg_.*x_] = k_Result; 
+    gb->SetFlag(k_BitIndexC, k_7thBit); 
+    gb->Write(gb->reg_.*x_, k_Result); 
   }
-  gb->UpdateRegAF(); 
 }
 
 template <typename T = uint8_t, T Register::*x_>
@@ -706,19 +781,17 @@ void RotateLeftCircular(GameBoy* gb) {
     const uint8_t k_Result = (gb->reg_.*x_ << 1) | static_cast<uint8_t>(k_7thBit);
 
     SetFlagZ00C(gb, k_Result); 
-    gb->reg_.f_[k_BitIndexC] = k_7thBit; 
+    gb->SetFlag(k_BitIndexC, k_7thBit); 
     gb->reg_.*x_ = k_Result;  
-    gb->UpdateRegisters<x_>();
   } else if constexpr (std::is_same_v<T, uint16_t>) { 
-    const bool k_7thBit = ((gb->memory_[gb->reg_.*x_] & 0x80) > 0);
+    const bool k_7thBit = ((gb->Read(gb->reg_.*x_) & 0x80) > 0);
     const uint8_t k_Result =
-        (gb->memory_[gb->reg_.*x_] << 1) | static_cast<uint8_t>(k_7thBit);
+        (gb->Read(gb->reg_.*x_) << 1) | static_cast<uint8_t>(k_7thBit);
 
     SetFlagZ00C(gb, k_Result);
-    gb->reg_.f_[k_BitIndexC] = k_7thBit;
-    gb->memory_[gb->reg_.*x_] = k_Result;
+    gb->SetFlag(k_BitIndexC, k_7thBit);
+    gb->Write(gb->reg_.*x_, k_Result);
   }
-  gb->UpdateRegAF();
 }
 
 template <typename T = uint8_t, T Register::*x_>
@@ -726,18 +799,17 @@ void RotateRight(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
     const bool k_FirstBit = ((gb->reg_.*x_ & 1) > 0);
     gb->reg_.*x_ >>= 1;
-    gb->reg_.*x_ |= (gb->reg_.f_[k_BitIndexC] == true) ? 0x80 : 0;
-    gb->reg_.f_[k_BitIndexC] = k_FirstBit;
-    gb->reg_.f_[k_BitIndexH] = false;
-    gb->UpdateRegisters<x_>(); 
+    gb->reg_.*x_ |= (gb->Flag(k_BitIndexC) == true) ? 0x80 : 0;
+    gb->SetFlag(k_BitIndexC, k_FirstBit);
+    gb->SetFlag(k_BitIndexH, false);
   } else if constexpr (std::is_same_v<T, uint16_t>) { 
-    const bool k_FirstBit = ((gb->memory_[gb->reg_.*x_] & 1) > 0);
-    gb->memory_[gb->reg_.*x_] >>= 1; 
-    gb->memory_[gb->reg_.*x_] |= (gb->reg_.f_[k_BitIndexC] == true) ? 0x80 : 0;
-    gb->reg_.f_[k_BitIndexC] = k_FirstBit; 
-    gb->reg_.f_[k_BitIndexH] = false; 
+    const bool k_FirstBit = ((gb->Read(gb->reg_.*x_) & 1) > 0);
+    const uint8_t k_Result = (gb->Read(gb->reg_.*x_) >> 1) |
+                             ((gb->Flag(k_BitIndexC) == true) ? 0x80 : 0);
+    gb->Write(gb->reg_.*x_, k_Result);
+    gb->SetFlag(k_BitIndexC, k_FirstBit); 
+    gb->SetFlag(k_BitIndexH, false); 
   }
-  gb->UpdateRegAF();
 }
 
 template <typename T = uint8_t, T Register::*x_>
@@ -745,10 +817,8 @@ void RotateRightCircular(GameBoy* gb) {
   bool k_FirstBit = ((gb->reg_.*x_ & 1) > 0);
   gb->reg_.*x_ >>= 1; 
   gb->reg_.*x_ |= (k_FirstBit == true) ? 0x80 : 0; 
-  gb->reg_.f_[k_BitIndexC] = k_FirstBit; 
-  gb->reg_.f_[k_BitIndexH] = false;
-  gb->UpdateRegisters<x_>(); 
-  gb->UpdateRegAF();
+  gb->SetFlag(k_BitIndexC, k_FirstBit); 
+  gb->SetFlag(k_BitIndexH, false);
 }
 
 extern void DecimalAdjust(GameBoy* gb);
@@ -765,26 +835,22 @@ template <typename T = uint8_t, T Register::*x_>
 void ShiftLeft(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
     gb->reg_.*x_ <<= 1; 
-    gb->reg_.f_ = (gb->reg_.*x_) ? k_FlagZ : 0;
-    gb->UpdateRegisters<x_>(); 
+    gb->SetFlags((gb->reg_.*x_) ? k_FlagZ : 0);
   } else if constexpr (std::is_same_v<T, uint16_t>) {
-    gb->memory_[gb->reg_.*x_] <<= 1;  
-    gb->reg_.f_ = (gb->reg_.*x_) ? k_FlagZ : 0; 
+    gb->Write(gb->reg_.*x_, gb->Read(gb->reg_.*x_) << 1);  
+    gb->SetFlags((gb->reg_.*x_) ? k_FlagZ : 0); 
   }
-  gb->UpdateRegAF(); 
 }
 
 template <typename T = uint8_t, T Register::*x_>
 void ShiftRight(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
     gb->reg_.*x_ >>= 1;
-    gb->reg_.f_ = (gb->reg_.*x_) ? k_FlagZ : 0;
-    gb->UpdateRegisters<x_>();
+    gb->SetFlags((gb->reg_.*x_) ? k_FlagZ : 0);
   } else if constexpr (std::is_same_v<T, uint16_t>) {
-    gb->memory_[gb->reg_.*x_] >>= 1;
-    gb->reg_.f_ = (gb->reg_.*x_) ? k_FlagZ : 0;
+    gb->Write(gb->reg_.*x_, gb->Read(gb->reg_.*x_) >> 1);
+    gb->SetFlags((gb->reg_.*x_) ? k_FlagZ : 0);
   }
-  gb->UpdateRegAF();
 }
 
 template <typename T = uint8_t, T Register::*x_, const uint8_t BitPos>
@@ -792,17 +858,15 @@ void Bit(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
     const uint8_t k_Bit = (1 << BitPos);
     const uint16_t k_Result = gb->reg_.*x_ ^ k_Bit;
-    gb->reg_.f_ |= (k_Result != 0) ? k_FlagH : k_FlagZ | k_FlagH;
+    gb->SetFlags(gb->Flags() | ((k_Result != 0) ? k_FlagH : k_FlagZ | k_FlagH));
     gb->reg_.*x_ = k_Result;
-    gb->UpdateRegisters<x_>();
   } else if constexpr (std::is_same_v<T, uint16_t>) {
     const uint8_t k_Bit = (1 << BitPos);
-    const uint16_t k_Result = gb->memory_[gb->reg_.*x_] ^ k_Bit; 
-    gb->reg_.f_ |= (k_Result != 0) ? k_FlagH : k_FlagZ | k_FlagH;
-    gb->memory_[gb->reg_.*x_] = k_Result;
+    const uint16_t k_Result = gb->Read(gb->reg_.*x_) ^ k_Bit; 
+    gb->SetFlags(gb->Flags() | ((k_Result != 0) ? k_FlagH : k_FlagZ | k_FlagH));
+    gb->Write(gb->reg_.*x_, k_Result);
 
   }
-  gb->UpdateRegAF();
 }
 
 template <typename T = uint8_t, T Register::*x_, const uint8_t BitPos>
@@ -810,10 +874,9 @@ void Set(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
     const uint8_t k_Bit = (1 << BitPos);
     gb->reg_.*x_ |= k_Bit;
-    gb->UpdateRegisters<x_>();
   } else if constexpr (std::is_same_v<T, uint16_t>) {
     const uint8_t k_Bit = (1 << BitPos);
-    gb->memory_[gb->reg_.*x_] |= k_Bit;
+    gb->Write(gb->reg_.*x_, gb->Read(gb->reg_.*x_) | k_Bit);
   }
 }
 
@@ -822,10 +885,9 @@ void Reset(GameBoy* gb) {
   if constexpr (std::is_same_v<T, uint8_t>) {
     const uint8_t k_Bit = (1 << BitPos);
     gb->reg_.*x_ &= ~k_Bit; 
-    gb->UpdateRegisters<x_>();
   } else if constexpr (std::is_same_v<T, uint16_t>) {
     const uint8_t k_Bit = (1 << BitPos);
-    gb->memory_[gb->reg_.*x_] &= ~k_Bit;
+    gb->Write(gb->reg_.*x_, gb->Read(gb->reg_.*x_) & ~k_Bit);
   }
 }
 template<const uint16_t k_Address>
@@ -833,8 +895,8 @@ void Restart(GameBoy* gb) {
   // There's a problem where if the stackpointer is greater than the memeory 
   // size the program crashes, I don't know what happens when stack pointer
   // 
-  gb->memory_[gb->reg_.stack_pointer_ - 1] = (gb->reg_.program_counter_ >> 8);
-  gb->memory_[gb->reg_.stack_pointer_ - 2] = (gb->reg_.program_counter_);
+  gb->Write(gb->reg_.stack_pointer_ - 1, (gb->reg_.program_counter_ >> 8));
+  gb->Write(gb->reg_.stack_pointer_ - 2, (gb->reg_.program_counter_));
   gb->reg_.stack_pointer_ -= 2;
   gb->reg_.program_counter_ = k_Address;
 }
@@ -846,17 +908,17 @@ void Load(GameBoy* gb) {
 
   if constexpr (std::is_same_v<T, uint16_t>) {
     if constexpr (address_mode == k_RegisterIndirect) {
-      gb->reg_.a_ = gb->memory_[gb->reg_.*y_];
+      gb->reg_.a_ = gb->Read(gb->reg_.*y_);
     } else if constexpr (address_mode == k_Indirect) {
-      gb->memory_[gb->reg_.*y_] = gb->reg_.a_;
+      gb->Write(gb->reg_.*y_, gb->reg_.a_);
     } else if constexpr (address_mode == k_Immediate16) {
       gb->reg_.*x_ = gb->Operand16Bit();
     } else if constexpr (address_mode == k_StackPointer) {
       gb->reg_.stack_pointer_ = gb->Operand16Bit();
     } else if constexpr (address_mode == k_Address16) {
       const uint16_t k_Address = gb->Operand16Bit();
-      gb->memory_[k_Address + 1] = (gb->reg_.stack_pointer_ >> 8);
-      gb->memory_[k_Address] = (gb->reg_.stack_pointer_);
+      gb->Write(k_Address + 1, (gb->reg_.stack_pointer_ >> 8));
+      gb->Write(k_Address, (gb->reg_.stack_pointer_));
     }
   } else {
     if constexpr (address_mode == k_RegisterDirect) { 
@@ -864,10 +926,9 @@ void Load(GameBoy* gb) {
     } else if constexpr (address_mode == k_Immediate8) { 
       gb->reg_.*x_ = gb->Operand8Bit(); 
     } else if constexpr (address_mode == k_RegisterIndirect) {
-      gb->memory_[gb->reg_.hl_] = gb->reg_.*y_;
+      gb->Write(gb->reg_.hl_, gb->reg_.*y_);
     }
   }
-  gb->UpdateRegisters<x_>(); 
 }
 
 template <uint8_t Register::*x_ = &Register::a_,
@@ -886,19 +947,17 @@ void Add(GameBoy* gb) {
     const uint16_t k_Result = gb->reg_.a_ + k_Operand;
     SetFlagZ0HC(gb, k_Result, gb->reg_.a_, gb->reg_.*x_);
     gb->reg_.a_ = k_Result;
-    gb->UpdateRegAF();
   }
 }
 
 template <uint8_t Register::*x_ = &Register::a_,
           AddressingMode address_mode = k_RegisterDirect> 
 void AddWithCarry(GameBoy* gb) {
-  uint8_t k_RegFValue = static_cast<uint8_t>(gb->reg_.f_.to_ulong());
+  uint8_t k_RegFValue = gb->Flags();
   const uint8_t k_Result =
-      k_RegFValue + gb->reg_.*x_ + gb->reg_.f_[k_BitIndexC];
-  gb->reg_.f_ = k_Result;
+      k_RegFValue + gb->reg_.*x_ + gb->Flag(k_BitIndexC);
+  gb->SetFlags(k_Result);
   SetFlagZ0HC(gb, k_Result, gb->reg_.a_, gb->reg_.*x_);
-  gb->UpdateRegAF();
 }
 
 template <uint8_t Register::*x_ = &Register::a_,
@@ -908,7 +967,6 @@ void Sub(GameBoy* gb) {
   const uint16_t k_Result = gb->reg_.a_ - k_Operand; 
   SetFlagZ1HC(gb, k_Result, gb->reg_.a_, k_Operand);
   gb->reg_.a_ = k_Result;
-  gb->UpdateRegAF();
 }
 
 template <typename T = uint8_t, T Register::*x_ = &Register::a_,
@@ -917,10 +975,9 @@ void Increment(GameBoy* gb) {
   if constexpr (address_mode == k_RegisterDirect) {
     ++(gb->reg_.*x_);
     if constexpr (std::is_same_v<T, uint8_t>) {
-      gb->UpdateRegisters<x_>(); 
     }
   }else if constexpr (address_mode == k_RegisterIndirect) {
-    gb->memory_[gb->reg_.hl_] += 1; 
+    gb->Write(gb->reg_.hl_, gb->Read(gb->reg_.hl_) + 1); 
   }
 }
 
@@ -930,10 +987,9 @@ void Decrement(GameBoy* gb) {
   if constexpr (address_mode == k_RegisterDirect) { 
     --(gb->reg_.*x_);
     if constexpr (std::is_same_v<T, uint8_t>) {
-      gb->UpdateRegisters<x_>(); 
     }
   }else if constexpr (address_mode == k_RegisterIndirect) {
-    gb->memory_[gb->reg_.hl_] -= 1;
+    gb->Write(gb->reg_.hl_, gb->Read(gb->reg_.hl_) - 1);
   } 
 }
 
@@ -942,7 +998,7 @@ auto GetOperandValue(GameBoy* gb) {
   if constexpr (address_mode == k_RegisterDirect) {
     return gb->reg_.*x_;
   } else if constexpr (address_mode == k_RegisterIndirect) {
-    return gb->memory_[gb->reg_.hl_];
+    return gb->Read(gb->reg_.hl_);
   } else if constexpr (address_mode == k_Immediate8) {
     return gb->Operand8Bit();
   } else if constexpr (address_mode == k_Immediate16){
@@ -955,12 +1011,11 @@ auto GetOperandValue(GameBoy* gb) {
 template <uint8_t Register::*x_ = &Register::a_,
           AddressingMode address_mode = k_RegisterDirect>
 void SubWithCarry(GameBoy* gb) {
-  const uint8_t k_RegFValue = static_cast<uint8_t>(gb->reg_.f_.to_ulong());
+  const uint8_t k_RegFValue = gb->Flags();
   const uint8_t k_Operand = GetOperandValue<x_, address_mode>(gb); 
-  const uint16_t k_Result = k_RegFValue - k_Operand - gb->reg_.f_[k_BitIndexC];
-  gb->reg_.f_ = k_Result;
+  const uint16_t k_Result = k_RegFValue - k_Operand - gb->Flag(k_BitIndexC);
+  gb->SetFlags(k_Result);
   SetFlagZ1HC(gb, k_Result, k_RegFValue, k_Operand);
-  gb->UpdateRegAF();
 }
 
 template <uint8_t Register::* x_ = &Register::a_,
@@ -968,9 +1023,8 @@ template <uint8_t Register::* x_ = &Register::a_,
 void Xor(GameBoy* gb) {
   const uint8_t k_Operand = GetOperandValue<x_, address_mode>(gb);
   const uint16_t k_Result = gb->reg_.a_ ^ k_Operand;
-  gb->reg_.f_ = (k_Result != 0) ? 0 : k_FlagZ;
+  gb->SetFlags((k_Result != 0) ? 0 : k_FlagZ);
   gb->reg_.a_ = k_Result;
-  gb->UpdateRegAF();
 }
 
 template <uint8_t Register::*x_ = &Register::a_,
@@ -978,9 +1032,8 @@ template <uint8_t Register::*x_ = &Register::a_,
 void Or(GameBoy* gb) {
   const uint8_t k_Operand = GetOperandValue<x_, address_mode>(gb);
   const uint16_t k_Result = k_Operand | gb->reg_.a_;
-  gb->reg_.f_ = (k_Result != 0) ? false : k_FlagZ;
+  gb->SetFlags((k_Result != 0) ? false : k_FlagZ);
   gb->reg_.a_ = k_Result;
-  gb->UpdateRegAF();
 }
 
 template <uint8_t Register::*x_ = &Register::a_, 
@@ -988,9 +1041,8 @@ template <uint8_t Register::*x_ = &Register::a_,
 void And(GameBoy* gb) {
   const uint8_t k_Operand = GetOperandValue<x_, address_mode>(gb);
   const uint16_t k_Result = k_Operand & gb->reg_.a_;
-  gb->reg_.f_ = (k_Result != 0) ? k_FlagH : (k_FlagZ | k_FlagH);
+  gb->SetFlags((k_Result != 0) ? k_FlagH : (k_FlagZ | k_FlagH));
   gb->reg_.a_ = k_Result;     
-  gb->UpdateRegAF();
 }
 
 template <uint8_t Register::*x_ = &Register::a_,
@@ -1000,27 +1052,32 @@ void Compare(GameBoy* gb) {
   if constexpr (address_mode == k_RegisterDirect) {
     k_Result = gb->reg_.a_ - gb->reg_.*x_; 
   } else if constexpr (address_mode == k_RegisterIndirect) {
-    k_Result = gb->reg_.a_ - gb->memory_[gb->reg_.hl_];
+    k_Result = gb->reg_.a_ - gb->Read(gb->reg_.hl_);
   }
   SetFlagZ1HC(gb, k_Result, gb->reg_.a_, gb->reg_.*x_);  
-  gb->reg_.f_ = k_Result; 
-  gb->UpdateRegAF(); 
+  gb->SetFlags(k_Result); 
 }
 
 template <uint16_t Register::*x_>
 void Pop(GameBoy* gb) {
-  const uint8_t k_HighNibble = gb->memory_[gb->reg_.stack_pointer_ + 1];
-  const uint8_t k_LowNibble = gb->memory_[gb->reg_.stack_pointer_ + 2];
+  if constexpr (x_ == &Register::af_) {
+    gb->SetFlags(0);
+  }
+  const uint8_t k_HighNibble = gb->Read(gb->reg_.stack_pointer_ + 1);
+  const uint8_t k_LowNibble = gb->Read(gb->reg_.stack_pointer_ + 2);
   gb->reg_.*x_ = k_HighNibble | k_LowNibble;
   gb->reg_.stack_pointer_ += 2;
 }
 
 template <uint16_t Register::*x_>
 void Push(GameBoy* gb) {
+  if constexpr (x_ == &Register::af_) {
+    gb->MaterializeFlags();
+  }
   const uint8_t k_HighNibble = gb->reg_.*x_ >> 4;
   const uint8_t k_LowNibble = gb->reg_.*x_ << 4;
-  gb->memory_[gb->reg_.stack_pointer_] = k_LowNibble;
-  gb->memory_[gb->reg_.stack_pointer_ - 1] = k_HighNibble;
+  gb->Write(gb->reg_.stack_pointer_, k_LowNibble);
+  gb->Write(gb->reg_.stack_pointer_ - 1, k_HighNibble);
   gb->reg_.stack_pointer_--;
   
 }
@@ -1038,15 +1095,15 @@ void Call(GameBoy* gb) {
   uint16_t function_address = gb->Operand16Bit(); 
   gb->GetProgramCounterBytes(program_coutner_high, program_counter_low);
   if constexpr (has_condition) {
-    if (gb->reg_.f_[bit_index] == condition) {
-      gb->memory_[gb->reg_.stack_pointer_ - 1] = program_coutner_high;
-      gb->memory_[gb->reg_.stack_pointer_ - 2] = program_counter_low;
+    if (gb->Flag(bit_index) == condition) {
+      gb->Write(gb->reg_.stack_pointer_ - 1, program_coutner_high);
+      gb->Write(gb->reg_.stack_pointer_ - 2, program_counter_low);
       gb->reg_.program_counter_ = function_address;
       gb->branched = true;
     }
   } else {
-    gb->memory_[gb->reg_.stack_pointer_ - 1] = program_coutner_high;
-    gb->memory_[gb->reg_.stack_pointer_ - 2] = program_counter_low;
+    gb->Write(gb->reg_.stack_pointer_ - 1, program_coutner_high);
+    gb->Write(gb->reg_.stack_pointer_ - 2, program_counter_low);
     gb->reg_.program_counter_ = function_address;
   }
 }
@@ -1056,7 +1113,7 @@ template <const bool has_condition, const uint8_t bit_index = k_BitIndexZ,
 void Return(GameBoy* gb) {
 
   if constexpr (has_condition) { 
-    if (gb->reg_.f_[bit_index] == condition) { 
+    if (gb->Flag(bit_index) == condition) { 
       gb->reg_.program_counter_ = gb->ReturnAddress();
       gb->branched = true;
     }
@@ -1070,7 +1127,7 @@ template <const bool has_condition, const uint8_t bit_index = k_BitIndexZ,
           const bool condition = false>
 void JumpRelative(GameBoy* gb) {
   if constexpr (has_condition) {
-    if (gb->reg_.f_[bit_index] == condition) {
+    if (gb->Flag(bit_index) == condition) {
       gb->reg_.program_counter_ += gb->Operand8Bit(); 
       gb->branched = true; 
     }
@@ -1083,7 +1140,7 @@ template <const bool has_condition, const uint8_t bit_index = k_BitIndexZ,
           const bool condition = false>
 void Jump(GameBoy* gb) {
   if constexpr (has_condition) {
-    if (gb->reg_.f_[bit_index] == condition) {
+    if (gb->Flag(bit_index) == condition) {
       const uint16_t k_JumpAddress = gb->Operand16Bit();
       gb->reg_.stack_pointer_ = gb->reg_.program_counter_;
       gb->reg_.program_counter_ = k_JumpAddress;
@@ -1101,11 +1158,11 @@ template <const uint8_t k_OpcodeLenght = 0>
 std::string PrintOpcode(GameBoy* gb, const uint8_t opcode) {
   std::string output; 
   if constexpr (k_OpcodeLenght == 2) {
-    const uint8_t k_Byte = gb->memory_[opcode + 1];
+    const uint8_t k_Byte = gb->Read(opcode + 1);
     output = std::format("{:02X} {:02X}", opcode, k_Byte);
   } else if constexpr (k_OpcodeLenght == 3) {
-    const uint8_t k_HByte = gb->memory_[opcode + 2];
-    const uint8_t k_LByte = gb->memory_[opcode + 1];
+    const uint8_t k_HByte = gb->Read(opcode + 2);
+    const uint8_t k_LByte = gb->Read(opcode + 1);
     output = std::format("{:02X} {:02X} {:02X}", opcode, k_LByte, k_HByte);
   } else{
     output = std::format("{:02X}", opcode);
@@ -1127,6 +1184,16 @@ extern void InitGenericOpcode(Opcode& opcode, const std::string k_Mnemonic,
   opcode.mnemonic_ = k_Mnemonic;
 }
 // LD r, r;   
-extern inline void Fetch(GameBoy* gb);
+// Defined here since the interpreters, the block cache and the JIT all call
+// it from their own translation units
+inline void Fetch(GameBoy* gb) {
+  gb->idu_                  = gb->reg_.program_counter_;
+  gb->address_bus_          = gb->idu_;
+  gb->idu_++;
+  gb->reg_.program_counter_ = gb->idu_;
+  gb->read_signal_          = true;
+  gb->instruction_          = gb->Read(gb->address_bus_);
+  gb->cycles_++;
+}
 
 }// namespace binary::gb::instructionset
\ No newline at end of file
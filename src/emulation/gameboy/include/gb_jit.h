@@ -0,0 +1,61 @@
+// Purpose: This header file contains the following
+//  * x86-64 dynamic recompiler for the Gameboy CPU (LR35902)
+//
+// Blocks from the BlockCache that run k_HotBlockThreshold times get compiled
+// into native code. Register only instructions (LD r,r, INC/DEC, ADD, SUB,
+// AND, OR, XOR) are translated, the guest registers they touch stay in host
+// registers until the next instruction that needs memory. Everything else,
+// including every memory and I/O access, is a direct call to the same
+// handler the interpreters use, so the results are identical. Cycles come
+// from k_MachineCycleTable like in the interpreters, taken conditional
+// branches add their extra cost on the way out of the block.
+//
+// ADD/SUB write the lazy flag record from the host registers, AND/OR/XOR
+// pick F with the host zero flag. Compiled blocks assume lazy flags are on,
+// with lazy_flags_ off EmulateJit() runs the cached interpreter instead.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "gb_block_cache.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BINARY_GB_JIT_X64
+#endif
+
+namespace binary::gb {
+#ifdef BINARY_GB_JIT_X64
+constexpr bool k_JitSupported = true;
+#else
+constexpr bool k_JitSupported = false;
+#endif
+// Executable memory shared by every compiled block, it's thrown away with
+// the block cache once it runs out. It's mapped read/write while a block is
+// copied in and read/execute otherwise, never both at once.
+constexpr size_t k_JitCodeSize = 4 * 1024 * 1024;
+constexpr uint32_t k_HotBlockThreshold = 8;
+
+class Jit {
+ public:
+  Jit() = default;
+  ~Jit();
+  Jit(const Jit&) = delete;
+  Jit& operator=(const Jit&) = delete;
+
+  // Returns false when the code buffer is full, the caller has to clear the
+  // block cache and call Reset()
+  bool Compile(GameBoy* gb, BasicBlock& block);
+  void Reset();
+
+  // Turning this off makes EmulateJit() behave like EmulateCached()
+  bool enabled_ = k_JitSupported;
+  uint64_t compiled_blocks_{};
+
+ private:
+  // Switches the whole code buffer between read/write and read/execute
+  bool Protect(const bool k_Writable);
+
+  uint8_t* code_ = nullptr;
+  size_t used_{};
+  bool writable_{};
+};
+}  // namespace binary::gb
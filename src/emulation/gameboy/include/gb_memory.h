@@ -0,0 +1,123 @@
+// Purpose: This header file contains the following
+//  * Memory Map
+//  * IO Ranges
+//  * Memory bus (page table) for the Gameboy
+//
+// The Gameboy has a 16 bit address bus, we split it into 256 pages of 256
+// bytes each. Every page either points straight at the host memory backing it
+// (ROM banks, VRAM, WRAM, OAM ...) or at a pair of handlers. Reading plain
+// memory is one page table lookup plus a load, only the I/O page and the MBC
+// control region pay for a function call. The PPU, timer and APU hook their
+// registers in with MapIo() so they never slow down the common path.
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binary::gb {
+class GameBoy;
+
+// Reference: https://gbdev.io/pandocs/Memory_Map.html
+enum class MemoryMap : uint16_t {
+  k_RomBank00Start     = 0x0000, k_RomBank00End     = 0x3FFF,
+  k_RomBank01NnStart   = 0x4000, k_RomBank01NnEnd   = 0x7FFF,
+  k_VideoRamStart      = 0x8000, k_VideoRamEnd      = 0x9FFF,
+  k_ExternalRamStart   = 0xA000, k_ExternalRamEnd   = 0xBFFF,
+  k_WorkRamStart       = 0xC000, k_WorkRamEnd       = 0xCFFF,
+  k_WorkRamBank01Start = 0xD000, k_WorkRamBank01End = 0xDFFF,
+  k_EchoRamStart       = 0xE000, k_EchoRamEnd       = 0xFDFF,
+  k_OamStart           = 0xFE00, k_OamEnd           = 0xFE9F,
+  k_NotUsableStart     = 0xFEA0, k_NotUsableEnd     = 0xFEFF,
+  k_IoRegistersStart   = 0xFF00, k_IoRegistersEnd   = 0xFF7F,
+  k_HighRamStart       = 0xFF80, k_HighRamEnd       = 0xFFFE,
+  k_InterruptEnable    = 0xFFFF
+};
+
+// Reference: https://gbdev.io/pandocs/Memory_Map.html
+enum class IORanges : uint16_t {
+  k_JoypadInput          = 0xFF00,
+  k_SerialTransferStart  = 0xFF01, k_SerialTransferEnd  = 0xFF02,
+  k_TimerDividerStart    = 0xFF04, k_TimerDividerEnd    = 0xFF07,
+  k_AudioStart           = 0xFF10, k_AudioEnd           = 0xFF26,
+  k_WavePatternStart     = 0xFF30, k_WavePatternEnd     = 0xFF3F,
+  k_LcdStart             = 0xFF40, k_LcdEnd             = 0xFF4B,
+  k_VramBankSelect       = 0xFF4F,
+  k_DisableBootRom       = 0xFF50,
+  k_VramDmaStart         = 0xFF51, k_VramDmaEnd         = 0xFF55,
+  k_BgObjPalettesStart   = 0xFF68, k_BgObjPalettesEnd   = 0xFF6B,
+  k_WramBankSelect       = 0xFF70
+};
+
+constexpr uint16_t k_PageSize     = 256;
+constexpr uint16_t k_PageCount    = 256;
+constexpr uint16_t k_RomBankSize  = 0x4000;
+constexpr uint16_t k_RamBankSize  = 0x2000;
+constexpr uint16_t k_IoRegisterCount = 0x80;
+
+typedef uint8_t (*ReadHandler)(GameBoy* gb, const uint16_t k_Address);
+typedef void (*WriteHandler)(GameBoy* gb, const uint16_t k_Address,
+                             const uint8_t k_Value);
+
+// When read_ or write_ is nullptr the access goes through the handler instead.
+// Pages can be read directly but written through a handler, that's how ROM
+// works since writing to it talks to the MBC.
+typedef struct MemoryPage {
+  uint8_t* read_ = nullptr;
+  uint8_t* write_ = nullptr;
+  ReadHandler read_handler_ = nullptr;
+  WriteHandler write_handler_ = nullptr;
+} MemoryPage;
+
+class MemoryBus {
+ public:
+  MemoryBus();
+  // The page table points into this object, copying it would leave the
+  // copy reading the original's memory
+  MemoryBus(const MemoryBus&) = delete;
+  MemoryBus& operator=(const MemoryBus&) = delete;
+
+  std::array<MemoryPage, k_PageCount> page_table_{};
+
+  // Cartridge, at least 2 banks of 16 KiB
+  std::vector<uint8_t> rom_ = std::vector<uint8_t>(k_RomBankSize * 2);
+  std::array<uint8_t, k_RamBankSize> video_ram_{};
+  std::array<uint8_t, k_RamBankSize> external_ram_{};
+  std::array<uint8_t, k_RamBankSize> work_ram_{};
+  // The not usable area after OAM shares the page, so OAM gets a full page
+  std::array<uint8_t, k_PageSize> oam_{};
+  std::array<uint8_t, k_IoRegisterCount> io_registers_{};
+  std::array<uint8_t, k_IoRegisterCount> high_ram_{};
+  uint8_t interrupt_enable_{};
+
+  // Per register handlers for 0xFF00-0xFF7F, registers without one read and
+  // write io_registers_
+  std::array<ReadHandler, k_IoRegisterCount> io_read_{};
+  std::array<WriteHandler, k_IoRegisterCount> io_write_{};
+
+  uint16_t rom_bank_ = 1;
+  bool external_ram_enabled_{};
+  // Incremented by LoadCartridge() so cached ROM code can tell it's stale
+  uint32_t cartridge_generation_{};
+
+  void LoadCartridge(const uint8_t* data, const size_t k_Size);
+  void MapRomBank(uint16_t bank);
+  void EnableExternalRam(const bool k_Enable);
+  void MapMemory(const MemoryMap k_Start, const MemoryMap k_End,
+                 uint8_t* memory);
+  // A nullptr handler leaves that direction of the page untouched
+  void MapHandlers(const MemoryMap k_Start, const MemoryMap k_End,
+                   ReadHandler read_handler, WriteHandler write_handler);
+  void MapIo(const IORanges k_Start, const IORanges k_End,
+             ReadHandler read_handler, WriteHandler write_handler);
+};
+
+extern void WriteMemoryBankController(GameBoy* gb, const uint16_t k_Address,
+                                      const uint8_t k_Value);
+extern uint8_t ReadExternalRamDisabled(GameBoy* gb, const uint16_t k_Address);
+extern void WriteExternalRamDisabled(GameBoy* gb, const uint16_t k_Address,
+                                     const uint8_t k_Value);
+extern uint8_t ReadHighPage(GameBoy* gb, const uint16_t k_Address);
+extern void WriteHighPage(GameBoy* gb, const uint16_t k_Address,
+                          const uint8_t k_Value);
+}  // namespace binary::gb
@@ -0,0 +1,139 @@
+// Purpose: This header file contains the following
+//  * Scanline PPU for the Gameboy (DMG)
+//
+// The PPU walks through OAM scan -> drawing -> HBlank for every visible line
+// and then 10 lines of VBlank, each mode change is a k_PpuMode event on the
+// scheduler so the CPU never checks on it. The whole line is rendered at once
+// when drawing starts, which is accurate enough for almost every game and a
+// lot cheaper than a per dot pixel FIFO. Mid line register writes only show
+// up on the next line.
+//
+// Tiles are kept decoded to one colour index per byte in tiles_. Writes to
+// the tile data area mark the tile in a dirty bitmap and only those get
+// decoded again before the next line, games rewrite VRAM far less often than
+// the PPU reads it. Lines are then copied out of the cache 8 pixels at a time
+// and the palettes applied with a byte shuffle.
+//
+// Tiles are decoded 16 pixels at a time with SSSE3: pshufb broadcasts the
+// two bit planes over the pixels and a compare picks each pixel's bit.
+// Without SSSE3 a lookup table spreads the 8 bits of a plane into 8 bytes
+// instead. x64 only guarantees SSE2, so the SSSE3 kernels are picked at
+// runtime when the CPU has it.
+//
+// indexed_framebuffer_ is the frame as one k_ShadeColors index per pixel,
+// top row first, for VulkanViewport's indexed streaming mode which looks the
+// colours up on the GPU. Nothing on the emulation path needs RGBA, so it's
+// only produced on demand by ExpandFramebuffer() in the layout VulkanViewport
+// takes in LoadFromArray()/Update() with VK_FORMAT_R8G8B8A8_UNORM.
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || (defined(_M_X64) && !defined(_M_ARM64EC))
+#define BINARY_GB_PPU_X64
+#endif
+
+namespace binary::gb {
+class GameBoy;
+
+constexpr uint16_t k_ScreenWidth = 160;
+constexpr uint16_t k_ScreenHeight = 144;
+constexpr size_t k_FramebufferSize = k_ScreenWidth * k_ScreenHeight * 4;
+constexpr size_t k_IndexedFramebufferSize = k_ScreenWidth * k_ScreenHeight;
+
+// Mode lengths in machine cycles like GameBoy::cycles_, 456 dots per line
+constexpr uint32_t k_OamScanCycles = 20;
+constexpr uint32_t k_DrawingCycles = 43;
+constexpr uint32_t k_HBlankCycles = 51;
+constexpr uint32_t k_ScanlineCycles =
+    k_OamScanCycles + k_DrawingCycles + k_HBlankCycles;
+constexpr uint8_t k_VBlankLine = 144;
+constexpr uint8_t k_LinesPerFrame = 154;
+constexpr uint8_t k_MaxSpritesPerLine = 10;
+
+// Tile data is 0x8000-0x97FF, 16 bytes per tile. There's no CGB VRAM bank 1
+// yet, so a single bank of tiles.
+constexpr uint16_t k_TileCount = 384;
+constexpr size_t k_TilePixels = 64;
+constexpr uint16_t k_TileDataSize = k_TileCount * 16;
+
+// Reference: https://gbdev.io/pandocs/STAT.html
+enum class PpuMode : uint8_t {
+  k_HBlank = 0,
+  k_VBlank = 1,
+  k_OamScan = 2,
+  k_Drawing = 3
+};
+
+// LCDC bits, reference: https://gbdev.io/pandocs/LCDC.html
+constexpr uint8_t k_LcdcBackgroundEnable = 0x01;
+constexpr uint8_t k_LcdcObjectEnable     = 0x02;
+constexpr uint8_t k_LcdcObjectSize       = 0x04;
+constexpr uint8_t k_LcdcBackgroundMap    = 0x08;
+constexpr uint8_t k_LcdcTileData         = 0x10;
+constexpr uint8_t k_LcdcWindowEnable     = 0x20;
+constexpr uint8_t k_LcdcWindowMap        = 0x40;
+constexpr uint8_t k_LcdcEnable           = 0x80;
+
+// DMG shades from lightest to darkest as R, G, B, A
+constexpr std::array<std::array<uint8_t, 4>, 4> k_ShadeColors = {{
+    {0xFF, 0xFF, 0xFF, 0xFF},
+    {0xAA, 0xAA, 0xAA, 0xFF},
+    {0x55, 0x55, 0x55, 0xFF},
+    {0x00, 0x00, 0x00, 0xFF}}};
+
+class Ppu {
+ public:
+  // Maps the LCD registers on gb's bus and the k_PpuMode event handler. The
+  // PPU starts off, it runs once LCDC bit 7 is set.
+  void Connect(GameBoy* gb);
+  // Renders line LY into indexed_framebuffer_
+  void RenderScanline(GameBoy* gb);
+  // Writes indexed_framebuffer_ as RGBA8 to output
+  void ExpandFramebuffer(std::array<uint8_t, k_FramebufferSize>& output) const;
+  // For code writing video_ram_ without going through GameBoy::Write()
+  inline void InvalidateTiles() { dirty_tiles_.fill(~uint64_t{0}); }
+  // Decodes the tiles written to since the last call
+  void RefreshTiles(GameBoy* gb);
+
+  std::array<uint8_t, k_IndexedFramebufferSize> indexed_framebuffer_{};
+  // Finished frames, bumped when VBlank starts
+  uint64_t frames_{};
+  PpuMode mode_ = PpuMode::k_HBlank;
+  // The window has its own line counter, it only moves on lines it's drawn
+  uint8_t window_line_{};
+  // STAT interrupts fire when any enabled source turns on while none was
+  bool stat_line_{};
+  // 8x8 colour indices per tile, rows top to bottom
+  std::array<uint8_t, k_TileCount * k_TilePixels> tiles_{};
+  // One bit per tile that has to be decoded again
+  std::array<uint64_t, k_TileCount / 64> dirty_tiles_ = [] {
+    std::array<uint64_t, k_TileCount / 64> dirty{};
+    dirty.fill(~uint64_t{0});
+    return dirty;
+  }();
+
+ private:
+  // 2 bit colour indices of one line plus room for the tile cut off by SCX
+  // and the vector loop running over the end
+  static constexpr size_t k_LineBufferSize = k_ScreenWidth + 32;
+
+  void RenderBackground(GameBoy* gb, const uint8_t k_Line);
+  void RenderWindow(GameBoy* gb, const uint8_t k_Line);
+  void RenderSprites(GameBoy* gb, const uint8_t k_Line);
+
+  std::array<uint8_t, k_LineBufferSize> background_{};
+  std::array<uint8_t, k_LineBufferSize> shades_{};
+};
+
+extern void PpuModeEvent(GameBoy* gb, const uint64_t k_Late);
+extern void WriteLcdRegister(GameBoy* gb, const uint16_t k_Address,
+                             const uint8_t k_Value);
+extern void WriteTileData(GameBoy* gb, const uint16_t k_Address,
+                          const uint8_t k_Value);
+// Colour indices of tiles plane pairs, 8 pixels per tile, leftmost first.
+// Writes a multiple of 16 bytes so output needs room for that.
+extern void DecodeTileRows(const uint8_t* low, const uint8_t* high,
+                           const size_t k_Tiles, uint8_t* output);
+}  // namespace binary::gb
@@ -0,0 +1,70 @@
+// Purpose: This header file contains the following
+//  * Event scheduler for the Gameboy peripherals
+//
+// Instead of ticking every component after each instruction, a component
+// schedules the cycle its next visible change happens at (the PPU switching
+// mode, the APU's frame sequencer stepping ...). EmulateFor() lets the CPU
+// run uninterrupted until the earliest of those timestamps, then dispatches
+// whatever is due. Handlers usually schedule their own next occurrence.
+//
+// Each event type owns one slot, so scheduling an event that's already
+// pending moves it. There are only a handful of types, keeping the earliest
+// one cached makes NextEvent() free and the rescan on change is a few
+// compares. A component adds its own type when it needs one.
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace binary::gb {
+class GameBoy;
+
+enum class EventType : uint8_t {
+  k_PpuMode,
+  k_ApuFrameSequencer,
+  k_Count
+};
+
+constexpr size_t k_EventCount = static_cast<size_t>(EventType::k_Count);
+// Timestamp of a slot with nothing scheduled
+constexpr uint64_t k_NoEvent = std::numeric_limits<uint64_t>::max();
+
+// k_Late is how many cycles past its timestamp the event got dispatched, an
+// instruction can't be interrupted halfway through
+typedef void (*EventHandler)(GameBoy* gb, const uint64_t k_Late);
+
+class Scheduler {
+ public:
+  inline void SetHandler(const EventType k_Type, EventHandler handler) {
+    handlers_[static_cast<size_t>(k_Type)] = handler;
+  }
+  void Schedule(const EventType k_Type, const uint64_t k_Timestamp);
+  void Cancel(const EventType k_Type);
+  inline bool Pending(const EventType k_Type) const {
+    return timestamps_[static_cast<size_t>(k_Type)] != k_NoEvent;
+  }
+  inline uint64_t Timestamp(const EventType k_Type) const {
+    return timestamps_[static_cast<size_t>(k_Type)];
+  }
+  // Cycle the CPU can run up to, k_NoEvent when nothing is scheduled
+  inline uint64_t NextEvent() const { return next_timestamp_; }
+  // Runs every event due at gb->cycles_, earliest first. Events scheduled by
+  // a handler for the current cycle run in the same call.
+  void Dispatch(GameBoy* gb);
+
+  uint64_t dispatched_{};
+
+ private:
+  void UpdateNext();
+
+  std::array<uint64_t, k_EventCount> timestamps_ = [] {
+    std::array<uint64_t, k_EventCount> timestamps{};
+    timestamps.fill(k_NoEvent);
+    return timestamps;
+  }();
+  std::array<EventHandler, k_EventCount> handlers_{};
+  uint64_t next_timestamp_ = k_NoEvent;
+  EventType next_type_ = EventType::k_Count;
+};
+}  // namespace binary::gb
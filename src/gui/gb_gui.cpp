@@ -29,6 +29,11 @@ void binary::OpenGLGUI::StartGUI() {
   ImGui_ImplSDL2_NewFrame();
   ImGui_ImplOpenGL3_NewFrame();
 }
+
+void binary::SDLRendererGUI::StartGUI() {
+  ImGui_ImplSDLRenderer2_NewFrame();
+  ImGui_ImplSDL2_NewFrame();
+}
  
 void binary::OpenGL::InitIMGUI() {
   ImGui::CreateContext();
@@ -47,9 +52,24 @@ void binary::OpenGL::InitIMGUI() {
     style.WindowRounding = 0.0f;
 
   }
-  auto sdl_gl_context = SDL_GL_CreateContext(sdl_->window_);
-  ImGui_ImplSDL2_InitForOpenGL(sdl_->window_, sdl_gl_context);
-  ImGui_ImplOpenGL3_Init();
+  ImGui_ImplSDL2_InitForOpenGL(sdl_->window_, context_);
+  // Matches the 3.3 core context from OpenGL::Init()
+  ImGui_ImplOpenGL3_Init("#version 330");
+  DefaultImGuiStyle();
+}
+
+void binary::SDLRenderer::InitIMGUI() {
+  ImGui::CreateContext();
+  ImGuiIO& io = ImGui::GetIO();
+  // The SDL_Renderer backend can't draw windows outside the main one, so no
+  // ImGuiConfigFlags_ViewportsEnable here
+  io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+  io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;
+  io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+
+  ImGui::StyleColorsDark();
+  ImGui_ImplSDL2_InitForSDLRenderer(sdl_->window_, sdl_->renderer_);
+  ImGui_ImplSDLRenderer2_Init(sdl_->renderer_);
   DefaultImGuiStyle();
 }
 
@@ -7,6 +7,7 @@ void Start(VulkanViewportInfo* texture) {
                                ImGuiDockNodeFlags_PassthruCentralNode);
   DrawMenuBar(texture);
   Titles(texture); 
+  MemoryStatistics(texture);
 
   ImGui::Render(); 
   if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
@@ -46,12 +47,50 @@ void Titles(VulkanViewportInfo* texture) {
    ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoCollapse | 
                                    !ImGuiWindowFlags_NoDocking;
   if (ImGui::Begin("Screen View", nullptr, window_flags)) {
-    VkDescriptorSet texture_descriptor_set;
+    ImTextureID texture_id = texture->texture_id;
     ImVec2 viewport_panel_size = ImGui::GetContentRegionAvail();
-    texture_descriptor_set = (*texture->texture_descriptor_set);
-    ImGui::Image((ImTextureID)texture_descriptor_set,
+    if (texture->texture_descriptor_set != nullptr) {
+      texture_id = (ImTextureID)(*texture->texture_descriptor_set);
+    }
+    ImGui::Image(texture_id,
                  ImVec2(viewport_panel_size.x, viewport_panel_size.y));
   }
   ImGui::End();
 }
+
+void MemoryStatistics(VulkanViewportInfo* texture) {
+  if (texture->vma_allocator == nullptr) {
+    return;
+  }
+  if (ImGui::Begin("GPU Memory")) {
+    const VkPhysicalDeviceMemoryProperties* memory_properties;
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+    constexpr float k_MiB = 1024.0f * 1024.0f;
+    vmaGetMemoryProperties(*texture->vma_allocator, &memory_properties);
+    vmaGetHeapBudgets(*texture->vma_allocator, budgets);
+    for (uint32_t heap = 0; heap < memory_properties->memoryHeapCount;
+         heap++) {
+      const VmaBudget& budget = budgets[heap];
+      const bool device_local = memory_properties->memoryHeaps[heap].flags &
+                                VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+      ImGui::Text("Heap %u (%s)", heap,
+                  device_local ? "device local" : "host");
+      // Usage against the budget is everything the process allocated in the
+      // heap, VMA's blocks are what the renderer holds of it
+      ImGui::ProgressBar(
+          budget.budget > 0 ? static_cast<float>(budget.usage) / budget.budget
+                            : 0.0f,
+          ImVec2(-1.0f, 0.0f));
+      ImGui::Text("Usage %.1f / %.1f MiB", budget.usage / k_MiB,
+                  budget.budget / k_MiB);
+      ImGui::Text("Blocks %.1f MiB in %u, allocations %.1f MiB in %u",
+                  budget.statistics.blockBytes / k_MiB,
+                  budget.statistics.blockCount,
+                  budget.statistics.allocationBytes / k_MiB,
+                  budget.statistics.allocationCount);
+      ImGui::Separator();
+    }
+  }
+  ImGui::End();
 }
+}
\ No newline at end of file
@@ -8,15 +8,23 @@ binary::VulkanViewport::VulkanViewport(gbVulkanGraphicsHandler vulkan,
   descriptor_pool_(vulkan.descriptor_pool),
   imgui_pool(vulkan.imgui_pool),
   texture_descriptor_set_(VK_NULL_HANDLE),
-  sdl_(sdl){
+  sdl_(sdl),
+  current_frame_(vulkan.current_frame),
+  in_flight_fence_(vulkan.in_flight_fence),
+  uploaders_(vulkan.uploaders),
+  vma_allocator_(vulkan.vma_allocator),
+  staging_pool_(vulkan.staging_pool),
+  pipeline_cache_(vulkan.pipeline_cache),
+  post_processor_(vulkan.post_processor) {
 }
 
 void binary::VulkanViewport::Destroy() {
   vkDeviceWaitIdle(*logical_device_);
+  StopStreaming();
+  SetPostProcessSource(VK_NULL_HANDLE);
   vkDestroySampler(*logical_device_, texture_sampler_, allocator_);
   vkDestroyImageView(*logical_device_, texture_image_view_, allocator_);
-  vkDestroyImage(*logical_device_, texture_image_, allocator_);
-  vkFreeMemory(*logical_device_, texture_image_memory_, allocator_);
+  vmaDestroyImage(*vma_allocator_, texture_image_, texture_image_allocation_);
   ImGui_ImplVulkan_RemoveTexture(texture_descriptor_set_);
 
   texture_descriptor_set_ = VK_NULL_HANDLE;
@@ -24,38 +32,405 @@ void binary::VulkanViewport::Destroy() {
 
 void binary::VulkanViewport::Free() {
   vkDeviceWaitIdle(*logical_device_);
+  StopStreaming();
+  SetPostProcessSource(VK_NULL_HANDLE);
   vkDestroySampler(*logical_device_, texture_sampler_, allocator_);
   vkDestroyImageView(*logical_device_, texture_image_view_, allocator_);
-  vkDestroyImage(*logical_device_, texture_image_, allocator_);
-  vkFreeMemory(*logical_device_, texture_image_memory_, allocator_);
+  vmaDestroyImage(*vma_allocator_, texture_image_, texture_image_allocation_);
   vkFreeDescriptorSets(*logical_device_, *imgui_pool, 1, 
                        &texture_descriptor_set_);
   texture_descriptor_set_ = VK_NULL_HANDLE;
+  // Update() recreates the texture when there's none
+  texture_sampler_ = VK_NULL_HANDLE;
+  texture_image_view_ = VK_NULL_HANDLE;
+  texture_image_ = VK_NULL_HANDLE;
+  texture_image_allocation_ = VK_NULL_HANDLE;
 }
 
 void binary::VulkanViewport::Update(void* array_data) {
-  vkDeviceWaitIdle(*logical_device_);
-  Free();
-  LoadImageFromArray(array_data, array_size_, w_, h_);
+  if (streaming_) {
+    const uint32_t k_Slot = *current_frame_;
+    // The last submission reading this slot is the one DrawFrame() waits for
+    // before recording the frame anyway, so this doesn't stall any longer
+    vkWaitForFences(*logical_device_, 1, &(*in_flight_fence_)[k_Slot],
+                    VK_TRUE, UINT64_MAX);
+    memcpy(staging_mapped_ + k_Slot * array_size_, array_data,
+           static_cast<size_t>(array_size_));
+    pending_slot_ = k_Slot;
+    return;
+  }
+  UploadBatch uploads = CreateUploadBatch();
+  Update(array_data, uploads);
+  uploads.Submit();
+}
+
+void binary::VulkanViewport::Update(void* array_data, UploadBatch& uploads) {
+  if (streaming_) {
+    Update(array_data);
+    return;
+  }
+  if (texture_image_ == VK_NULL_HANDLE) {
+    LoadFromArray(array_data, array_size_, w_, h_, &uploads);
+    return;
+  }
+  // Same size as before, the image, view, sampler and descriptor set stay.
+  // The upload's barrier waits for the frames still sampling the image, so
+  // there's no need to wait for the device here.
+  uploads.UploadImage(texture_image_, w_, h_, array_data, array_size_);
+}
+
+binary::UploadBatch binary::VulkanViewport::CreateUploadBatch() {
+  return UploadBatch(*logical_device_, *command_pool_, *graphics_queue_,
+                     *vma_allocator_, *staging_pool_);
+}
+
+void binary::VulkanViewport::LoadFromPath(const char* file_path,
+                                          UploadBatch* uploads) {
+  // Only submits anything when nobody passed a batch
+  UploadBatch own_uploads = CreateUploadBatch();
+  ViewPortCreateTextureImage(file_path,
+                             uploads != nullptr ? *uploads : own_uploads);
   CreateTextureImageView();
   CreateTextureSampler();
   CreateTextureDescriptorSet();
+  own_uploads.Submit();
 }
 
-void binary::VulkanViewport::LoadFromPath(const char* file_path) {
-  ViewPortCreateTextureImage(file_path);
+void binary::VulkanViewport::LoadFromArray(void* array_data,
+                                             VkDeviceSize array_size,
+                                             uint32_t w, uint32_t h,
+                                             UploadBatch* uploads) {
+  UploadBatch own_uploads = CreateUploadBatch();
+  // Update() reuploads with these
+  w_ = w;
+  h_ = h;
+  array_size_ = array_size;
+  LoadImageFromArray(array_data, array_size, w, h,
+                     uploads != nullptr ? *uploads : own_uploads);
   CreateTextureImageView();
   CreateTextureSampler();
   CreateTextureDescriptorSet();
+  own_uploads.Submit();
 }
 
-void binary::VulkanViewport::LoadFromArray(void* array_data,
-                                             VkDeviceSize array_size,
-                                             uint32_t w, uint32_t h){
-  LoadImageFromArray(array_data, array_size, w, h);
+void binary::VulkanViewport::CreateStreamingStaging(uint32_t w, uint32_t h,
+                                                    uint32_t pixel_size) {
+  void* data;
+  w_ = w;
+  h_ = h;
+  array_size_ = static_cast<VkDeviceSize>(w) * h * pixel_size;
+  // Stays mapped until StopStreaming(), coherent memory needs no flushes
+  CreateBuffer(array_size_ * k_MaxFramesInFlight,
+               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               staging_buffer_, staging_buffer_allocation_, *staging_pool_,
+               &data);
+  staging_mapped_ = static_cast<uint8_t*>(data);
+}
+
+void binary::VulkanViewport::StartStreaming(uint32_t w, uint32_t h) {
+  UploadBatch uploads = CreateUploadBatch();
+  CreateStreamingStaging(w, h, 4);
+  CreateImage(w, h, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_,
+              texture_image_allocation_);
+  // Start out black instead of with whatever the memory held
+  uploads.ClearImage(texture_image_);
+  CreateTextureImageView();
+  CreateTextureSampler();
+  CreateTextureDescriptorSet();
+  uploads.Submit();
+
+  uploaders_->push_back(this);
+  streaming_ = true;
+}
+
+void binary::VulkanViewport::StartIndexedStreaming(uint32_t w, uint32_t h) {
+  void* data;
+  UploadBatch uploads = CreateUploadBatch();
+  CreateStreamingStaging(w, h, 1);
+  // R8_UINT is sampled with texelFetch(), unlike storage support for it
+  // every device has that
+  CreateImage(w, h, VK_FORMAT_R8_UINT, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_image_,
+              index_image_allocation_);
+  index_image_view_ = CreateImageView(index_image_, VK_FORMAT_R8_UINT,
+                                      VK_IMAGE_ASPECT_COLOR_BIT);
+  CreateImage(w, h, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                  VK_IMAGE_USAGE_STORAGE_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_,
+              texture_image_allocation_);
+  uploads.ClearImage(index_image_);
+  uploads.ClearImage(texture_image_);
+
+  CreateBuffer(k_PaletteSize * sizeof(uint32_t),
+               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               palette_buffer_, palette_buffer_allocation_, VK_NULL_HANDLE,
+               &data);
+  palette_mapped_ = static_cast<uint32_t*>(data);
+  memset(palette_mapped_, 0, k_PaletteSize * sizeof(uint32_t));
+
   CreateTextureImageView();
   CreateTextureSampler();
   CreateTextureDescriptorSet();
+  CreateExpandPipeline();
+  uploads.Submit();
+
+  uploaders_->push_back(this);
+  streaming_ = true;
+  indexed_ = true;
+}
+
+void binary::VulkanViewport::SetPalette(
+    std::span<const std::array<uint8_t, 4>> colors) {
+  if (!indexed_) {
+    return;
+  }
+  if (colors.size() > k_PaletteSize) {
+    spdlog::warn("Palette has {} colours, only the first {} are used",
+                 colors.size(), k_PaletteSize);
+    colors = colors.first(k_PaletteSize);
+  }
+  // Rarely called, waiting for every frame in flight beats a palette buffer
+  // per frame
+  vkWaitForFences(*logical_device_,
+                  static_cast<uint32_t>(in_flight_fence_->size()),
+                  in_flight_fence_->data(), VK_TRUE, UINT64_MAX);
+  for (size_t index = 0; index < colors.size(); index++) {
+    // unpackUnorm4x8() takes R from the lowest byte
+    palette_mapped_[index] = static_cast<uint32_t>(colors[index][0]) |
+                             static_cast<uint32_t>(colors[index][1]) << 8 |
+                             static_cast<uint32_t>(colors[index][2]) << 16 |
+                             static_cast<uint32_t>(colors[index][3]) << 24;
+  }
+}
+
+void binary::VulkanViewport::CreateExpandPipeline() {
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+  VkDescriptorSetLayoutCreateInfo set_layout_info{};
+  VkPipelineLayoutCreateInfo pipeline_layout_info{};
+  VkShaderModuleCreateInfo shader_module_info{};
+  VkShaderModule shader_module;
+  VkComputePipelineCreateInfo pipeline_info{};
+  VkDescriptorSetAllocateInfo allocate_info{};
+  VkDescriptorImageInfo index_info{};
+  VkDescriptorBufferInfo palette_info{};
+  VkDescriptorImageInfo frame_info{};
+  std::array<VkWriteDescriptorSet, 3> writes{};
+  VkResult result;
+  const std::vector<char> k_ShaderCode = ReadFile("shaders/comp.spv");
+
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  bindings[2].binding = 2;
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  for (VkDescriptorSetLayoutBinding& binding : bindings) {
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  set_layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+  set_layout_info.pBindings = bindings.data();
+  result = vkCreateDescriptorSetLayout(*logical_device_, &set_layout_info,
+                                       allocator_, &expand_set_layout_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create palette descriptor set layout! {}",
+                     VkResultToString(result));
+    throw std::runtime_error(
+        "Failed to create palette descriptor set layout! " +
+        VkResultToString(result));
+  }
+
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &expand_set_layout_;
+  result = vkCreatePipelineLayout(*logical_device_, &pipeline_layout_info,
+                                  allocator_, &expand_pipeline_layout_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create palette pipeline layout! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create palette pipeline layout! " +
+                             VkResultToString(result));
+  }
+
+  shader_module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shader_module_info.codeSize = k_ShaderCode.size();
+  shader_module_info.pCode =
+      reinterpret_cast<const uint32_t*>(k_ShaderCode.data());
+  result = vkCreateShaderModule(*logical_device_, &shader_module_info,
+                                allocator_, &shader_module);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create shader module: {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create shader module");
+  }
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipeline_info.stage.module = shader_module;
+  pipeline_info.stage.pName = "main";
+  pipeline_info.layout = expand_pipeline_layout_;
+  result = vkCreateComputePipelines(*logical_device_, *pipeline_cache_, 1,
+                                    &pipeline_info, allocator_,
+                                    &expand_pipeline_);
+  vkDestroyShaderModule(*logical_device_, shader_module, allocator_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to create palette pipeline! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to create palette pipeline! " +
+                             VkResultToString(result));
+  }
+
+  allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocate_info.descriptorPool = *imgui_pool;
+  allocate_info.descriptorSetCount = 1;
+  allocate_info.pSetLayouts = &expand_set_layout_;
+  result = vkAllocateDescriptorSets(*logical_device_, &allocate_info,
+                                    &expand_descriptor_set_);
+  if (result != VK_SUCCESS) {
+    spdlog::critical("Failed to allocate palette descriptor set! {}",
+                     VkResultToString(result));
+    throw std::runtime_error("Failed to allocate palette descriptor set! " +
+                             VkResultToString(result));
+  }
+  index_info.imageView = index_image_view_;
+  index_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  palette_info.buffer = palette_buffer_;
+  palette_info.range = VK_WHOLE_SIZE;
+  frame_info.imageView = texture_image_view_;
+  frame_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+  for (size_t index = 0; index < writes.size(); index++) {
+    writes[index].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[index].dstSet = expand_descriptor_set_;
+    writes[index].dstBinding = static_cast<uint32_t>(index);
+    writes[index].descriptorCount = 1;
+    writes[index].descriptorType = bindings[index].descriptorType;
+  }
+  writes[0].pImageInfo = &index_info;
+  writes[1].pBufferInfo = &palette_info;
+  writes[2].pImageInfo = &frame_info;
+  vkUpdateDescriptorSets(*logical_device_,
+                         static_cast<uint32_t>(writes.size()), writes.data(),
+                         0, nullptr);
+}
+
+namespace {
+void ImageBarrier(VkCommandBuffer command_buffer, VkImage image,
+                  VkImageLayout old_layout, VkImageLayout new_layout,
+                  VkAccessFlags source_access,
+                  VkAccessFlags destination_access,
+                  VkPipelineStageFlags source_stage,
+                  VkPipelineStageFlags destination_stage) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcAccessMask = source_access;
+  barrier.dstAccessMask = destination_access;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0,
+                       nullptr, 0, nullptr, 1, &barrier);
+}
+}  // namespace
+
+void binary::VulkanViewport::RecordUploads(VkCommandBuffer command_buffer,
+                                           uint32_t frame) {
+  if (!pending_slot_.has_value()) {
+    return;
+  }
+  VkBufferImageCopy region{};
+  // The staging slot goes to the indices when the shader expands them
+  const VkImage k_Target = indexed_ ? index_image_ : texture_image_;
+  const VkPipelineStageFlags k_Reader =
+      indexed_ ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+               : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+  // There's only the one image, the previous frame may still be reading it
+  ImageBarrier(command_buffer, k_Target,
+               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+               VK_ACCESS_TRANSFER_WRITE_BIT, k_Reader,
+               VK_PIPELINE_STAGE_TRANSFER_BIT);
+  region.bufferOffset = *pending_slot_ * array_size_;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {w_, h_, 1};
+  vkCmdCopyBufferToImage(command_buffer, staging_buffer_, k_Target,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+  ImageBarrier(command_buffer, k_Target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+               VK_PIPELINE_STAGE_TRANSFER_BIT, k_Reader);
+  pending_slot_.reset();
+  if (!indexed_) {
+    return;
+  }
+
+  ImageBarrier(command_buffer, texture_image_,
+               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
+               VK_ACCESS_SHADER_WRITE_BIT,
+               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    expand_pipeline_);
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          expand_pipeline_layout_, 0, 1,
+                          &expand_descriptor_set_, 0, nullptr);
+  // 8x8 workgroups, see shaders/palette.comp
+  vkCmdDispatch(command_buffer, (w_ + 7) / 8, (h_ + 7) / 8, 1);
+  ImageBarrier(command_buffer, texture_image_, VK_IMAGE_LAYOUT_GENERAL,
+               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void binary::VulkanViewport::StopStreaming() {
+  if (!streaming_) {
+    return;
+  }
+  std::erase(*uploaders_, this);
+  vmaDestroyBuffer(*vma_allocator_, staging_buffer_,
+                   staging_buffer_allocation_);
+  staging_mapped_ = nullptr;
+  pending_slot_.reset();
+  streaming_ = false;
+  DestroyIndexed();
+}
+
+void binary::VulkanViewport::DestroyIndexed() {
+  if (!indexed_) {
+    return;
+  }
+  vkFreeDescriptorSets(*logical_device_, *imgui_pool, 1,
+                       &expand_descriptor_set_);
+  vkDestroyPipeline(*logical_device_, expand_pipeline_, allocator_);
+  vkDestroyPipelineLayout(*logical_device_, expand_pipeline_layout_,
+                          allocator_);
+  vkDestroyDescriptorSetLayout(*logical_device_, expand_set_layout_,
+                               allocator_);
+  vmaDestroyBuffer(*vma_allocator_, palette_buffer_,
+                   palette_buffer_allocation_);
+  vkDestroyImageView(*logical_device_, index_image_view_, allocator_);
+  vmaDestroyImage(*vma_allocator_, index_image_, index_image_allocation_);
+  expand_descriptor_set_ = VK_NULL_HANDLE;
+  palette_mapped_ = nullptr;
+  indexed_ = false;
 }
 
 binary::VulkanViewportInfo binary::VulkanViewport::GetViewportInfo() { 
@@ -68,10 +443,18 @@ binary::VulkanViewportInfo binary::VulkanViewport::GetViewportInfo() {
                                              // THIS IS BAD, FIX THIS!    
   viewport_info.texture_sampler = &texture_sampler_; 
   viewport_info.texture_image_view = &texture_image_view_; 
-  viewport_info.texture_image_memory = &texture_image_memory_; 
+  viewport_info.texture_image_allocation = &texture_image_allocation_; 
+  viewport_info.vma_allocator = vma_allocator_;
   viewport_info.texture_image = &texture_image_; 
   viewport_info.array_size = &array_size_;
-  viewport_info.texture_descriptor_set = &texture_descriptor_set_;
+  // The post-processing chain's output when there is one
+  shown_descriptor_set_ = post_processor_ != nullptr
+                              ? post_processor_->PostProcessOutput()
+                              : VK_NULL_HANDLE;
+  if (shown_descriptor_set_ == VK_NULL_HANDLE) {
+    shown_descriptor_set_ = texture_descriptor_set_;
+  }
+  viewport_info.texture_descriptor_set = &shown_descriptor_set_;
   viewport_info.h = h_;
   viewport_info.w = w_;
   return viewport_info; 
@@ -79,110 +462,56 @@ binary::VulkanViewportInfo binary::VulkanViewport::GetViewportInfo() {
 
 binary::VulkanViewport::~VulkanViewport() { Destroy(); }
 
-void binary::VulkanViewport::ViewPortCreateTextureImage(const char* image_path){
+void binary::VulkanViewport::ViewPortCreateTextureImage(const char* image_path,
+                                                        UploadBatch& uploads) {
   sdl_->InitSurfaceFromPath(image_path, File::PNG);
   w_ = sdl_->surface_->w;
   h_ = sdl_->surface_->h;
   array_size_ = sdl_->surface_->format->BytesPerPixel * w_ * h_;
-  LoadImageFromArray(sdl_->surface_->pixels, array_size_, w_, h_);
+  LoadImageFromArray(sdl_->surface_->pixels, array_size_, w_, h_, uploads);
 }
 
 void binary::VulkanViewport::LoadImageFromArray(void* image_data,
                                                VkDeviceSize image_size,
-                                               uint32_t w, uint32_t h) {
-  void* data;
-  VkDeviceMemory staging_buffer_memory;
-  VkBuffer staging_buffer;
-  CreateBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               staging_buffer, staging_buffer_memory);
-
-  // Data is a pointer to VRAM in your graphics card, and if you
-  // don't have a graphics card then it's DDRAM.
-  //
-  // This whole setup is allocating space in whatever memory channel you're
-  // using and puting the image there
-  vkMapMemory(*logical_device_, staging_buffer_memory, 0, image_size, 0, &data);
-
-  // We got the pointer to the memory free for us to use, lets put the surface
-  // pixels where the data address is pointing at
-  memcpy(data, image_data, static_cast<size_t>(image_size));
-  vkUnmapMemory(*logical_device_, staging_buffer_memory);
-
+                                               uint32_t w, uint32_t h,
+                                               UploadBatch& uploads) {
   CreateImage(w, h, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_,
-              texture_image_memory_);
-
-  TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM,
-                        VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  CopyBufferToImage(staging_buffer, texture_image_, w, h);
-
-  TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  vkDestroyBuffer(*logical_device_, staging_buffer, allocator_);
-  vkFreeMemory(*logical_device_, staging_buffer_memory, allocator_);
+              texture_image_allocation_);
+  uploads.UploadImage(texture_image_, w, h, image_data, image_size);
 }
 
 void binary::VulkanViewport::CreateBuffer(VkDeviceSize size,
                                          VkBufferUsageFlags usage,
                                          VkMemoryPropertyFlags properties,
                                          VkBuffer& buffer,
-                                         VkDeviceMemory& buffer_memory) {
+                                         VmaAllocation& buffer_allocation,
+                                         VmaPool pool, void** mapped) {
   VkBufferCreateInfo buffer_info{};
-  VkMemoryRequirements memory_requirements;
-  VkMemoryAllocateInfo allocate_info{};
+  VmaAllocationCreateInfo allocation_info{};
+  VmaAllocationInfo allocated{};
   VkResult result;
-  // Graphic devices have specialized areas in its memory for certain buffers,
-  // for us to store our buffer. We are defineing our buffer then asking
-  // our graphic device, what are the requirements for this buffer.
   buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   buffer_info.size = size;
   buffer_info.usage = usage;
   buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-  result = vkCreateBuffer(*logical_device_, &buffer_info, allocator_, &buffer);
+  // Suballocated from the renderer's VMA blocks, see Vulkan::CreateBuffer
+  allocation_info.requiredFlags = properties;
+  allocation_info.pool = pool;
+  if (mapped != nullptr) {
+    allocation_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  }
+  result = vmaCreateBuffer(*vma_allocator_, &buffer_info, &allocation_info,
+                           &buffer, &buffer_allocation, &allocated);
   if (result != VK_SUCCESS) {
     spdlog::critical("Failed to create buffer! {}", VkResultToString(result));
     throw std::runtime_error("Failed to create buffer" +
                              VkResultToString(result));
   }
-  // We tell the graphic device what our buffer needs and it outputs the memory
-  // requirements for our buffer
-  vkGetBufferMemoryRequirements(*logical_device_, buffer, &memory_requirements);
-
-  // Even though we know what our memory requirements are, we don't know where
-  // to store the buffer in the graphic device. This is where we write the
-  // allocate info
-  allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocate_info.allocationSize = memory_requirements.size;
-  // Graphic devices have memory storage for specialize task, the data is
-  // store in a way for the graphics device to process it easily.
-  // But we don't know if the graphic device has the specialize type of
-  // memory for our buffer, so we pass infomation to this function to find
-  // the memory location.
-  allocate_info.memoryTypeIndex =
-      FindMemoryType(memory_requirements.memoryTypeBits,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-  // Now we pass the infomation to the vulkan function that allocates memory to
-  // the device. However we don't know where the grahpic device stored the data
-  result = vkAllocateMemory(*logical_device_, &allocate_info, allocator_,
-                            &buffer_memory);
-  if (result != VK_SUCCESS) {
-    spdlog::critical("Failed to allocate buffer memory {} ",
-                     VkResultToString(result));
-    throw std::runtime_error("Failed to allocate buffer memory " +
-                             VkResultToString(result));
+  if (mapped != nullptr) {
+    *mapped = allocated.pMappedData;
   }
-
-  // This is where this function comes along and binds our buffer to the memory
-  // location, that way we know where our buffer is in the memory location.
-  vkBindBufferMemory(*logical_device_, buffer, buffer_memory, 0);
 }
 
 void binary::VulkanViewport::CreateImage(uint32_t width, uint32_t height,
@@ -190,11 +519,10 @@ void binary::VulkanViewport::CreateImage(uint32_t width, uint32_t height,
                                         VkImageUsageFlags usage,
                                         VkMemoryPropertyFlags properties,
                                         VkImage& image,
-                                        VkDeviceMemory& image_memory) {
+                                        VmaAllocation& image_allocation) {
   VkResult result;
   VkImageCreateInfo image_info{};
-  VkMemoryRequirements memory_requirements;
-  VkMemoryAllocateInfo allocate_info{};
+  VmaAllocationCreateInfo allocation_info{};
 
   image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   image_info.imageType = VK_IMAGE_TYPE_2D;
@@ -211,113 +539,15 @@ void binary::VulkanViewport::CreateImage(uint32_t width, uint32_t height,
   image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE; 
   image_info.flags = 0; 
 
-  result =
-      vkCreateImage(*logical_device_, &image_info, allocator_, &image);
+  allocation_info.requiredFlags = properties;
+  result = vmaCreateImage(*vma_allocator_, &image_info, &allocation_info,
+                          &image, &image_allocation, nullptr);
 
   if (result != VK_SUCCESS) { 
     spdlog::critical("Failed to create image! {}", VkResultToString(result)); 
     throw std::runtime_error("Failed to create image! " + 
                              VkResultToString(result));
   }
-
-  vkGetImageMemoryRequirements(*logical_device_, image, &memory_requirements);
-
-  allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocate_info.allocationSize = memory_requirements.size;
-  allocate_info.memoryTypeIndex =
-      FindMemoryType(memory_requirements.memoryTypeBits, properties);
-  
-  result = vkAllocateMemory(*logical_device_, &allocate_info, allocator_,
-                            &image_memory);
-  if (result != VK_SUCCESS) {
-    spdlog::critical("Failed to allocate image memory! {}",
-                     VkResultToString(result));
-    throw std::runtime_error("Failed to allocate image memory! " +
-                             VkResultToString(result));
-  }
-  vkBindImageMemory(*logical_device_, image, image_memory, 0);
-}
-
-uint32_t binary::VulkanViewport::FindMemoryType(uint32_t type_filter,
-                                           VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memory_properties;
-  vkGetPhysicalDeviceMemoryProperties(*physical_device_, &memory_properties);
-  for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
-    if ((type_filter & (1 << i)) &&
-        (memory_properties.memoryTypes[i].propertyFlags & properties) ==
-            properties) {
-      return i;
-    }
-  }
-  spdlog::critical("failed to find suitable memory type!");
-  throw std::runtime_error("failed to find suitable memory type!");
-}
-
-void binary::VulkanViewport::TransitionImageLayout(VkImage image,
-                                                  VkFormat format,
-                                                  VkImageLayout old_layout,
-                                                  VkImageLayout new_layout) {
-  VkImageMemoryBarrier barrier{};
-  VkPipelineStageFlags source_stage;
-  VkPipelineStageFlags destination_stage;
-  VkCommandBuffer command_buffer =
-      BeginSingleTimeCommands(*command_pool_, *logical_device_);
-
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER; 
-  barrier.oldLayout = old_layout;
-  barrier.newLayout = new_layout;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; 
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; 
-  barrier.image = image; 
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; 
-  barrier.subresourceRange.baseMipLevel = 0; 
-  barrier.subresourceRange.levelCount = 1; 
-  barrier.subresourceRange.baseArrayLayer = 0; 
-  barrier.subresourceRange.layerCount = 1;
-
-  if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && 
-      new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) { 
-    barrier.srcAccessMask = 0; 
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; 
-
-    source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; 
-    destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT; 
-  } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && 
-             new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) { 
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; 
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT; 
-
-    source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT; 
-    destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT; 
-  } else { 
-    spdlog::warn("Unsupported Layout translation!"); 
-    throw std::invalid_argument("Unsupported Layout translation!"); 
-  }
-  vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, 
-                       nullptr, 0, nullptr, 1, &barrier); 
-  EndSingleTimeCommands(command_buffer, *command_pool_, *logical_device_,
-                        *graphics_queue_);
-
-}
-
-void binary::VulkanViewport::CopyBufferToImage(VkBuffer buffer, VkImage image,
-                                              uint32_t width, uint32_t height) {
-  VkCommandBuffer command_buffer =
-      BeginSingleTimeCommands(*command_pool_, *logical_device_);
-  VkBufferImageCopy region{};
-  region.bufferOffset = 0;
-  region.bufferRowLength = 0;
-  region.bufferImageHeight = 0;
-  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount = 1;
-  region.imageOffset = {0, 0, 0};
-  region.imageExtent = {width, height, 1};
-  vkCmdCopyBufferToImage(command_buffer, buffer, image,
-                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-  EndSingleTimeCommands(command_buffer, *command_pool_, *logical_device_,
-                        *graphics_queue_);
 }
 
 void binary::VulkanViewport::CreateTextureImageView() {
@@ -386,4 +616,11 @@ void binary::VulkanViewport::CreateTextureDescriptorSet() {
   texture_descriptor_set_ =
       ImGui_ImplVulkan_AddTexture(texture_sampler_, texture_image_view_,
                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  SetPostProcessSource(texture_image_view_);
+}
+
+void binary::VulkanViewport::SetPostProcessSource(VkImageView view) {
+  if (post_processor_ != nullptr) {
+    post_processor_->SetPostProcessSource(view, {w_, h_});
+  }
 }
\ No newline at end of file
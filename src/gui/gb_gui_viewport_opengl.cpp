@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "include/gb_gui.h"
+namespace {
+// Only a GPU that's hung takes this long, it's logged and waited for again
+constexpr GLuint64 k_FenceTimeout = 1'000'000'000;
+}  // namespace
+
+binary::OpenGLViewport::OpenGLViewport(const gbOpenGLFunctions* gl, SDL* sdl)
+    : gl_(gl), sdl_(sdl) {}
+
+binary::OpenGLViewport::~OpenGLViewport() { Free(); }
+
+void binary::OpenGLViewport::Free() {
+  StopStreaming();
+  glDeleteTextures(1, &texture_);
+  texture_ = 0;
+}
+
+void binary::OpenGLViewport::Update(void* array_data) {
+  if (!streaming_) {
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w_, h_, GL_RGBA, GL_UNSIGNED_BYTE,
+                    array_data);
+    return;
+  }
+  const size_t k_Slot = next_slot_;
+  const size_t k_Offset = k_Slot * slot_size_;
+  uint8_t* pixels;
+  next_slot_ = (next_slot_ + 1) % k_PixelBufferSlots;
+  WaitForSlot(k_Slot);
+  gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer_);
+  if (pixel_buffer_mapped_ != nullptr) {
+    pixels = pixel_buffer_mapped_ + k_Offset;
+  } else {
+    // The fence already says the GPU is done with the slot
+    pixels = static_cast<uint8_t*>(gl_->map_buffer_range(
+        GL_PIXEL_UNPACK_BUFFER, k_Offset, slot_size_,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT));
+    if (pixels == nullptr) {
+      spdlog::error("Failed to map pixel buffer slot {}", k_Slot);
+      gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return;
+    }
+  }
+  const uint8_t* k_Indices = static_cast<const uint8_t*>(array_data);
+  for (size_t pixel = 0; pixel < static_cast<size_t>(w_) * h_; pixel++) {
+    std::memcpy(pixels + pixel * 4, palette_[k_Indices[pixel]].data(), 4);
+  }
+  if (pixel_buffer_mapped_ == nullptr) {
+    gl_->unmap_buffer(GL_PIXEL_UNPACK_BUFFER);
+  }
+  // With a buffer bound the last argument is an offset into it and the copy
+  // happens whenever the GPU gets to it
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w_, h_, GL_RGBA, GL_UNSIGNED_BYTE,
+                  reinterpret_cast<const void*>(k_Offset));
+  slot_fences_[k_Slot] = gl_->fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void binary::OpenGLViewport::StartIndexedStreaming(uint32_t w, uint32_t h) {
+  const std::vector<uint8_t> k_Black(static_cast<size_t>(w) * h * 4);
+  // Stops a stream that's already running along with the old texture
+  CreateTexture(w, h, k_Black.data());
+  slot_size_ = static_cast<size_t>(w) * h * 4;
+  next_slot_ = 0;
+  gl_->gen_buffers(1, &pixel_buffer_);
+  gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer_);
+  if (gl_->buffer_storage != nullptr) {
+    // Coherent, so the writes are visible to every later glTexSubImage2D()
+    // without flushing
+    constexpr GLbitfield k_Flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    gl_->buffer_storage(GL_PIXEL_UNPACK_BUFFER,
+                        slot_size_ * k_PixelBufferSlots, nullptr, k_Flags);
+    pixel_buffer_mapped_ = static_cast<uint8_t*>(gl_->map_buffer_range(
+        GL_PIXEL_UNPACK_BUFFER, 0, slot_size_ * k_PixelBufferSlots, k_Flags));
+    if (pixel_buffer_mapped_ == nullptr) {
+      spdlog::critical("Failed to map the pixel buffer persistently");
+      gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      gl_->delete_buffers(1, &pixel_buffer_);
+      pixel_buffer_ = 0;
+      throw std::runtime_error("failed to map the pixel buffer persistently");
+    }
+  } else {
+    gl_->buffer_data(GL_PIXEL_UNPACK_BUFFER, slot_size_ * k_PixelBufferSlots,
+                     nullptr, GL_STREAM_DRAW);
+  }
+  gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  streaming_ = true;
+}
+
+void binary::OpenGLViewport::SetPalette(
+    std::span<const std::array<uint8_t, 4>> colors) {
+  if (!streaming_) {
+    return;
+  }
+  if (colors.size() > k_PaletteSize) {
+    spdlog::warn("Palette has {} colours, only the first {} are used",
+                 colors.size(), k_PaletteSize);
+    colors = colors.first(k_PaletteSize);
+  }
+  // Frames already in the ring keep the colours they were written with
+  std::copy(colors.begin(), colors.end(), palette_.begin());
+}
+
+void binary::OpenGLViewport::LoadFromPath(const char* file_path) {
+  sdl_->InitSurfaceFromPath(file_path, File::PNG);
+  if (sdl_->surface_ == nullptr) {
+    return;
+  }
+  LoadFromArray(sdl_->surface_->pixels, sdl_->surface_->w, sdl_->surface_->h);
+}
+
+void binary::OpenGLViewport::LoadFromArray(void* array_data, uint32_t w,
+                                           uint32_t h) {
+  CreateTexture(w, h, array_data);
+}
+
+binary::VulkanViewportInfo binary::OpenGLViewport::GetViewportInfo() {
+  if (texture_ == 0) {
+    spdlog::critical("No texture has been loaded in OpenGL viewport!");
+    throw std::runtime_error("No texture has been loaded in OpenGL viewport!");
+  }
+  binary::VulkanViewportInfo viewport_info{};
+  viewport_info.texture_id = (ImTextureID)(intptr_t)texture_;
+  viewport_info.w = w_;
+  viewport_info.h = h_;
+  return viewport_info;
+}
+
+void binary::OpenGLViewport::CreateTexture(uint32_t w, uint32_t h,
+                                           const void* pixels) {
+  // Replaces the texture and any stream a viewport that's already loaded
+  // has, instead of leaking them
+  Free();
+  w_ = w;
+  h_ = h;
+  glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               pixels);
+}
+
+void binary::OpenGLViewport::WaitForSlot(size_t k_Slot) {
+  GLenum result;
+  if (slot_fences_[k_Slot] == nullptr) {
+    return;
+  }
+  do {
+    result = gl_->client_wait_sync(slot_fences_[k_Slot],
+                                   GL_SYNC_FLUSH_COMMANDS_BIT, k_FenceTimeout);
+    if (result == GL_TIMEOUT_EXPIRED) {
+      spdlog::warn("Pixel buffer slot {} is still being copied", k_Slot);
+    }
+  } while (result == GL_TIMEOUT_EXPIRED);
+  if (result == GL_WAIT_FAILED) {
+    spdlog::error("Waiting for pixel buffer slot {} failed", k_Slot);
+  }
+  gl_->delete_sync(slot_fences_[k_Slot]);
+  slot_fences_[k_Slot] = nullptr;
+}
+
+void binary::OpenGLViewport::StopStreaming() {
+  if (!streaming_) {
+    return;
+  }
+  for (size_t slot = 0; slot < k_PixelBufferSlots; slot++) {
+    WaitForSlot(slot);
+  }
+  if (pixel_buffer_mapped_ != nullptr) {
+    gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer_);
+    gl_->unmap_buffer(GL_PIXEL_UNPACK_BUFFER);
+    gl_->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    pixel_buffer_mapped_ = nullptr;
+  }
+  gl_->delete_buffers(1, &pixel_buffer_);
+  pixel_buffer_ = 0;
+  streaming_ = false;
+}
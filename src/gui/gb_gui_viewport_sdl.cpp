@@ -0,0 +1,128 @@
+#include <algorithm>
+#include "include/gb_gui.h"
+
+binary::SDLViewport::SDLViewport(SDL* sdl) : sdl_(sdl) {}
+
+binary::SDLViewport::~SDLViewport() { Free(); }
+
+void binary::SDLViewport::Free() {
+  if (texture_ != nullptr) {
+    SDL_DestroyTexture(texture_);
+  }
+  texture_ = nullptr;
+  streaming_ = false;
+  scale_ = 1;
+}
+
+void binary::SDLViewport::Update(void* array_data) {
+  void* pixels;
+  int pitch;
+  if (!streaming_) {
+    SDL_UpdateTexture(texture_, nullptr, array_data, w_ * 4);
+    return;
+  }
+  // Follows the window, recreating the texture is rare next to the frames
+  if (FitScale() != scale_) {
+    scale_ = FitScale();
+    CreateStreamingTexture();
+  }
+  if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch) != 0) {
+    spdlog::error("Failed to lock the streaming texture: {}", SDL_GetError());
+    return;
+  }
+  ScaleIndexed(static_cast<const uint8_t*>(array_data), w_, h_, palette_,
+               scale_, static_cast<uint8_t*>(pixels),
+               static_cast<size_t>(pitch));
+  SDL_UnlockTexture(texture_);
+}
+
+void binary::SDLViewport::StartIndexedStreaming(uint32_t w, uint32_t h) {
+  void* pixels;
+  int pitch;
+  w_ = w;
+  h_ = h;
+  scale_ = FitScale();
+  CreateStreamingTexture();
+  streaming_ = true;
+  // Black until the first frame, the texture's contents are undefined
+  if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch) == 0) {
+    const uint32_t k_Black = PackColor({0x00, 0x00, 0x00, 0xFF});
+    for (uint32_t row = 0; row < h_ * scale_; row++) {
+      uint32_t* line = reinterpret_cast<uint32_t*>(
+          static_cast<uint8_t*>(pixels) + static_cast<size_t>(row) * pitch);
+      std::fill_n(line, w_ * scale_, k_Black);
+    }
+    SDL_UnlockTexture(texture_);
+  }
+}
+
+void binary::SDLViewport::SetPalette(
+    std::span<const std::array<uint8_t, 4>> colors) {
+  if (!streaming_) {
+    return;
+  }
+  if (colors.size() > palette_.size()) {
+    spdlog::warn("Palette has {} colours, only the first {} are used",
+                 colors.size(), palette_.size());
+    colors = colors.first(palette_.size());
+  }
+  for (size_t index = 0; index < colors.size(); index++) {
+    palette_[index] = PackColor(colors[index]);
+  }
+}
+
+void binary::SDLViewport::LoadFromPath(const char* file_path) {
+  sdl_->InitSurfaceFromPath(file_path, File::PNG);
+  if (sdl_->surface_ == nullptr) {
+    return;
+  }
+  w_ = sdl_->surface_->w;
+  h_ = sdl_->surface_->h;
+  texture_ = SDL_CreateTexture(sdl_->renderer_, SDL_PIXELFORMAT_RGBA32,
+                               SDL_TEXTUREACCESS_STATIC, w_, h_);
+  if (texture_ == nullptr) {
+    spdlog::critical("Failed to create texture for {}: {}", file_path,
+                     SDL_GetError());
+    throw std::runtime_error(std::string("failed to create texture for ") +
+                             file_path);
+  }
+  SDL_UpdateTexture(texture_, nullptr, sdl_->surface_->pixels,
+                    sdl_->surface_->pitch);
+}
+
+binary::VulkanViewportInfo binary::SDLViewport::GetViewportInfo() {
+  if (texture_ == nullptr) {
+    spdlog::critical("No texture has been loaded in SDL viewport!");
+    throw std::runtime_error("No texture has been loaded in SDL viewport!");
+  }
+  binary::VulkanViewportInfo viewport_info{};
+  viewport_info.texture_id = (ImTextureID)(intptr_t)texture_;
+  viewport_info.w = w_ * scale_;
+  viewport_info.h = h_ * scale_;
+  return viewport_info;
+}
+
+uint32_t binary::SDLViewport::FitScale() const {
+  int output_w = 0;
+  int output_h = 0;
+  SDL_GetRendererOutputSize(sdl_->renderer_, &output_w, &output_h);
+  const uint32_t k_Fit = std::min(static_cast<uint32_t>(output_w) / w_,
+                                  static_cast<uint32_t>(output_h) / h_);
+  return std::clamp(k_Fit, 1u, k_MaxScale);
+}
+
+void binary::SDLViewport::CreateStreamingTexture() {
+  if (texture_ != nullptr) {
+    SDL_DestroyTexture(texture_);
+  }
+  texture_ = SDL_CreateTexture(sdl_->renderer_, SDL_PIXELFORMAT_RGBA32,
+                               SDL_TEXTUREACCESS_STREAMING, w_ * scale_,
+                               h_ * scale_);
+  if (texture_ == nullptr) {
+    spdlog::critical("Failed to create the streaming texture: {}",
+                     SDL_GetError());
+    throw std::runtime_error("failed to create the streaming texture");
+  }
+  // Whatever scaling is left to the renderer stays sharp
+  SDL_SetTextureScaleMode(texture_, SDL_ScaleModeNearest);
+}
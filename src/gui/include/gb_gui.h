@@ -1,5 +1,9 @@
+#include <array>
+#include <span>
 #include "../../drivers/include/renderer_vulkan.h"
 #include "../../drivers/include/renderer_opengl.h"
+#include "../../drivers/include/renderer_sdl.h"
+#include "../../drivers/include/pixel_scaler.h"
 #include "../../drivers/include/peripherals_sdl.h"
 #include "../../io/include/io.h"
 namespace binary {
@@ -7,12 +11,17 @@ typedef struct VulkanViewportInfo {
   uint32_t* mips_levels{};
   VkSampler* texture_sampler{};
   VkImageView* texture_image_view{};
-  VkDeviceMemory* texture_image_memory{};
+  VmaAllocation* texture_image_allocation{};
   VkImage* texture_image{};
   VkDeviceSize* array_size{};
   VkDescriptorSet* texture_descriptor_set{};
   uint32_t w{};
   uint32_t h{};
+  // For the memory statistics in the debug UI
+  VmaAllocator* vma_allocator{};
+  // Viewports of the other renderers only fill this in, ImGui::Image() takes
+  // it instead of the descriptor set
+  ImTextureID texture_id{};
 } VulkanViewportInfo; 
 
 class GUI {
@@ -27,25 +36,65 @@ class VulkanGUI : public GUI {
 class OpenGLGUI : public GUI {
   void StartGUI();
 };
+
+class SDLRendererGUI : public GUI {
+  void StartGUI();
+};
 extern void DefaultImGuiStyle();
 
-class VulkanViewport {
+// The texture the emulator's screen is drawn into, whatever renders it
+class Viewport {
+ public:
+  virtual ~Viewport() = default;
+  virtual void Free() = 0;
+  // A whole frame in the texture's format, see StartIndexedStreaming()
+  virtual void Update(void* array_data) = 0;
+  virtual void StartIndexedStreaming(uint32_t w, uint32_t h) = 0;
+  virtual void SetPalette(std::span<const std::array<uint8_t, 4>> colors) = 0;
+  virtual VulkanViewportInfo GetViewportInfo() = 0;
+};
+
+class VulkanViewport : public VulkanUploader, public Viewport {
  public:
   VulkanViewport(gbVulkanGraphicsHandler vulkan, SDL* sdl);
   ~VulkanViewport(); 
   void Destroy();
-  void Free();
-  void Update(void* array_data);
-  void LoadFromPath(const char* file_path);
+  void Free() override;
+  // Outside of streaming mode this reuploads the whole texture and submits
+  // it straight away
+  void Update(void* array_data) override;
+  // Same as Update() outside of streaming mode, the copy into the existing
+  // image is only recorded into uploads and can't be seen before
+  // uploads.Submit()
+  void Update(void* array_data, UploadBatch& uploads);
+  // Streaming mode for textures that change every frame. The image, view,
+  // sampler and descriptor set are created once, Update() only copies into
+  // a persistently mapped staging slot for the frame being recorded and the
+  // copy to the image is recorded into that frame's command buffer.
+  void StartStreaming(uint32_t w, uint32_t h);
+  // Streaming mode for palette based frames. Update() takes one byte per
+  // pixel, an index into the palette from SetPalette(), so only a quarter of
+  // the RGBA data goes to the GPU. A compute shader expands the indices into
+  // the RGBA texture in the same command buffer, before the GUI samples it.
+  void StartIndexedStreaming(uint32_t w, uint32_t h) override;
+  // Up to k_PaletteSize RGBA colours, used from the next Update() on
+  void SetPalette(std::span<const std::array<uint8_t, 4>> colors) override;
+  void RecordUploads(VkCommandBuffer command_buffer, uint32_t frame) override;
+  // With uploads the texture is only recorded into it and can't be drawn
+  // before uploads->Submit(), that way several textures share one submit.
+  // Without it they're submitted straight away.
+  void LoadFromPath(const char* file_path, UploadBatch* uploads = nullptr);
   void LoadFromArray(void* array_data, VkDeviceSize array_size, uint32_t w,
-                     uint32_t h);
-  VulkanViewportInfo GetViewportInfo();
+                     uint32_t h, UploadBatch* uploads = nullptr);
+  // A batch on the same device, queue and staging pool as this viewport
+  UploadBatch CreateUploadBatch();
+  VulkanViewportInfo GetViewportInfo() override;
  private:
   VkDescriptorSet texture_descriptor_set_;
   uint32_t mips_levels_{};
   VkSampler texture_sampler_{}; 
   VkImageView texture_image_view_{};
-  VkDeviceMemory texture_image_memory_{};
+  VmaAllocation texture_image_allocation_{};
   VkImage texture_image_{};
   VkDeviceSize array_size_{};
   uint32_t w_{};
@@ -64,8 +113,47 @@ class VulkanViewport {
   // Pointer to the SDL class
   SDL* sdl_;
 
+  // Streaming mode, one staging slot of array_size_ per frame in flight
+  bool streaming_ = false;
+  VkBuffer staging_buffer_{};
+  VmaAllocation staging_buffer_allocation_{};
+  uint8_t* staging_mapped_{};
+  // Slot written by the last Update() that isn't recorded yet
+  std::optional<uint32_t> pending_slot_{};
+  uint32_t* current_frame_;
+  std::vector<VkFence>* in_flight_fence_;
+  std::vector<VulkanUploader*>* uploaders_;
+  VmaAllocator* vma_allocator_;
+  VmaPool* staging_pool_;
+  VkPipelineCache* pipeline_cache_;
+  // Runs binary_config.yaml's post-processing on texture_image_, ImGui
+  // shows its output through shown_descriptor_set_ when it has one
+  VulkanPostProcessor* post_processor_;
+  VkDescriptorSet shown_descriptor_set_{};
+  void SetPostProcessSource(VkImageView view);
+  void CreateStreamingStaging(uint32_t w, uint32_t h, uint32_t pixel_size);
+  void StopStreaming();
+
+  // Indexed streaming mode, the staging slots go to index_image_ and the
+  // palette expansion writes texture_image_
+  static constexpr size_t k_PaletteSize = 256;
+  bool indexed_ = false;
+  VkImage index_image_{};
+  VmaAllocation index_image_allocation_{};
+  VkImageView index_image_view_{};
+  VkBuffer palette_buffer_{};
+  VmaAllocation palette_buffer_allocation_{};
+  uint32_t* palette_mapped_{};
+  VkDescriptorSetLayout expand_set_layout_{};
+  VkPipelineLayout expand_pipeline_layout_{};
+  VkPipeline expand_pipeline_{};
+  VkDescriptorSet expand_descriptor_set_{};
+  void CreateExpandPipeline();
+  void DestroyIndexed();
+
   // Texture Function
-  void ViewPortCreateTextureImage(const char* image_path);
+  void ViewPortCreateTextureImage(const char* image_path,
+                                  UploadBatch& uploads);
   //void CreateTextureImageView();
   //void ViewPortCreateTextureSampler();
   //void ViewPortCreateTextureDescriptorSet();
@@ -74,22 +162,16 @@ class VulkanViewport {
 
   // These functions are direct copies of Vulkan's memeber functions
   void LoadImageFromArray(void* image_data, VkDeviceSize image_size, uint32_t w,
-                          uint32_t h);
+                          uint32_t h, UploadBatch& uploads);
   void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                     VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                    VkDeviceMemory& buffer_memory);
+                    VmaAllocation& buffer_allocation,
+                    VmaPool pool = VK_NULL_HANDLE, void** mapped = nullptr);
 
   void CreateImage(uint32_t width, uint32_t height, VkFormat format,
                    VkImageTiling tiling, VkImageUsageFlags usage,
                    VkMemoryPropertyFlags properties, VkImage& image,
-                   VkDeviceMemory& image_memory);
-  uint32_t FindMemoryType(uint32_t type_filter,
-                          VkMemoryPropertyFlags properties); 
-  void TransitionImageLayout(VkImage image, VkFormat format,
-                             VkImageLayout old_layout, 
-                             VkImageLayout new_layout);
-  void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
-                         uint32_t height);
+                   VmaAllocation& image_allocation);
   void CreateTextureImageView();
   void CreateImageViews();
   void CreateTextureSampler();
@@ -98,11 +180,95 @@ class VulkanViewport {
                        VkImageAspectFlags aspect_flag);
   void CreateTextureDescriptorSet();
 };
+
+// OpenGL's viewport. Streaming frames go through a ring of pixel buffer
+// slots, Update() writes the next slot and glTexSubImage2D() copies it to the
+// texture on the GPU's time. A fence after each copy tells when the slot can
+// be written again, with k_PixelBufferSlots of them Update() practically never
+// waits. With ARB_buffer_storage the buffer stays mapped the whole time.
+class OpenGLViewport : public Viewport {
+ public:
+  OpenGLViewport(const gbOpenGLFunctions* gl, SDL* sdl);
+  ~OpenGLViewport();
+  void Free() override;
+  // Outside of streaming mode this uploads straight from array_data
+  void Update(void* array_data) override;
+  // Update() takes one palette index per pixel. There's no shader of our own
+  // on this path, the indices are expanded while they're written into the
+  // mapped slot, which is the only pass over the frame on the CPU anyway.
+  void StartIndexedStreaming(uint32_t w, uint32_t h) override;
+  // Up to k_PaletteSize RGBA colours, used from the next Update() on
+  void SetPalette(std::span<const std::array<uint8_t, 4>> colors) override;
+  // RGBA8 like VulkanViewport's
+  void LoadFromPath(const char* file_path);
+  void LoadFromArray(void* array_data, uint32_t w, uint32_t h);
+  VulkanViewportInfo GetViewportInfo() override;
+  GLuint GetTexture() const { return texture_; }
+
+ private:
+  static constexpr size_t k_PaletteSize = 256;
+  static constexpr size_t k_PixelBufferSlots = 3;
+  void CreateTexture(uint32_t w, uint32_t h, const void* pixels);
+  // Waits for the last copy out of k_Slot
+  void WaitForSlot(size_t k_Slot);
+  void StopStreaming();
+
+  const gbOpenGLFunctions* gl_;
+  SDL* sdl_;
+  GLuint texture_{};
+  uint32_t w_{};
+  uint32_t h_{};
+
+  bool streaming_ = false;
+  GLuint pixel_buffer_{};
+  size_t slot_size_{};
+  size_t next_slot_{};
+  std::array<GLsync, k_PixelBufferSlots> slot_fences_{};
+  // The whole ring, nullptr without ARB_buffer_storage
+  uint8_t* pixel_buffer_mapped_{};
+  std::array<std::array<uint8_t, 4>, k_PaletteSize> palette_{};
+};
+
+// SDLRenderer's viewport, an SDL streaming texture. In indexed streaming mode
+// the frame is expanded and scaled by the largest whole factor up to
+// k_MaxScale that fits the window with ScaleIndexed(), straight into the
+// locked texture. The renderer then only copies pixels 1:1 or close to it,
+// which is the cheap case for SDL's software renderer.
+class SDLViewport : public Viewport {
+ public:
+  SDLViewport(SDL* sdl);
+  ~SDLViewport();
+  void Free() override;
+  // Outside of streaming mode this uploads straight from array_data
+  void Update(void* array_data) override;
+  void StartIndexedStreaming(uint32_t w, uint32_t h) override;
+  // Up to 256 RGBA colours, used from the next Update() on
+  void SetPalette(std::span<const std::array<uint8_t, 4>> colors) override;
+  // RGBA8 like VulkanViewport's
+  void LoadFromPath(const char* file_path);
+  VulkanViewportInfo GetViewportInfo() override;
+
+ private:
+  // The scale the window fits right now
+  uint32_t FitScale() const;
+  void CreateStreamingTexture();
+
+  SDL* sdl_;
+  SDL_Texture* texture_{};
+  // Source size, the streaming texture is scale_ times that
+  uint32_t w_{};
+  uint32_t h_{};
+  bool streaming_ = false;
+  uint32_t scale_ = 1;
+  PixelPalette palette_{};
+};
 }  // namespace binary
 
 namespace binary::gui::mainmenu {
 extern void Start(VulkanViewportInfo* texture);
 extern void DrawMenuBar(VulkanViewportInfo* texture);
 extern void Titles(VulkanViewportInfo* texture);
+// VMA's budget and usage per memory heap
+extern void MemoryStatistics(VulkanViewportInfo* texture);
 }
 
@@ -58,9 +58,38 @@ Result LoadMainConfig(const std::string& file_path, Application* app) {
 
   if (graphics_api.compare("Vulkan") == 0){
     app->renderer = k_Vulkan;
-  } else { // If it's not Vulkan then it must be OpenGL
+  } else if (graphics_api.compare("SDL") == 0) {
+    app->renderer = k_SDL;
+  } else { // If it's not Vulkan or SDL then it must be OpenGL
     app->renderer = k_OpenGL;
   }
+
+  // Present mode, optional, FIFO is the one every driver has
+  std::string present_mode =
+      config["graphic_api"]["present_mode"].as<std::string>("FIFO");
+  if (present_mode.compare("MAILBOX") == 0) {
+    app->present_mode = k_PresentMailbox;
+  } else if (present_mode.compare("IMMEDIATE") == 0) {
+    app->present_mode = k_PresentImmediate;
+  } else {
+    if (present_mode.compare("FIFO") != 0) {
+      spdlog::warn("Unknown present mode {}, using FIFO", present_mode);
+    }
+    app->present_mode = k_PresentFifo;
+  }
+
+  // Frame pacing, optional
+  app->frame_rate = config["frame_pacing"]["frame_rate"].as<uint32_t>(0);
+
+  // Post-processing, optional
+  for (const YAML::Node& pass : config["post_processing"]) {
+    PostProcessPass post_process_pass{};
+    post_process_pass.shader = pass["shader"].as<std::string>();
+    if (pass["strength"]) {
+      post_process_pass.strength = pass["strength"].as<float>();
+    }
+    app->post_processing.push_back(post_process_pass);
+  }
   return k_Success;
 }
 
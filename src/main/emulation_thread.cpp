@@ -0,0 +1,88 @@
+#include "include/emulation_thread.h"
+#include <chrono>
+#include "spdlog/spdlog.h"
+
+namespace {
+// One LCD frame, 154 lines of 114 machine cycles
+constexpr uint64_t k_FrameCycles =
+    binary::gb::k_ScanlineCycles * binary::gb::k_LinesPerFrame;
+constexpr double k_MachineCyclesPerSecond = binary::gb::k_ClockRate / 4.0;
+// Falling further behind than this (a breakpoint, the window being dragged
+// on some platforms ...) restarts the pacing instead of fast forwarding to
+// catch up
+constexpr std::chrono::milliseconds k_MaxLag{100};
+}  // namespace
+
+binary::EmulationThread::EmulationThread(AudioSDL* audio) : audio_(audio) {}
+
+binary::EmulationThread::~EmulationThread() { Stop(); }
+
+void binary::EmulationThread::Start(const std::vector<char>& rom) {
+  Stop();
+  gb_ = std::make_unique<gb::GameBoy>();
+  if (!rom.empty()) {
+    gb_->bus_.LoadCartridge(reinterpret_cast<const uint8_t*>(rom.data()),
+                            rom.size());
+  }
+  if (audio_ != nullptr && audio_->SampleRate() != 0) {
+    gb_->apu_.SetSampleRate(static_cast<uint32_t>(audio_->SampleRate()));
+  }
+  thread_ = std::jthread([this](std::stop_token stop) { Run(stop); });
+}
+
+void binary::EmulationThread::Stop() {
+  if (!thread_.joinable()) return;
+  thread_.request_stop();
+  thread_.join();
+}
+
+binary::EmulationThread::Frame* binary::EmulationThread::NewFrame() {
+  return frames_.Acquire() ? &frames_.Front() : nullptr;
+}
+
+void binary::EmulationThread::Run(std::stop_token stop) {
+  using Clock = std::chrono::steady_clock;
+  spdlog::info("Emulation thread started");
+  Clock::time_point deadline = Clock::now();
+  uint64_t frames = gb_->ppu_.frames_;
+  while (!stop.stop_requested()) {
+    gb::EmulateFor(gb_.get(), k_FrameCycles);
+    // With the LCD off no frame comes out, there's nothing new to show
+    if (gb_->ppu_.frames_ != frames) {
+      frames = gb_->ppu_.frames_;
+      frames_.Back() = gb_->ppu_.indexed_framebuffer_;
+      frames_.Publish();
+    }
+    PushAudio();
+
+    const float k_Speed = speed_.load(std::memory_order_relaxed);
+    if (k_Speed <= 0.0f) {
+      deadline = Clock::now();
+      continue;
+    }
+    deadline += std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(k_FrameCycles /
+                                      k_MachineCyclesPerSecond / k_Speed));
+    const Clock::time_point k_Now = Clock::now();
+    if (k_Now > deadline + k_MaxLag) {
+      deadline = k_Now;
+    }
+    std::this_thread::sleep_until(deadline);
+  }
+  spdlog::info("Emulation thread stopped");
+}
+
+void binary::EmulationThread::PushAudio() {
+  gb::Apu& apu = gb_->apu_;
+  if (audio_ == nullptr || audio_->SampleRate() == 0) {
+    apu.EndFrame(gb_.get());
+    apu.ReadSamples(nullptr, apu.AvailableSamples());
+    return;
+  }
+  apu.EndFrame(gb_.get());
+  // Right after EndFrame() so the whole next frame is at the new ratio
+  apu.SetRateRatio(audio_->RateRatio());
+  const size_t k_Frames = apu.ReadSamples(samples_.data(), samples_.size() / 2);
+  // Past real time the ring overflows, whatever doesn't fit is dropped
+  audio_->Push(samples_.data(), k_Frames);
+}
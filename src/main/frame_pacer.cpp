@@ -0,0 +1,88 @@
+#include "include/frame_pacer.h"
+#include <algorithm>
+#include <thread>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace {
+using namespace std::chrono_literals;
+// Spinning at least this long covers the wake up itself
+constexpr binary::FramePacer::Clock::duration k_MinSpinMargin = 200us;
+constexpr binary::FramePacer::Clock::duration k_InitialSpinMargin = 2ms;
+}  // namespace
+
+binary::FramePacer::FramePacer(double frame_rate)
+    : deadline_(Clock::now()), spin_margin_(k_InitialSpinMargin) {
+#ifdef _WIN32
+  timer_ = CreateWaitableTimerExW(nullptr, nullptr,
+                                  CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                  TIMER_ALL_ACCESS);
+#endif
+  SetFrameRate(frame_rate);
+}
+
+binary::FramePacer::~FramePacer() {
+#ifdef _WIN32
+  if (timer_ != nullptr) {
+    CloseHandle(timer_);
+  }
+#endif
+}
+
+void binary::FramePacer::SetFrameRate(double frame_rate) {
+  if (frame_rate <= 0.0) {
+    frame_rate = k_FallbackFrameRate;
+  }
+  period_ = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / frame_rate));
+}
+
+void binary::FramePacer::Wait() {
+  const Clock::time_point k_Wake = deadline_ - spin_margin_;
+  if (Clock::now() < k_Wake) {
+    SleepUntil(k_Wake);
+    // Grows as soon as a sleep wakes up late and shrinks slowly, one lucky
+    // wake up shouldn't make the next frame miss
+    const Clock::duration k_Late = Clock::now() - k_Wake;
+    // Above 5000 fps the period is shorter than the minimum margin, clamp
+    // needs its bounds in order
+    spin_margin_ =
+        std::clamp(std::max(k_Late + k_MinSpinMargin,
+                            spin_margin_ - spin_margin_ / 16),
+                   k_MinSpinMargin, std::max(period_, k_MinSpinMargin));
+  }
+  while (Clock::now() < deadline_) {
+    std::this_thread::yield();
+  }
+  deadline_ += period_;
+  const Clock::time_point k_Now = Clock::now();
+  if (k_Now > deadline_) {
+    deadline_ = k_Now + period_;
+  }
+}
+
+void binary::FramePacer::SleepUntil(Clock::time_point time) {
+#ifdef _WIN32
+  if (timer_ != nullptr) {
+    LARGE_INTEGER due{};
+    // Negative is relative to now, in 100 ns steps
+    due.QuadPart = -std::max<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time -
+                                                             Clock::now())
+                .count() /
+            100,
+        0);
+    if (SetWaitableTimerEx(timer_, &due, 0, nullptr, nullptr, nullptr, 0)) {
+      WaitForSingleObject(timer_, INFINITE);
+      return;
+    }
+  }
+#endif
+  std::this_thread::sleep_until(time);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../../drivers/include/audio_sdl.h"
+#include "../../emulation/gameboy/include/gb_emulator.h"
+#include "../../types/include/triple_buffer.h"
+namespace binary {
+// Runs the emulator on its own thread so vsync, ImGui or a slow frame on the
+// render thread never hold it up, and the other way around. Finished frames
+// go through a triple buffer and samples through the audio ring, the render
+// thread only takes the newest frame when there is one.
+class EmulationThread {
+ public:
+  // Shade indices, see Ppu::indexed_framebuffer_
+  typedef std::array<uint8_t, gb::k_IndexedFramebufferSize> Frame;
+
+  // audio may be nullptr, samples are dropped then
+  explicit EmulationThread(AudioSDL* audio);
+  ~EmulationThread();
+  // (Re)starts from a fresh GameBoy with rom as the cartridge, an empty rom
+  // leaves the cartridge slot empty
+  void Start(const std::vector<char>& rom);
+  void Stop();
+  // Render thread, the newest frame if one came out since the last call
+  Frame* NewFrame();
+
+  // Multiple of real time, 0 runs as fast as the host can
+  std::atomic<float> speed_{1.0f};
+
+ private:
+  void Run(std::stop_token stop);
+  void PushAudio();
+
+  AudioSDL* audio_{};
+  std::unique_ptr<gb::GameBoy> gb_;
+  TripleBuffer<Frame> frames_{};
+  // Only touched by the emulation thread, sized once so nothing allocates
+  // while running
+  std::vector<int16_t> samples_ =
+      std::vector<int16_t>(gb::BlipBuffer::k_Capacity * 2);
+  std::jthread thread_;
+};
+}  // namespace binary
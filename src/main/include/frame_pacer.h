@@ -0,0 +1,44 @@
+// Purpose: This header file contains the following
+//  * Frame pacer for the render loop
+//
+// Sleeping until a deadline wakes up late by however coarse the OS timer
+// is, spinning until it burns a core. The pacer sleeps until shortly before
+// the deadline and spins the rest, where shortly is learned from how late
+// its sleeps actually wake up. The render loop waits before polling input,
+// so the frame it draws next carries the freshest input it can.
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace binary {
+class FramePacer {
+ public:
+  using Clock = std::chrono::steady_clock;
+  // When the display's refresh rate is unknown
+  static constexpr double k_FallbackFrameRate = 60.0;
+
+  // Frames per second, 0 or less is k_FallbackFrameRate
+  explicit FramePacer(double frame_rate);
+  ~FramePacer();
+  FramePacer(const FramePacer&) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+  void SetFrameRate(double frame_rate);
+  // Returns when the next frame is due. A frame that ran over by more than
+  // a period moves the deadlines instead of the next ones being rushed out.
+  void Wait();
+  // How long before a deadline the pacer stops sleeping and spins
+  Clock::duration SpinMargin() const { return spin_margin_; }
+
+ private:
+  void SleepUntil(Clock::time_point time);
+
+  Clock::duration period_{};
+  Clock::time_point deadline_{};
+  Clock::duration spin_margin_{};
+#ifdef _WIN32
+  // High resolution waitable timer, Sleep() is 15.6 ms coarse without
+  // timeBeginPeriod(). nullptr before Windows 10 1803.
+  void* timer_{};
+#endif
+};
+}  // namespace binary
@@ -26,13 +26,36 @@ namespace binary{
 typedef enum RendererType  { 
   k_None = 0,
   k_Vulkan = 1,
-  k_OpenGL = 2
+  k_OpenGL = 2,
+  // SDL_Renderer, no GPU needed
+  k_SDL = 3
 } RendererType;
+// How finished frames reach the display
+typedef enum PresentMode {
+  // Vsync, every frame is shown in order
+  k_PresentFifo = 0,
+  // Vsync, a newer frame replaces one still waiting to be shown
+  k_PresentMailbox = 1,
+  // No vsync, can tear
+  k_PresentImmediate = 2
+} PresentMode;
+// One full screen pass of the Vulkan post-processing chain, shader is the
+// name of a shader in shaders/post
+typedef struct PostProcessPass {
+  std::string shader;
+  // The shader's own default when not set
+  std::optional<float> strength;
+} PostProcessPass;
 typedef struct Application {
   std::string name;
   uint32_t version;
   uint32_t width;
   uint32_t height;
   RendererType renderer;
+  PresentMode present_mode;
+  // Frames per second the render loop is paced to, 0 follows the display
+  uint32_t frame_rate;
+  // Run in order, empty draws the texture as it is
+  std::vector<PostProcessPass> post_processing;
 } Application; 
 }  // namespace binary
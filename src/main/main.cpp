@@ -6,16 +6,20 @@
 #include <gtest/gtest.h>
 #include <nfd.h>
 #include <memory>
+#include <optional>
 #include "include/gbengine.h"
 #include "../drivers/include/peripherals_sdl.h"
 #include "../drivers/include/renderer_vulkan.h"
 #include "../drivers/include/renderer_opengl.h"
+#include "../drivers/include/renderer_sdl.h"
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_vulkan.h"
 #include "imgui_internal.h" 
 #include "../gui/include/gb_gui.h"
 #include "../io/include/io.h"
+#include "include/emulation_thread.h"
+#include "include/frame_pacer.h"
 
 int main(int argc, char** argv) {
   // Initialize Google Test
@@ -72,51 +76,110 @@ int main(int argc, char** argv) {
   binary::SDL sdl(app);
   std::unique_ptr<binary::Renderer> render;
   std::unique_ptr<binary::GUI> gui;
+  // Declared after the renderer so it's destroyed while the context or device
+  // is still around
+  std::unique_ptr<binary::Viewport> texture;
+  // Vulkan only. Texture loads record into it and it's submitted once a
+  // frame, the splash screen and the first frame's loads share one submit.
+  binary::VulkanViewport* vulkan_viewport = nullptr;
+  std::optional<binary::UploadBatch> uploads;
   
   if (app.renderer == binary::k_OpenGL) {
-    render = std::make_unique<binary::OpenGL>(&sdl);
+    auto opengl = std::make_unique<binary::OpenGL>(&sdl, app);
+    auto viewport = std::make_unique<binary::OpenGLViewport>(
+        opengl->GetFunctions(), &sdl);
+    viewport->LoadFromPath("resources/textures/sunshine.png");
+    render = std::move(opengl);
+    texture = std::move(viewport);
     gui = std::make_unique<binary::OpenGLGUI>();
+  } else if (app.renderer == binary::k_SDL) {
+    auto viewport = std::make_unique<binary::SDLViewport>(&sdl);
+    render = std::make_unique<binary::SDLRenderer>(&sdl);
+    viewport->LoadFromPath("resources/textures/sunshine.png");
+    texture = std::move(viewport);
+    gui = std::make_unique<binary::SDLRendererGUI>();
   } else {
     render = std::make_unique<binary::Vulkan>(&sdl, app);
     gui = std::make_unique<binary::VulkanGUI>();
+    auto viewport = std::make_unique<binary::VulkanViewport>(
+        render->GetGraphicsHandler(), &sdl);
+    uploads.emplace(viewport->CreateUploadBatch());
+    viewport->LoadFromPath("resources/textures/sunshine.png", &*uploads);
+    vulkan_viewport = viewport.get();
+    texture = std::move(viewport);
   }
-
-  binary::gbVulkanGraphicsHandler vulkan = render->GetGraphicsHandler();
-  binary::VulkanViewport texture(vulkan, &sdl);
-  texture.LoadFromPath("resources/textures/sunshine.png");
+  // The splash screen stays up until the emulator's first frame, the texture
+  // then gets recreated once as a streaming one
+  bool showing_emulator = false;
+  binary::EmulationThread emulator(&sdl.audio_);
+  emulator.Start({});
+  // Follows the display the window is on unless the config sets a rate
+  binary::FramePacer pacer(app.frame_rate != 0 ? app.frame_rate
+                                               : sdl.RefreshRate());
   while (running) {
     bool window_is_minimized = true;
     // After SDL, Renderer, and ImGui have finished the initialization phase,
     // The program is stuck in this main loop until the user closes the program
-  
+
+    // Sleeps until the frame is due before polling, so the frame drawn
+    // right after carries the newest input. Minimized it keeps the loop
+    // from spinning too.
+    pacer.Wait();
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
       ImGui_ImplSDL2_ProcessEvent(&event);
       if (event.type == SDL_QUIT) {
         running = false;
       }
+      if (event.type == SDL_WINDOWEVENT &&
+          event.window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED &&
+          app.frame_rate == 0) {
+        pacer.SetFrameRate(sdl.RefreshRate());
+      }
       if (event.window.event == SDL_WINDOWEVENT_CLOSE &&
           event.window.windowID == SDL_GetWindowID(sdl.window_)) {
         running = false;
       }
-      if (event.key.keysym.sym == SDLK_LEFT) {
+      // Only on the press, a release used to load the texture again
+      if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_LEFT) {
         std::cout << "SDK:K_LEFT!\n";
         sdl.InitSurfaceFromPath("resources/textures/moonvoid.png", 
           binary::File::PNG);
-        texture.Update(sdl.surface_->pixels); 
+        if (vulkan_viewport != nullptr) {
+          vulkan_viewport->Update(sdl.surface_->pixels, *uploads);
+        } else {
+          texture->Update(sdl.surface_->pixels);
+        }
       }
     }
+    // Before anything below frees the textures these uploads write to
+    if (uploads) {
+      uploads->Submit();
+    }
   
     // When we minimize the window this causes Vulkan to send validation
     // errors because the window size is less than 1. To fix this, we do not
     // draw new frames until the user opens the application.
     if (!(SDL_GetWindowFlags(sdl.window_) & SDL_WINDOW_MINIMIZED)) {
+      // Only upload when the emulator finished a frame since the last one
+      if (binary::EmulationThread::Frame* frame = emulator.NewFrame()) {
+        if (!showing_emulator) {
+          texture->Free();
+          // Frames come out as shade indices, the GPU turns them into colours
+          texture->StartIndexedStreaming(binary::gb::k_ScreenWidth,
+                                        binary::gb::k_ScreenHeight);
+          texture->SetPalette(binary::gb::k_ShadeColors);
+          showing_emulator = true;
+        }
+        texture->Update(frame->data());
+      }
       gui->StartGUI(); 
-      binary::VulkanViewportInfo vulkan_viewport_info = texture.GetViewportInfo();
+      binary::VulkanViewportInfo vulkan_viewport_info = texture->GetViewportInfo();
       binary::gui::mainmenu::Start(&vulkan_viewport_info); 
       render->DrawFrame(); 
     }
   }
+  emulator.Stop();
   return EXIT_SUCCESS;
   #endif
 }
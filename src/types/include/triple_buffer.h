@@ -0,0 +1,55 @@
+// Purpose: This header file contains the following
+//  * Lock free triple buffer
+//
+// One thread keeps writing whole frames, another keeps reading the newest
+// one. Of the three buffers the producer owns one, the consumer owns one and
+// the third is parked in middle_. Publishing and acquiring are a single
+// atomic exchange with middle_, so neither side ever waits: the producer
+// overwrites frames nobody picked up and the consumer keeps the last frame
+// when nothing new came in.
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace binary {
+template <typename T>
+class TripleBuffer {
+ public:
+  // Producer side, the buffer to fill in next
+  inline T& Back() { return buffers_[back_]; }
+
+  // Producer side, hands Back() over and takes whatever was parked instead
+  void Publish() {
+    const uint8_t k_Parked =
+        middle_.exchange(back_ | k_Fresh, std::memory_order_acq_rel);
+    back_ = k_Parked & k_IndexMask;
+  }
+
+  // Consumer side, swaps the parked buffer into Front() if it's newer.
+  // Returns false and leaves Front() alone when nothing was published since.
+  bool Acquire() {
+    if ((middle_.load(std::memory_order_relaxed) & k_Fresh) == 0) {
+      return false;
+    }
+    const uint8_t k_Parked =
+        middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = k_Parked & k_IndexMask;
+    return true;
+  }
+
+  // Consumer side, the newest frame acquired
+  inline T& Front() { return buffers_[front_]; }
+
+ private:
+  static constexpr uint8_t k_IndexMask = 0x03;
+  // Set on middle_ when the parked buffer hasn't been acquired yet
+  static constexpr uint8_t k_Fresh = 0x04;
+
+  std::array<T, 3> buffers_{};
+  // Each side's index on its own cache line
+  alignas(64) std::atomic<uint8_t> middle_{1};
+  alignas(64) uint8_t back_ = 0;
+  alignas(64) uint8_t front_ = 2;
+};
+}  // namespace binary
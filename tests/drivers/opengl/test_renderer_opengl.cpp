@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "../../../src/gui/include/gb_gui.h"
+#include "../../test_benchmark.h"
+namespace binary {
+namespace {
+// The Gameboy screen, what the emulator streams every frame
+constexpr uint32_t k_Width = 160;
+constexpr uint32_t k_Height = 144;
+constexpr size_t k_WarmUpFrames = 10;
+constexpr size_t k_BenchmarkFrames = 500;
+constexpr std::array<std::array<uint8_t, 4>, 4> k_Palette = {{
+    {0xFF, 0x00, 0x00, 0xFF},
+    {0x00, 0xFF, 0x00, 0xFF},
+    {0x00, 0x00, 0xFF, 0xFF},
+    {0x00, 0x00, 0x00, 0xFF}}};
+}  // namespace
+
+// Needs an OpenGL 3.3 driver and something SDL can open a hidden window on,
+// llvmpipe works. Skips otherwise.
+class OpenGLHeadlessTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<OpenGL> opengl_;
+  std::unique_ptr<OpenGLViewport> viewport_;
+  std::vector<uint8_t> indices_ =
+      std::vector<uint8_t>(static_cast<size_t>(k_Width) * k_Height);
+
+  void SetUp() override {
+    Application app{};
+    app.name = "Binary_Test";
+    app.width = k_Width;
+    app.height = k_Height;
+    try {
+      opengl_ = std::make_unique<OpenGL>(app);
+    } catch (const std::runtime_error& error) {
+      GTEST_SKIP() << "No usable OpenGL context: " << error.what();
+    }
+    viewport_ = std::make_unique<OpenGLViewport>(opengl_->GetFunctions(),
+                                                 nullptr);
+    viewport_->StartIndexedStreaming(k_Width, k_Height);
+    viewport_->SetPalette(k_Palette);
+  }
+
+  void TearDown() override { viewport_.reset(); }
+
+  // Diagonal stripes that move with k_Frame
+  void FillIndices(const size_t k_Frame) {
+    for (size_t y = 0; y < k_Height; y++) {
+      for (size_t x = 0; x < k_Width; x++) {
+        indices_[y * k_Width + x] =
+            static_cast<uint8_t>((x + y + k_Frame) % k_Palette.size());
+      }
+    }
+  }
+};
+
+TEST_F(OpenGLHeadlessTest, StreamsIndexedFrames) {
+  std::vector<uint8_t> pixels(indices_.size() * 4);
+  // Twice around the ring, so every slot is written after its fence
+  for (size_t frame = 0; frame < 6; frame++) {
+    FillIndices(frame);
+    viewport_->Update(indices_.data());
+    opengl_->DrawFrame();
+  }
+  glBindTexture(GL_TEXTURE_2D, viewport_->GetTexture());
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  for (size_t pixel = 0; pixel < indices_.size(); pixel++) {
+    const std::array<uint8_t, 4>& k_Color = k_Palette[indices_[pixel]];
+    ASSERT_TRUE(std::equal(k_Color.begin(), k_Color.end(),
+                           pixels.begin() + pixel * 4))
+        << "pixel " << pixel;
+  }
+}
+
+TEST_F(OpenGLHeadlessTest, LoadingAnImageStopsStreaming) {
+  std::vector<uint8_t> colors(indices_.size() * 4);
+  std::vector<uint8_t> pixels(colors.size());
+  for (size_t byte = 0; byte < colors.size(); byte++) {
+    colors[byte] = static_cast<uint8_t>(byte);
+  }
+  viewport_->LoadFromArray(colors.data(), k_Width, k_Height);
+  // Straight RGBA again, not palette indices
+  std::reverse(colors.begin(), colors.end());
+  viewport_->Update(colors.data());
+  glBindTexture(GL_TEXTURE_2D, viewport_->GetTexture());
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  EXPECT_EQ(pixels, colors);
+}
+
+// Frame times of a streamed frame: palette expansion into the pixel buffer,
+// the texture copy, DrawFrame() and glFinish() so the copy is part of the
+// time, see test_benchmark.h
+TEST_F(OpenGLHeadlessTest, DISABLED_DrawFrameTime) {
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> frame_ms;
+  frame_ms.reserve(k_BenchmarkFrames);
+  for (size_t frame = 0; frame < k_WarmUpFrames; frame++) {
+    FillIndices(frame);
+    viewport_->Update(indices_.data());
+    opengl_->DrawFrame();
+    glFinish();
+  }
+  for (size_t frame = 0; frame < k_BenchmarkFrames; frame++) {
+    FillIndices(frame);
+    const Clock::time_point k_Start = Clock::now();
+    viewport_->Update(indices_.data());
+    opengl_->DrawFrame();
+    glFinish();
+    frame_ms.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - k_Start)
+            .count());
+  }
+  PrintBenchmark("OpenGL::DrawFrame", std::move(frame_ms));
+}
+}  // namespace binary
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "../../../src/drivers/include/audio_ring.h"
+namespace binary {
+TEST(AudioRing, WrapsAroundAndStopsWhenFull) {
+  SpscRing<int16_t, 8> ring;
+  const int16_t k_Input[6] = {1, 2, 3, 4, 5, 6};
+  int16_t output[8]{};
+  EXPECT_EQ(ring.Push(k_Input, 6), 6);
+  EXPECT_EQ(ring.Pop(output, 4), 4);
+  // 2 left, 6 free, the copy has to wrap
+  EXPECT_EQ(ring.Push(k_Input, 6), 6);
+  EXPECT_EQ(ring.Push(k_Input, 6), 0);
+  EXPECT_EQ(ring.Size(), 8);
+  EXPECT_EQ(ring.Pop(output, 8), 8);
+  const int16_t k_Expected[8] = {5, 6, 1, 2, 3, 4, 5, 6};
+  for (size_t index = 0; index < 8; index++) {
+    EXPECT_EQ(output[index], k_Expected[index]);
+  }
+  EXPECT_EQ(ring.Pop(output, 1), 0);
+}
+
+TEST(AudioRing, KeepsOrderAcrossThreads) {
+  constexpr uint32_t k_Total = 1 << 16;
+  SpscRing<uint32_t, 1024> ring;
+  std::thread producer([&ring] {
+    std::vector<uint32_t> block(100);
+    for (uint32_t next = 0; next < k_Total;) {
+      const uint32_t k_Count = std::min<uint32_t>(100, k_Total - next);
+      std::iota(block.begin(), block.begin() + k_Count, next);
+      const size_t k_Pushed = ring.Push(block.data(), k_Count);
+      if (k_Pushed == 0) std::this_thread::yield();
+      next += static_cast<uint32_t>(k_Pushed);
+    }
+  });
+  std::vector<uint32_t> block(64);
+  uint32_t expected = 0;
+  bool in_order = true;
+  while (expected < k_Total) {
+    const size_t k_Popped = ring.Pop(block.data(), block.size());
+    if (k_Popped == 0) std::this_thread::yield();
+    for (size_t index = 0; index < k_Popped; index++) {
+      in_order &= block[index] == expected++;
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(in_order);
+  EXPECT_EQ(ring.Size(), 0);
+}
+
+TEST(AudioRing, RateRatioCentersTheFill) {
+  EXPECT_DOUBLE_EQ(RateRatio(0, 1000), 1.0 + k_MaxRateDelta);
+  EXPECT_DOUBLE_EQ(RateRatio(500, 1000), 1.0);
+  EXPECT_DOUBLE_EQ(RateRatio(1000, 1000), 1.0 - k_MaxRateDelta);
+  EXPECT_GT(RateRatio(250, 1000), 1.0);
+  EXPECT_LT(RateRatio(750, 1000), 1.0);
+}
+}  // namespace binary
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../../src/drivers/include/pixel_scaler.h"
+#include "../test_benchmark.h"
+namespace binary {
+namespace {
+// Not a multiple of 8 or 4, so every SIMD path also runs its scalar tail
+constexpr uint32_t k_OddWidth = 163;
+constexpr uint32_t k_OddHeight = 5;
+// Bytes left alone at the end of every output row
+constexpr size_t k_PitchPadding = 12;
+constexpr uint8_t k_Untouched = 0xCD;
+constexpr size_t k_BenchmarkFrames = 200;
+
+PixelPalette RandomPalette(std::mt19937& random) {
+  PixelPalette palette{};
+  for (uint32_t& color : palette) {
+    color = static_cast<uint32_t>(random());
+  }
+  return palette;
+}
+}  // namespace
+
+TEST(PixelScaler, PackColorKeepsByteOrder) {
+  const uint32_t k_Packed = PackColor({0x11, 0x22, 0x33, 0x44});
+  uint8_t bytes[4];
+  std::memcpy(bytes, &k_Packed, sizeof(bytes));
+  EXPECT_EQ(bytes[0], 0x11);
+  EXPECT_EQ(bytes[1], 0x22);
+  EXPECT_EQ(bytes[2], 0x33);
+  EXPECT_EQ(bytes[3], 0x44);
+}
+
+TEST(PixelScaler, PicksASupportedKernel) {
+  EXPECT_TRUE(ScalerKernelSupported(ScalerKernel::k_Scalar));
+  EXPECT_TRUE(ScalerKernelSupported(BestScalerKernel()));
+}
+
+// Every kernel this CPU runs, the one ScaleIndexed() picked among them
+TEST(PixelScaler, MatchesScalarAtEveryScale) {
+  std::mt19937 random(1234);
+  const PixelPalette k_Palette = RandomPalette(random);
+  std::vector<uint8_t> indices(k_OddWidth * k_OddHeight);
+  for (uint8_t& index : indices) {
+    index = static_cast<uint8_t>(random());
+  }
+  for (const ScalerKernel k_Kernel :
+       {ScalerKernel::k_Scalar, ScalerKernel::k_Ssse3, ScalerKernel::k_Avx2}) {
+    if (!ScalerKernelSupported(k_Kernel)) {
+      continue;
+    }
+    for (uint32_t scale = 1; scale <= k_MaxScale; scale++) {
+      const size_t k_Pitch = k_OddWidth * scale * 4 + k_PitchPadding;
+      const size_t k_Size = k_Pitch * k_OddHeight * scale;
+      std::vector<uint8_t> expected(k_Size, k_Untouched);
+      std::vector<uint8_t> output(k_Size, k_Untouched);
+      ScaleIndexedScalar(indices.data(), k_OddWidth, k_OddHeight, k_Palette,
+                         scale, expected.data(), k_Pitch);
+      if (k_Kernel == BestScalerKernel()) {
+        ScaleIndexed(indices.data(), k_OddWidth, k_OddHeight, k_Palette,
+                     scale, output.data(), k_Pitch);
+      } else {
+        ScaleIndexedWith(k_Kernel, indices.data(), k_OddWidth, k_OddHeight,
+                         k_Palette, scale, output.data(), k_Pitch);
+      }
+      const int k_KernelIndex = static_cast<int>(k_Kernel);
+      ASSERT_EQ(output, expected)
+          << "kernel " << k_KernelIndex << " scale " << scale;
+      // The scalar version writes exactly the scaled rows, so the padding
+      // being equal means neither wrote into it
+      for (size_t row = 0; row < k_OddHeight * scale; row++) {
+        ASSERT_EQ(output[row * k_Pitch + k_Pitch - 1], k_Untouched)
+            << "kernel " << k_KernelIndex << " scale " << scale << " row "
+            << row;
+      }
+    }
+  }
+}
+
+// A Gameboy frame scaled 6x is about what a 1080p window shows, see
+// test_benchmark.h
+TEST(PixelScaler, DISABLED_ScaleTime) {
+  constexpr uint32_t k_Width = 160;
+  constexpr uint32_t k_Height = 144;
+  using Clock = std::chrono::steady_clock;
+  std::mt19937 random(99);
+  const PixelPalette k_Palette = RandomPalette(random);
+  std::vector<uint8_t> indices(k_Width * k_Height);
+  for (uint8_t& index : indices) {
+    index = static_cast<uint8_t>(random() & 3);
+  }
+  const size_t k_Pitch = k_Width * k_MaxScale * 4;
+  std::vector<uint8_t> output(k_Pitch * k_Height * k_MaxScale);
+  for (const bool k_Scalar : {true, false}) {
+    std::vector<double> frame_ms;
+    frame_ms.reserve(k_BenchmarkFrames);
+    for (size_t frame = 0; frame < k_BenchmarkFrames; frame++) {
+      const Clock::time_point k_Start = Clock::now();
+      if (k_Scalar) {
+        ScaleIndexedScalar(indices.data(), k_Width, k_Height, k_Palette,
+                           k_MaxScale, output.data(), k_Pitch);
+      } else {
+        ScaleIndexed(indices.data(), k_Width, k_Height, k_Palette,
+                     k_MaxScale, output.data(), k_Pitch);
+      }
+      frame_ms.push_back(
+          std::chrono::duration<double, std::milli>(Clock::now() - k_Start)
+              .count());
+    }
+    PrintBenchmark(k_Scalar ? "ScaleIndexedScalar 6x" : "ScaleIndexed 6x",
+                   std::move(frame_ms));
+  }
+}
+}  // namespace binary
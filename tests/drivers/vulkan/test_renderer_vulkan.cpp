@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "../../../src/drivers/include/renderer_vulkan.h"
+#include "../../test_benchmark.h"
+namespace binary {
+namespace {
+// Twice the Gameboy screen, the GUI usually scales it up at least that much
+constexpr uint32_t k_Width = 320;
+constexpr uint32_t k_Height = 288;
+constexpr size_t k_WarmUpFrames = 10;
+constexpr size_t k_BenchmarkFrames = 500;
+}  // namespace
+
+// Needs a Vulkan device but no display, lavapipe works. Skips when there's
+// no device at all.
+class VulkanHeadlessTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<Vulkan> vulkan_;
+
+  void SetUp() override {
+    Application app{};
+    app.name = "Binary_Test";
+    app.width = k_Width;
+    app.height = k_Height;
+    try {
+      vulkan_ = std::make_unique<Vulkan>(app);
+    } catch (const std::runtime_error& error) {
+      GTEST_SKIP() << "No usable Vulkan device: " << error.what();
+    }
+  }
+};
+
+TEST_F(VulkanHeadlessTest, ReadsBackTheDrawnFrame) {
+  vulkan_->DrawFrame();
+  const uint8_t* k_Pixels = vulkan_->ReadBack();
+  ASSERT_NE(k_Pixels, nullptr);
+  // The quad covers the whole target with the black and white checkerboard
+  size_t black = 0;
+  size_t white = 0;
+  for (size_t pixel = 0; pixel < k_Width * k_Height; pixel++) {
+    const uint8_t* k_Color = k_Pixels + pixel * 4;
+    ASSERT_EQ(k_Color[3], 0xFF) << "pixel " << pixel;
+    black += (k_Color[0] == 0x00) ? 1 : 0;
+    white += (k_Color[0] == 0xFF) ? 1 : 0;
+  }
+  EXPECT_GT(black, k_Width * k_Height / 4);
+  EXPECT_GT(white, k_Width * k_Height / 4);
+}
+
+// Frame times of the whole DrawFrame() path: record, submit, fence wait and
+// readback, see test_benchmark.h
+TEST_F(VulkanHeadlessTest, DISABLED_DrawFrameTime) {
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> frame_ms;
+  frame_ms.reserve(k_BenchmarkFrames);
+  for (size_t frame = 0; frame < k_WarmUpFrames; frame++) {
+    vulkan_->DrawFrame();
+    vulkan_->ReadBack();
+  }
+  for (size_t frame = 0; frame < k_BenchmarkFrames; frame++) {
+    const Clock::time_point k_Start = Clock::now();
+    vulkan_->DrawFrame();
+    ASSERT_NE(vulkan_->ReadBack(), nullptr);
+    frame_ms.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - k_Start)
+            .count());
+  }
+  PrintBenchmark("Vulkan::DrawFrame", std::move(frame_ms));
+}
+}  // namespace binary
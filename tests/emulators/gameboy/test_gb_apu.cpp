@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "../../../src/emulation/gameboy/include/gb_emulator.h"
+namespace binary::gb {
+namespace {
+// A tenth of a second
+constexpr uint64_t k_TestCycles = k_ClockRate / 4 / 10;
+}  // namespace
+
+class GameBoyApuTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<GameBoy> gb_ = std::make_unique<GameBoy>();
+
+  void SetUp() override {
+    // NOPs all the way, Fetch() adds one cycle per instruction
+    gb_->reg_.program_counter_ = 1;
+  }
+
+  uint8_t Io(const HardwareRegistersName k_Register) {
+    return gb_->Read(static_cast<uint16_t>(k_Register));
+  }
+
+  void SetIo(const HardwareRegistersName k_Register, const uint8_t k_Value) {
+    gb_->Write(static_cast<uint16_t>(k_Register), k_Value);
+  }
+
+  // Powers the APU on with both sides at full volume
+  void PowerOn(const uint8_t k_Panning) {
+    SetIo(HardwareRegistersName::k_Nr52, 0x80);
+    SetIo(HardwareRegistersName::k_Nr50, 0x77);
+    SetIo(HardwareRegistersName::k_Nr51, k_Panning);
+  }
+
+  // Left channel of everything rendered so far
+  std::vector<int16_t> Render(const uint64_t k_Cycles) {
+    EmulateFor(gb_.get(), k_Cycles);
+    gb_->apu_.EndFrame(gb_.get());
+    std::vector<int16_t> samples(gb_->apu_.AvailableSamples() * 2);
+    const size_t k_Frames =
+        gb_->apu_.ReadSamples(samples.data(), samples.size() / 2);
+    std::vector<int16_t> left(k_Frames);
+    for (size_t frame = 0; frame < k_Frames; frame++) {
+      left[frame] = samples[frame * 2];
+    }
+    return left;
+  }
+
+  // Skips the kernel's pre-ringing in front of the very first step
+  static size_t RisingEdges(const std::vector<int16_t>& k_Samples) {
+    size_t edges = 0;
+    for (size_t index = BlipBuffer::k_Taps; index < k_Samples.size();
+         index++) {
+      edges += (k_Samples[index - 1] < 0 && k_Samples[index] >= 0) ? 1 : 0;
+    }
+    return edges;
+  }
+};
+
+TEST_F(GameBoyApuTest, BlipBufferStepIsBandLimited) {
+  BlipBuffer buffer;
+  buffer.SetRates(k_DefaultSampleRate, k_DefaultSampleRate);
+  buffer.AddDelta(10, 10'000.0f);
+  buffer.EndFrame(64);
+  std::vector<int16_t> samples(64);
+  ASSERT_EQ(buffer.ReadSamples(samples.data(), samples.size(), 1), 64);
+  EXPECT_EQ(samples[0], 0);
+  // The step settles at its full height without ringing much past it
+  const int16_t k_Peak = *std::max_element(samples.begin(), samples.end());
+  EXPECT_GT(k_Peak, 9'500);
+  EXPECT_LT(k_Peak, 11'000);
+  EXPECT_GT(samples[40], 9'000);
+  EXPECT_EQ(buffer.Available(), 0);
+}
+
+TEST_F(GameBoyApuTest, RegistersNeedPower) {
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52), 0x70);
+  SetIo(HardwareRegistersName::k_Nr50, 0x77);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr50), 0x00);
+
+  PowerOn(0xFF);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52), 0xF0);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr50), 0x77);
+  // Write only bits read back as 1
+  SetIo(HardwareRegistersName::k_Nr11, 0x80);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr11), 0xBF);
+  EXPECT_TRUE(gb_->scheduler_.Pending(EventType::k_ApuFrameSequencer));
+
+  SetIo(HardwareRegistersName::k_Nr52, 0x00);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr50), 0x00);
+  EXPECT_FALSE(gb_->scheduler_.Pending(EventType::k_ApuFrameSequencer));
+}
+
+TEST_F(GameBoyApuTest, SquareChannelPlaysItsFrequency) {
+  PowerOn(0x11);
+  // 131072 / (2048 - 1750) = 440 Hz at 50% duty
+  SetIo(HardwareRegistersName::k_Nr11, 0x80);
+  SetIo(HardwareRegistersName::k_Nr12, 0xF0);
+  SetIo(HardwareRegistersName::k_Nr13, 1750 & 0xFF);
+  SetIo(HardwareRegistersName::k_Nr14, 0x80 | (1750 >> 8));
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x0F, 0x01);
+
+  const std::vector<int16_t> k_Samples = Render(k_TestCycles);
+  EXPECT_NEAR(k_Samples.size(), k_DefaultSampleRate / 10, 16);
+  EXPECT_NEAR(RisingEdges(k_Samples), 44, 1);
+  const int16_t k_Peak = *std::max_element(k_Samples.begin(), k_Samples.end());
+  EXPECT_GT(k_Peak, 15 * 8 * 64 / 4);
+}
+
+TEST_F(GameBoyApuTest, UltrasonicSquareIsSilent) {
+  PowerOn(0x11);
+  // 131 kHz, way past Nyquist. Point sampling would alias it into an audible
+  // tone, band limited steps leave only the DC the capacitor takes away.
+  SetIo(HardwareRegistersName::k_Nr11, 0x80);
+  SetIo(HardwareRegistersName::k_Nr12, 0xF0);
+  SetIo(HardwareRegistersName::k_Nr13, 0xFF);
+  SetIo(HardwareRegistersName::k_Nr14, 0x87);
+  const std::vector<int16_t> k_Samples = Render(k_TestCycles);
+  ASSERT_GT(k_Samples.size(), 2'400);
+  for (size_t index = 2'400; index < k_Samples.size(); index++) {
+    ASSERT_LT(std::abs(k_Samples[index]), 16) << "sample " << index;
+  }
+}
+
+TEST_F(GameBoyApuTest, LengthCounterStopsTheChannel) {
+  PowerOn(0xFF);
+  // Length 63 leaves one frame sequencer length clock
+  SetIo(HardwareRegistersName::k_Nr21, 0x3F);
+  SetIo(HardwareRegistersName::k_Nr22, 0xF0);
+  SetIo(HardwareRegistersName::k_Nr24, 0xC0);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x0F, 0x02);
+  EmulateFor(gb_.get(), k_FrameSequencerCycles);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x0F, 0x00);
+
+  // Without the length enable it keeps playing
+  SetIo(HardwareRegistersName::k_Nr21, 0x3F);
+  SetIo(HardwareRegistersName::k_Nr24, 0x80);
+  EmulateFor(gb_.get(), k_FrameSequencerCycles * 16);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x0F, 0x02);
+
+  // Turning the DAC off stops it straight away
+  SetIo(HardwareRegistersName::k_Nr22, 0x00);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x0F, 0x00);
+}
+
+TEST_F(GameBoyApuTest, SweepOverflowStopsChannel1) {
+  PowerOn(0xFF);
+  // Pace 1, adding freq >> 1 every 2 sequencer steps goes past 2047 quickly
+  SetIo(HardwareRegistersName::k_Nr10, 0x11);
+  SetIo(HardwareRegistersName::k_Nr12, 0xF0);
+  SetIo(HardwareRegistersName::k_Nr13, 0x00);
+  SetIo(HardwareRegistersName::k_Nr14, 0x84);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x01, 0x01);
+  EmulateFor(gb_.get(), k_FrameSequencerCycles * 8);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x01, 0x00);
+  // The frequency register was updated on the way
+  EXPECT_GT(gb_->bus_.io_registers_[0x14] & 0x07, 0x04);
+}
+
+TEST_F(GameBoyApuTest, WaveAndNoiseChannelsPlay) {
+  PowerOn(0xCC);
+  for (uint16_t address = 0xFF30; address < 0xFF38; address++) {
+    gb_->Write(address, 0xFF);
+  }
+  SetIo(HardwareRegistersName::k_Nr30, 0x80);
+  SetIo(HardwareRegistersName::k_Nr32, 0x20);
+  SetIo(HardwareRegistersName::k_Nr33, 1750 & 0xFF);
+  SetIo(HardwareRegistersName::k_Nr34, 0x80 | (1750 >> 8));
+  SetIo(HardwareRegistersName::k_Nr42, 0xF0);
+  SetIo(HardwareRegistersName::k_Nr43, 0x50);
+  SetIo(HardwareRegistersName::k_Nr44, 0x80);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Nr52) & 0x0F, 0x0C);
+
+  // Half the wave table high, half low, so the same 220 Hz square as a
+  // channel 1 tone of the same period would give at half the pitch
+  SetIo(HardwareRegistersName::k_Nr51, 0x40);
+  const std::vector<int16_t> k_Wave = Render(k_TestCycles);
+  EXPECT_NEAR(RisingEdges(k_Wave), 22, 1);
+
+  SetIo(HardwareRegistersName::k_Nr51, 0x80);
+  const std::vector<int16_t> k_Noise = Render(k_TestCycles);
+  EXPECT_GT(RisingEdges(k_Noise), 100);
+}
+}  // namespace binary::gb
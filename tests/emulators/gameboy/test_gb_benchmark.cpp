@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "../../../src/emulation/gameboy/include/gb_emulator.h"
+#include <format>
+namespace binary::gb {
+// Machine cycles each interpreter runs
+constexpr uint64_t k_BenchmarkCycles = 20'000'000;
+
+class GameBoyBenchmark : public ::testing::Test {
+ protected:
+  // Address 0 is only reached through the JP, Fetch() then moves the program
+  // counter to 1 where the body of the loop starts
+  static constexpr std::array<uint8_t, 16> k_Program = {
+      0x00,              // NOP
+      0x3C,              // INC A
+      0x04,              // INC B
+      0x80,              // ADD A,B
+      0x91,              // SUB C
+      0xAA,              // XOR D
+      0x4F,              // LD C,A
+      0xA3,              // AND E
+      0xB4,              // OR H
+      0x2D,              // DEC L
+      0xB8,              // CP B
+      0x50,              // LD D,B
+      0xC3, 0x00, 0x00,  // JP 0x0000
+      0x00};
+
+  // Instructions in one pass through the loop, from INC A to the JP
+  static constexpr size_t k_PassInstructions = 12;
+
+  static uint64_t PassCycles() {
+    uint64_t cycles = 0;
+    for (size_t index = 1; index <= k_PassInstructions; index++) {
+      cycles += k_MachineCycleTable[k_Program[index]].cycles_;
+    }
+    return cycles;
+  }
+
+  void LoadProgram(GameBoy* gb) {
+    gb->bus_.LoadCartridge(k_Program.data(), k_Program.size());
+    gb->reg_.program_counter_ = 1;
+  }
+
+  // Returns the speed in millions of instructions per second
+  template <typename Function>
+  double Measure(const std::string& name, GameBoy* gb, Function run) {
+    LoadProgram(gb);
+    const auto k_Start = std::chrono::steady_clock::now();
+    run(gb);
+    const auto k_End = std::chrono::steady_clock::now();
+    const double k_Seconds =
+        std::chrono::duration<double>(k_End - k_Start).count();
+    const double k_Instructions = static_cast<double>(k_BenchmarkCycles) /
+                                  PassCycles() * k_PassInstructions;
+    const double k_Mips = k_Instructions / k_Seconds / 1'000'000.0;
+    std::cout << std::format("[ BENCHMARK] {:<24} {:>8.2f} MIPS\n", name,
+                             k_Mips);
+    return k_Mips;
+  }
+
+  void ExpectSameState(GameBoy& expected, GameBoy& actual) {
+    expected.MaterializeFlags();
+    actual.MaterializeFlags();
+    EXPECT_EQ(expected.cycles_, actual.cycles_);
+    EXPECT_EQ(expected.reg_.program_counter_, actual.reg_.program_counter_);
+    EXPECT_EQ(expected.reg_.a_, actual.reg_.a_);
+    EXPECT_EQ(expected.reg_.b_, actual.reg_.b_);
+    EXPECT_EQ(expected.reg_.c_, actual.reg_.c_);
+    EXPECT_EQ(expected.reg_.d_, actual.reg_.d_);
+    EXPECT_EQ(expected.reg_.e_, actual.reg_.e_);
+    EXPECT_EQ(expected.reg_.h_, actual.reg_.h_);
+    EXPECT_EQ(expected.reg_.l_, actual.reg_.l_);
+    EXPECT_EQ(expected.reg_.f_, actual.reg_.f_);
+    EXPECT_EQ(expected.bus_.work_ram_, actual.bus_.work_ram_);
+    EXPECT_EQ(expected.bus_.high_ram_, actual.bus_.high_ram_);
+  }
+};
+
+// Prints the MIPS of every interpreter and checks that they all end up in the
+// same state. Not a pass/fail on speed, see test_benchmark.h for running it.
+TEST_F(GameBoyBenchmark, DISABLED_InterpreterMips) {
+  std::unique_ptr<std::array<Opcode, 512>> opcode_table;
+  opcode_table = std::make_unique<std::array<Opcode, 512>>();
+  InitOpcodeTable(*opcode_table);
+
+  auto opcode_table_gb = std::make_unique<GameBoy>();
+  const double k_OpcodeTableMips =
+      Measure("std::function table", opcode_table_gb.get(), [&](GameBoy* gb) {
+        while (gb->cycles_ < k_BenchmarkCycles) {
+          const uint16_t k_Instruction =
+              gb->Read(gb->reg_.program_counter_);
+          opcode_table->at(k_Instruction).execute_(gb);
+          instructionset::Fetch(gb);
+          gb->cycles_ += InstructionCycles(gb, k_Instruction) - 1;
+        }
+      });
+
+  auto loop_gb = std::make_unique<GameBoy>();
+  const double k_LoopMips =
+      Measure("EmulateLoop", loop_gb.get(), [](GameBoy* gb) {
+        EmulateLoop(gb, k_BenchmarkCycles);
+      });
+  ExpectSameState(*opcode_table_gb, *loop_gb);
+  std::cout << std::format("[ BENCHMARK] EmulateLoop speedup {:.2f}x\n",
+                           k_LoopMips / k_OpcodeTableMips);
+
+  auto cached_gb = std::make_unique<GameBoy>();
+  const double k_CachedMips =
+      Measure("EmulateCached", cached_gb.get(), [](GameBoy* gb) {
+        EmulateCached(gb, k_BenchmarkCycles);
+      });
+  ExpectSameState(*opcode_table_gb, *cached_gb);
+  std::cout << std::format("[ BENCHMARK] EmulateCached speedup {:.2f}x\n",
+                           k_CachedMips / k_OpcodeTableMips);
+
+  auto jit_gb = std::make_unique<GameBoy>();
+  const double k_JitMips = Measure("EmulateJit", jit_gb.get(), [](GameBoy* gb) {
+    EmulateJit(gb, k_BenchmarkCycles);
+  });
+  ExpectSameState(*opcode_table_gb, *jit_gb);
+  std::cout << std::format("[ BENCHMARK] EmulateJit speedup {:.2f}x\n",
+                           k_JitMips / k_OpcodeTableMips);
+
+#ifdef BINARY_GB_MUSTTAIL
+  auto threaded_gb = std::make_unique<GameBoy>();
+  const double k_ThreadedMips =
+      Measure("EmulateThreaded", threaded_gb.get(), [](GameBoy* gb) {
+        EmulateThreaded(gb, k_BenchmarkCycles);
+      });
+  ExpectSameState(*opcode_table_gb, *threaded_gb);
+  std::cout << std::format("[ BENCHMARK] EmulateThreaded speedup {:.2f}x\n",
+                           k_ThreadedMips / k_OpcodeTableMips);
+#endif
+}
+
+#ifdef BINARY_GB_MUSTTAIL
+// InterpreterMips is disabled, this keeps the threaded interpreter checked
+// against EmulateLoop in the default run on a short slice of the same loop
+TEST_F(GameBoyBenchmark, ThreadedMatchesLoop) {
+  constexpr uint64_t k_Cycles = 100'000;
+  auto loop_gb = std::make_unique<GameBoy>();
+  LoadProgram(loop_gb.get());
+  EmulateLoop(loop_gb.get(), k_Cycles);
+
+  auto threaded_gb = std::make_unique<GameBoy>();
+  LoadProgram(threaded_gb.get());
+  EmulateThreaded(threaded_gb.get(), k_Cycles);
+  ExpectSameState(*loop_gb, *threaded_gb);
+}
+#endif
+
+// APU cost on its own, all 4 channels playing for 10 emulated seconds with
+// only the frame sequencer moving time forward. Disabled like
+// InterpreterMips.
+TEST_F(GameBoyBenchmark, DISABLED_ApuCoreLoad) {
+  constexpr uint64_t k_Seconds = 10;
+  auto gb = std::make_unique<GameBoy>();
+  const std::array<std::pair<uint16_t, uint8_t>, 16> k_Registers = {{
+      {0xFF26, 0x80}, {0xFF24, 0x77}, {0xFF25, 0xFF},
+      {0xFF11, 0x80}, {0xFF12, 0xF0}, {0xFF13, 0x00}, {0xFF14, 0x87},
+      {0xFF16, 0x40}, {0xFF17, 0xF0}, {0xFF19, 0x86},
+      {0xFF1A, 0x80}, {0xFF1C, 0x20}, {0xFF1E, 0x87},
+      {0xFF21, 0xF0}, {0xFF22, 0x00}, {0xFF23, 0x80}}};
+  for (const auto& [k_Address, k_Value] : k_Registers) {
+    gb->Write(k_Address, k_Value);
+  }
+  std::vector<int16_t> samples(BlipBuffer::k_Capacity * 2);
+  const auto k_Start = std::chrono::steady_clock::now();
+  const uint64_t k_End = k_Seconds * k_ClockRate / 4;
+  while (gb->cycles_ < k_End) {
+    gb->cycles_ = gb->scheduler_.NextEvent();
+    gb->scheduler_.Dispatch(gb.get());
+    gb->apu_.ReadSamples(samples.data(), BlipBuffer::k_Capacity);
+  }
+  const double k_Elapsed = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - k_Start)
+                               .count();
+  std::cout << std::format("[ BENCHMARK] APU {:.3f}% of one core\n",
+                           k_Elapsed / k_Seconds * 100.0);
+}
+}  // namespace binary::gb
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include "../../../src/emulation/gameboy/include/gb_emulator.h"
+namespace binary::gb {
+// Every test runs the same program on the table interpreter and the cached
+// interpreter, the two must always end up in the same state
+class GameBoyBlockCacheTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<GameBoy> loop_gb_ = std::make_unique<GameBoy>();
+  std::unique_ptr<GameBoy> cached_gb_ = std::make_unique<GameBoy>();
+
+  void LoadProgram(const uint16_t k_Address,
+                   const std::vector<uint8_t>& program) {
+    for (GameBoy* gb : {loop_gb_.get(), cached_gb_.get()}) {
+      for (size_t index = 0; index < program.size(); index++) {
+        gb->Write(k_Address + index, program[index]);
+      }
+      // Fetch() moves the program counter past the jump target, the program
+      // starts one byte in
+      gb->reg_.program_counter_ = k_Address + 1;
+    }
+  }
+
+  void Run(const uint64_t k_Cycles) {
+    EmulateLoop(loop_gb_.get(), k_Cycles);
+    EmulateCached(cached_gb_.get(), k_Cycles);
+  }
+
+  void Write(const uint16_t k_Address, const uint8_t k_Value) {
+    loop_gb_->Write(k_Address, k_Value);
+    cached_gb_->Write(k_Address, k_Value);
+  }
+
+  void ExpectSameState() {
+    loop_gb_->MaterializeFlags();
+    cached_gb_->MaterializeFlags();
+    EXPECT_EQ(loop_gb_->cycles_, cached_gb_->cycles_);
+    EXPECT_EQ(loop_gb_->instruction_, cached_gb_->instruction_);
+    EXPECT_EQ(loop_gb_->reg_.program_counter_,
+              cached_gb_->reg_.program_counter_);
+    EXPECT_EQ(loop_gb_->reg_.af_, cached_gb_->reg_.af_);
+    EXPECT_EQ(loop_gb_->reg_.bc_, cached_gb_->reg_.bc_);
+    EXPECT_EQ(loop_gb_->reg_.de_, cached_gb_->reg_.de_);
+    EXPECT_EQ(loop_gb_->reg_.hl_, cached_gb_->reg_.hl_);
+    EXPECT_EQ(loop_gb_->bus_.work_ram_, cached_gb_->bus_.work_ram_);
+    EXPECT_EQ(loop_gb_->bus_.high_ram_, cached_gb_->bus_.high_ram_);
+  }
+};
+
+TEST_F(GameBoyBlockCacheTest, RomBlocksAreReused) {
+  const std::array<uint8_t, 8> k_Program = {
+      0x00,              // NOP
+      0x3C,              // INC A
+      0x04,              // INC B
+      0x80,              // ADD A,B
+      0xC3, 0x00, 0x00,  // JP 0x0000
+      0x00};
+  for (GameBoy* gb : {loop_gb_.get(), cached_gb_.get()}) {
+    gb->bus_.LoadCartridge(k_Program.data(), k_Program.size());
+    gb->reg_.program_counter_ = 1;
+  }
+  Run(10'000);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->block_cache_.misses_, 1);
+  EXPECT_GT(cached_gb_->block_cache_.hits_, 0);
+  EXPECT_EQ(cached_gb_->block_cache_.invalidations_, 0);
+}
+
+TEST_F(GameBoyBlockCacheTest, WorkRamWriteInvalidatesBlock) {
+  LoadProgram(0xC000, {
+      0x00,              // NOP
+      0x3C,              // INC A
+      0xC3, 0x00, 0xC0   // JP 0xC000
+  });
+  // 4 machine cycles per pass, INC A and JP
+  Run(200);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->reg_.a_, 50);
+
+  // Write through echo RAM, it has to find the block in WRAM
+  Write(0xE001, 0x04);  // INC B
+  Run(200);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->reg_.a_, 50);
+  EXPECT_EQ(cached_gb_->reg_.b_, 50);
+  EXPECT_EQ(cached_gb_->block_cache_.invalidations_, 1);
+}
+
+TEST_F(GameBoyBlockCacheTest, SelfModifyingCode) {
+  // Every pass turns the opcode at 0xC001 into the next one
+  LoadProgram(0xC000, {
+      0x00,              // NOP
+      0x3C,              // INC A
+      0x34,              // INC (HL)
+      0xC3, 0x00, 0xC0   // JP 0xC000
+  });
+  for (GameBoy* gb : {loop_gb_.get(), cached_gb_.get()}) {
+    gb->reg_.hl_ = 0xC001;
+  }
+  // Three passes: INC A, DEC A, then LD A,d8, each followed by INC (HL) and
+  // JP for 7, 7 and 8 machine cycles
+  Run(22);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->Read(0xC001), 0x3F);
+  EXPECT_EQ(cached_gb_->block_cache_.invalidations_, 3);
+
+  // Whatever the program turns into, both interpreters have to agree
+  Run(1'000);
+  ExpectSameState();
+}
+
+TEST_F(GameBoyBlockCacheTest, HighRamWriteInvalidatesBlock) {
+  LoadProgram(0xFF80, {
+      0x00,              // NOP
+      0x3C,              // INC A
+      0xC3, 0x80, 0xFF   // JP 0xFF80
+  });
+  Run(200);
+  Write(0xFF81, 0x0C);  // INC C
+  Run(200);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->reg_.a_, 50);
+  EXPECT_EQ(cached_gb_->reg_.c_, 50);
+  EXPECT_EQ(cached_gb_->block_cache_.invalidations_, 1);
+}
+TEST_F(GameBoyBlockCacheTest, IdleLoopIsSkipped) {
+  // Polls a HRAM byte, nothing changes until it's written
+  const std::array<uint8_t, 6> k_Program = {
+      0x00,              // NOP
+      0x78,              // LD A,B
+      0xB6,              // OR (HL)
+      0xC3, 0x00, 0x00   // JP 0x0000
+  };
+  for (GameBoy* gb : {loop_gb_.get(), cached_gb_.get()}) {
+    gb->bus_.LoadCartridge(k_Program.data(), k_Program.size());
+    gb->reg_.program_counter_ = 1;
+    gb->reg_.b_ = 0x01;
+    gb->reg_.hl_ = 0xFF90;
+  }
+  Run(10'000);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->block_cache_.idle_stats_.skips_, 1);
+  EXPECT_GT(cached_gb_->block_cache_.idle_stats_.skipped_cycles_, 9'900);
+
+  Write(0xFF90, 0x80);
+  // Passes take 5 machine cycles, stop right after the OR
+  Run(1'002);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->reg_.a_, 0x81);
+  EXPECT_EQ(cached_gb_->block_cache_.idle_stats_.skips_, 2);
+}
+
+TEST_F(GameBoyBlockCacheTest, LoopsThatWriteArentIdle) {
+  // Same registers every time around, but memory keeps changing
+  const std::array<uint8_t, 5> k_Program = {
+      0x00,              // NOP
+      0x34,              // INC (HL)
+      0xC3, 0x00, 0x00   // JP 0x0000
+  };
+  for (GameBoy* gb : {loop_gb_.get(), cached_gb_.get()}) {
+    gb->bus_.LoadCartridge(k_Program.data(), k_Program.size());
+    gb->reg_.program_counter_ = 1;
+    gb->reg_.hl_ = 0xFF90;
+  }
+  Run(3'000);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->block_cache_.idle_stats_.skips_, 0);
+}
+
+TEST_F(GameBoyBlockCacheTest, IdleLoopSkippingCanBeTurnedOff) {
+  const std::array<uint8_t, 4> k_Program = {
+      0x00,              // NOP
+      0xC3, 0x00, 0x00   // JP 0x0000
+  };
+  for (GameBoy* gb : {loop_gb_.get(), cached_gb_.get()}) {
+    gb->bus_.LoadCartridge(k_Program.data(), k_Program.size());
+    gb->reg_.program_counter_ = 1;
+  }
+  cached_gb_->block_cache_.skip_idle_loops_ = false;
+  Run(1'000);
+  ExpectSameState();
+  EXPECT_EQ(cached_gb_->block_cache_.idle_stats_.skipped_cycles_, 0);
+}
+}  // namespace binary::gb
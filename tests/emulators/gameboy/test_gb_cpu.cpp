@@ -1,17 +1,19 @@
 #include <gtest/gtest.h>
 #include <memory>
 #include "../../../src/emulation/gameboy/include/gb_instruction.h"
+#include "../../../src/emulation/gameboy/include/gb_dispatch.h"
 #include <gmock/gmock.h>
 #include <format>
 using ::testing::AtLeast;
 namespace binary::gb {
-class GameBoyTest : public ::testing::Test {
+// Every CPU test runs twice, once with the flags worked out as soon as an
+// instruction sets them and once with lazy flags, both must give the same
+// results
+class GameBoyTest : public ::testing::TestWithParam<bool> {
  protected:
   GameBoy gb_;
 
-  void SetUp() override {
-    // Initialize GameBoy or set any pre-conditions here
-  }
+  void SetUp() override { gb_.SetLazyFlags(GetParam()); }
 
   void TearDown() override {
     // Clean up after tests if necessary
@@ -61,7 +63,7 @@ class GameBoyTest : public ::testing::Test {
   }
 };
 
-TEST_F(GameBoyTest, LoadRegDirectOpcodeTable) {
+TEST_P(GameBoyTest, LoadRegDirectOpcodeTable) {
   using namespace binary::gb::instructionset;
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
@@ -111,7 +113,7 @@ TEST_F(GameBoyTest, LoadRegDirectOpcodeTable) {
   uint16_t hl_value = static_cast<uint16_t>((gb_.reg_.h_ << 8) | gb_.reg_.l_);
   EXPECT_EQ(gb_.reg_.hl_, hl_value);
 }
-TEST_F(GameBoyTest, AddRegXtoRegYTable) {
+TEST_P(GameBoyTest, AddRegXtoRegYTable) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -132,27 +134,27 @@ TEST_F(GameBoyTest, AddRegXtoRegYTable) {
   gb_.reg_.b_ = 4;
   opcode_table->at(ADD_B).execute_(&gb_);
   uint16_t af_value =
-      static_cast<uint16_t>((gb_.reg_.a_ << 8) | gb_.reg_.f_.to_ulong());
+      static_cast<uint16_t>((gb_.reg_.a_ << 8) | gb_.Flags());
   EXPECT_EQ(gb_.reg_.a_, 6);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], false) << "Zero flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexN], false) << "Negative flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexH], false) << "Half Carry flag wasn 't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexC], false) << "Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), false) << "Zero flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexN), false) << "Negative flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexH), false) << "Half Carry flag wasn 't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexC), false) << "Carry flag wasn't set";
   EXPECT_EQ(gb_.reg_.af_, af_value);
   gb_.reg_.a_ = 255;
   gb_.reg_.c_ = 255;
   opcode_table->at(ADD_C).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0xFE);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexC], true) << "Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexC), true) << "Carry flag wasn't set";
 
   gb_.reg_.d_ = 2;
   opcode_table->at(ADD_D).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexC], true) << "Carry flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], true) << "Zero flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexC), true) << "Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), true) << "Zero flag wasn't set";
 }
 
-TEST_F(GameBoyTest, SubRegXTable) {
+TEST_P(GameBoyTest, SubRegXTable) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -163,23 +165,23 @@ TEST_F(GameBoyTest, SubRegXTable) {
   gb_.reg_.b_ = 4;
   opcode_table->at(SUB_B).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 2);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], false) << "Zero flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexN], true) << "Negative flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexH], false) << "Half Carry flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexC], false) << "Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), false) << "Zero flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexN), true) << "Negative flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexH), false) << "Half Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexC), false) << "Carry flag wasn't set";
   gb_.reg_.a_ = 255;
   gb_.reg_.c_ = 255;
   opcode_table->at(SUB_C).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], true) << "Zero flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), true) << "Zero flag wasn't set";
   gb_.reg_.a_ = 10;
   gb_.reg_.d_ = 11;
   opcode_table->at(SUB_D).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0xFF);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexC], true) << "Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexC), true) << "Carry flag wasn't set";
 }
 
-TEST_F(GameBoyTest, IncAndDecRegXTable) {
+TEST_P(GameBoyTest, IncAndDecRegXTable) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -210,7 +212,7 @@ TEST_F(GameBoyTest, IncAndDecRegXTable) {
   EXPECT_EQ(gb_.reg_.bc_, 1);
 }
 
-TEST_F(GameBoyTest, OrRegXTable) {
+TEST_P(GameBoyTest, OrRegXTable) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -222,15 +224,15 @@ TEST_F(GameBoyTest, OrRegXTable) {
   opcode_table->at(OR_B).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0xFF)
       << "0b00001111 OR 0b11110000 does not equal: " << gb_.reg_.a_;
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], false);
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), false);
   gb_.reg_.a_ = 0b00000000;
   gb_.reg_.c_ = 0b00000000;
   opcode_table->at(OR_C).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], true);
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), true);
 }
 
-TEST_F(GameBoyTest, XorRegXTable) {
+TEST_P(GameBoyTest, XorRegXTable) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -242,16 +244,16 @@ TEST_F(GameBoyTest, XorRegXTable) {
   opcode_table->at(XOR_B).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0x0F)
       << "0b11111111 XOR 0b11110000 does not equal: " << gb_.reg_.a_;
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], false)
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), false)
       << " Zero flag was set when register a was " << gb_.reg_.a_;
   gb_.reg_.a_ = 0b00000000;
   gb_.reg_.c_ = 0b00000000;
   opcode_table->at(XOR_C).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], true);
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), true);
 }
 
-TEST_F(GameBoyTest, AndRegXTable) {
+TEST_P(GameBoyTest, AndRegXTable) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -262,18 +264,18 @@ TEST_F(GameBoyTest, AndRegXTable) {
   opcode_table->at(AND_B).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0xF0) << "0b11111111 AND 0b11110000 does not equal: "
                                << std::format("{:8b}", gb_.reg_.a_);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], false)
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), false)
       << " Zero flag was set when register a was " << gb_.reg_.a_;
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexH], true);
+  EXPECT_EQ(gb_.Flag(k_BitIndexH), true);
   gb_.reg_.a_ = 0b00000000;
   gb_.reg_.c_ = 0b00000000;
   opcode_table->at(AND_C).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], true);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexH], true);
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), true);
+  EXPECT_EQ(gb_.Flag(k_BitIndexH), true);
 }
 
-TEST_F(GameBoyTest, CompareRegXTable) {
+TEST_P(GameBoyTest, CompareRegXTable) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   const std::array<std::string, 8> k_Letter = {"B", "C", "D",  "E",
@@ -284,23 +286,23 @@ TEST_F(GameBoyTest, CompareRegXTable) {
   gb_.reg_.b_ = 4;
   opcode_table->at(SUB_B).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 2);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], false) << "Zero flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexN], true) << "Negative flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexH], false) << "Half Carry flag wasn't set";
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexC], false) << "Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), false) << "Zero flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexN), true) << "Negative flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexH), false) << "Half Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexC), false) << "Carry flag wasn't set";
   gb_.reg_.a_ = 255;
   gb_.reg_.c_ = 255;
   opcode_table->at(SUB_C).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexZ], true) << "Zero flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexZ), true) << "Zero flag wasn't set";
   gb_.reg_.a_ = 10;
   gb_.reg_.d_ = 11;
   opcode_table->at(SUB_D).execute_(&gb_);
   EXPECT_EQ(gb_.reg_.a_, 0xFF);
-  EXPECT_EQ(gb_.reg_.f_[k_BitIndexC], true) << "Carry flag wasn't set";
+  EXPECT_EQ(gb_.Flag(k_BitIndexC), true) << "Carry flag wasn't set";
 }
 
-TEST_F(GameBoyTest, Restart) {
+TEST_P(GameBoyTest, Restart) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   gb_.reg_.program_counter_ = 0x20;
@@ -311,11 +313,19 @@ TEST_F(GameBoyTest, Restart) {
   EXPECT_EQ(gb_.reg_.stack_pointer_, 0x40 - 2);
 
 }
-TEST_F(GameBoyTest, Bit) {
+TEST_P(GameBoyTest, Bit) {
   std::unique_ptr<std::array<Opcode, 512>> opcode_table;
   opcode_table = std::make_unique<std::array<Opcode, 512>>();
   uint16_t hl_value = 0;
   InitOpcodeTable(*opcode_table);
+  // H and L are the two halves of HL, so (HL) is tested first with HL
+  // pointing at work RAM since ROM can't be written to
+  gb_.reg_.hl_ = static_cast<uint16_t>(MemoryMap::k_WorkRamStart);
+  opcode_table->at(BIT_0__HL).execute_(&gb_);
+  EXPECT_EQ(gb_.Read(gb_.reg_.hl_), 1); 
+  opcode_table->at(RES_0__HL).execute_(&gb_);
+  EXPECT_EQ(gb_.Read(gb_.reg_.hl_), 0); 
+  gb_.reg_.hl_ = 0;
   opcode_table->at(BIT_0_A).execute_(&gb_);
   opcode_table->at(BIT_0_B).execute_(&gb_);
   opcode_table->at(BIT_0_C).execute_(&gb_);
@@ -323,9 +333,7 @@ TEST_F(GameBoyTest, Bit) {
   opcode_table->at(BIT_0_E).execute_(&gb_);
   opcode_table->at(BIT_0_H).execute_(&gb_);
   opcode_table->at(BIT_0_L).execute_(&gb_);
-  opcode_table->at(BIT_0__HL).execute_(&gb_);
   CheckRegisterValues(1);
-  EXPECT_EQ(gb_.memory_[gb_.reg_.hl_], 1); 
   opcode_table->at(RES_0_A).execute_(&gb_);
   opcode_table->at(RES_0_B).execute_(&gb_);
   opcode_table->at(RES_0_C).execute_(&gb_);
@@ -333,9 +341,133 @@ TEST_F(GameBoyTest, Bit) {
   opcode_table->at(RES_0_E).execute_(&gb_);
   opcode_table->at(RES_0_H).execute_(&gb_);
   opcode_table->at(RES_0_L).execute_(&gb_);
-  opcode_table->at(RES_0__HL).execute_(&gb_);
-  EXPECT_EQ(gb_.memory_[gb_.reg_.hl_], 0); 
   CheckRegisterValues(0);
   EXPECT_EQ(hl_value, 0);
-}  // namespace binary
-}  // namespace binary::gb
\ No newline at end of file
+}
+
+TEST_P(GameBoyTest, RegisterPairsAliasHalves) {
+  gb_.reg_.bc_ = 0x1234;
+  EXPECT_EQ(gb_.reg_.b_, 0x12);
+  EXPECT_EQ(gb_.reg_.c_, 0x34);
+  gb_.reg_.d_ = 0xAB;
+  gb_.reg_.e_ = 0xCD;
+  EXPECT_EQ(gb_.reg_.de_, 0xABCD);
+  gb_.reg_.l_ = 0xFF;
+  ++gb_.reg_.hl_;
+  EXPECT_EQ(gb_.reg_.h_, 1);
+  EXPECT_EQ(gb_.reg_.l_, 0);
+  gb_.reg_.a_ = 0x01;
+  gb_.reg_.SetFlag(k_BitIndexZ, true);
+  gb_.reg_.SetFlag(k_BitIndexC, true);
+  EXPECT_EQ(gb_.reg_.af_, 0x0190);
+  EXPECT_EQ(gb_.reg_.Flag(k_BitIndexN), false);
+}
+
+TEST_P(GameBoyTest, DispatchTableMatchesOpcodeTable) {
+  std::unique_ptr<std::array<Opcode, 512>> opcode_table;
+  opcode_table = std::make_unique<std::array<Opcode, 512>>();
+  InitOpcodeTable(*opcode_table);
+  for (size_t opcode = 0; opcode < opcode_table->size(); opcode++) {
+    if (!opcode_table->at(opcode).execute_) {
+      EXPECT_EQ(k_DispatchTable[opcode], instructionset::NoOperation)
+          << "Unimplemented opcode " << std::format("0x{:X}", opcode)
+          << " should fall through to NoOperation";
+      continue;
+    }
+    // Anything but a plain function pointer (a lambda ...) has no
+    // counterpart in k_DispatchTable
+    auto* execute = opcode_table->at(opcode).execute_.target<Execute>();
+    ASSERT_NE(execute, nullptr)
+        << "Opcode " << std::format("0x{:X}", opcode)
+        << " isn't a plain function in the opcode table";
+    EXPECT_EQ(*execute, k_DispatchTable[opcode])
+        << "k_DispatchTable[" << std::format("0x{:X}", opcode)
+        << "] doesn't point to the same handler as the opcode table";
+  }
+}
+
+// F is only worked out on demand in lazy mode, reading it after every step
+// would hide a flag that gets lost between two instructions. The pending
+// operation is put back after peeking at it
+namespace {
+uint8_t PeekFlags(GameBoy* gb) {
+  const LazyFlags k_Pending = gb->lazy_;
+  const uint8_t k_Flags = gb->reg_.f_;
+  gb->MaterializeFlags();
+  const uint8_t k_Resolved = gb->reg_.f_;
+  gb->lazy_ = k_Pending;
+  gb->reg_.f_ = k_Flags;
+  return k_Resolved;
+}
+}  // namespace
+
+TEST(GameBoyFlagModes, LazyAndEagerMatchAfterEveryStep) {
+  using namespace binary::gb::instructionset;
+  // Handlers are called straight through k_DispatchTable, CB prefixed ones
+  // included, so no operand bytes or program counter get in the way
+  const std::array<uint16_t, 27> k_Stream = {
+      ADD_B,  DAA,    ADC_C,  DAA,    SUB_D,  DAA,    SBC_E,
+      DAA,    RL_B,   RLC_C,  RR_D,   RRC_E,  SLA_H,  SRA_L,
+      SRL_B,  SWAP_A, CP_B,   CCF,    ADC_A,  SBC_A,  DAA,
+      RLA,    RRA,    RLCA,   RRCA,   SCF,    ADD_A};
+  const std::array<uint8_t, 8> k_Seeds = {0x00, 0x09, 0x0F, 0x45,
+                                          0x99, 0x9A, 0xF0, 0xFF};
+  for (const uint8_t k_Seed : k_Seeds) {
+    std::unique_ptr<GameBoy> lazy_gb = std::make_unique<GameBoy>();
+    std::unique_ptr<GameBoy> eager_gb = std::make_unique<GameBoy>();
+    lazy_gb->SetLazyFlags(true);
+    eager_gb->SetLazyFlags(false);
+    for (GameBoy* gb : {lazy_gb.get(), eager_gb.get()}) {
+      gb->reg_.a_ = k_Seed;
+      gb->reg_.b_ = k_Seed ^ 0x5A;
+      gb->reg_.c_ = k_Seed * 3;
+      gb->reg_.d_ = ~k_Seed;
+      gb->reg_.e_ = (k_Seed >> 1) | 0x80;
+      gb->reg_.h_ = k_Seed + 0x11;
+      gb->reg_.l_ = k_Seed ^ 0x81;
+      gb->SetFlags((k_Seed & 1) ? k_FlagC : 0);
+    }
+    // A few passes so the registers drift away from the seed
+    for (int pass = 0; pass < 4; pass++) {
+      for (const uint16_t k_Opcode : k_Stream) {
+        k_DispatchTable[k_Opcode](lazy_gb.get());
+        k_DispatchTable[k_Opcode](eager_gb.get());
+        ASSERT_EQ(PeekFlags(lazy_gb.get()), eager_gb->reg_.f_)
+            << "Seed " << std::format("0x{:02X}", k_Seed) << ", pass " << pass
+            << ", opcode " << std::format("0x{:03X}", k_Opcode);
+        ASSERT_EQ(lazy_gb->reg_.a_, eager_gb->reg_.a_);
+        ASSERT_EQ(lazy_gb->reg_.bc_, eager_gb->reg_.bc_);
+        ASSERT_EQ(lazy_gb->reg_.de_, eager_gb->reg_.de_);
+        ASSERT_EQ(lazy_gb->reg_.hl_, eager_gb->reg_.hl_);
+      }
+    }
+  }
+}
+
+TEST(GameBoyFlagModes, DecimalAdjust) {
+  GameBoy gb;
+  // 0x45 + 0x38 = 0x7D, 45 + 38 = 83
+  gb.reg_.a_ = 0x7D;
+  gb.SetFlags(0);
+  instructionset::DecimalAdjust(&gb);
+  EXPECT_EQ(gb.reg_.a_, 0x83);
+  EXPECT_EQ(gb.Flags(), 0);
+  // 0x99 + 0x01 = 0x9A, wraps around to 00 with a carry
+  gb.reg_.a_ = 0x9A;
+  gb.SetFlags(0);
+  instructionset::DecimalAdjust(&gb);
+  EXPECT_EQ(gb.reg_.a_, 0x00);
+  EXPECT_EQ(gb.Flags(), k_FlagZ | k_FlagC);
+  // 0x10 - 0x01 = 0x0F with a half borrow, 10 - 1 = 9
+  gb.reg_.a_ = 0x0F;
+  gb.SetFlags(k_FlagN | k_FlagH);
+  instructionset::DecimalAdjust(&gb);
+  EXPECT_EQ(gb.reg_.a_, 0x09);
+  EXPECT_EQ(gb.Flags(), k_FlagN);
+}
+
+INSTANTIATE_TEST_SUITE_P(FlagModes, GameBoyTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                           return info.param ? "Lazy" : "Eager";
+                         });
+}  // namespace binary::gb
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../../../src/emulation/gameboy/include/gb_emulator.h"
+namespace binary::gb {
+// Runs the table interpreter and the JIT side by side in small slices, the
+// state has to match after every slice
+class GameBoyJitTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<GameBoy> loop_gb_ = std::make_unique<GameBoy>();
+  std::unique_ptr<GameBoy> jit_gb_ = std::make_unique<GameBoy>();
+
+  void LoadCartridge(const std::vector<uint8_t>& program) {
+    for (GameBoy* gb : {loop_gb_.get(), jit_gb_.get()}) {
+      gb->bus_.LoadCartridge(program.data(), program.size());
+      gb->reg_.program_counter_ = 1;
+    }
+  }
+
+  // Odd slice sizes so blocks keep hitting the deadline halfway through
+  void RunLockstep(const uint64_t k_Slices, const uint64_t k_SliceCycles) {
+    for (uint64_t slice = 0; slice < k_Slices; slice++) {
+      EmulateLoop(loop_gb_.get(), k_SliceCycles);
+      EmulateJit(jit_gb_.get(), k_SliceCycles);
+      ExpectSameState();
+      if (HasFailure()) {
+        FAIL() << "Diverged in slice " << slice;
+      }
+    }
+  }
+
+  void ExpectSameState() {
+    loop_gb_->MaterializeFlags();
+    jit_gb_->MaterializeFlags();
+    EXPECT_EQ(loop_gb_->cycles_, jit_gb_->cycles_);
+    EXPECT_EQ(loop_gb_->instruction_, jit_gb_->instruction_);
+    EXPECT_EQ(loop_gb_->address_bus_, jit_gb_->address_bus_);
+    EXPECT_EQ(loop_gb_->reg_.program_counter_, jit_gb_->reg_.program_counter_);
+    EXPECT_EQ(loop_gb_->reg_.stack_pointer_, jit_gb_->reg_.stack_pointer_);
+    EXPECT_EQ(loop_gb_->reg_.af_, jit_gb_->reg_.af_);
+    EXPECT_EQ(loop_gb_->reg_.bc_, jit_gb_->reg_.bc_);
+    EXPECT_EQ(loop_gb_->reg_.de_, jit_gb_->reg_.de_);
+    EXPECT_EQ(loop_gb_->reg_.hl_, jit_gb_->reg_.hl_);
+    EXPECT_EQ(loop_gb_->cb_prefixed, jit_gb_->cb_prefixed);
+    EXPECT_EQ(loop_gb_->bus_.work_ram_, jit_gb_->bus_.work_ram_);
+    EXPECT_EQ(loop_gb_->bus_.high_ram_, jit_gb_->bus_.high_ram_);
+  }
+};
+
+TEST_F(GameBoyJitTest, RandomRegisterProgram) {
+  // Everything that only touches registers, the translated instructions and
+  // a few that stay calls (CP, RLCA, CB prefixed ops)
+  std::vector<uint8_t> pool = {0x00, 0x03, 0x07, 0x0B, 0x13, 0x1B, 0x23,
+                               0x2B, 0x33, 0x3B, 0xCB};
+  for (const uint8_t k_Register : {0, 1, 2, 3, 4, 5, 7}) {
+    pool.push_back(0x04 | (k_Register << 3));  // INC r
+    pool.push_back(0x05 | (k_Register << 3));  // DEC r
+    for (const uint8_t k_Source : {0, 1, 2, 3, 4, 5, 7}) {
+      pool.push_back(0x40 | (k_Register << 3) | k_Source);  // LD r,r'
+    }
+    for (uint8_t alu = 0; alu < 8; alu++) {
+      pool.push_back(0x80 | (alu << 3) | k_Register);  // ADD..CP A,r
+    }
+  }
+  std::mt19937 random(0x6B);
+  std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+  constexpr uint16_t k_ProgramSize = 0x3000;
+  std::uniform_int_distribution<uint16_t> target(0, k_ProgramSize - 1);
+  std::vector<uint8_t> program = {0x00};
+  while (program.size() < k_ProgramSize) {
+    program.push_back(pool[pick(random)]);
+    // Short blocks as well as ones cut off at k_MaxBlockLength
+    if (random() % 40 == 0) {
+      const uint16_t k_Target = target(random);
+      program.insert(program.end(),
+                     {0xC3, static_cast<uint8_t>(k_Target & 0xFF),
+                      static_cast<uint8_t>(k_Target >> 8)});
+    }
+  }
+  program.insert(program.end(), {0xC3, 0x00, 0x00, 0x00});
+  LoadCartridge(program);
+
+  RunLockstep(400, 997);
+  if constexpr (k_JitSupported) {
+    EXPECT_GT(jit_gb_->jit_.compiled_blocks_, 0);
+  }
+}
+
+TEST_F(GameBoyJitTest, SelfModifyingCode) {
+  // INC (HL) keeps rewriting the instruction after the NOP, the compiled
+  // block has to be dropped and the new code picked up
+  const std::vector<uint8_t> k_Program = {
+      0x00,              // NOP
+      0x04,              // INC B
+      0x80,              // ADD A,B
+      0x34,              // INC (HL)
+      0xA9,              // XOR C
+      0xC3, 0x00, 0xC0   // JP 0xC000
+  };
+  for (GameBoy* gb : {loop_gb_.get(), jit_gb_.get()}) {
+    for (size_t index = 0; index < k_Program.size(); index++) {
+      gb->Write(0xC000 + index, k_Program[index]);
+    }
+    gb->reg_.program_counter_ = 0xC001;
+    gb->reg_.hl_ = 0xC001;
+  }
+  RunLockstep(100, 61);
+  EXPECT_GT(jit_gb_->block_cache_.invalidations_, 0);
+}
+
+TEST_F(GameBoyJitTest, ConditionalBranchTiming) {
+  // JP NZ is taken three times out of four, taken it costs
+  // machine_cycles_branch_ instead of machine_cycles_
+  LoadCartridge({
+      0x00,              // NOP
+      0x3C,              // INC A
+      0xA0,              // AND B
+      0xC2, 0x00, 0x00,  // JP NZ 0x0000
+      0x0C,              // INC C
+      0xC3, 0x00, 0x00,  // JP 0x0000
+      0x00});
+  for (GameBoy* gb : {loop_gb_.get(), jit_gb_.get()}) {
+    gb->reg_.b_ = 0x03;
+  }
+  RunLockstep(200, 37);
+  EXPECT_GT(loop_gb_->reg_.c_, 0);
+  if constexpr (k_JitSupported) {
+    EXPECT_GT(jit_gb_->jit_.compiled_blocks_, 0);
+  }
+}
+
+TEST_F(GameBoyJitTest, DisabledMatchesCachedInterpreter) {
+  LoadCartridge({0x00, 0x3C, 0x04, 0x80, 0x91, 0xC3, 0x00, 0x00, 0x00});
+  jit_gb_->jit_.enabled_ = false;
+  RunLockstep(50, 101);
+  EXPECT_EQ(jit_gb_->jit_.compiled_blocks_, 0);
+}
+}  // namespace binary::gb
@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <random>
+#include "../../../src/emulation/gameboy/include/gb_emulator.h"
+namespace binary::gb {
+namespace {
+constexpr uint64_t k_FrameCycles = k_ScanlineCycles * k_LinesPerFrame;
+// Tile 1 row 0: low plane 0xF0, high plane 0xCC
+constexpr std::array<uint8_t, 8> k_TileRow = {3, 3, 1, 1, 2, 2, 0, 0};
+}  // namespace
+
+class GameBoyPpuTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<GameBoy> gb_ = std::make_unique<GameBoy>();
+
+  void SetUp() override {
+    // NOPs all the way, Fetch() adds one cycle per instruction
+    gb_->reg_.program_counter_ = 1;
+    gb_->Write(0x8010, 0xF0);
+    gb_->Write(0x8011, 0xCC);
+    // Darkest shade for the highest index, same as the boot ROM sets
+    gb_->Write(static_cast<uint16_t>(HardwareRegistersName::k_Bgp), 0xE4);
+    gb_->Write(static_cast<uint16_t>(HardwareRegistersName::k_Obp0), 0xE4);
+  }
+
+  uint8_t Io(const HardwareRegistersName k_Register) {
+    return gb_->Read(static_cast<uint16_t>(k_Register));
+  }
+
+  void SetIo(const HardwareRegistersName k_Register, const uint8_t k_Value) {
+    gb_->Write(static_cast<uint16_t>(k_Register), k_Value);
+  }
+
+  // Index into k_ShadeColors of a pixel of the expanded framebuffer
+  int Shade(const size_t k_X, const size_t k_Y) {
+    gb_->ppu_.ExpandFramebuffer(framebuffer_);
+    const uint8_t* k_Pixel =
+        framebuffer_.data() + (k_Y * k_ScreenWidth + k_X) * 4;
+    for (size_t shade = 0; shade < k_ShadeColors.size(); shade++) {
+      if (std::memcmp(k_Pixel, k_ShadeColors[shade].data(), 4) == 0) {
+        return static_cast<int>(shade);
+      }
+    }
+    return -1;
+  }
+
+  std::array<uint8_t, k_FramebufferSize> framebuffer_{};
+};
+
+TEST_F(GameBoyPpuTest, DecodeTileRowsMatchesBitPlanes) {
+  std::mt19937 random(11);
+  std::array<uint8_t, 22> low{};
+  std::array<uint8_t, 22> high{};
+  for (size_t tile = 0; tile < low.size(); tile++) {
+    low[tile] = static_cast<uint8_t>(random());
+    high[tile] = static_cast<uint8_t>(random());
+  }
+  std::array<uint8_t, 22 * 8> output{};
+  DecodeTileRows(low.data(), high.data(), low.size(), output.data());
+  for (size_t tile = 0; tile < low.size(); tile++) {
+    for (size_t pixel = 0; pixel < 8; pixel++) {
+      const uint8_t k_Expected = ((low[tile] >> (7 - pixel)) & 1) |
+                                 (((high[tile] >> (7 - pixel)) & 1) << 1);
+      ASSERT_EQ(output[tile * 8 + pixel], k_Expected)
+          << "tile " << tile << " pixel " << pixel;
+    }
+  }
+}
+
+TEST_F(GameBoyPpuTest, ModesFollowTheScanline) {
+  EXPECT_EQ(gb_->scheduler_.NextEvent(), k_NoEvent);
+  SetIo(HardwareRegistersName::k_Lcdc, k_LcdcEnable);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Stat) & 0x03, 2);
+
+  EmulateFor(gb_.get(), k_OamScanCycles);
+  EXPECT_EQ(gb_->ppu_.mode_, PpuMode::k_Drawing);
+  EmulateFor(gb_.get(), k_DrawingCycles);
+  EXPECT_EQ(gb_->ppu_.mode_, PpuMode::k_HBlank);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Ly), 0);
+  EmulateFor(gb_.get(), k_HBlankCycles);
+  EXPECT_EQ(gb_->ppu_.mode_, PpuMode::k_OamScan);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Ly), 1);
+
+  // LY is read only
+  SetIo(HardwareRegistersName::k_Ly, 100);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Ly), 1);
+
+  // Turning the LCD off stops everything at line 0
+  SetIo(HardwareRegistersName::k_Lcdc, 0);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Ly), 0);
+  EXPECT_FALSE(gb_->scheduler_.Pending(EventType::k_PpuMode));
+}
+
+TEST_F(GameBoyPpuTest, VBlankOncePerFrame) {
+  SetIo(HardwareRegistersName::k_Lcdc, k_LcdcEnable);
+  EmulateFor(gb_.get(), k_ScanlineCycles * k_VBlankLine - 1);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Ly), k_VBlankLine - 1);
+  EXPECT_EQ(Io(HardwareRegistersName::k_If) & k_InterruptVBlank, 0);
+
+  EmulateFor(gb_.get(), 1);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Ly), k_VBlankLine);
+  EXPECT_EQ(gb_->ppu_.mode_, PpuMode::k_VBlank);
+  EXPECT_NE(Io(HardwareRegistersName::k_If) & k_InterruptVBlank, 0);
+  EXPECT_EQ(gb_->ppu_.frames_, 1);
+
+  EmulateFor(gb_.get(), k_ScanlineCycles * (k_LinesPerFrame - k_VBlankLine));
+  EXPECT_EQ(Io(HardwareRegistersName::k_Ly), 0);
+  EXPECT_EQ(gb_->ppu_.mode_, PpuMode::k_OamScan);
+
+  EmulateFor(gb_.get(), k_FrameCycles * 9);
+  EXPECT_EQ(gb_->ppu_.frames_, 10);
+}
+
+TEST_F(GameBoyPpuTest, LycRequestsStatInterrupt) {
+  SetIo(HardwareRegistersName::k_Lyc, 5);
+  SetIo(HardwareRegistersName::k_Stat, 0x40);
+  SetIo(HardwareRegistersName::k_Lcdc, k_LcdcEnable);
+  EmulateFor(gb_.get(), k_ScanlineCycles * 5 - 1);
+  EXPECT_EQ(Io(HardwareRegistersName::k_If) & k_InterruptStat, 0);
+  EXPECT_EQ(Io(HardwareRegistersName::k_Stat) & 0x04, 0);
+
+  EmulateFor(gb_.get(), 1);
+  EXPECT_NE(Io(HardwareRegistersName::k_If) & k_InterruptStat, 0);
+  EXPECT_NE(Io(HardwareRegistersName::k_Stat) & 0x04, 0);
+}
+
+TEST_F(GameBoyPpuTest, RendersBackgroundTiles) {
+  gb_->Write(0x9800, 1);
+  SetIo(HardwareRegistersName::k_Lcdc,
+        k_LcdcEnable | k_LcdcTileData | k_LcdcBackgroundEnable);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  for (size_t pixel = 0; pixel < k_TileRow.size(); pixel++) {
+    EXPECT_EQ(Shade(pixel, 0), k_TileRow[pixel]) << "pixel " << pixel;
+  }
+  // Tile 0 is empty, so is row 1 of tile 1
+  EXPECT_EQ(Shade(8, 0), 0);
+  EXPECT_EQ(Shade(0, 1), 0);
+
+  // SCX scrolls left by pixels, the map wraps around
+  SetIo(HardwareRegistersName::k_Scx, 254);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  EXPECT_EQ(Shade(0, 0), 0);
+  EXPECT_EQ(Shade(2, 0), 3);
+  EXPECT_EQ(Shade(4, 0), 1);
+
+  // The palette maps every index
+  SetIo(HardwareRegistersName::k_Bgp, 0x1B);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  EXPECT_EQ(Shade(0, 0), 3);
+  EXPECT_EQ(Shade(2, 0), 0);
+}
+
+TEST_F(GameBoyPpuTest, WindowCoversBackground) {
+  gb_->Write(0x9C00, 1);
+  SetIo(HardwareRegistersName::k_Wy, 0);
+  SetIo(HardwareRegistersName::k_Wx, 80 + 7);
+  SetIo(HardwareRegistersName::k_Lcdc,
+        k_LcdcEnable | k_LcdcWindowMap | k_LcdcWindowEnable | k_LcdcTileData |
+            k_LcdcBackgroundEnable);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  EXPECT_EQ(Shade(0, 0), 0);
+  for (size_t pixel = 0; pixel < k_TileRow.size(); pixel++) {
+    EXPECT_EQ(Shade(80 + pixel, 0), k_TileRow[pixel]) << "pixel " << pixel;
+  }
+  EXPECT_EQ(gb_->ppu_.window_line_, 0);
+}
+
+TEST_F(GameBoyPpuTest, SpritesDrawnThroughOamDma) {
+  // One sprite at the top left corner plus 4 pixels, flipped horizontally
+  const std::array<uint8_t, 8> k_Sprites = {16, 8 + 4, 1, 0x20,
+                                            16, 8 + 40, 1, 0x80};
+  for (size_t index = 0; index < k_Sprites.size(); index++) {
+    gb_->Write(0xC000 + index, k_Sprites[index]);
+  }
+  SetIo(HardwareRegistersName::k_Dma, 0xC0);
+  EXPECT_EQ(gb_->bus_.oam_[1], 8 + 4);
+
+  SetIo(HardwareRegistersName::k_Lcdc, k_LcdcEnable | k_LcdcTileData |
+                                           k_LcdcObjectEnable |
+                                           k_LcdcBackgroundEnable);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  for (size_t pixel = 0; pixel < k_TileRow.size(); pixel++) {
+    EXPECT_EQ(Shade(4 + pixel, 0), k_TileRow[7 - pixel]) << "pixel " << pixel;
+  }
+  // Behind the background only shows through colour index 0, which the
+  // empty background tile is
+  EXPECT_EQ(Shade(40, 0), 3);
+
+  // Put the background tile under the second sprite, it disappears
+  gb_->Write(0x9805, 1);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  for (size_t pixel = 0; pixel < k_TileRow.size(); pixel++) {
+    EXPECT_EQ(Shade(40 + pixel, 0), k_TileRow[pixel]) << "pixel " << pixel;
+  }
+}
+
+TEST_F(GameBoyPpuTest, IndexedFramebufferMatchesColors) {
+  gb_->Write(0x9800, 1);
+  gb_->Write(0x9821, 1);
+  SetIo(HardwareRegistersName::k_Bgp, 0x1B);
+  SetIo(HardwareRegistersName::k_Lcdc,
+        k_LcdcEnable | k_LcdcTileData | k_LcdcBackgroundEnable);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  gb_->ppu_.ExpandFramebuffer(framebuffer_);
+  for (size_t pixel = 0; pixel < k_IndexedFramebufferSize; pixel++) {
+    const uint8_t k_Shade = gb_->ppu_.indexed_framebuffer_[pixel];
+    ASSERT_LT(k_Shade, k_ShadeColors.size()) << "pixel " << pixel;
+    ASSERT_EQ(std::memcmp(framebuffer_.data() + pixel * 4,
+                          k_ShadeColors[k_Shade].data(), 4),
+              0)
+        << "pixel " << pixel;
+  }
+}
+
+TEST_F(GameBoyPpuTest, TileCacheFollowsVramWrites) {
+  gb_->Write(0x9800, 1);
+  SetIo(HardwareRegistersName::k_Lcdc,
+        k_LcdcEnable | k_LcdcTileData | k_LcdcBackgroundEnable);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  for (const uint64_t k_Word : gb_->ppu_.dirty_tiles_) {
+    EXPECT_EQ(k_Word, 0);
+  }
+  for (size_t pixel = 0; pixel < k_TileRow.size(); pixel++) {
+    EXPECT_EQ(gb_->ppu_.tiles_[k_TilePixels + pixel], k_TileRow[pixel]);
+  }
+
+  // Only the tile written to is marked, the map isn't tile data
+  gb_->Write(0x8011, 0x00);
+  gb_->Write(0x9801, 1);
+  EXPECT_EQ(gb_->ppu_.dirty_tiles_[0], 0b10);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  EXPECT_EQ(gb_->ppu_.dirty_tiles_[0], 0);
+  EXPECT_EQ(Shade(0, 0), 1);
+  EXPECT_EQ(Shade(4, 0), 0);
+  EXPECT_EQ(Shade(8, 0), 1);
+
+  // 0x8800 addressing, tile 0x80 is the first one past 0x8800 and index 0
+  // is the tile at 0x9000
+  gb_->Write(0x8800, 0xFF);
+  gb_->Write(0x9800, 0x80);
+  gb_->Write(0x9801, 0x00);
+  EXPECT_EQ(gb_->ppu_.dirty_tiles_[2], 1);
+  SetIo(HardwareRegistersName::k_Lcdc, k_LcdcEnable | k_LcdcBackgroundEnable);
+  EmulateFor(gb_.get(), k_FrameCycles);
+  EXPECT_EQ(Shade(0, 0), 1);
+  EXPECT_EQ(Shade(8, 0), 0);
+}
+}  // namespace binary::gb
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "../../../src/emulation/gameboy/include/gb_emulator.h"
+namespace binary::gb {
+namespace {
+// Handlers are plain function pointers, they log here
+std::vector<std::pair<EventType, uint64_t>> g_dispatched;
+
+void LogApu(GameBoy* gb, const uint64_t k_Late) {
+  g_dispatched.emplace_back(EventType::k_ApuFrameSequencer,
+                            gb->cycles_ - k_Late);
+}
+void LogPpu(GameBoy* gb, const uint64_t k_Late) {
+  g_dispatched.emplace_back(EventType::k_PpuMode, gb->cycles_ - k_Late);
+}
+void RequestVBlank(GameBoy* gb, const uint64_t k_Late) {
+  g_dispatched.emplace_back(EventType::k_PpuMode, gb->cycles_ - k_Late);
+  gb->RequestInterrupt(k_InterruptVBlank);
+}
+// Repeats every 456 cycles like a scanline
+void Scanline(GameBoy* gb, const uint64_t k_Late) {
+  g_dispatched.emplace_back(EventType::k_PpuMode, gb->cycles_);
+  gb->scheduler_.Schedule(EventType::k_PpuMode, gb->cycles_ - k_Late + 456);
+}
+}  // namespace
+
+class GameBoySchedulerTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<GameBoy> gb_ = std::make_unique<GameBoy>();
+
+  void SetUp() override {
+    g_dispatched.clear();
+    // NOPs all the way, Fetch() adds one cycle per instruction
+    gb_->reg_.program_counter_ = 1;
+  }
+};
+
+TEST_F(GameBoySchedulerTest, EventsRunInTimestampOrder) {
+  Scheduler& scheduler = gb_->scheduler_;
+  scheduler.SetHandler(EventType::k_ApuFrameSequencer, LogApu);
+  scheduler.SetHandler(EventType::k_PpuMode, LogPpu);
+  scheduler.Schedule(EventType::k_PpuMode, 30);
+  scheduler.Schedule(EventType::k_ApuFrameSequencer, 50);
+  EXPECT_EQ(scheduler.NextEvent(), 30);
+
+  // Moving the earliest event back makes the other one first
+  scheduler.Schedule(EventType::k_PpuMode, 70);
+  EXPECT_EQ(scheduler.NextEvent(), 50);
+
+  EmulateFor(gb_.get(), 100);
+  ASSERT_EQ(g_dispatched.size(), 2);
+  EXPECT_EQ(g_dispatched[0], std::make_pair(EventType::k_ApuFrameSequencer,
+                                            uint64_t{50}));
+  EXPECT_EQ(g_dispatched[1], std::make_pair(EventType::k_PpuMode,
+                                            uint64_t{70}));
+  EXPECT_EQ(gb_->cycles_, 100);
+  EXPECT_EQ(scheduler.NextEvent(), k_NoEvent);
+}
+
+TEST_F(GameBoySchedulerTest, CpuStopsAtTheDeadline) {
+  Scheduler& scheduler = gb_->scheduler_;
+  scheduler.SetHandler(EventType::k_PpuMode, Scanline);
+  scheduler.Schedule(EventType::k_PpuMode, 456);
+
+  EmulateFor(gb_.get(), 456 * 10);
+  ASSERT_EQ(g_dispatched.size(), 10);
+  for (size_t index = 0; index < g_dispatched.size(); index++) {
+    // Dispatched on the exact cycle, not at the end of the slice
+    EXPECT_EQ(g_dispatched[index].second, 456 * (index + 1));
+  }
+  EXPECT_EQ(scheduler.Timestamp(EventType::k_PpuMode), 456 * 11);
+}
+
+TEST_F(GameBoySchedulerTest, CancelledEventsDontRun) {
+  Scheduler& scheduler = gb_->scheduler_;
+  scheduler.SetHandler(EventType::k_ApuFrameSequencer, LogApu);
+  scheduler.SetHandler(EventType::k_PpuMode, LogPpu);
+  scheduler.Schedule(EventType::k_ApuFrameSequencer, 10);
+  scheduler.Schedule(EventType::k_PpuMode, 20);
+  scheduler.Cancel(EventType::k_ApuFrameSequencer);
+  EXPECT_FALSE(scheduler.Pending(EventType::k_ApuFrameSequencer));
+  EXPECT_EQ(scheduler.NextEvent(), 20);
+
+  EmulateFor(gb_.get(), 100);
+  ASSERT_EQ(g_dispatched.size(), 1);
+  EXPECT_EQ(g_dispatched[0].first, EventType::k_PpuMode);
+  EXPECT_EQ(scheduler.dispatched_, 1);
+}
+
+TEST_F(GameBoySchedulerTest, SameCycleEventsRunInTypeOrder) {
+  Scheduler& scheduler = gb_->scheduler_;
+  scheduler.SetHandler(EventType::k_ApuFrameSequencer, LogApu);
+  scheduler.SetHandler(EventType::k_PpuMode, LogPpu);
+  scheduler.Schedule(EventType::k_ApuFrameSequencer, 40);
+  scheduler.Schedule(EventType::k_PpuMode, 40);
+
+  EmulateFor(gb_.get(), 100);
+  ASSERT_EQ(g_dispatched.size(), 2);
+  EXPECT_EQ(g_dispatched[0].first, EventType::k_PpuMode);
+  EXPECT_EQ(g_dispatched[1].first, EventType::k_ApuFrameSequencer);
+}
+
+TEST_F(GameBoySchedulerTest, HaltSkipsToTheNextEvent) {
+  const std::array<uint8_t, 6> k_Program = {
+      0x00,              // NOP
+      0x3C,              // INC A
+      0x76,              // HALT
+      0x04,              // INC B
+      0x00,              // NOP
+      0x00};
+  gb_->bus_.LoadCartridge(k_Program.data(), k_Program.size());
+  gb_->bus_.interrupt_enable_ = k_InterruptVBlank;
+  gb_->scheduler_.SetHandler(EventType::k_PpuMode, RequestVBlank);
+  gb_->scheduler_.Schedule(EventType::k_PpuMode, 70'000);
+
+  EmulateFor(gb_.get(), 69'999);
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Halted);
+  EXPECT_EQ(gb_->cycles_, 69'999);
+  EXPECT_EQ(gb_->reg_.a_, 1);
+  EXPECT_EQ(gb_->reg_.b_, 0);
+
+  // The VBlank request wakes the CPU up right at the event
+  EmulateFor(gb_.get(), 1);
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Running);
+  EmulateFor(gb_.get(), 1);
+  EXPECT_EQ(gb_->reg_.b_, 1);
+  EXPECT_EQ(gb_->reg_.a_, 1);
+}
+
+TEST_F(GameBoySchedulerTest, HaltWithPendingInterruptDoesntSleep) {
+  gb_->bus_.interrupt_enable_ = k_InterruptTimer;
+  gb_->RequestInterrupt(k_InterruptTimer);
+  instructionset::Halt(gb_.get());
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Running);
+
+  // Requested but not enabled doesn't count
+  gb_->bus_.interrupt_enable_ = k_InterruptVBlank;
+  instructionset::Halt(gb_.get());
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Halted);
+  gb_->RequestInterrupt(k_InterruptSerial);
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Halted);
+  gb_->RequestInterrupt(k_InterruptVBlank);
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Running);
+}
+
+TEST_F(GameBoySchedulerTest, StopOnlyWakesForTheJoypad) {
+  gb_->bus_.interrupt_enable_ = k_InterruptMask;
+  instructionset::Stop(gb_.get());
+  gb_->RequestInterrupt(k_InterruptVBlank);
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Stopped);
+  EmulateFor(gb_.get(), 1'000);
+  EXPECT_EQ(gb_->reg_.program_counter_, 1);
+  EXPECT_EQ(gb_->cycles_, 1'000);
+  gb_->RequestInterrupt(k_InterruptJoypad);
+  EXPECT_EQ(gb_->mode_, CpuMode::k_Running);
+}
+}  // namespace binary::gb
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../../src/main/include/frame_pacer.h"
+#include "../test_benchmark.h"
+namespace binary {
+namespace {
+using namespace std::chrono_literals;
+using Clock = FramePacer::Clock;
+constexpr double k_FrameRate = 240.0;
+constexpr Clock::duration k_Period =
+    std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / k_FrameRate));
+constexpr size_t k_Frames = 240;
+}  // namespace
+
+TEST(FramePacer, NeverReturnsEarly) {
+  // No later than the pacer's own first deadline
+  Clock::time_point deadline = Clock::now();
+  FramePacer pacer(k_FrameRate);
+  pacer.Wait();
+  for (size_t frame = 0; frame < k_Frames; frame++) {
+    deadline += k_Period;
+    pacer.Wait();
+    const Clock::time_point k_Now = Clock::now();
+    ASSERT_GE(k_Now, deadline) << "frame " << frame;
+    // On a loaded machine a frame can still come late, the next ones are
+    // paced from there
+    deadline = std::max(deadline, k_Now - k_Period);
+  }
+}
+
+TEST(FramePacer, LateFrameMovesTheDeadlines) {
+  FramePacer pacer(k_FrameRate);
+  pacer.Wait();
+  std::this_thread::sleep_for(50ms);
+  // Behind by several periods, the next frame is due right away but the one
+  // after it a whole period later instead of immediately
+  pacer.Wait();
+  const Clock::time_point k_Start = Clock::now();
+  pacer.Wait();
+  EXPECT_GE(Clock::now() - k_Start, 3ms);
+}
+
+TEST(FramePacer, SpinMarginStaysWithinAPeriod) {
+  FramePacer pacer(k_FrameRate);
+  for (size_t frame = 0; frame < 30; frame++) {
+    pacer.Wait();
+    EXPECT_GT(pacer.SpinMargin(), Clock::duration::zero());
+    EXPECT_LE(pacer.SpinMargin(), k_Period);
+  }
+}
+
+// How late Wait() returns past each deadline, what pacing adds on top of the
+// frame itself, see test_benchmark.h
+TEST(FramePacer, DISABLED_WakeUpLateness) {
+  std::vector<double> late_ms;
+  late_ms.reserve(k_Frames);
+  Clock::time_point deadline = Clock::now();
+  FramePacer pacer(k_FrameRate);
+  pacer.Wait();
+  for (size_t frame = 0; frame < k_Frames; frame++) {
+    deadline += k_Period;
+    pacer.Wait();
+    const Clock::time_point k_Now = Clock::now();
+    late_ms.push_back(
+        std::chrono::duration<double, std::milli>(k_Now - deadline).count());
+    deadline = std::max(deadline, k_Now - k_Period);
+  }
+  PrintBenchmark("FramePacer::Wait late", std::move(late_ms));
+}
+}  // namespace binary
@@ -0,0 +1,30 @@
+// File: test_benchmark.h
+// Shared by the tests that time something. None of them pass or fail on
+// speed, they print the numbers. They're all DISABLED_ so the default run
+// stays quick, run them with:
+//   Binary_Test --gtest_also_run_disabled_tests --gtest_filter=*DISABLED_*
+#pragma once
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <string_view>
+#include <vector>
+namespace binary {
+// Prints the mean, median and 99th percentile of samples_ms
+inline void PrintBenchmark(std::string_view name,
+                           std::vector<double> samples_ms) {
+  if (samples_ms.empty()) {
+    return;
+  }
+  std::sort(samples_ms.begin(), samples_ms.end());
+  double total = 0.0;
+  for (const double k_Ms : samples_ms) {
+    total += k_Ms;
+  }
+  std::cout << std::format(
+      "[ BENCHMARK] {:<24} mean {:>7.3f} ms  p50 {:>7.3f} ms  p99 {:>7.3f} "
+      "ms\n",
+      name, total / samples_ms.size(), samples_ms[samples_ms.size() / 2],
+      samples_ms[samples_ms.size() * 99 / 100]);
+}
+}  // namespace binary
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <thread>
+#include "../../src/types/include/triple_buffer.h"
+namespace binary {
+TEST(TripleBuffer, ConsumerGetsTheNewestFrame) {
+  TripleBuffer<uint32_t> frames;
+  EXPECT_FALSE(frames.Acquire());
+  frames.Back() = 1;
+  frames.Publish();
+  frames.Back() = 2;
+  frames.Publish();
+  // Frame 1 was overwritten before anyone looked at it
+  ASSERT_TRUE(frames.Acquire());
+  EXPECT_EQ(frames.Front(), 2);
+  EXPECT_FALSE(frames.Acquire());
+  EXPECT_EQ(frames.Front(), 2);
+
+  frames.Back() = 3;
+  frames.Publish();
+  ASSERT_TRUE(frames.Acquire());
+  EXPECT_EQ(frames.Front(), 3);
+}
+
+TEST(TripleBuffer, FramesNeverTearAcrossThreads) {
+  // Every word of a frame holds the frame number, a torn read mixes two
+  struct Frame {
+    std::array<uint32_t, 256> words;
+  };
+  constexpr uint32_t k_Frames = 20'000;
+  TripleBuffer<Frame> frames;
+  std::thread producer([&frames] {
+    for (uint32_t frame = 1; frame <= k_Frames; frame++) {
+      frames.Back().words.fill(frame);
+      frames.Publish();
+    }
+  });
+  uint32_t last = 0;
+  bool torn = false;
+  bool backwards = false;
+  while (last < k_Frames) {
+    if (!frames.Acquire()) {
+      std::this_thread::yield();
+      continue;
+    }
+    const Frame& k_Frame = frames.Front();
+    for (const uint32_t k_Word : k_Frame.words) {
+      torn |= k_Word != k_Frame.words[0];
+    }
+    backwards |= k_Frame.words[0] <= last;
+    last = k_Frame.words[0];
+  }
+  producer.join();
+  EXPECT_FALSE(torn);
+  EXPECT_FALSE(backwards);
+}
+}  // namespace binary